@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "device_interfaces.h"
+
+// Real elapsed time plus the latency that the fake network has simulated so far.
+class HostClock : public Clock
+{
+public:
+  uint32_t micros() override
+  {
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + simulatedMicros);
+  }
+
+  void yield() override {}
+
+  void advance(uint64_t micros) { simulatedMicros += micros; }
+  uint64_t getSimulatedMicros() const { return simulatedMicros; }
+
+private:
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t simulatedMicros = 0;
+};
+
+// Replays a recorded HTTP response in chunks of a fixed size, charging a fixed latency per chunk.
+class ReplayNetworkClient : public NetworkClient
+{
+public:
+  ReplayNetworkClient(HostClock &clock, size_t chunkBytes, uint32_t chunkLatencyMicros)
+      : clock(clock), chunkBytes(chunkBytes), chunkLatencyMicros(chunkLatencyMicros) {}
+
+  void setResponse(const std::vector<uint8_t> &data)
+  {
+    response = &data;
+    position = 0;
+    chunkRemaining = 0;
+  }
+
+  bool connect(const char *, uint16_t) override
+  {
+    isConnected = response != nullptr;
+    request.clear();
+    return isConnected;
+  }
+
+  size_t write(const uint8_t *data, size_t length) override
+  {
+    request.append(reinterpret_cast<const char *>(data), length);
+    return length;
+  }
+
+  int available() override
+  {
+    if (!isConnected || position == response->size())
+    {
+      return 0;
+    }
+
+    if (chunkRemaining == 0)
+    { // the next segment arrives
+      clock.advance(chunkLatencyMicros);
+      chunkRemaining = std::min(chunkBytes, response->size() - position);
+    }
+
+    return static_cast<int>(chunkRemaining);
+  }
+
+  int read(uint8_t *data, size_t length) override
+  {
+    const size_t count = std::min(length, static_cast<size_t>(available()));
+    memcpy(data, response->data() + position, count);
+    position += count;
+    chunkRemaining -= count;
+    return static_cast<int>(count);
+  }
+
+  bool connected() override { return isConnected && position < response->size(); }
+  void stop() override { isConnected = false; }
+
+  const std::string &getRequest() const { return request; }
+
+private:
+  HostClock &clock;
+  const size_t chunkBytes;
+  const uint32_t chunkLatencyMicros;
+  const std::vector<uint8_t> *response = nullptr;
+  size_t position = 0;
+  size_t chunkRemaining = 0;
+  bool isConnected = false;
+  std::string request;
+};
+
+// Copies bands into a full-frame buffer, standing in for the panel controller memory.
+class MemoryFrameDisplay : public FrameDisplay
+{
+public:
+  MemoryFrameDisplay(uint16_t width, uint16_t height)
+      : rowBytes(width / 8), black(rowBytes * height), red(rowBytes * height) {}
+
+  void beginFrame() override { bandCount = 0; }
+
+  void writeBand(const FrameBand &band) override
+  {
+    const auto writeStart = std::chrono::steady_clock::now();
+    const size_t length = static_cast<size_t>(band.rows) * rowBytes;
+    memcpy(black.data() + band.y * rowBytes, band.black, length);
+    if (band.red != nullptr)
+    { // black and white panels have no red plane
+      memcpy(red.data() + band.y * rowBytes, band.red, length);
+    }
+    ++bandCount;
+    writeMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writeStart).count();
+  }
+
+  size_t getBandCount() const { return bandCount; }
+  uint64_t getWriteMicros() const { return writeMicros; }
+  const std::vector<uint8_t> &getBlack() const { return black; }
+  const std::vector<uint8_t> &getRed() const { return red; }
+
+private:
+  const size_t rowBytes;
+  std::vector<uint8_t> black;
+  std::vector<uint8_t> red;
+  size_t bandCount = 0;
+  uint64_t writeMicros = 0;
+};
+
+class MemorySettingsStore : public SettingsStore
+{
+public:
+  std::string getString(const char *key, const char *defaultValue) override
+  {
+    const auto value = values.find(key);
+    return value != values.end() ? value->second : defaultValue;
+  }
+
+  int32_t getInt(const char *key, int32_t defaultValue) override
+  {
+    const auto value = values.find(key);
+    return value != values.end() ? std::stoi(value->second) : defaultValue;
+  }
+
+  uint64_t getULong64(const char *key, uint64_t defaultValue) override
+  {
+    const auto value = values.find(key);
+    return value != values.end() ? std::stoull(value->second) : defaultValue;
+  }
+
+  void putString(const char *key, const std::string &value) override { values[key] = value; }
+  void putInt(const char *key, int32_t value) override { values[key] = std::to_string(value); }
+  void putULong64(const char *key, uint64_t value) override { values[key] = std::to_string(value); }
+  void clear() override { values.clear(); }
+
+private:
+  std::map<std::string, std::string> values;
+};
+
+// Flash file system emulation: files live in memory, writes go to a temporary buffer until commit,
+// and reads are charged a fixed latency per kilobyte. Counts committed files and written bytes to show flash wear.
+class MemoryFrameStorage : public FrameStorage
+{
+public:
+  MemoryFrameStorage(HostClock &clock, uint32_t readMicrosPerKilobyte)
+      : clock(clock), readMicrosPerKilobyte(readMicrosPerKilobyte) {}
+
+  bool openRead(const char *path) override
+  {
+    close();
+    const auto file = files.find(path);
+    if (file == files.end())
+    {
+      return false;
+    }
+
+    readFile = &file->second;
+    readPosition = 0;
+    return true;
+  }
+
+  size_t read(uint8_t *data, size_t length) override
+  {
+    if (readFile == nullptr)
+    {
+      return 0;
+    }
+
+    const size_t count = std::min(length, readFile->size() - readPosition);
+    memcpy(data, readFile->data() + readPosition, count);
+    readPosition += count;
+    clock.advance(count * readMicrosPerKilobyte / 1024);
+    return count;
+  }
+
+  bool openWrite(const char *path) override
+  {
+    close();
+    writePath = path;
+    writeBuffer.clear();
+    isWriting = true;
+    return true;
+  }
+
+  bool write(const uint8_t *data, size_t length) override
+  {
+    if (!isWriting)
+    {
+      return false;
+    }
+
+    writeBuffer.insert(writeBuffer.end(), data, data + length);
+    bytesWritten += length;
+    return true;
+  }
+
+  bool commit() override
+  {
+    if (!isWriting)
+    {
+      return false;
+    }
+
+    files[writePath].swap(writeBuffer);
+    isWriting = false;
+    ++commitCount;
+    return true;
+  }
+
+  void close() override
+  {
+    readFile = nullptr;
+    isWriting = false;
+  }
+
+  size_t getCommitCount() const { return commitCount; }
+  uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+  HostClock &clock;
+  const uint32_t readMicrosPerKilobyte;
+  std::map<std::string, std::vector<uint8_t>> files;
+  const std::vector<uint8_t> *readFile = nullptr;
+  size_t readPosition = 0;
+  std::string writePath;
+  std::vector<uint8_t> writeBuffer;
+  bool isWriting = false;
+  size_t commitCount = 0;
+  uint64_t bytesWritten = 0;
+};
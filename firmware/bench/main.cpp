@@ -0,0 +1,375 @@
+// Replays recorded server responses through the firmware fetch path on the host and reports where the time goes.
+//
+// Record a response with e.g.
+//   curl -si -H "X-Api-Key: <key>" "http://<server>/api/render/binary?width=800&height=480&encoding=rle,planar&bandHeight=160" > frame.http
+// and run
+//   pio run -e native && .pio/build/native/program frame.http --chunk 1460 --latency 300 --iterations 20
+// With --from-flash, the frame is stored in an emulated flash first and every iteration draws it from there
+// after a 304 response naming it; the network column then holds the flash read time.
+// With --compare-encodings, the same generated frame is replayed once interleaved and once planar instead.
+
+#include <atomic>
+#include <fstream>
+#include <random>
+#include <iterator>
+#include <new>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "dashboard_client.h"
+#include "fakes.h"
+
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> allocationBytes{0};
+static bool isVerbose = false;
+
+void *operator new(size_t size)
+{
+  ++allocationCount;
+  allocationBytes += size;
+  if (void *memory = malloc(size))
+  {
+    return memory;
+  }
+
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+void deviceLog(const char *format, ...)
+{
+  if (!isVerbose)
+  {
+    return;
+  }
+
+  va_list arguments;
+  va_start(arguments, format);
+  vprintf(format, arguments);
+  va_end(arguments);
+}
+
+struct Options
+{
+  std::vector<std::string> recordings;
+  size_t chunkBytes = 1460;
+  uint32_t latencyMicros = 0;
+  size_t transferChunkBytes = 0;
+  int iterations = 10;
+  bool isFromFlash = false;
+  bool isComparingEncodings = false;
+  uint32_t flashReadMicrosPerKilobyte = 100;
+  // Layout the recordings were requested with.
+  PanelGeometry panel{800, 480, 2};
+  uint16_t bandRows = 160;
+};
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--chunk") == 0 && hasValue)
+    {
+      options.chunkBytes = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--latency") == 0 && hasValue)
+    {
+      options.latencyMicros = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--transfer-chunks") == 0 && hasValue)
+    {
+      options.transferChunkBytes = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+    {
+      options.iterations = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--from-flash") == 0)
+    {
+      options.isFromFlash = true;
+    }
+    else if (strcmp(argv[i], "--compare-encodings") == 0)
+    {
+      options.isComparingEncodings = true;
+    }
+    else if (strcmp(argv[i], "--flash-read") == 0 && hasValue)
+    {
+      options.flashReadMicrosPerKilobyte = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--size") == 0 && hasValue)
+    {
+      char *height = nullptr;
+      options.panel.width = static_cast<uint16_t>(strtoul(argv[++i], &height, 10));
+      options.panel.height = *height == 'x' ? static_cast<uint16_t>(strtoul(height + 1, nullptr, 10)) : 0;
+    }
+    else if (strcmp(argv[i], "--planes") == 0 && hasValue)
+    {
+      options.panel.planeCount = static_cast<uint8_t>(atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--band-rows") == 0 && hasValue)
+    {
+      options.bandRows = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "--verbose") == 0)
+    {
+      isVerbose = true;
+    }
+    else
+    {
+      options.recordings.push_back(argv[i]);
+    }
+  }
+
+  // Generated frames carry no band checksums, so they cannot be stored in the emulated flash.
+  const bool hasFrames = options.isComparingEncodings ? options.recordings.empty() && !options.isFromFlash
+                                                      : !options.recordings.empty();
+  return hasFrames && options.chunkBytes > 0 && options.iterations > 0 &&
+         options.panel.width > 0 && options.panel.width % 8 == 0 && options.panel.height > 0 &&
+         (options.panel.planeCount == 1 || options.panel.planeCount == 2) &&
+         options.bandRows > 0 && options.bandRows <= options.panel.height;
+}
+
+static bool readRecording(const std::string &path, std::vector<uint8_t> &data)
+{
+  std::ifstream file(path, std::ios::binary);
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return file.good() || file.eof();
+}
+
+// Builds a response holding a sparse dashboard-like frame for the layout, either interleaved raw or planar.
+static std::vector<uint8_t> buildFrameResponse(const PanelGeometry &panel, uint16_t bandRows, FrameEncoding encoding)
+{
+  std::mt19937 random(42);
+  const size_t planeBytes = static_cast<size_t>(panel.height) * panel.getRowBytes();
+  std::vector<uint8_t> black(planeBytes);
+  std::vector<uint8_t> red(panel.planeCount == 2 ? planeBytes : 0);
+  for (size_t i = 0; i < planeBytes; ++i)
+  {
+    black[i] = random() % 8 == 0 ? static_cast<uint8_t>(random()) : 0xFF;
+    if (!red.empty())
+    {
+      red[i] = random() % 32 == 0 ? static_cast<uint8_t>(random()) : 0x00;
+    }
+  }
+
+  std::string body;
+  for (size_t bandStart = 0; bandStart < planeBytes; bandStart += static_cast<size_t>(bandRows) * panel.getRowBytes())
+  {
+    const size_t bandEnd = std::min(planeBytes, bandStart + static_cast<size_t>(bandRows) * panel.getRowBytes());
+    if (encoding == FrameEncoding::Planar)
+    {
+      body.append(black.begin() + bandStart, black.begin() + bandEnd);
+      body.append(red.begin() + std::min(bandStart, red.size()), red.begin() + std::min(bandEnd, red.size()));
+      continue;
+    }
+
+    for (size_t i = bandStart; i < bandEnd; ++i)
+    {
+      body += static_cast<char>(black[i]);
+      if (!red.empty())
+      {
+        body += static_cast<char>(red[i]);
+      }
+    }
+  }
+
+  const std::string header = std::string("HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: ") +
+                             std::to_string(body.size()) + "\r\nETag: \"generated\"\r\nX-Frame-Planes: " +
+                             std::to_string(panel.planeCount) +
+                             (encoding == FrameEncoding::Planar ? "\r\nX-Frame-Encoding: planar" : "") + "\r\n\r\n";
+  std::vector<uint8_t> response(header.begin(), header.end());
+  response.insert(response.end(), body.begin(), body.end());
+  return response;
+}
+
+// Re-frames a recorded response with chunked transfer encoding, as some reverse proxies send it.
+static void toChunkedTransfer(std::vector<uint8_t> &response, size_t chunkBytes)
+{
+  const std::string text(response.begin(), response.end());
+  const size_t headerEnd = text.find("\r\n\r\n");
+  if (headerEnd == std::string::npos)
+  {
+    return;
+  }
+
+  std::string framed;
+  size_t lineStart = 0;
+  while (lineStart < headerEnd + 2)
+  {
+    const size_t lineEnd = text.find("\r\n", lineStart) + 2;
+    if (strncasecmp(text.c_str() + lineStart, "Content-Length:", 15) != 0)
+    {
+      framed.append(text, lineStart, lineEnd - lineStart);
+    }
+    lineStart = lineEnd;
+  }
+  framed += "Transfer-Encoding: chunked\r\n\r\n";
+
+  for (size_t offset = headerEnd + 4; offset < text.size(); offset += chunkBytes)
+  {
+    const size_t length = std::min(chunkBytes, text.size() - offset);
+    char size[24];
+    snprintf(size, sizeof(size), "%zx\r\n", length);
+    framed += size;
+    framed.append(text, offset, length);
+    framed += "\r\n";
+  }
+  framed += "0\r\n\r\n";
+
+  response.assign(framed.begin(), framed.end());
+}
+
+// Fetches the frame until the cache stores it, which happens on its second download,
+// and builds the 304 response that makes the client draw it from flash.
+static bool storeFrame(DashboardClient &dashboardClient, ReplayNetworkClient &client, MemoryFrameDisplay &display,
+                       BandPipeline::Buffers &buffers, FrameCache &frameCache, const std::vector<uint8_t> &response,
+                       std::vector<uint8_t> &notModified)
+{
+  DisplayedFrame displayedFrame{};
+  for (int download = 0; download < 2; ++download)
+  {
+    displayedFrame = DisplayedFrame{};
+    client.setResponse(response);
+    if (dashboardClient.fetchBinaryData(display, buffers, displayedFrame, true) != FetchResult::Updated)
+    {
+      return false;
+    }
+  }
+
+  if (!frameCache.contains(displayedFrame.etag))
+  {
+    return false;
+  }
+
+  const std::string header = std::string("HTTP/1.1 304 Not Modified\r\nETag: ") + displayedFrame.etag + "\r\n\r\n";
+  notModified.assign(header.begin(), header.end());
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  Options options{};
+  if (!parseOptions(argc, argv, options))
+  {
+    fprintf(stderr, "Usage: %s <response.http>... [--chunk bytes] [--latency us-per-chunk] [--transfer-chunks bytes] [--iterations n]\n"
+                    "         [--from-flash] [--flash-read us-per-KB] [--compare-encodings] [--size WxH] [--planes n] [--band-rows n] [--verbose]\n", argv[0]);
+    return 1;
+  }
+
+  MemorySettingsStore settings{};
+  storeConfiguration(settings, Configuration{"ssid", "password", "dashboard.local", 80, 60, "api-key", ""});
+  const auto configuration = getConfiguration(settings);
+
+  // Allocated before the measured iterations, as on the device where the buffers live for the whole wake.
+  const FrameLayout layout{options.panel, options.bandRows, BandPipeline::maxSlots, false};
+  BandPipeline::Buffers buffers{};
+  BandPipeline::allocateBuffers(buffers, layout);
+
+  printf("%-24s %10s %10s %10s %10s %10s %8s %12s %12s\n",
+         "recording", "bytes", "total us", "network", "display", "decode", "allocs", "decode MB/s", "total MB/s");
+
+  std::vector<std::pair<std::string, std::vector<uint8_t>>> generated;
+  if (options.isComparingEncodings)
+  {
+    generated.emplace_back("interleaved", buildFrameResponse(options.panel, options.bandRows, FrameEncoding::Raw));
+    generated.emplace_back("planar", buildFrameResponse(options.panel, options.bandRows, FrameEncoding::Planar));
+    for (const auto &frame : generated)
+    {
+      options.recordings.push_back(frame.first);
+    }
+  }
+
+  int exitCode = 0;
+  for (size_t recording = 0; recording < options.recordings.size(); ++recording)
+  {
+    const std::string &path = options.recordings[recording];
+    std::vector<uint8_t> response;
+    if (options.isComparingEncodings)
+    {
+      response = generated[recording].second;
+    }
+    else if (!readRecording(path, response) || response.empty())
+    {
+      fprintf(stderr, "Cannot read %s\n", path.c_str());
+      exitCode = 1;
+      continue;
+    }
+
+    if (options.transferChunkBytes > 0)
+    {
+      toChunkedTransfer(response, options.transferChunkBytes);
+    }
+
+    HostClock clock{};
+    ReplayNetworkClient client(clock, options.chunkBytes, options.latencyMicros);
+    MemoryFrameDisplay display(layout.panel.width, layout.panel.height);
+    WakeTimings wakeTimings{};
+    MemoryFrameStorage frameStorage(clock, options.flashReadMicrosPerKilobyte);
+    FrameCacheIndex frameCacheIndex{};
+    FrameCache frameCache(frameCacheIndex, frameStorage);
+    frameCache.begin();
+    DashboardClient dashboardClient(configuration.value(), layout, client, clock, wakeTimings, options.isFromFlash ? &frameCache : nullptr);
+
+    std::vector<uint8_t> notModified;
+    if (options.isFromFlash && !storeFrame(dashboardClient, client, display, buffers, frameCache, response, notModified))
+    {
+      fprintf(stderr, "%s: frame was not stored, the recording needs band checksums\n", path.c_str());
+      exitCode = 1;
+      continue;
+    }
+
+    uint64_t totalMicros = 0;
+    uint64_t networkMicros = 0;
+    size_t allocations = 0;
+    for (int iteration = 0; iteration < options.iterations; ++iteration)
+    {
+      DisplayedFrame displayedFrame{};
+      client.setResponse(options.isFromFlash ? notModified : response);
+      beginWakeCycle(wakeTimings);
+
+      const uint64_t simulatedStart = clock.getSimulatedMicros();
+      const size_t allocationStart = allocationCount;
+      const uint32_t start = clock.micros();
+      const auto result = dashboardClient.fetchBinaryData(display, buffers, displayedFrame, false);
+      totalMicros += clock.micros() - start;
+      allocations += allocationCount - allocationStart;
+      networkMicros += clock.getSimulatedMicros() - simulatedStart;
+      endWakeCycle(wakeTimings);
+
+      if (result != FetchResult::Updated || displayedFrame.etag[0] == '\0')
+      {
+        fprintf(stderr, "%s: frame was not applied completely\n", path.c_str());
+        exitCode = 1;
+        break;
+      }
+    }
+
+    const uint64_t displayMicros = display.getWriteMicros();
+
+    const uint64_t decodeMicros = totalMicros - networkMicros - displayMicros;
+    printf("%-24s %10zu %10llu %10llu %10llu %10llu %8zu %12.1f %12.1f\n",
+           path.c_str(),
+           response.size(),
+           static_cast<unsigned long long>(totalMicros / options.iterations),
+           static_cast<unsigned long long>(networkMicros / options.iterations),
+           static_cast<unsigned long long>(displayMicros / options.iterations),
+           static_cast<unsigned long long>(decodeMicros / options.iterations),
+           allocations / options.iterations,
+           decodeMicros > 0 ? static_cast<double>(response.size()) * options.iterations / decodeMicros : 0.0,
+           totalMicros > 0 ? static_cast<double>(response.size()) * options.iterations / totalMicros : 0.0);
+  }
+
+  return exitCode;
+}
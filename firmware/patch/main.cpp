@@ -0,0 +1,250 @@
+// Applies a firmware delta on the host the way the device does and reports its size and how long applying it takes.
+//
+// Write a delta with the server's benchmark command, e.g.
+//   dotnet run -c Release --project EPaperDashboard.Benchmarks -- firmware-delta old.bin new.bin --output delta.bin
+// and run
+//   pio run -e patch && .pio/build/patch/program old.bin delta.bin new.bin --chunk 1460 --bandwidth 2000
+// The delta is fed to the patcher in network-sized chunks and the result is compared with new.bin. Flash and
+// download times are estimated from the bytes moved, for the delta and for downloading the whole image instead.
+
+#include <openssl/sha.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "firmware_patch.h"
+
+static bool isVerbose = false;
+
+void deviceLog(const char *format, ...)
+{
+  if (!isVerbose)
+  {
+    return;
+  }
+
+  va_list arguments;
+  va_start(arguments, format);
+  vprintf(format, arguments);
+  va_end(arguments);
+}
+
+struct Options
+{
+  std::string source;
+  std::string delta;
+  std::string target;
+  size_t chunkBytes = 1460;
+  int iterations = 10;
+  uint32_t bandwidthKilobits = 2000;
+  uint32_t flashReadMicrosPerKilobyte = 100;
+  uint32_t flashWriteMicrosPerKilobyte = 1500;
+  uint32_t flashEraseMicrosPerKilobyte = 10000;
+};
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--chunk") == 0 && hasValue)
+    {
+      options.chunkBytes = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--iterations") == 0 && hasValue)
+    {
+      options.iterations = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--bandwidth") == 0 && hasValue)
+    {
+      options.bandwidthKilobits = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--flash-read") == 0 && hasValue)
+    {
+      options.flashReadMicrosPerKilobyte = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--flash-write") == 0 && hasValue)
+    {
+      options.flashWriteMicrosPerKilobyte = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--flash-erase") == 0 && hasValue)
+    {
+      options.flashEraseMicrosPerKilobyte = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--verbose") == 0)
+    {
+      isVerbose = true;
+    }
+    else
+    {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.size() != 3)
+  {
+    return false;
+  }
+
+  options.source = paths[0];
+  options.delta = paths[1];
+  options.target = paths[2];
+  return options.chunkBytes > 0 && options.iterations > 0 && options.bandwidthKilobits > 0;
+}
+
+static bool readFile(const std::string &path, std::vector<uint8_t> &data)
+{
+  std::ifstream file(path, std::ios::binary);
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return file.good() || file.eof();
+}
+
+// The running image and the inactive slot in memory, counting the flash bytes read and written.
+class MemoryFirmwareUpdater : public FirmwareUpdater
+{
+public:
+  explicit MemoryFirmwareUpdater(const std::vector<uint8_t> &running) : running(running) {}
+
+  bool readRunning(uint32_t offset, uint8_t *data, size_t length) override
+  {
+    if (offset > running.size() || length > running.size() - offset)
+    {
+      return false;
+    }
+
+    memcpy(data, running.data() + offset, length);
+    readBytes += length;
+    return true;
+  }
+
+  bool isRunning(uint32_t size, const uint8_t *sha256) override
+  {
+    return size <= running.size() && hasSha256(running.data(), size, sha256);
+  }
+
+  bool begin(uint32_t size) override
+  {
+    slot.clear();
+    slot.reserve(size);
+    erasedBytes += (size + 4095) / 4096 * 4096;
+    return true;
+  }
+
+  bool write(const uint8_t *data, size_t length) override
+  {
+    slot.insert(slot.end(), data, data + length);
+    writtenBytes += length;
+    return true;
+  }
+
+  bool finish(const uint8_t *sha256) override
+  {
+    return hasSha256(slot.data(), slot.size(), sha256);
+  }
+
+  void abort() override
+  {
+    slot.clear();
+  }
+
+  const std::vector<uint8_t> &getSlot() const { return slot; }
+
+  uint64_t readBytes = 0;
+  uint64_t writtenBytes = 0;
+  uint64_t erasedBytes = 0;
+
+private:
+  bool hasSha256(const uint8_t *data, size_t size, const uint8_t *sha256)
+  {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(data, size, digest);
+    readBytes += size;
+    return memcmp(digest, sha256, sizeof(digest)) == 0;
+  }
+
+  const std::vector<uint8_t> &running;
+  std::vector<uint8_t> slot;
+};
+
+static uint64_t flashMicros(const MemoryFirmwareUpdater &updater, const Options &options)
+{
+  return (updater.readBytes * options.flashReadMicrosPerKilobyte + updater.writtenBytes * options.flashWriteMicrosPerKilobyte +
+          updater.erasedBytes * options.flashEraseMicrosPerKilobyte) /
+         1024;
+}
+
+static uint64_t downloadMicros(size_t bytes, const Options &options)
+{
+  return bytes * 8000ULL / options.bandwidthKilobits;
+}
+
+int main(int argc, char **argv)
+{
+  Options options{};
+  if (!parseOptions(argc, argv, options))
+  {
+    fprintf(stderr, "Usage: %s <running.bin> <delta.bin> <new.bin> [--chunk bytes] [--iterations n] [--bandwidth kbit/s]\n"
+                    "         [--flash-read us-per-KB] [--flash-write us-per-KB] [--flash-erase us-per-KB] [--verbose]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<uint8_t> source;
+  std::vector<uint8_t> delta;
+  std::vector<uint8_t> target;
+  if (!readFile(options.source, source) || !readFile(options.delta, delta) || !readFile(options.target, target))
+  {
+    fprintf(stderr, "Cannot read the images or the delta\n");
+    return 1;
+  }
+
+  uint64_t applyMicros = 0;
+  uint64_t deltaFlashMicros = 0;
+  for (int iteration = 0; iteration < options.iterations; ++iteration)
+  {
+    MemoryFirmwareUpdater updater(source);
+    FirmwarePatcher patcher(updater);
+    const auto start = std::chrono::steady_clock::now();
+    bool isApplied = true;
+    for (size_t offset = 0; offset < delta.size() && isApplied; offset += options.chunkBytes)
+    {
+      isApplied = patcher.write(delta.data() + offset, std::min(options.chunkBytes, delta.size() - offset));
+    }
+    isApplied = isApplied && patcher.isComplete() && updater.finish(patcher.getHeader().targetSha256);
+    applyMicros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    if (!isApplied || updater.getSlot() != target)
+    {
+      fprintf(stderr, "The delta did not produce %s\n", options.target.c_str());
+      return 1;
+    }
+
+    deltaFlashMicros = flashMicros(updater, options);
+  }
+
+  // Downloading the whole image writes and verifies it the same way, without reading the running image.
+  MemoryFirmwareUpdater fullUpdater(source);
+  fullUpdater.begin(target.size());
+  fullUpdater.write(target.data(), target.size());
+  uint8_t targetSha256[SHA256_DIGEST_LENGTH];
+  SHA256(target.data(), target.size(), targetSha256);
+  fullUpdater.finish(targetSha256);
+  const uint64_t fullFlashMicros = flashMicros(fullUpdater, options);
+
+  const uint64_t deltaMicros = downloadMicros(delta.size(), options) + applyMicros / options.iterations + deltaFlashMicros;
+  const uint64_t fullMicros = downloadMicros(target.size(), options) + fullFlashMicros;
+  printf("%10s %10s %7s %10s %10s %12s %10s %10s\n",
+         "image", "delta", "ratio", "apply us", "flash ms", "download ms", "total ms", "full ms");
+  printf("%10zu %10zu %6.1f%% %10llu %10llu %12llu %10llu %10llu\n",
+         target.size(), delta.size(), 100.0 * delta.size() / target.size(),
+         static_cast<unsigned long long>(applyMicros / options.iterations),
+         static_cast<unsigned long long>(deltaFlashMicros / 1000),
+         static_cast<unsigned long long>(downloadMicros(delta.size(), options) / 1000),
+         static_cast<unsigned long long>(deltaMicros / 1000), static_cast<unsigned long long>(fullMicros / 1000));
+  return 0;
+}
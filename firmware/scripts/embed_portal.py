@@ -0,0 +1,93 @@
+"""Minifies and gzips the setup portal page into a header that keeps it in flash.
+
+Runs before every build of the device environments (extra_scripts in platformio.ini) and can be run
+on its own with `python scripts/embed_portal.py`. The page is edited in src/index.html; the generated
+src/portal_assets.h is not checked in. After writing, the byte array in the header is read back,
+decompressed and compared with the minified page, and the build stops if they differ.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE_PATH = os.path.join(PROJECT_DIR, "src", "index.html")
+HEADER_PATH = os.path.join(PROJECT_DIR, "src", "portal_assets.h")
+BYTES_PER_LINE = 16
+
+
+def minify_css(css):
+    css = re.sub(r"/\*.*?\*/", "", css, flags=re.S)
+    css = re.sub(r"\s+", " ", css)
+    css = re.sub(r"\s*([{};,])\s*", r"\1", css)
+    css = re.sub(r":\s+", ":", css)
+    return css.replace(";}", "}").strip()
+
+
+def minify_html(html):
+    # The page has no <pre>, <textarea> or scripts, so whitespace only matters as a single separator.
+    html = re.sub(r"<style>(.*?)</style>", lambda m: "<style>" + minify_css(m.group(1)) + "</style>", html, flags=re.S)
+    html = re.sub(r"\s+", " ", html)
+    html = re.sub(r">\s+<", "><", html)
+    return html.strip()
+
+
+def render_header(data, etag, source_length):
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by scripts/embed_portal.py from src/index.html; edit the page there.",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        f"// Setup portal page, minified and gzipped ({source_length} bytes before, {len(data)} bytes after).",
+        "// Served as is with Content-Encoding: gzip; the entity tag changes with the page.",
+        f'constexpr char portalIndexETag[] = "\\"{etag}\\"";',
+        f"constexpr size_t portalIndexGzipLength = {len(data)};",
+        "constexpr uint8_t portalIndexGzip[] = {",
+    ]
+    for offset in range(0, len(data), BYTES_PER_LINE):
+        chunk = data[offset:offset + BYTES_PER_LINE]
+        lines.append("  " + ", ".join(f"0x{byte:02X}" for byte in chunk) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def read_header_bytes(header):
+    array = header[header.index("portalIndexGzip[] = {"):]
+    return bytes(int(value, 16) for value in re.findall(r"0x([0-9A-F]{2})", array))
+
+
+def embed_portal():
+    with open(SOURCE_PATH, encoding="utf-8") as source:
+        html = source.read()
+
+    minified = minify_html(html).encode("utf-8")
+    # A fixed timestamp keeps the output, and with it the entity tag, the same from build to build.
+    data = gzip.compress(minified, compresslevel=9, mtime=0)
+    etag = hashlib.sha256(data).hexdigest()[:16]
+    header = render_header(data, etag, len(html.encode("utf-8")))
+
+    if gzip.decompress(read_header_bytes(header)) != minified:
+        sys.exit("embed_portal: the embedded page does not decompress to the minified src/index.html")
+
+    existing = None
+    if os.path.exists(HEADER_PATH):
+        with open(HEADER_PATH, encoding="utf-8") as current:
+            existing = current.read()
+    # Rewriting an unchanged header would rebuild firmware.cpp on every build.
+    if existing != header:
+        with open(HEADER_PATH, "w", encoding="utf-8", newline="\n") as output:
+            output.write(header)
+        print(f"embed_portal: {len(html)} bytes of HTML embedded as {len(data)} gzipped bytes")
+
+
+embed_portal()
@@ -0,0 +1,429 @@
+// Simulates a fleet of panels waking up and fetching frames from a running dashboard server. Every device runs the
+// firmware fetch and decode path over a real TCP connection whose WiFi link has a configurable bandwidth and loss,
+// and the run reports device awake times, server latency, transferred bytes and errors.
+//
+//   pio run -e fleet
+//   .pio/build/fleet/program --server localhost --port 8128 --api-key <key> --devices 50 --cycles 5 --output fleet.json
+
+#include <algorithm>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "dashboard_client.h"
+#include "fakes.h"
+#include "simulated_link.h"
+#include "tls_link.h"
+
+static bool isVerbose = false;
+static std::mutex logMutex;
+
+void deviceLog(const char *format, ...)
+{
+  if (!isVerbose)
+  {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(logMutex);
+  va_list arguments;
+  va_start(arguments, format);
+  vprintf(format, arguments);
+  va_end(arguments);
+}
+
+struct Options
+{
+  std::string server = "localhost";
+  uint16_t port = 8128;
+  std::vector<std::string> apiKeys;
+  int devices = 10;
+  int cycles = 3;
+  uint32_t intervalSeconds = 60;
+  uint32_t spreadSeconds = 0;
+  uint32_t jitterMillis = 0;
+  LinkProfile link;
+  // Panel and band buffers of an ESP32 without PSRAM, unless set otherwise.
+  FrameLayout layout{PanelGeometry{800, 480, 2}, 160, BandPipeline::maxSlots, false};
+  std::string certificateFingerprint; // connects over TLS when set
+  uint32_t seed = 1;
+  std::string outputPath;
+};
+
+struct CycleSample
+{
+  FetchResult result;
+  bool isTimedOut;
+  uint32_t awakeMillis;
+  // From sending the request to receiving the response headers, i.e. queueing and rendering on the server.
+  // 0 when no headers arrived.
+  uint32_t serverMillis;
+  uint64_t bytesReceived;
+  uint64_t bytesSent;
+};
+
+struct DeviceReport
+{
+  std::string apiKey;
+  std::vector<CycleSample> cycles;
+  std::vector<uint32_t> tlsFullMillis;
+  std::vector<uint32_t> tlsResumedMillis;
+};
+
+struct Percentiles
+{
+  uint32_t p50;
+  uint32_t p90;
+  uint32_t p99;
+  uint32_t max;
+};
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    const bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--server") == 0 && hasValue)
+    {
+      options.server = argv[++i];
+    }
+    else if (strcmp(argv[i], "--port") == 0 && hasValue)
+    {
+      options.port = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+    }
+    else if (strcmp(argv[i], "--api-key") == 0 && hasValue)
+    {
+      options.apiKeys.push_back(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--devices") == 0 && hasValue)
+    {
+      options.devices = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--cycles") == 0 && hasValue)
+    {
+      options.cycles = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--interval") == 0 && hasValue)
+    {
+      options.intervalSeconds = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--spread") == 0 && hasValue)
+    {
+      options.spreadSeconds = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--jitter") == 0 && hasValue)
+    {
+      options.jitterMillis = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--bandwidth") == 0 && hasValue)
+    {
+      options.link.bandwidthKbps = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--loss") == 0 && hasValue)
+    {
+      options.link.lossRate = atof(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--rto") == 0 && hasValue)
+    {
+      options.link.retransmitMillis = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--timeout") == 0 && hasValue)
+    {
+      options.link.timeoutMillis = strtoul(argv[++i], nullptr, 10) * 1000;
+    }
+    else if (strcmp(argv[i], "--planes") == 0 && hasValue)
+    {
+      options.layout.panel.planeCount = static_cast<uint8_t>(atoi(argv[++i]));
+    }
+    else if (strcmp(argv[i], "--band-rows") == 0 && hasValue)
+    {
+      options.layout.bandRows = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+      options.layout.slotCount = options.layout.bandRows < options.layout.panel.height ? BandPipeline::maxSlots : 1;
+    }
+    else if (strcmp(argv[i], "--tls-pin") == 0 && hasValue)
+    {
+      options.certificateFingerprint = argv[++i];
+    }
+    else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+    {
+      options.seed = strtoul(argv[++i], nullptr, 10);
+    }
+    else if (strcmp(argv[i], "--output") == 0 && hasValue)
+    {
+      options.outputPath = argv[++i];
+    }
+    else if (strcmp(argv[i], "--verbose") == 0)
+    {
+      isVerbose = true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  uint8_t fingerprint[TLS_FINGERPRINT_LENGTH];
+  return !options.apiKeys.empty() && options.devices > 0 && options.cycles > 0 &&
+         options.link.lossRate >= 0 && options.link.lossRate < 1 &&
+         (options.layout.panel.planeCount == 1 || options.layout.panel.planeCount == 2) &&
+         options.layout.bandRows > 0 && options.layout.bandRows <= options.layout.panel.height &&
+         (options.certificateFingerprint.empty() || parseCertificateFingerprint(options.certificateFingerprint.c_str(), fingerprint));
+}
+
+// Wakes on the schedule, fetches a frame like the firmware does and records the cycle. The displayed frame
+// the wake timings and the TLS session survive between cycles, as they do in RTC memory on the device.
+static void runDevice(int deviceId, const Options &options, SteadyTime start, DeviceReport &report)
+{
+  std::mt19937 random(options.seed + deviceId);
+
+  MemorySettingsStore settings{};
+  storeConfiguration(settings, Configuration{"ssid", "password", options.server, options.port, options.intervalSeconds, report.apiKey,
+                                           options.certificateFingerprint});
+  const auto configuration = getConfiguration(settings);
+
+  BandPipeline::Buffers buffers{};
+  MemoryFrameDisplay display(options.layout.panel.width, options.layout.panel.height);
+  SimulatedLinkClient client(options.link, random);
+  TlsSessionCache tlsSessionCache{};
+  beginTlsSessionCache(tlsSessionCache);
+  uint8_t fingerprint[TLS_FINGERPRINT_LENGTH] = {};
+  parseCertificateFingerprint(configuration->certificateFingerprint.c_str(), fingerprint);
+  TlsLinkClient tlsClient(client, tlsSessionCache, fingerprint);
+  NetworkClient &networkClient = options.certificateFingerprint.empty() ? static_cast<NetworkClient &>(client) : tlsClient;
+  WakeTimings wakeTimings{};
+  DisplayedFrame displayedFrame{};
+
+  const auto offset = std::chrono::milliseconds(
+      options.spreadSeconds > 0 ? std::uniform_int_distribution<uint32_t>(0, options.spreadSeconds * 1000)(random) : 0);
+  for (int cycle = 0; cycle < options.cycles; ++cycle)
+  {
+    const auto jitter = std::chrono::milliseconds(
+        options.jitterMillis > 0 ? std::uniform_int_distribution<int32_t>(-static_cast<int32_t>(options.jitterMillis), options.jitterMillis)(random) : 0);
+    std::this_thread::sleep_until(start + offset + jitter + std::chrono::seconds(options.intervalSeconds) * cycle);
+
+    DeviceClock clock(std::chrono::steady_clock::now());
+    DashboardClient dashboardClient(configuration.value(), options.layout, networkClient, clock, wakeTimings);
+    const uint64_t receivedBefore = client.getBytesReceived();
+    const uint64_t sentBefore = client.getBytesSent();
+
+    beginWakeCycle(wakeTimings);
+    const FetchResult result = dashboardClient.fetchBinaryData(display, buffers, displayedFrame, false);
+    const uint32_t *phases = wakeTimings.current.phaseEndMillis;
+    const uint32_t requestSent = phases[static_cast<uint8_t>(WakePhase::TcpConnect)];
+    const uint32_t headersReceived = phases[static_cast<uint8_t>(WakePhase::HeadersReceived)];
+    markWakePhase(wakeTimings, WakePhase::SleepEntry, clock.micros() / 1000);
+    endWakeCycle(wakeTimings);
+
+    report.cycles.push_back(CycleSample{
+        result,
+        client.hasRequestTimedOut(),
+        clock.micros() / 1000,
+        headersReceived != 0 && headersReceived >= requestSent ? headersReceived - requestSent : 0,
+        client.getBytesReceived() - receivedBefore,
+        client.getBytesSent() - sentBefore});
+  }
+
+  for (uint8_t slot = 0; slot < buffers.count; ++slot)
+  {
+    free(buffers.black[slot]);
+    free(buffers.red[slot]);
+  }
+
+  report.tlsFullMillis = tlsClient.getFullHandshakeMillis();
+  report.tlsResumedMillis = tlsClient.getResumedHandshakeMillis();
+}
+
+static Percentiles getPercentiles(std::vector<uint32_t> values)
+{
+  if (values.empty())
+  {
+    return Percentiles{0, 0, 0, 0};
+  }
+
+  std::sort(values.begin(), values.end());
+  const auto at = [&values](double percentile)
+  {
+    const size_t rank = static_cast<size_t>(percentile * values.size() + 0.999999);
+    return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+  };
+  return Percentiles{at(0.50), at(0.90), at(0.99), values.back()};
+}
+
+static void printPercentilesJson(FILE *file, const char *name, const Percentiles &percentiles)
+{
+  fprintf(file, "\"%s\": {\"p50\": %u, \"p90\": %u, \"p99\": %u, \"max\": %u}",
+          name, percentiles.p50, percentiles.p90, percentiles.p99, percentiles.max);
+}
+
+static void writeJson(FILE *file, const Options &options, const std::vector<DeviceReport> &reports, double durationSeconds)
+{
+  std::vector<uint32_t> awakeMillis;
+  std::vector<uint32_t> serverMillis;
+  size_t counts[3] = {0, 0, 0};
+  size_t timedOut = 0;
+  uint64_t bytesReceived = 0;
+  uint64_t bytesSent = 0;
+  for (const auto &report : reports)
+  {
+    for (const auto &cycle : report.cycles)
+    {
+      awakeMillis.push_back(cycle.awakeMillis);
+      if (cycle.serverMillis != 0)
+      {
+        serverMillis.push_back(cycle.serverMillis);
+      }
+      ++counts[static_cast<int>(cycle.result)];
+      timedOut += cycle.isTimedOut ? 1 : 0;
+      bytesReceived += cycle.bytesReceived;
+      bytesSent += cycle.bytesSent;
+    }
+  }
+
+  const size_t cycleCount = awakeMillis.size();
+  fprintf(file, "{\n  \"options\": {\"devices\": %d, \"cycles\": %d, \"intervalSeconds\": %u, \"spreadSeconds\": %u, "
+                "\"jitterMillis\": %u, \"bandwidthKbps\": %u, \"lossRate\": %g, \"retransmitMillis\": %u, \"timeoutSeconds\": %u, "
+                "\"planes\": %u, \"bandRows\": %u},\n",
+          options.devices, options.cycles, options.intervalSeconds, options.spreadSeconds, options.jitterMillis,
+          options.link.bandwidthKbps, options.link.lossRate, options.link.retransmitMillis, options.link.timeoutMillis / 1000,
+          options.layout.panel.planeCount, options.layout.bandRows);
+  fprintf(file, "  \"summary\": {\"durationSeconds\": %.1f, \"cycles\": %zu, \"updated\": %zu, \"notModified\": %zu, "
+                "\"failed\": %zu, \"timedOut\": %zu, \"errorRate\": %.4f, \"bytesReceived\": %llu, \"bytesSent\": %llu, ",
+          durationSeconds, cycleCount,
+          counts[static_cast<int>(FetchResult::Updated)], counts[static_cast<int>(FetchResult::NotModified)],
+          counts[static_cast<int>(FetchResult::Failed)], timedOut,
+          cycleCount > 0 ? static_cast<double>(counts[static_cast<int>(FetchResult::Failed)]) / cycleCount : 0.0,
+          static_cast<unsigned long long>(bytesReceived), static_cast<unsigned long long>(bytesSent));
+  printPercentilesJson(file, "awakeMillis", getPercentiles(awakeMillis));
+  fprintf(file, ", ");
+  printPercentilesJson(file, "serverMillis", getPercentiles(serverMillis));
+  if (!options.certificateFingerprint.empty())
+  {
+    std::vector<uint32_t> tlsFullMillis;
+    std::vector<uint32_t> tlsResumedMillis;
+    for (const auto &report : reports)
+    {
+      tlsFullMillis.insert(tlsFullMillis.end(), report.tlsFullMillis.begin(), report.tlsFullMillis.end());
+      tlsResumedMillis.insert(tlsResumedMillis.end(), report.tlsResumedMillis.begin(), report.tlsResumedMillis.end());
+    }
+
+    fprintf(file, ", \"tlsFullHandshakes\": %zu, ", tlsFullMillis.size());
+    printPercentilesJson(file, "tlsFullMillis", getPercentiles(tlsFullMillis));
+    fprintf(file, ", \"tlsResumedHandshakes\": %zu, ", tlsResumedMillis.size());
+    printPercentilesJson(file, "tlsResumedMillis", getPercentiles(tlsResumedMillis));
+  }
+  fprintf(file, "},\n  \"devices\": [\n");
+
+  for (size_t device = 0; device < reports.size(); ++device)
+  {
+    std::vector<uint32_t> deviceAwakeMillis;
+    size_t failed = 0;
+    uint64_t deviceBytesReceived = 0;
+    for (const auto &cycle : reports[device].cycles)
+    {
+      deviceAwakeMillis.push_back(cycle.awakeMillis);
+      failed += cycle.result == FetchResult::Failed ? 1 : 0;
+      deviceBytesReceived += cycle.bytesReceived;
+    }
+
+    fprintf(file, "    {\"id\": %zu, \"cycles\": %zu, \"failed\": %zu, \"bytesReceived\": %llu, ",
+            device, reports[device].cycles.size(), failed, static_cast<unsigned long long>(deviceBytesReceived));
+    printPercentilesJson(file, "awakeMillis", getPercentiles(deviceAwakeMillis));
+    fprintf(file, "}%s\n", device + 1 < reports.size() ? "," : "");
+  }
+
+  fprintf(file, "  ]\n}\n");
+}
+
+static void printSummary(const std::vector<DeviceReport> &reports)
+{
+  std::vector<uint32_t> awakeMillis;
+  std::vector<uint32_t> serverMillis;
+  std::vector<uint32_t> tlsFullMillis;
+  std::vector<uint32_t> tlsResumedMillis;
+  size_t failed = 0;
+  uint64_t bytesReceived = 0;
+  for (const auto &report : reports)
+  {
+    tlsFullMillis.insert(tlsFullMillis.end(), report.tlsFullMillis.begin(), report.tlsFullMillis.end());
+    tlsResumedMillis.insert(tlsResumedMillis.end(), report.tlsResumedMillis.begin(), report.tlsResumedMillis.end());
+    for (const auto &cycle : report.cycles)
+    {
+      awakeMillis.push_back(cycle.awakeMillis);
+      if (cycle.serverMillis != 0)
+      {
+        serverMillis.push_back(cycle.serverMillis);
+      }
+      failed += cycle.result == FetchResult::Failed ? 1 : 0;
+      bytesReceived += cycle.bytesReceived;
+    }
+  }
+
+  const Percentiles awake = getPercentiles(awakeMillis);
+  const Percentiles server = getPercentiles(serverMillis);
+  printf("%-12s %8s %8s %8s %8s\n", "ms", "p50", "p90", "p99", "max");
+  printf("%-12s %8u %8u %8u %8u\n", "awake", awake.p50, awake.p90, awake.p99, awake.max);
+  printf("%-12s %8u %8u %8u %8u\n", "server", server.p50, server.p90, server.p99, server.max);
+  if (!tlsFullMillis.empty() || !tlsResumedMillis.empty())
+  {
+    const Percentiles full = getPercentiles(tlsFullMillis);
+    const Percentiles resumed = getPercentiles(tlsResumedMillis);
+    printf("%-12s %8u %8u %8u %8u  (%zu handshakes)\n", "tls full", full.p50, full.p90, full.p99, full.max, tlsFullMillis.size());
+    printf("%-12s %8u %8u %8u %8u  (%zu handshakes)\n", "tls resumed", resumed.p50, resumed.p90, resumed.p99, resumed.max,
+           tlsResumedMillis.size());
+  }
+  printf("%zu cycles, %zu failed (%.1f%%), %.1f KB received\n",
+         awakeMillis.size(), failed, awakeMillis.empty() ? 0.0 : 100.0 * failed / awakeMillis.size(), bytesReceived / 1024.0);
+}
+
+int main(int argc, char **argv)
+{
+  Options options{};
+  if (!parseOptions(argc, argv, options))
+  {
+    fprintf(stderr,
+            "Usage: %s --api-key <key>... [--server host] [--port port] [--devices n] [--cycles n]\n"
+            "         [--interval s] [--spread s] [--jitter ms] [--bandwidth kbit/s] [--loss rate] [--rto ms]\n"
+            "         [--timeout s] [--planes n] [--band-rows n] [--tls-pin sha256] [--seed n] [--output results.json] [--verbose]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<DeviceReport> reports(options.devices);
+  for (int device = 0; device < options.devices; ++device)
+  { // devices are spread over the dashboards round-robin
+    reports[device].apiKey = options.apiKeys[device % options.apiKeys.size()];
+  }
+
+  const SteadyTime start = std::chrono::steady_clock::now();
+  std::vector<std::thread> devices;
+  for (int device = 0; device < options.devices; ++device)
+  {
+    devices.emplace_back(runDevice, device, std::cref(options), start, std::ref(reports[device]));
+  }
+
+  for (auto &device : devices)
+  {
+    device.join();
+  }
+
+  const double durationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printSummary(reports);
+
+  if (!options.outputPath.empty())
+  {
+    FILE *file = fopen(options.outputPath.c_str(), "w");
+    if (file == nullptr)
+    {
+      fprintf(stderr, "Cannot write %s\n", options.outputPath.c_str());
+      return 1;
+    }
+
+    writeJson(file, options, reports, durationSeconds);
+    fclose(file);
+  }
+
+  return 0;
+}
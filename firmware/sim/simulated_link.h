@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <random>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include "device_interfaces.h"
+
+using SteadyTime = std::chrono::steady_clock::time_point;
+
+// Time since the simulated device woke up.
+class DeviceClock : public Clock
+{
+public:
+  explicit DeviceClock(SteadyTime wakeTime) : wakeTime(wakeTime) {}
+
+  uint32_t micros() override
+  {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - wakeTime).count());
+  }
+
+  void yield() override { std::this_thread::sleep_for(std::chrono::microseconds(500)); }
+
+private:
+  const SteadyTime wakeTime;
+};
+
+// Properties of the WiFi link between a device and the access point.
+struct LinkProfile
+{
+  uint32_t bandwidthKbps = 0; // 0 for no limit
+  double lossRate = 0;        // probability that a segment is lost and retransmitted
+  uint32_t retransmitMillis = 200;
+  uint32_t timeoutMillis = 60000;
+};
+
+// TCP connection to the dashboard server that delivers received data at the link bandwidth. A lost segment
+// is delivered after the retransmission timeout, which is how loss shows up to the application over TCP.
+class SimulatedLinkClient : public NetworkClient
+{
+public:
+  static const size_t segmentBytes = 1460;
+
+  SimulatedLinkClient(const LinkProfile &link, std::mt19937 &random) : link(link), random(random) {}
+  ~SimulatedLinkClient() override { stop(); }
+
+  bool connect(const char *host, uint16_t port) override
+  {
+    stop();
+    hasTimedOut = false;
+    deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(link.timeoutMillis);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    const std::string service = std::to_string(port);
+    if (getaddrinfo(host, service.c_str(), &hints, &addresses) != 0)
+    {
+      return false;
+    }
+
+    for (addrinfo *address = addresses; address != nullptr && socketFd < 0; address = address->ai_next)
+    {
+      socketFd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+      if (socketFd >= 0 && ::connect(socketFd, address->ai_addr, address->ai_addrlen) != 0)
+      {
+        close(socketFd);
+        socketFd = -1;
+      }
+    }
+    freeaddrinfo(addresses);
+
+    if (socketFd < 0)
+    {
+      return false;
+    }
+
+    const int noDelay = 1;
+    setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    fcntl(socketFd, F_SETFL, fcntl(socketFd, F_GETFL) | O_NONBLOCK);
+
+    // A lost SYN is retried after the initial retransmission timeout of one second.
+    nextDelivery = std::chrono::steady_clock::now();
+    if (isLost())
+    {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    return true;
+  }
+
+  size_t write(const uint8_t *data, size_t length) override
+  {
+    size_t written = 0;
+    while (written < length && socketFd >= 0 && !isTimedOut())
+    {
+      const ssize_t result = send(socketFd, data + written, length - written, MSG_NOSIGNAL);
+      if (result > 0)
+      {
+        written += result;
+        continue;
+      }
+
+      if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      {
+        pollfd descriptor{socketFd, POLLOUT, 0};
+        poll(&descriptor, 1, 10);
+        continue;
+      }
+
+      isPeerClosed = true;
+      break;
+    }
+
+    // The request is small, so only its transmission time is charged.
+    std::this_thread::sleep_for(getTransmitTime(written));
+    bytesSent += written;
+    return written;
+  }
+
+  int available() override
+  {
+    if (segmentLength == 0)
+    {
+      receiveSegment();
+    }
+
+    if (segmentLength == 0 || std::chrono::steady_clock::now() < nextDelivery)
+    {
+      return 0;
+    }
+
+    return static_cast<int>(segmentLength - segmentOffset);
+  }
+
+  int read(uint8_t *data, size_t length) override
+  {
+    const size_t count = std::min(length, static_cast<size_t>(available()));
+    memcpy(data, segment + segmentOffset, count);
+    segmentOffset += count;
+    if (segmentOffset == segmentLength)
+    {
+      segmentLength = 0;
+      segmentOffset = 0;
+    }
+    bytesReceived += count;
+    return static_cast<int>(count);
+  }
+
+  bool connected() override
+  {
+    if (isTimedOut())
+    {
+      hasTimedOut = true;
+      return false;
+    }
+
+    return socketFd >= 0 && (!isPeerClosed || segmentLength > 0);
+  }
+
+  void stop() override
+  {
+    if (socketFd >= 0)
+    {
+      close(socketFd);
+      socketFd = -1;
+    }
+    segmentLength = 0;
+    segmentOffset = 0;
+    isPeerClosed = false;
+  }
+
+  uint64_t getBytesSent() const { return bytesSent; }
+  uint64_t getBytesReceived() const { return bytesReceived; }
+
+  // True if the last request was abandoned because the server did not finish in time.
+  bool hasRequestTimedOut() const { return hasTimedOut; }
+
+private:
+  bool isTimedOut() const { return std::chrono::steady_clock::now() > deadline; }
+
+  bool isLost() { return link.lossRate > 0 && std::uniform_real_distribution<double>(0, 1)(random) < link.lossRate; }
+
+  std::chrono::microseconds getTransmitTime(size_t bytes) const
+  {
+    return link.bandwidthKbps == 0
+               ? std::chrono::microseconds(0)
+               : std::chrono::microseconds(bytes * 8 * 1000 / link.bandwidthKbps);
+  }
+
+  // Takes the next segment from the socket and schedules when the link would have delivered it.
+  void receiveSegment()
+  {
+    if (socketFd < 0 || isPeerClosed)
+    {
+      return;
+    }
+
+    const ssize_t result = recv(socketFd, segment, sizeof(segment), MSG_DONTWAIT);
+    if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+    {
+      isPeerClosed = true;
+      return;
+    }
+
+    if (result < 0)
+    {
+      return;
+    }
+
+    segmentLength = result;
+    nextDelivery = std::max(nextDelivery, std::chrono::steady_clock::now()) + getTransmitTime(segmentLength);
+    if (isLost())
+    {
+      nextDelivery += std::chrono::milliseconds(link.retransmitMillis);
+    }
+  }
+
+  const LinkProfile &link;
+  std::mt19937 &random;
+  int socketFd = -1;
+  SteadyTime deadline{};
+  SteadyTime nextDelivery{};
+  uint8_t segment[segmentBytes];
+  size_t segmentLength = 0;
+  size_t segmentOffset = 0;
+  bool isPeerClosed = false;
+  bool hasTimedOut = false;
+  uint64_t bytesSent = 0;
+  uint64_t bytesReceived = 0;
+};
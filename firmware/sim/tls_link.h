@@ -0,0 +1,238 @@
+#pragma once
+
+#include <chrono>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "device_interfaces.h"
+#include "tls_session.h"
+
+// Host counterpart of the firmware TLS client: OpenSSL instead of mbedtls, limited to TLS 1.2 like the device,
+// over another network client such as the simulated link. Pins the server certificate by its SHA-256
+// fingerprint and resumes the session kept in the same RTC memory layout as on the device.
+class TlsLinkClient : public NetworkClient
+{
+public:
+  TlsLinkClient(NetworkClient &transport, TlsSessionCache &sessionCache, const uint8_t *fingerprint)
+      : transport(transport), sessionCache(sessionCache), fingerprint(fingerprint)
+  {
+    context = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_set_verify(context, SSL_VERIFY_NONE, nullptr);
+  }
+
+  ~TlsLinkClient() override
+  {
+    stop();
+    SSL_CTX_free(context);
+  }
+
+  bool connect(const char *host, uint16_t port) override
+  {
+    stop();
+    if (!transport.connect(host, port))
+    {
+      return false;
+    }
+
+    ssl = SSL_new(context);
+    BIO *bio = BIO_new(getBioMethod());
+    BIO_set_data(bio, this);
+    BIO_set_init(bio, 1);
+    SSL_set_bio(ssl, bio, bio);
+    SSL_set_tlsext_host_name(ssl, host);
+
+    const uint32_t serverId = getTlsServerId(host, port, fingerprint);
+    size_t sessionLength = 0;
+    const uint8_t *sessionData = getTlsSession(sessionCache, serverId, sessionLength);
+    if (sessionData != nullptr)
+    {
+      SSL_SESSION *session = d2i_SSL_SESSION(nullptr, &sessionData, static_cast<long>(sessionLength));
+      if (session == nullptr || SSL_set_session(ssl, session) != 1)
+      {
+        clearTlsSession(sessionCache);
+      }
+      SSL_SESSION_free(session);
+    }
+
+    const auto handshakeStart = std::chrono::steady_clock::now();
+    int result;
+    while ((result = SSL_connect(ssl)) != 1)
+    {
+      const int error = SSL_get_error(ssl, result);
+      if ((error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) || !transport.connected())
+      {
+        deviceLog("TLS handshake failed.\n");
+        clearTlsSession(sessionCache);
+        stop();
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    const uint32_t handshakeMillis = static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - handshakeStart).count());
+
+    const bool isResumed = SSL_session_reused(ssl) == 1;
+    if (!isResumed && !isPinMatched())
+    {
+      deviceLog("Server certificate does not match the pinned fingerprint.\n");
+      clearTlsSession(sessionCache);
+      stop();
+      return false;
+    }
+
+    recordTlsHandshake(sessionCache, isResumed, handshakeMillis);
+    (isResumed ? resumedHandshakeMillis : fullHandshakeMillis).push_back(handshakeMillis);
+    storeSession(serverId);
+    return true;
+  }
+
+  size_t write(const uint8_t *data, size_t length) override
+  {
+    size_t written = 0;
+    while (ssl != nullptr && written < length)
+    {
+      const int result = SSL_write(ssl, data + written, static_cast<int>(length - written));
+      if (result > 0)
+      {
+        written += result;
+        continue;
+      }
+
+      const int error = SSL_get_error(ssl, result);
+      if ((error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) || !transport.connected())
+      {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+
+    return written;
+  }
+
+  int available() override
+  {
+    if (ssl != nullptr && plainOffset == plainLength && transport.available() > 0)
+    {
+      const int result = SSL_read(ssl, plain, sizeof(plain));
+      plainOffset = 0;
+      plainLength = result > 0 ? result : 0;
+      if (result <= 0 && SSL_get_error(ssl, result) == SSL_ERROR_ZERO_RETURN)
+      {
+        isPeerClosed = true;
+      }
+    }
+
+    return static_cast<int>(plainLength - plainOffset);
+  }
+
+  int read(uint8_t *data, size_t length) override
+  {
+    const size_t count = std::min(length, static_cast<size_t>(available()));
+    memcpy(data, plain + plainOffset, count);
+    plainOffset += count;
+    return static_cast<int>(count);
+  }
+
+  bool connected() override
+  {
+    return ssl != nullptr && (plainOffset < plainLength || (!isPeerClosed && transport.connected()));
+  }
+
+  void stop() override
+  {
+    if (ssl != nullptr)
+    {
+      SSL_free(ssl);
+      ssl = nullptr;
+    }
+    transport.stop();
+    plainOffset = 0;
+    plainLength = 0;
+    isPeerClosed = false;
+  }
+
+  const std::vector<uint32_t> &getFullHandshakeMillis() const { return fullHandshakeMillis; }
+  const std::vector<uint32_t> &getResumedHandshakeMillis() const { return resumedHandshakeMillis; }
+
+private:
+  bool isPinMatched() const
+  {
+    X509 *certificate = SSL_get1_peer_certificate(ssl);
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    const bool isMatched = certificate != nullptr && X509_digest(certificate, EVP_sha256(), digest, &digestLength) == 1 &&
+                           digestLength == TLS_FINGERPRINT_LENGTH && memcmp(digest, fingerprint, digestLength) == 0;
+    X509_free(certificate);
+    return isMatched;
+  }
+
+  void storeSession(uint32_t serverId)
+  {
+    SSL_SESSION *session = SSL_get1_session(ssl);
+    uint8_t sessionData[TLS_SESSION_MAX_LENGTH];
+    const int sessionLength = session != nullptr ? i2d_SSL_SESSION(session, nullptr) : 0;
+    uint8_t *end = sessionData;
+    if (sessionLength <= 0 || sessionLength > TLS_SESSION_MAX_LENGTH || i2d_SSL_SESSION(session, &end) != sessionLength ||
+        !storeTlsSession(sessionCache, serverId, sessionData, sessionLength))
+    {
+      deviceLog("TLS session cannot be kept for the next wake.\n");
+      clearTlsSession(sessionCache);
+    }
+    SSL_SESSION_free(session);
+  }
+
+  // Plain BIO over the transport, which only has non-blocking reads.
+  static BIO_METHOD *getBioMethod()
+  {
+    static BIO_METHOD *method = []()
+    {
+      BIO_METHOD *created = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "network client");
+      BIO_meth_set_write(created, writeToTransport);
+      BIO_meth_set_read(created, readFromTransport);
+      BIO_meth_set_ctrl(created, controlTransport);
+      return created;
+    }();
+    return method;
+  }
+
+  static int writeToTransport(BIO *bio, const char *data, int length)
+  {
+    auto *client = static_cast<TlsLinkClient *>(BIO_get_data(bio));
+    return static_cast<int>(client->transport.write(reinterpret_cast<const uint8_t *>(data), length));
+  }
+
+  static int readFromTransport(BIO *bio, char *data, int length)
+  {
+    auto *client = static_cast<TlsLinkClient *>(BIO_get_data(bio));
+    BIO_clear_retry_flags(bio);
+    if (client->transport.available() <= 0)
+    {
+      if (client->transport.connected())
+      {
+        BIO_set_retry_read(bio);
+        return -1;
+      }
+      return 0;
+    }
+
+    return client->transport.read(reinterpret_cast<uint8_t *>(data), length);
+  }
+
+  static long controlTransport(BIO *, int command, long, void *) { return command == BIO_CTRL_FLUSH ? 1 : 0; }
+
+  NetworkClient &transport;
+  TlsSessionCache &sessionCache;
+  const uint8_t *fingerprint;
+  SSL_CTX *context = nullptr;
+  SSL *ssl = nullptr;
+  uint8_t plain[16384];
+  size_t plainLength = 0;
+  size_t plainOffset = 0;
+  bool isPeerClosed = false;
+  std::vector<uint32_t> fullHandshakeMillis;
+  std::vector<uint32_t> resumedHandshakeMillis;
+};
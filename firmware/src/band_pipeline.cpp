@@ -0,0 +1,167 @@
+#include "band_pipeline.h"
+
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <esp_heap_caps.h>
+#endif
+
+static uint8_t *allocatePlane(size_t bytes, bool isExternalMemory)
+{
+#ifdef ARDUINO
+  if (isExternalMemory)
+  {
+    return static_cast<uint8_t *>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  }
+#else
+  (void)isExternalMemory; // host builds have no PSRAM
+#endif
+  return static_cast<uint8_t *>(malloc(bytes));
+}
+
+bool BandPipeline::allocateBuffers(Buffers &buffers, const FrameLayout &layout)
+{
+  const size_t planeBytes = layout.getBandPlaneBytes();
+  const bool hasRed = layout.panel.planeCount > 1;
+  for (; buffers.count < layout.slotCount && buffers.count < maxSlots; ++buffers.count)
+  {
+    buffers.black[buffers.count] = allocatePlane(planeBytes, layout.isExternalMemory);
+    buffers.red[buffers.count] = hasRed ? allocatePlane(planeBytes, layout.isExternalMemory) : nullptr;
+    if (buffers.black[buffers.count] == nullptr || (hasRed && buffers.red[buffers.count] == nullptr))
+    {
+      free(buffers.black[buffers.count]);
+      free(buffers.red[buffers.count]);
+      break;
+    }
+  }
+
+  return buffers.count > 0;
+}
+
+BandPipeline::BandPipeline(const Buffers &buffers, FrameDisplay &display, Clock &clock)
+    : slotCount(buffers.count < maxSlots ? buffers.count : maxSlots), display(display), clock(clock)
+{
+  for (uint8_t i = 0; i < slotCount; ++i)
+  {
+    slots[i] = FrameBand{buffers.black[i], buffers.red[i], 0, 0};
+  }
+}
+
+#ifdef ARDUINO
+bool BandPipeline::begin()
+{
+  producerTask = xTaskGetCurrentTaskHandle();
+  const BaseType_t otherCore = xPortGetCoreID() == 0 ? 1 : 0;
+  if (slotCount < 2 || xTaskCreatePinnedToCore(run, "display", displayTaskStackBytes, this, 1, &consumerTask, otherCore) != pdPASS)
+  {
+    consumerTask = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+FrameBand &BandPipeline::acquire()
+{
+  const uint32_t current = produced.load(std::memory_order_relaxed);
+  while (current - consumed.load(std::memory_order_acquire) == slotCount)
+  {
+    const uint32_t waitStart = clock.micros();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    waitMicros += clock.micros() - waitStart;
+  }
+
+  return slots[current % slotCount];
+}
+
+void BandPipeline::publish()
+{
+  produced.fetch_add(1, std::memory_order_release);
+  if (consumerTask == nullptr)
+  {
+    writeNext();
+    return;
+  }
+
+  xTaskNotifyGive(consumerTask);
+}
+
+void BandPipeline::finish()
+{
+  if (consumerTask == nullptr)
+  {
+    return;
+  }
+
+  isStopping.store(true, std::memory_order_release);
+  xTaskNotifyGive(consumerTask);
+
+  const uint32_t waitStart = clock.micros();
+  while (!isFinished.load(std::memory_order_acquire))
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  waitMicros += clock.micros() - waitStart;
+  consumerTask = nullptr;
+  deviceLog("Display task stack: %u of %u bytes unused.\n", static_cast<unsigned>(stackHeadroomBytes),
+            static_cast<unsigned>(displayTaskStackBytes));
+}
+
+void BandPipeline::run(void *parameter)
+{
+  auto *pipeline = static_cast<BandPipeline *>(parameter);
+  while (true)
+  {
+    // Read the stop flag first, so that every band published before it is seen below.
+    const bool isStopping = pipeline->isStopping.load(std::memory_order_acquire);
+    if (pipeline->consumed.load(std::memory_order_relaxed) != pipeline->produced.load(std::memory_order_acquire))
+    {
+      pipeline->writeNext();
+      xTaskNotifyGive(pipeline->producerTask);
+      continue;
+    }
+
+    if (isStopping)
+    {
+      break;
+    }
+
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+
+  // The high-water mark is in bytes on the ESP32, where stack sizes are given in bytes as well.
+  pipeline->stackHeadroomBytes = uxTaskGetStackHighWaterMark(nullptr);
+  pipeline->isFinished.store(true, std::memory_order_release);
+  xTaskNotifyGive(pipeline->producerTask);
+  vTaskDelete(nullptr);
+}
+#else
+bool BandPipeline::begin()
+{
+  return false;
+}
+
+FrameBand &BandPipeline::acquire()
+{
+  return slots[produced.load(std::memory_order_relaxed) % slotCount];
+}
+
+void BandPipeline::publish()
+{
+  produced.fetch_add(1, std::memory_order_release);
+  writeNext();
+}
+
+void BandPipeline::finish()
+{
+}
+#endif
+
+void BandPipeline::writeNext()
+{
+  const uint32_t current = consumed.load(std::memory_order_relaxed);
+  const uint32_t writeStart = clock.micros();
+  display.writeBand(slots[current % slotCount]);
+  writeMicros += clock.micros() - writeStart;
+  consumed.store(current + 1, std::memory_order_release);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include "device_interfaces.h"
+#include "panel_profile.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// Hands decoded bands from the network side to a display task on the other core, so that
+// receiving the next band overlaps with pushing the previous one over SPI.
+// The slots form a single-producer/single-consumer ring; both sides wake each other with task notifications.
+// Host builds have no second core and always write synchronously.
+class BandPipeline
+{
+public:
+  static const uint8_t maxSlots = 2;
+  // The display task also powers up the panel on the first band, which runs the SPI and GxEPD2 init with
+  // its serial diagnostics. finish() logs how much of the stack the task left unused.
+  static const uint32_t displayTaskStackBytes = 6144;
+
+  struct Buffers
+  {
+    uint8_t *black[maxSlots];
+    uint8_t *red[maxSlots]; // nullptr for black and white panels
+    uint8_t count;
+  };
+
+  // Allocates the band buffers of the layout, in PSRAM if it says so, for as many of its slots as fit.
+  // Returns false if not even one does.
+  static bool allocateBuffers(Buffers &buffers, const FrameLayout &layout);
+
+  BandPipeline(const Buffers &buffers, FrameDisplay &display, Clock &clock);
+
+  // Starts the display task. Without it, bands are written synchronously on publish.
+  bool begin();
+
+  // Waits until a slot is free and returns it for decoding.
+  FrameBand &acquire();
+
+  // Queues the acquired slot for writing.
+  void publish();
+
+  // Waits until every published band is written and stops the display task.
+  void finish();
+
+  uint32_t getWriteMicros() const { return writeMicros; }
+  uint32_t getWaitMicros() const { return waitMicros; }
+  uint32_t getBandCount() const { return consumed; }
+
+private:
+  void writeNext();
+
+  FrameBand slots[maxSlots];
+  const uint8_t slotCount;
+  FrameDisplay &display;
+  Clock &clock;
+
+#ifdef ARDUINO
+  static void run(void *parameter);
+
+  TaskHandle_t producerTask = nullptr;
+  TaskHandle_t consumerTask = nullptr;
+  std::atomic<bool> isStopping{false};
+  std::atomic<bool> isFinished{false};
+  uint32_t stackHeadroomBytes = 0;
+#endif
+  std::atomic<uint32_t> produced{0};
+  std::atomic<uint32_t> consumed{0};
+
+  uint32_t writeMicros = 0;
+  uint32_t waitMicros = 0;
+};
@@ -0,0 +1,75 @@
+#include "captive_dns.h"
+
+#include <string.h>
+
+static const size_t headerLength = 12;
+static const size_t answerLength = 16;
+static const uint16_t typeA = 1;
+static const uint16_t typeAny = 255;
+static const uint32_t answerTtlSeconds = 60;
+
+static uint16_t readUint16(const uint8_t *data) { return static_cast<uint16_t>((data[0] << 8) | data[1]); }
+
+static uint8_t *writeUint16(uint8_t *data, uint16_t value)
+{
+  data[0] = static_cast<uint8_t>(value >> 8);
+  data[1] = static_cast<uint8_t>(value);
+  return data + 2;
+}
+
+size_t writeCaptiveDnsResponse(const uint8_t *query, size_t queryLength, const uint8_t address[4], uint8_t *response,
+                               size_t capacity)
+{
+  // A standard query (QR 0, opcode 0) with exactly one question.
+  if (queryLength < headerLength || (query[2] & 0xF8) != 0 || readUint16(query + 4) != 1)
+  {
+    return 0;
+  }
+
+  size_t position = headerLength;
+  while (position < queryLength && query[position] != 0)
+  {
+    // Compression pointers are not expected in a question and would end the name here.
+    if ((query[position] & 0xC0) != 0)
+    {
+      return 0;
+    }
+    position += query[position] + 1;
+  }
+
+  const size_t questionEnd = position + 1 + 4; // root label, type and class
+  if (questionEnd > queryLength)
+  {
+    return 0;
+  }
+
+  const uint16_t type = readUint16(query + questionEnd - 4);
+  const bool hasAnswer = type == typeA || type == typeAny;
+  const size_t length = questionEnd + (hasAnswer ? answerLength : 0);
+  if (length > capacity)
+  {
+    return 0;
+  }
+
+  // The header and question are echoed; additional records of the query, such as EDNS options, are dropped.
+  memmove(response, query, questionEnd);
+  response[2] = 0x84 | (query[2] & 0x01); // response, authoritative, recursion desired as asked
+  response[3] = 0x00; // no error
+  writeUint16(response + 6, hasAnswer ? 1 : 0);
+  writeUint16(response + 8, 0);
+  writeUint16(response + 10, 0);
+  if (!hasAnswer)
+  {
+    return length;
+  }
+
+  uint8_t *answer = response + questionEnd;
+  answer = writeUint16(answer, 0xC000 | headerLength); // the name of the question
+  answer = writeUint16(answer, typeA);
+  answer = writeUint16(answer, 1); // IN
+  answer = writeUint16(answer, answerTtlSeconds >> 16);
+  answer = writeUint16(answer, answerTtlSeconds & 0xFFFF);
+  answer = writeUint16(answer, 4);
+  memcpy(answer, address, 4);
+  return length;
+}
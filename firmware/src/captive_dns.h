@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest DNS message sent over UDP without EDNS.
+#define CAPTIVE_DNS_MAX_MESSAGE_LENGTH 512
+
+// Answers a DNS query of a client of the setup access point with the address of the device, whatever name it
+// asks for, so that phones open the setup page when they probe for a captive portal. A and ANY queries get
+// one A record; other types get an empty answer so that clients fall back to IPv4.
+// Returns the response length, or 0 when the message is not a standard query with one question and is
+// to be ignored.
+size_t writeCaptiveDnsResponse(const uint8_t *query, size_t queryLength, const uint8_t address[4], uint8_t *response,
+                               size_t capacity);
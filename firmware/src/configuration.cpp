@@ -0,0 +1,41 @@
+#include "configuration.h"
+
+static const char *CONFIGURATION_SSID = "ssid";
+static const char *CONFIGURATION_PASSWORD = "pwd";
+static const char *CONFIGURATION_DASHBOARD_URL = "url";
+static const char *CONFIGURATION_DASHBOARD_PORT = "port";
+static const char *CONFIGURATION_DASHBOARD_RATE = "rate";
+static const char *CONFIGURATION_DASHBOARD_API_KEY = "apikey";
+static const char *CONFIGURATION_CERTIFICATE_FINGERPRINT = "certsha";
+
+std::optional<Configuration> getConfiguration(SettingsStore &store)
+{
+  Configuration configuration{
+      store.getString(CONFIGURATION_SSID, ""),
+      store.getString(CONFIGURATION_PASSWORD, ""),
+      store.getString(CONFIGURATION_DASHBOARD_URL, ""),
+      store.getInt(CONFIGURATION_DASHBOARD_PORT, 80),
+      store.getULong64(CONFIGURATION_DASHBOARD_RATE, 60),
+      store.getString(CONFIGURATION_DASHBOARD_API_KEY, ""),
+      store.getString(CONFIGURATION_CERTIFICATE_FINGERPRINT, "")};
+
+  return configuration.ssid.empty() || configuration.dashboardUrl.empty()
+             ? std::nullopt
+             : std::make_optional(configuration);
+}
+
+void storeConfiguration(SettingsStore &store, const Configuration &config)
+{
+  store.putString(CONFIGURATION_SSID, config.ssid);
+  store.putString(CONFIGURATION_PASSWORD, config.password);
+  store.putString(CONFIGURATION_DASHBOARD_URL, config.dashboardUrl);
+  store.putInt(CONFIGURATION_DASHBOARD_PORT, config.dashboardPort);
+  store.putULong64(CONFIGURATION_DASHBOARD_RATE, config.dashboardRate);
+  store.putString(CONFIGURATION_DASHBOARD_API_KEY, config.dashboardApiKey);
+  store.putString(CONFIGURATION_CERTIFICATE_FINGERPRINT, config.certificateFingerprint);
+}
+
+void clearConfiguration(SettingsStore &store)
+{
+  store.clear();
+}
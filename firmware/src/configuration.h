@@ -0,0 +1,21 @@
+#pragma once
+
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include "device_interfaces.h"
+
+struct Configuration
+{
+  std::string ssid;
+  std::string password;
+  std::string dashboardUrl;
+  int dashboardPort;
+  uint64_t dashboardRate;
+  std::string dashboardApiKey;
+  std::string certificateFingerprint; // SHA-256 of the server certificate; HTTPS is used when set
+};
+
+std::optional<Configuration> getConfiguration(SettingsStore &store);
+void storeConfiguration(SettingsStore &store, const Configuration &config);
+void clearConfiguration(SettingsStore &store);
@@ -0,0 +1,33 @@
+#include "crc32.h"
+
+#include <array>
+
+static constexpr std::array<uint32_t, 256> createCrc32Table()
+{
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < table.size(); ++i)
+  {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+    }
+    table[i] = crc;
+  }
+
+  return table;
+}
+
+// Built at compile time, so it lives in flash instead of taking RAM.
+static constexpr std::array<uint32_t, 256> crc32Table = createCrc32Table();
+
+uint32_t updateCrc32(uint32_t crc, const uint8_t *data, size_t length)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < length; ++i)
+  {
+    crc = crc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+
+  return ~crc;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC-32 as used by zlib and Ethernet, matching the checksums the server appends to frame bands.
+// Pass 0 to start and the previous result to continue over more data.
+uint32_t updateCrc32(uint32_t crc, const uint8_t *data, size_t length);
@@ -0,0 +1,882 @@
+#include "dashboard_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "crc32.h"
+
+FetchResult DashboardClient::fetchBinaryData(FrameDisplay &display, BandPipeline::Buffers &buffers,
+                                             DisplayedFrame &displayedFrame, bool isManualRefresh)
+{
+  deviceLog("Connecting to the remote server...\n");
+
+  // A manual refresh always redraws the panel, even if the frame is unchanged.
+  const char *etag = isManualRefresh || displayedFrame.etag[0] == '\0' ? nullptr : displayedFrame.etag;
+
+  char url[176];
+  int urlLength = snprintf(url, sizeof(url), "/api/render/binary?width=%u&height=%u&planes=%u&encoding=rle,planar&bandHeight=%u&checksum=crc32",
+                           layout.panel.width, layout.panel.height, layout.panel.planeCount, layout.bandRows);
+  if (etag != nullptr)
+  { // lets the server answer with only the rows that changed since the displayed frame
+    urlLength += snprintf(url + urlLength, sizeof(url) - urlLength, "&since=");
+    for (const char *c = etag; *c != '\0' && urlLength < static_cast<int>(sizeof(url)) - 1; ++c)
+    {
+      if (*c != '"')
+      {
+        url[urlLength++] = *c;
+      }
+    }
+    url[urlLength] = '\0';
+  }
+
+  // Stored frames are offered as well; the server then names the current one in its 304 response.
+  char etags[(FRAME_ETAG_MAX_LENGTH + 2) * (FrameCacheIndex::capacity + 1)];
+  size_t etagsLength = etag != nullptr ? snprintf(etags, sizeof(etags), "%s", etag) : 0;
+  if (frameCache != nullptr && !isManualRefresh)
+  {
+    etagsLength = frameCache->appendETags(etags, etagsLength, sizeof(etags), etag);
+  }
+
+  char wakeTimingsReport[800];
+  const bool hasWakeTimingsReport = formatPendingWakeTimings(wakeTimings, wakeTimingsReport, sizeof(wakeTimingsReport)) > 0;
+  if (!trySendGetRequest(url, etagsLength > 0 ? etags : nullptr, hasWakeTimingsReport ? wakeTimingsReport : nullptr))
+  {
+    deviceLog("Failed to connect to the remote server...\n");
+    return FetchResult::Failed;
+  }
+
+  ResponseReader reader(client, clock);
+  const auto headers = readResponseHeaders(reader);
+  if (headers.statusCode == 200 || headers.statusCode == 304)
+  { // the server has stored the reported cycles
+    clearPendingWakeTimings(wakeTimings);
+  }
+
+  if (headers.hasNextWait)
+  { // servers that predate the header are asked separately before sleeping
+    hasFrameWait = true;
+    frameWaitSeconds = headers.nextWaitSeconds;
+    frameWaitReceivedMicros = clock.micros();
+  }
+
+  if (headers.statusCode == 200 || headers.statusCode == 304)
+  {
+    strcpy(firmwareUpdate, headers.firmwareUpdate);
+  }
+
+  if (headers.hasServerTime)
+  {
+    hasServerTime = true;
+    serverSecondsOfDay = headers.serverSecondsOfDay;
+    serverUtcSecondsOfDay = headers.serverUtcSecondsOfDay;
+    strcpy(updateScheduleId, headers.updateScheduleId);
+    serverTimeReceivedMicros = clock.micros();
+  }
+
+  if (headers.statusCode == 304)
+  {
+    client.stop();
+    const bool isStoredFrame = frameCache != nullptr && frameCache->contains(headers.etag) &&
+                               (etag == nullptr || strcmp(headers.etag, etag) != 0);
+    return isStoredFrame ? showStoredFrame(display, buffers, displayedFrame, headers.etag) : FetchResult::NotModified;
+  }
+
+  if (headers.statusCode != 200)
+  {
+    deviceLog("The request was not successful...\n");
+    client.stop();
+    return FetchResult::Failed;
+  }
+
+  if (headers.planeCount != layout.panel.planeCount)
+  { // servers that predate black and white frames always send the red plane
+    deviceLog("The server sent %u planes for a panel with %u.\n", headers.planeCount, layout.panel.planeCount);
+    client.stop();
+    return FetchResult::Failed;
+  }
+
+  if (!ensureBandBuffers(buffers))
+  {
+    client.stop();
+    return FetchResult::Failed;
+  }
+
+  deviceLog("Reading image content...\n");
+
+  // The panel content is about to be overwritten, so the previous tag no longer describes it.
+  setDisplayedFrameETag(displayedFrame, "");
+  display.beginFrame();
+
+  // Servers that predate the compressed encoding ignore the request and send raw frames.
+  FrameBandDecoder decoder(headers.encoding, layout.panel.getRowBytes(), layout.panel.planeCount);
+  BandPipeline pipeline(buffers, display, clock);
+  if (!pipeline.begin())
+  {
+    deviceLog("Writing bands without a display task.\n");
+  }
+
+  // Whole frames are written to flash as they arrive, so that they can be drawn from there when they come back.
+  // Stored frames are verified when they are drawn, which needs the band checksums.
+  bool isStoring = frameCache != nullptr && !headers.isDelta && headers.hasChecksums &&
+                   frameCache->beginStore(headers.etag, headers.encoding, layout);
+  if (isStoring)
+  {
+    reader.storeBodyIn(*frameCache);
+  }
+
+  const uint32_t streamStart = clock.micros();
+  FrameTransfer transfer{headers.isDelta, headers.hasChecksums, headers.hasChecksums && headers.etag[0] != '\0', 0,
+                         static_cast<uint16_t>(headers.isDelta ? 0 : layout.getBandCount()), 0};
+  bool isComplete = headers.isDelta
+                        ? writeDeltaRegions(reader, decoder, pipeline, transfer)
+                        : writeFullFrame(reader, decoder, pipeline, transfer);
+
+  // Servers that send checksums also serve byte ranges of the frame, so only the part after the last verified band is fetched again.
+  for (uint8_t attempt = 0; !isComplete && transfer.isResumable && attempt < maxResumeAttempts; ++attempt)
+  {
+    if (isStoring)
+    { // the stored part may end inside a band, so the frame is not stored this time
+      frameCache->abortStore();
+      isStoring = false;
+    }
+
+    isComplete = resumeFrame(url, headers, decoder, pipeline, transfer);
+  }
+  pipeline.finish();
+  const uint32_t streamMicros = clock.micros() - streamStart;
+  if (reader.getFirstBodyMicros() != 0)
+  {
+    markWakePhase(WakePhase::FirstBodyByte, reader.getFirstBodyMicros());
+  }
+  markWakePhase(WakePhase::BandsWritten, clock.micros());
+  setWakeBandTiming(wakeTimings, pipeline.getBandCount(), pipeline.getWriteMicros() / 1000);
+
+  client.stop();
+
+  // Receiving and writing overlap when the sum of both exceeds the total stream time.
+  const uint32_t networkMicros = streamMicros - pipeline.getWaitMicros();
+  deviceLog("Frame streamed in %lu ms: network %lu ms, display %lu ms, overlap %ld ms\n",
+            static_cast<unsigned long>(streamMicros / 1000),
+            static_cast<unsigned long>(networkMicros / 1000),
+            static_cast<unsigned long>(pipeline.getWriteMicros() / 1000),
+            (static_cast<long>(networkMicros + pipeline.getWriteMicros()) - static_cast<long>(streamMicros)) / 1000);
+
+  if (isStoring && isComplete)
+  {
+    frameCache->commitStore();
+  }
+  else if (isStoring)
+  {
+    frameCache->abortStore();
+  }
+
+  if (!isComplete)
+  { // the panel is not refreshed with a partial frame, and the next wake downloads it again
+    deviceLog("Frame data is incomplete, keeping the displayed frame.\n");
+    return FetchResult::Failed;
+  }
+
+  setDisplayedFrameETag(displayedFrame, headers.etag);
+  return FetchResult::Updated;
+}
+
+bool DashboardClient::resumeFrame(const char *url, const ResponseHeaders &headers, FrameBandDecoder &decoder,
+                                  BandPipeline &pipeline, FrameTransfer &transfer)
+{
+  client.stop();
+  deviceLog("Resuming frame download at byte %lu...\n", static_cast<unsigned long>(transfer.verifiedBytes));
+
+  // If-Range makes the server send the whole frame instead when it has changed since.
+  char rangeHeaders[48 + FRAME_ETAG_MAX_LENGTH];
+  snprintf(rangeHeaders, sizeof(rangeHeaders), "Range: bytes=%lu-\r\nIf-Range: %s\r\n",
+           static_cast<unsigned long>(transfer.verifiedBytes), headers.etag);
+  if (!trySendGetRequest(url, nullptr, nullptr, rangeHeaders))
+  {
+    return false;
+  }
+
+  ResponseReader reader(client, clock);
+  const auto resumed = readResponseHeaders(reader);
+  if (resumed.statusCode != 206 || resumed.rangeStart != transfer.verifiedBytes ||
+      resumed.isDelta != headers.isDelta || resumed.encoding != headers.encoding ||
+      resumed.planeCount != headers.planeCount || strcmp(resumed.etag, headers.etag) != 0)
+  {
+    deviceLog("The frame has changed and cannot be resumed.\n");
+    transfer.isResumable = false;
+    return false;
+  }
+
+  return transfer.isDelta
+             ? writeDeltaRegions(reader, decoder, pipeline, transfer)
+             : writeFullFrame(reader, decoder, pipeline, transfer);
+}
+
+FetchResult DashboardClient::showStoredFrame(FrameDisplay &display, BandPipeline::Buffers &buffers,
+                                             DisplayedFrame &displayedFrame, const char *etag)
+{
+  FrameEncoding encoding;
+  if (!frameCache->openFrame(etag, layout, encoding))
+  {
+    deviceLog("Stored frame %s cannot be read, downloading it.\n", etag);
+    frameCache->remove(etag);
+    return fetchBinaryData(display, buffers, displayedFrame, true);
+  }
+
+  if (!ensureBandBuffers(buffers))
+  {
+    frameCache->closeFrame();
+    return FetchResult::Failed;
+  }
+
+  deviceLog("Drawing stored frame %s...\n", etag);
+  setDisplayedFrameETag(displayedFrame, "");
+  display.beginFrame();
+
+  FrameBandDecoder decoder(encoding, layout.panel.getRowBytes(), layout.panel.planeCount);
+  BandPipeline pipeline(buffers, display, clock);
+  pipeline.begin();
+  StoredFrameReader reader(*frameCache);
+  FrameTransfer transfer{false, true, false, 0, layout.getBandCount(), 0};
+  const bool isComplete = writeFullFrame(reader, decoder, pipeline, transfer);
+  pipeline.finish();
+  frameCache->closeFrame();
+  markWakePhase(WakePhase::BandsWritten, clock.micros());
+  setWakeBandTiming(wakeTimings, pipeline.getBandCount(), pipeline.getWriteMicros() / 1000);
+
+  if (!isComplete)
+  { // a manual refresh neither offers stored frames nor expects the panel to hold the displayed one
+    deviceLog("Stored frame %s failed verification, downloading it.\n", etag);
+    frameCache->remove(etag);
+    return fetchBinaryData(display, buffers, displayedFrame, true);
+  }
+
+  setDisplayedFrameETag(displayedFrame, etag);
+  return FetchResult::Updated;
+}
+
+bool DashboardClient::writeFullFrame(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, FrameTransfer &transfer)
+{
+  const uint32_t bodyStart = transfer.verifiedBytes;
+  for (; transfer.nextRegion < transfer.regionCount; ++transfer.nextRegion)
+  {
+    const uint16_t y = transfer.nextRegion * layout.bandRows;
+    const uint16_t rows = layout.panel.height - y < layout.bandRows ? layout.panel.height - y : layout.bandRows;
+    if (!writeRegion(reader, decoder, pipeline, transfer.hasChecksums, y, rows))
+    {
+      return false;
+    }
+
+    transfer.verifiedBytes = bodyStart + reader.getBodyOffset();
+  }
+
+  return true;
+}
+
+bool DashboardClient::writeDeltaRegions(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, FrameTransfer &transfer)
+{
+  // Region count, then per region its first row and row count, all little-endian.
+  const uint32_t bodyStart = transfer.verifiedBytes;
+  uint8_t header[4];
+  if (transfer.verifiedBytes == 0)
+  {
+    if (!reader.readBytes(header, 2))
+    {
+      deviceLog("Incomplete frame data received, stopping.\n");
+      return false;
+    }
+
+    transfer.regionCount = header[0] | (header[1] << 8);
+    transfer.verifiedBytes = bodyStart + reader.getBodyOffset();
+    deviceLog("Updating changed regions: %u\n", transfer.regionCount);
+  }
+
+  for (; transfer.nextRegion < transfer.regionCount; ++transfer.nextRegion)
+  {
+    if (!reader.readBytes(header, sizeof(header)))
+    {
+      deviceLog("Incomplete frame data received, stopping.\n");
+      return false;
+    }
+
+    const uint16_t y = header[0] | (header[1] << 8);
+    const uint16_t rows = header[2] | (header[3] << 8);
+    if (rows == 0 || rows > layout.bandRows || y + rows > layout.panel.height)
+    {
+      deviceLog("Invalid frame region received, stopping.\n");
+      return false;
+    }
+
+    if (!writeRegion(reader, decoder, pipeline, transfer.hasChecksums, y, rows))
+    {
+      return false;
+    }
+
+    transfer.verifiedBytes = bodyStart + reader.getBodyOffset();
+  }
+
+  return true;
+}
+
+bool DashboardClient::writeRegion(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, bool hasChecksum,
+                                  uint16_t y, uint16_t rows)
+{
+  FrameBand &band = pipeline.acquire();
+  const size_t planeBytes = static_cast<size_t>(rows) * layout.panel.getRowBytes();
+  const bool hasRed = layout.panel.planeCount > 1;
+
+  bool isRead;
+  if (decoder.getEncoding() == FrameEncoding::Planar)
+  { // planar bands already match the display buffers, so they are read straight into them
+    isRead = reader.readBytes(band.black, planeBytes) && (!hasRed || reader.readBytes(band.red, planeBytes));
+  }
+  else
+  {
+    decoder.beginBand(band.black, band.red, rows);
+    isRead = reader.readBand(decoder);
+  }
+
+  if (!isRead)
+  {
+    deviceLog("Incomplete frame data received, stopping.\n");
+    return false;
+  }
+
+  if (hasChecksum)
+  { // the checksum covers the decoded rows and follows them, little-endian
+    uint8_t trailer[4];
+    if (!reader.readBytes(trailer, sizeof(trailer)))
+    {
+      deviceLog("Incomplete frame data received, stopping.\n");
+      return false;
+    }
+
+    const uint32_t expected = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<uint32_t>(trailer[3]) << 24);
+    const uint32_t blackCrc = updateCrc32(0, band.black, planeBytes);
+    if ((hasRed ? updateCrc32(blackCrc, band.red, planeBytes) : blackCrc) != expected)
+    { // the band is not written, so the panel memory never holds corrupted rows
+      deviceLog("Frame band at row %u failed verification, stopping.\n", y);
+      return false;
+    }
+  }
+
+  band.y = y;
+  band.rows = rows;
+  pipeline.publish();
+  return true;
+}
+
+std::optional<uint64_t> DashboardClient::fetchNextWaitSeconds()
+{
+  if (hasFrameWait)
+  {
+    if (!frameWaitSeconds.has_value())
+    {
+      return std::nullopt;
+    }
+
+    // The interval was measured from the frame response, before the panel refresh.
+    const uint64_t elapsedSeconds = (clock.micros() - frameWaitReceivedMicros) / 1000000;
+    return *frameWaitSeconds > elapsedSeconds ? *frameWaitSeconds - elapsedSeconds : 1;
+  }
+
+  deviceLog("Connecting to the remote server...\n");
+
+  if (!trySendGetRequest("/api/configuration/next-update-wait-seconds"))
+  {
+    return std::nullopt;
+  }
+
+  ResponseReader reader(client, clock);
+  if (!hasSuccessfulStatusCode(reader))
+  {
+    deviceLog("The request was not successful...\n");
+    client.stop();
+    return std::nullopt;
+  }
+
+  deviceLog("Reading content...\n");
+  char delayString[24];
+  const size_t delayLength = readBodyText(reader, delayString, sizeof(delayString));
+  deviceLog("%s\n", delayString);
+
+  client.stop();
+  return delayLength > 0
+             ? std::make_optional(strtoull(delayString, nullptr, 10))
+             : std::nullopt;
+}
+
+void DashboardClient::syncUpdateSchedule(UpdateSchedule &schedule, uint64_t deviceMillis)
+{
+  if (!hasServerTime)
+  { // servers that predate the header leave the schedule unsynced and the device sleeps as told
+    return;
+  }
+
+  const uint64_t elapsedMillis = (clock.micros() - serverTimeReceivedMicros) / 1000;
+  syncUpdateScheduleTime(schedule, serverSecondsOfDay, serverUtcSecondsOfDay, deviceMillis - elapsedMillis);
+  if (strcmp(schedule.id, updateScheduleId) == 0)
+  {
+    return;
+  }
+
+  deviceLog("Fetching the update schedule %s...\n", updateScheduleId);
+  if (!trySendGetRequest("/api/configuration/update-schedule"))
+  {
+    return;
+  }
+
+  ResponseReader reader(client, clock);
+  if (!hasSuccessfulStatusCode(reader))
+  {
+    deviceLog("The request was not successful...\n");
+    client.stop();
+    return;
+  }
+
+  // "<id>;" plus up to capacity times of at most five digits and a comma
+  char scheduleText[UPDATE_SCHEDULE_ID_MAX_LENGTH + 2 + UpdateSchedule::capacity * 6];
+  readBodyText(reader, scheduleText, sizeof(scheduleText));
+  client.stop();
+  if (!setUpdateTimes(schedule, scheduleText))
+  {
+    deviceLog("Invalid update schedule received.\n");
+    return;
+  }
+  deviceLog("Stored %u update times.\n", schedule.count);
+}
+
+bool DashboardClient::updateFirmware(FirmwareUpdater &updater, RejectedFirmware &rejectedFirmware, bool isServerPinned)
+{
+  // The version goes into the URL, so anything but a plain version name is refused.
+  if (!hasFirmwareUpdate() || firmwareBuild == nullptr || strspn(firmwareUpdate, "0123456789.-abcdefghijklmnopqrstuvwxyz") != strlen(firmwareUpdate))
+  {
+    return false;
+  }
+
+  // The SHA-256 in the delta only protects against a broken download; the image is trusted because the server is.
+  if (!isServerPinned)
+  {
+    deviceLog("Firmware update to %s skipped: updates are only taken over TLS with a pinned certificate.\n", firmwareUpdate);
+    return false;
+  }
+
+  if (isFirmwareRejected(rejectedFirmware, firmwareUpdate))
+  {
+    deviceLog("Firmware update to %s skipped: its delta was made for another image.\n", firmwareUpdate);
+    return false;
+  }
+
+  deviceLog("Fetching the firmware update to %s...\n", firmwareUpdate);
+  char url[48 + FIRMWARE_VERSION_MAX_LENGTH];
+  snprintf(url, sizeof(url), "/api/firmware/delta?to=%s", firmwareUpdate);
+  const uint32_t updateStart = clock.micros();
+  if (!trySendGetRequest(url))
+  {
+    return false;
+  }
+
+  ResponseReader reader(client, clock);
+  if (!hasSuccessfulStatusCode(reader))
+  {
+    deviceLog("The request was not successful...\n");
+    client.stop();
+    return false;
+  }
+
+  // The delta is applied as it arrives and never stored; an interrupted download is started again on a later wake.
+  FirmwarePatcher patcher(updater);
+  uint8_t chunk[1024];
+  uint32_t deltaBytes = 0;
+  while (!patcher.isComplete())
+  {
+    const size_t count = reader.read(chunk, sizeof(chunk));
+    if (count == 0 || !patcher.write(chunk, count))
+    {
+      break;
+    }
+    deltaBytes += count;
+  }
+  client.stop();
+
+  if (patcher.isForAnotherImage())
+  {
+    rejectFirmware(rejectedFirmware, firmwareUpdate);
+  }
+
+  if (!patcher.isComplete())
+  {
+    deviceLog("The firmware delta is incomplete.\n");
+    updater.abort();
+    return false;
+  }
+
+  if (!updater.finish(patcher.getHeader().targetSha256))
+  {
+    deviceLog("The new firmware image failed verification.\n");
+    return false;
+  }
+
+  deviceLog("Firmware %s written from a delta of %lu bytes for an image of %lu bytes in %lu ms.\n",
+            firmwareUpdate, static_cast<unsigned long>(deltaBytes),
+            static_cast<unsigned long>(patcher.getHeader().targetSize),
+            static_cast<unsigned long>((clock.micros() - updateStart) / 1000));
+  return true;
+}
+
+size_t DashboardClient::readBodyText(ResponseReader &reader, char *text, size_t capacity)
+{
+  size_t length = 0;
+  while (length < capacity - 1)
+  {
+    const size_t count = reader.read(reinterpret_cast<uint8_t *>(text + length), capacity - 1 - length);
+    if (count == 0)
+    {
+      break;
+    }
+
+    length += count;
+  }
+
+  text[length] = '\0';
+  return length;
+}
+
+bool DashboardClient::ensureBandBuffers(BandPipeline::Buffers &buffers)
+{
+  if (buffers.count > 0 || BandPipeline::allocateBuffers(buffers, layout))
+  {
+    return true;
+  }
+
+  deviceLog("Failed to allocate frame buffers!\n");
+  return false;
+}
+
+bool DashboardClient::hasSuccessfulStatusCode(ResponseReader &reader)
+{
+  return readResponseHeaders(reader).statusCode == 200;
+}
+
+ResponseHeaders DashboardClient::readResponseHeaders(ResponseReader &reader)
+{
+  deviceLog("Reading headers...\n");
+  ResponseHeaders headers{0, "", FrameEncoding::Raw, 2, false, false, 0, false, std::nullopt, false, 0, std::nullopt, "", ""};
+  char encoding[8] = "";
+  char deltaBase[FRAME_ETAG_MAX_LENGTH + 1] = "";
+  char checksum[8] = "";
+  char planes[4] = "";
+  char contentRange[48] = "";
+  char nextWait[24] = "";
+  char updateSchedule[UPDATE_SCHEDULE_ID_MAX_LENGTH + 14] = "";
+  HttpHeaderField etagField{"ETag", headers.etag, sizeof(headers.etag), false};
+  HttpHeaderField encodingField{"X-Frame-Encoding", encoding, sizeof(encoding), false};
+  HttpHeaderField deltaField{"X-Frame-Delta", deltaBase, sizeof(deltaBase), false};
+  HttpHeaderField checksumField{"X-Frame-Checksum", checksum, sizeof(checksum), false};
+  HttpHeaderField planesField{"X-Frame-Planes", planes, sizeof(planes), false};
+  HttpHeaderField contentRangeField{"Content-Range", contentRange, sizeof(contentRange), false};
+  HttpHeaderField nextWaitField{"X-Next-Update-Wait-Seconds", nextWait, sizeof(nextWait), false};
+  HttpHeaderField updateScheduleField{"X-Update-Schedule", updateSchedule, sizeof(updateSchedule), false};
+  HttpHeaderField firmwareUpdateField{"X-Firmware-Update", headers.firmwareUpdate, sizeof(headers.firmwareUpdate), false};
+
+  HttpHeaderField *fields[] = {&etagField, &encodingField, &deltaField, &checksumField, &planesField,
+                               &contentRangeField, &nextWaitField, &updateScheduleField, &firmwareUpdateField};
+  static_assert(sizeof(fields) / sizeof(fields[0]) <= HttpResponseParser::maxCapturedHeaders,
+                "HttpResponseParser::maxCapturedHeaders is too small for the response headers");
+
+  HttpResponseParser &parser = reader.getParser();
+  for (HttpHeaderField *field : fields)
+  {
+    if (!parser.captureHeader(*field))
+    {
+      deviceLog("Cannot capture header %s.\n", field->name);
+      return headers;
+    }
+  }
+  if (!reader.readHeaders())
+  {
+    deviceLog("Invalid response headers received.\n");
+    return headers;
+  }
+  markWakePhase(WakePhase::HeadersReceived, clock.micros());
+
+  headers.statusCode = parser.getStatusCode();
+  headers.encoding = strcmp(encoding, "rle") == 0      ? FrameEncoding::Rle
+                     : strcmp(encoding, "planar") == 0 ? FrameEncoding::Planar
+                                                       : FrameEncoding::Raw;
+  headers.isDelta = deltaField.isPresent;
+  headers.hasChecksums = strcmp(checksum, "crc32") == 0;
+  headers.planeCount = strcmp(planes, "1") == 0 ? 1 : 2;
+
+  // "bytes <first>-<last>/<length>"
+  if (strncmp(contentRange, "bytes ", 6) == 0)
+  {
+    headers.rangeStart = strtoul(contentRange + 6, nullptr, 10);
+  }
+
+  // "none" means the dashboard has no update times and the configured rate applies.
+  headers.hasNextWait = nextWaitField.isPresent;
+  if (nextWaitField.isPresent && strcmp(nextWait, "none") != 0)
+  {
+    headers.nextWaitSeconds = strtoull(nextWait, nullptr, 10);
+  }
+
+  // "<server local seconds after midnight>[,<UTC seconds after midnight>];<update schedule id>"
+  const char *scheduleId = strchr(updateSchedule, ';');
+  if (updateScheduleField.isPresent && scheduleId != nullptr && strlen(scheduleId + 1) <= UPDATE_SCHEDULE_ID_MAX_LENGTH)
+  {
+    char *end;
+    headers.hasServerTime = true;
+    headers.serverSecondsOfDay = strtoul(updateSchedule, &end, 10);
+    if (*end == ',')
+    {
+      headers.serverUtcSecondsOfDay = strtoul(end + 1, nullptr, 10);
+    }
+    strcpy(headers.updateScheduleId, scheduleId + 1);
+  }
+  deviceLog("Status %d, %s body of %lu bytes\n",
+            headers.statusCode,
+            parser.isChunked() ? "chunked" : "plain",
+            static_cast<unsigned long>(parser.getContentLength()));
+  return headers;
+}
+
+bool DashboardClient::trySendGetRequest(const char *url, const char *etag, const char *wakeTimingsReport, const char *rangeHeaders)
+{
+  if (!client.connect(config.dashboardUrl.c_str(), config.dashboardPort))
+  {
+    deviceLog("Failed to connect to the remote server...\n");
+    return false;
+  }
+  markWakePhase(WakePhase::TcpConnect, clock.micros());
+  deviceLog("Successfully connected to the remote server!\n");
+  deviceLog("Sending request...\n");
+
+  // The request goes out in one write instead of one small segment per header line.
+  char request[1600];
+  const int length = snprintf(request, sizeof(request),
+                              "GET %s HTTP/1.1\r\n"
+                              "X-Api-Key: %s\r\n"
+                              "Host: %s:%d\r\n"
+                              "%s%s%s"
+                              "%s%s%s"
+                              "%s%s%s"
+                              "%s"
+                              "Connection: close\r\n\r\n",
+                              url,
+                              config.dashboardApiKey.c_str(),
+                              config.dashboardUrl.c_str(),
+                              config.dashboardPort,
+                              etag != nullptr ? "If-None-Match: " : "",
+                              etag != nullptr ? etag : "",
+                              etag != nullptr ? "\r\n" : "",
+                              wakeTimingsReport != nullptr ? "X-Wake-Timings: " : "",
+                              wakeTimingsReport != nullptr ? wakeTimingsReport : "",
+                              wakeTimingsReport != nullptr ? "\r\n" : "",
+                              firmwareBuild != nullptr ? "X-Firmware-Version: " : "",
+                              firmwareBuild != nullptr ? firmwareBuild : "",
+                              firmwareBuild != nullptr ? "\r\n" : "",
+                              rangeHeaders != nullptr ? rangeHeaders : "");
+  if (length <= 0 || length >= static_cast<int>(sizeof(request)))
+  {
+    deviceLog("Request does not fit the request buffer.\n");
+    client.stop();
+    return false;
+  }
+
+  client.write(reinterpret_cast<const uint8_t *>(request), length);
+  return true;
+}
+
+void DashboardClient::markWakePhase(WakePhase phase, uint32_t micros)
+{
+  ::markWakePhase(wakeTimings, phase, micros / 1000);
+}
+
+bool ResponseReader::readHeaders()
+{
+  while (!parser.isHeaderComplete())
+  {
+    if (parser.hasError())
+    {
+      return false;
+    }
+
+    if (bufferOffset == bufferLength)
+    {
+      const int bytesRead = readClient(buffer, sizeof(buffer));
+      if (bytesRead <= 0)
+      {
+        return false;
+      }
+
+      bufferLength = bytesRead;
+      bufferOffset = 0;
+    }
+
+    bufferOffset += parser.parseHeaders(buffer + bufferOffset, bufferLength - bufferOffset);
+  }
+
+  // Bytes received after the blank line already belong to the body.
+  bufferLength = bufferOffset + parser.decodeBody(buffer + bufferOffset, bufferLength - bufferOffset);
+  if (bufferLength > bufferOffset)
+  {
+    firstBodyMicros = clock.micros();
+  }
+  return !parser.hasError();
+}
+
+bool ResponseReader::readBytes(uint8_t *data, size_t length)
+{
+  while (length > 0)
+  {
+    if (bufferOffset == bufferLength)
+    { // large reads bypass the buffer and land directly in the destination
+      if (length >= sizeof(buffer))
+      {
+        const size_t bytesRead = readBody(data, length);
+        if (bytesRead == 0)
+        {
+          return false;
+        }
+
+        consume(data, bytesRead);
+        data += bytesRead;
+        length -= bytesRead;
+        continue;
+      }
+
+      if (!fill())
+      {
+        return false;
+      }
+    }
+
+    const size_t available = bufferLength - bufferOffset;
+    const size_t count = length < available ? length : available;
+    memcpy(data, buffer + bufferOffset, count);
+    consume(buffer + bufferOffset, count);
+    bufferOffset += count;
+    data += count;
+    length -= count;
+  }
+
+  return true;
+}
+
+size_t ResponseReader::read(uint8_t *data, size_t length)
+{
+  if (bufferOffset == bufferLength && !fill())
+  {
+    return 0;
+  }
+
+  const size_t available = bufferLength - bufferOffset;
+  const size_t count = length < available ? length : available;
+  memcpy(data, buffer + bufferOffset, count);
+  consume(buffer + bufferOffset, count);
+  bufferOffset += count;
+  return count;
+}
+
+bool ResponseReader::readBand(FrameBandDecoder &decoder)
+{
+  while (!decoder.isBandComplete())
+  {
+    if (decoder.hasError() || (bufferOffset == bufferLength && !fill()))
+    {
+      return false;
+    }
+
+    const size_t consumed = decoder.decode(buffer + bufferOffset, bufferLength - bufferOffset);
+    consume(buffer + bufferOffset, consumed);
+    bufferOffset += consumed;
+  }
+
+  return true;
+}
+
+void ResponseReader::consume(const uint8_t *data, size_t length)
+{
+  bodyOffset += length;
+  if (storingCache != nullptr)
+  {
+    storingCache->append(data, length);
+  }
+}
+
+bool ResponseReader::fill()
+{
+  const size_t bytesRead = readBody(buffer, sizeof(buffer));
+  if (bytesRead == 0)
+  {
+    return false;
+  }
+
+  bufferLength = bytesRead;
+  bufferOffset = 0;
+  return true;
+}
+
+size_t ResponseReader::readBody(uint8_t *data, size_t length)
+{
+  // Reads stop at the end of the body instead of waiting for the server to close the connection.
+  while (!parser.isBodyComplete() && !parser.hasError())
+  {
+    const int bytesRead = readClient(data, length);
+    if (bytesRead <= 0)
+    {
+      return 0;
+    }
+
+    const size_t bodyBytes = parser.decodeBody(data, bytesRead);
+    if (bodyBytes > 0)
+    {
+      if (firstBodyMicros == 0)
+      {
+        firstBodyMicros = clock.micros();
+      }
+      return bodyBytes;
+    }
+  }
+
+  return 0;
+}
+
+int ResponseReader::readClient(uint8_t *data, size_t length)
+{
+  const uint32_t idleStart = clock.micros();
+  while (client.connected() || client.available())
+  {
+    const size_t available = client.available();
+    if (available == 0)
+    {
+      if (clock.micros() - idleStart >= idleTimeoutMicros)
+      {
+        deviceLog("No response data received for %u ms.\n", static_cast<unsigned>(idleTimeoutMicros / 1000));
+        return 0;
+      }
+
+      clock.yield();
+      continue;
+    }
+
+    const int bytesRead = client.read(data, available < length ? available : length);
+    if (bytesRead > 0)
+    {
+      return bytesRead;
+    }
+  }
+
+  return 0;
+}
+
+void setDisplayedFrameETag(DisplayedFrame &displayedFrame, const char *etag)
+{
+  if (strlen(etag) > FRAME_ETAG_MAX_LENGTH)
+  {
+    displayedFrame.etag[0] = '\0';
+    return;
+  }
+
+  strcpy(displayedFrame.etag, etag);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <optional>
+#include "band_pipeline.h"
+#include "configuration.h"
+#include "device_interfaces.h"
+#include "firmware_patch.h"
+#include "frame_cache.h"
+#include "frame_decoder.h"
+#include "http_response.h"
+#include "panel_profile.h"
+#include "update_schedule.h"
+#include "wake_timing.h"
+
+enum class FetchResult
+{
+  Failed,
+  NotModified,
+  Updated
+};
+
+// Frame currently shown on the panel. The device keeps it in RTC memory so it survives deep sleep.
+struct DisplayedFrame
+{
+  char etag[FRAME_ETAG_MAX_LENGTH + 1];
+};
+
+struct ResponseHeaders
+{
+  int statusCode;
+  char etag[FRAME_ETAG_MAX_LENGTH + 1];
+  FrameEncoding encoding;
+  uint8_t planeCount;
+  bool isDelta;
+  bool hasChecksums;
+  uint32_t rangeStart; // first body byte of a partial response
+  bool hasNextWait;
+  std::optional<uint64_t> nextWaitSeconds;
+  bool hasServerTime;
+  uint32_t serverSecondsOfDay;
+  std::optional<uint32_t> serverUtcSecondsOfDay;
+  char updateScheduleId[UPDATE_SCHEDULE_ID_MAX_LENGTH + 1];
+  char firmwareUpdate[FIRMWARE_VERSION_MAX_LENGTH + 1]; // version the server offers as a delta; empty if none
+};
+
+// Progress through a frame body. Bands and delta regions count as received once they are verified and handed
+// to the display, so an interrupted download can continue after the last one with a Range request.
+struct FrameTransfer
+{
+  bool isDelta;
+  bool hasChecksums;
+  bool isResumable;
+  uint32_t verifiedBytes; // body bytes up to the end of the last received band or region
+  uint16_t regionCount; // bands of a full frame; regions of a delta once its header is read
+  uint16_t nextRegion;
+};
+
+// Buffers the response so that headers, region headers and band data can be read from the same stream.
+// Body reads see only the body: chunk framing is removed and reading stops at the end of the body.
+class ResponseReader : public FrameReader
+{
+public:
+  // Longest wait for the next bytes of a response, which covers the server rendering the frame before the headers.
+  static const uint32_t idleTimeoutMicros = 30000000;
+
+  ResponseReader(NetworkClient &client, Clock &clock) : client(client), clock(clock) {}
+
+  HttpResponseParser &getParser() { return parser; }
+
+  // Time at which the first body bytes arrived, or 0 if none have yet.
+  uint32_t getFirstBodyMicros() const { return firstBodyMicros; }
+
+  uint32_t getBodyOffset() const override { return bodyOffset; }
+
+  // Also writes every body byte handed out to the frame being stored in the cache.
+  void storeBodyIn(FrameCache &cache) { storingCache = &cache; }
+
+  bool readHeaders();
+  bool readBytes(uint8_t *data, size_t length) override;
+  bool readBand(FrameBandDecoder &decoder) override;
+
+  // Reads up to length body bytes and returns how many were read; 0 at the end of the body.
+  size_t read(uint8_t *data, size_t length);
+
+private:
+  bool fill();
+  void consume(const uint8_t *data, size_t length);
+  size_t readBody(uint8_t *data, size_t length);
+  int readClient(uint8_t *data, size_t length);
+
+  NetworkClient &client;
+  Clock &clock;
+  HttpResponseParser parser{};
+  uint8_t buffer[1024];
+  size_t bufferLength = 0;
+  size_t bufferOffset = 0;
+  uint32_t firstBodyMicros = 0;
+  uint32_t bodyOffset = 0;
+  FrameCache *storingCache = nullptr;
+};
+
+// Requests frames and the refresh schedule from the dashboard server. Frames are requested in the geometry,
+// plane format and band height of the layout.
+// Pending wake cycle timings are reported with the frame request and the network phases of the running cycle are marked.
+// With a frame cache, the stored frames are offered in If-None-Match and drawn from flash when the server names one of them.
+// With a firmware build ("<panel profile>/<version>"), every request reports it and the server may offer a newer version.
+class DashboardClient
+{
+public:
+  DashboardClient(const Configuration &config, const FrameLayout &layout, NetworkClient &client, Clock &clock,
+                  WakeTimings &wakeTimings, FrameCache *frameCache = nullptr, const char *firmwareBuild = nullptr)
+      : config(config), layout(layout), client(client), clock(clock), wakeTimings(wakeTimings), frameCache(frameCache),
+        firmwareBuild(firmwareBuild) {}
+
+  // Empty band buffers are allocated once a frame is about to be drawn, so wakes without a new frame
+  // leave the heap alone. The display sees beginFrame() and its first band only at that point, too.
+  FetchResult fetchBinaryData(FrameDisplay &display, BandPipeline::Buffers &buffers,
+                              DisplayedFrame &displayedFrame, bool isManualRefresh);
+  // Uses the interval sent with the last frame response and only asks the server when there was none.
+  std::optional<uint64_t> fetchNextWaitSeconds();
+  // True if the last frame response carried the interval, even if the dashboard has no update times.
+  bool hasNextWait() const { return hasFrameWait; }
+
+  // Syncs the stored schedule with the server time sent with the last frame response and fetches the
+  // update times when the server reports that they changed.
+  void syncUpdateSchedule(UpdateSchedule &schedule, uint64_t deviceMillis);
+
+  // True if the last frame response offered a firmware update.
+  bool hasFirmwareUpdate() const { return firmwareUpdate[0] != '\0'; }
+  // Downloads the offered update as a delta against the running firmware and applies it while it arrives.
+  // True once the new image is verified and will be booted next. Updates are only taken from a server whose
+  // certificate is pinned, since nothing else vouches for the image. A version whose delta does not apply to
+  // the running image is recorded in rejectedFirmware and skipped from then on.
+  bool updateFirmware(FirmwareUpdater &updater, RejectedFirmware &rejectedFirmware, bool isServerPinned);
+
+private:
+  static const uint8_t maxResumeAttempts = 3;
+
+  bool trySendGetRequest(const char *url, const char *etag = nullptr, const char *wakeTimingsReport = nullptr,
+                         const char *rangeHeaders = nullptr);
+  void markWakePhase(WakePhase phase, uint32_t micros);
+  bool hasSuccessfulStatusCode(ResponseReader &reader);
+  bool ensureBandBuffers(BandPipeline::Buffers &buffers);
+  size_t readBodyText(ResponseReader &reader, char *text, size_t capacity);
+  ResponseHeaders readResponseHeaders(ResponseReader &reader);
+  bool resumeFrame(const char *url, const ResponseHeaders &headers, FrameBandDecoder &decoder, BandPipeline &pipeline,
+                   FrameTransfer &transfer);
+  FetchResult showStoredFrame(FrameDisplay &display, BandPipeline::Buffers &buffers, DisplayedFrame &displayedFrame,
+                              const char *etag);
+  bool writeFullFrame(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, FrameTransfer &transfer);
+  bool writeDeltaRegions(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, FrameTransfer &transfer);
+  bool writeRegion(FrameReader &reader, FrameBandDecoder &decoder, BandPipeline &pipeline, bool hasChecksum,
+                   uint16_t y, uint16_t rows);
+
+  const Configuration &config;
+  const FrameLayout &layout;
+  NetworkClient &client;
+  Clock &clock;
+  WakeTimings &wakeTimings;
+  FrameCache *frameCache;
+  const char *firmwareBuild;
+
+  bool hasFrameWait = false;
+  std::optional<uint64_t> frameWaitSeconds{};
+  uint32_t frameWaitReceivedMicros = 0;
+
+  bool hasServerTime = false;
+  uint32_t serverSecondsOfDay = 0;
+  std::optional<uint32_t> serverUtcSecondsOfDay{};
+  char updateScheduleId[UPDATE_SCHEDULE_ID_MAX_LENGTH + 1] = "";
+  uint32_t serverTimeReceivedMicros = 0;
+
+  char firmwareUpdate[FIRMWARE_VERSION_MAX_LENGTH + 1] = "";
+};
+
+void setDisplayedFrameETag(DisplayedFrame &displayedFrame, const char *etag);
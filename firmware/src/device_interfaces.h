@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+struct FrameBand
+{
+  uint8_t *black;
+  uint8_t *red;
+  uint16_t y;
+  uint16_t rows;
+};
+
+// Byte stream to the dashboard server, implemented by WiFiClient on the device and by fakes on the host.
+class NetworkClient
+{
+public:
+  virtual ~NetworkClient() = default;
+
+  virtual bool connect(const char *host, uint16_t port) = 0;
+  virtual size_t write(const uint8_t *data, size_t length) = 0;
+  virtual int available() = 0;
+  virtual int read(uint8_t *data, size_t length) = 0;
+  virtual bool connected() = 0;
+  virtual void stop() = 0;
+};
+
+// Panel controller memory that frame bands are written into before a refresh.
+class FrameDisplay
+{
+public:
+  virtual ~FrameDisplay() = default;
+
+  // Prepares the controller for a sequence of band writes.
+  virtual void beginFrame() = 0;
+  virtual void writeBand(const FrameBand &band) = 0;
+};
+
+// Persistent key-value storage, e.g. the Preferences namespace holding the configuration.
+class SettingsStore
+{
+public:
+  virtual ~SettingsStore() = default;
+
+  virtual std::string getString(const char *key, const char *defaultValue) = 0;
+  virtual int32_t getInt(const char *key, int32_t defaultValue) = 0;
+  virtual uint64_t getULong64(const char *key, uint64_t defaultValue) = 0;
+  virtual void putString(const char *key, const std::string &value) = 0;
+  virtual void putInt(const char *key, int32_t value) = 0;
+  virtual void putULong64(const char *key, uint64_t value) = 0;
+  virtual void clear() = 0;
+};
+
+// Flash file system holding stored frames, implemented with LittleFS on the device and in memory on the host.
+// One file is open at a time, either for reading or for writing.
+class FrameStorage
+{
+public:
+  virtual ~FrameStorage() = default;
+
+  virtual bool openRead(const char *path) = 0;
+  virtual size_t read(uint8_t *data, size_t length) = 0;
+
+  // Writes go to a temporary file that replaces the file at path on commit,
+  // so an interrupted write never leaves a partial file behind.
+  virtual bool openWrite(const char *path) = 0;
+  virtual bool write(const uint8_t *data, size_t length) = 0;
+  virtual bool commit() = 0;
+
+  // Closes the open file and discards an uncommitted write.
+  virtual void close() = 0;
+};
+
+// App slots of an over-the-air update: the running firmware, which deltas are applied against, and the inactive
+// slot the new firmware is written to. Implemented with the OTA partitions on the device and in memory on the host.
+class FirmwareUpdater
+{
+public:
+  virtual ~FirmwareUpdater() = default;
+
+  virtual bool readRunning(uint32_t offset, uint8_t *data, size_t length) = 0;
+  // True if the first size bytes of the running firmware have this SHA-256.
+  virtual bool isRunning(uint32_t size, const uint8_t *sha256) = 0;
+
+  // Prepares the inactive slot for an image of size bytes.
+  virtual bool begin(uint32_t size) = 0;
+  virtual bool write(const uint8_t *data, size_t length) = 0;
+  // Reads the written image back and makes it the one to boot if it has this SHA-256; discards it otherwise.
+  virtual bool finish(const uint8_t *sha256) = 0;
+  virtual void abort() = 0;
+};
+
+class Clock
+{
+public:
+  virtual ~Clock() = default;
+
+  virtual uint32_t micros() = 0;
+
+  // Gives other tasks a chance to run while waiting for data.
+  virtual void yield() = 0;
+};
+
+// Writes a formatted diagnostic message; implemented once per platform.
+void deviceLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
@@ -1,344 +1,543 @@
 #include <Arduino.h>
+#include <atomic>
 #include <Preferences.h>
 #include <optional>
+#include <stdarg.h>
 #include <WiFi.h>
-#include <WebServer.h>
-#include <DNSServer.h>
+#include <AsyncUDP.h>
+#include <ESPAsyncWebServer.h>
 #include <driver/rtc_io.h>
+#include <esp_heap_caps.h>
+#include <LittleFS.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <mbedtls/sha256.h>
+#include <sys/time.h>
 #include "version.h"
+#include "captive_dns.h"
+#include "configuration.h"
+#include "dashboard_client.h"
+#include "firmware_patch.h"
+#include "frame_cache.h"
+#include "panel_profile.h"
+#include "portal_assets.h"
+#include "tls_network_client.h"
+#include "tls_session.h"
+#include "update_schedule.h"
+#include "wake_timing.h"
 
 #define ENABLE_GxEPD2_GFX 1
 
+#include <GxEPD2_BW.h>
 #include <GxEPD2_3C.h>
 #include <qrcode.h>
 #include <Fonts/FreeSansBold18pt7b.h>
 #include <Fonts/FreeSans12pt7b.h>
 
-#define GxEPD2_DISPLAY_CLASS GxEPD2_3C
-#define GxEPD2_DRIVER_CLASS GxEPD2_750c_Z08 // GDEW075Z08  800x480, EK79655 (GD7965), (WFT0583CZ61)
-
-#define GxEPD2_3C_IS_GxEPD2_3C true
-#define IS_GxEPD(c, x) (c##x)
-#define IS_GxEPD2_BW(x) IS_GxEPD(GxEPD2_BW_IS_, x)
-#define IS_GxEPD2_3C(x) IS_GxEPD(GxEPD2_3C_IS_, x)
-#define IS_GxEPD2_7C(x) IS_GxEPD(GxEPD2_7C_IS_, x)
-
-#define MAX_DISPLAY_BUFFER_SIZE 65536ul
-#if IS_GxEPD2_BW(GxEPD2_DISPLAY_CLASS)
-#define MAX_HEIGHT(EPD) (EPD::HEIGHT <= MAX_DISPLAY_BUFFER_SIZE / (EPD::WIDTH / 8) ? EPD::HEIGHT : MAX_DISPLAY_BUFFER_SIZE / (EPD::WIDTH / 8))
-#elif IS_GxEPD2_3C(GxEPD2_DISPLAY_CLASS)
-#define MAX_HEIGHT(EPD) (EPD::HEIGHT <= (MAX_DISPLAY_BUFFER_SIZE / 2) / (EPD::WIDTH / 8) ? EPD::HEIGHT : (MAX_DISPLAY_BUFFER_SIZE / 2) / (EPD::WIDTH / 8))
-#elif IS_GxEPD2_7C(GxEPD2_DISPLAY_CLASS)
-#define MAX_HEIGHT(EPD) (EPD::HEIGHT <= (MAX_DISPLAY_BUFFER_SIZE) / (EPD::WIDTH / 2) ? EPD::HEIGHT : (MAX_DISPLAY_BUFFER_SIZE) / (EPD::WIDTH / 2))
+// Supported panels. PANEL_PROFILE selects one at build time, see the environments in platformio.ini.
+using Gdew075z08 = PanelProfile<GxEPD2_3C, GxEPD2_750c_Z08, 2, 20000000>; // 7.5" 800x480 black/white/red, EK79655 (GD7965)
+using Gdew075t7 = PanelProfile<GxEPD2_BW, GxEPD2_750_T7, 1, 20000000>; // 7.5" 800x480 black/white, EK79655 (GD7965)
+using Gdey116t91 = PanelProfile<GxEPD2_BW, GxEPD2_1160_T91, 1, 20000000>; // 11.6" 960x640 black/white, SSD1677
+
+#ifndef PANEL_PROFILE
+#define PANEL_PROFILE Gdew075z08
 #endif
+using Panel = PANEL_PROFILE;
+
+// Reported to the server, which offers updates built for the same panel profile.
+#define STRINGIFY(value) #value
+#define TO_STRING(value) STRINGIFY(value)
+static const char *FIRMWARE_BUILD = TO_STRING(PANEL_PROFILE) "/" FIRMWARE_VERSION;
 
-GxEPD2_DISPLAY_CLASS<GxEPD2_DRIVER_CLASS, MAX_HEIGHT(GxEPD2_DRIVER_CLASS)> display(GxEPD2_DRIVER_CLASS(/*CS=*/15, /*DC=*/27, /*RST=*/26, /*BUSY=*/25));
+Panel::Display display(Panel::Driver(/*CS=*/15, /*DC=*/27, /*RST=*/26, /*BUSY=*/25));
 
-#define SEC_TO_USEC_FACTOR 1000000
 #define RESET_WAKEUP_PIN GPIO_NUM_33
 #define RESET_REQUEST_TIMEOUT 10
 #define LED_PIN 2
+#define WIFI_CACHED_CONNECT_TIMEOUT 3000
+#define WIFI_CONNECT_TIMEOUT 10000
+#define BAND_HEAP_RESERVE 32768 // left free for the HTTP client, the display task and the frame cache
+#define TLS_HEAP_RESERVE 49152 // mbedtls record buffers and handshake state, allocated when connecting
+#define WIFI_GOT_IP_BIT BIT0
+#define WIFI_DISCONNECTED_BIT BIT1
 
 static const char *CONFIGURATION_NAMESPACE = "config";
-static const char *CONFIGURATION_SSID = "ssid";
-static const char *CONFIGURATION_PASSWORD = "pwd";
-static const char *CONFIGURATION_DASHBOARD_URL = "url";
-static const char *CONFIGURATION_DASHBOARD_PORT = "port";
-static const char *CONFIGURATION_DASHBOARD_RATE = "rate";
-static const char *CONFIGURATION_DASHBOARD_API_KEY = "apikey";
-
-static const uint16_t displayWidth = 800;
-static const uint16_t displayHeight = 480;
-static const uint16_t frameWidth = displayWidth;
-static const uint16_t frameHeight = 160;
-static const uint16_t frameBytes = frameWidth * frameHeight / 8;
-static uint8_t *epd_bitmap_BW = nullptr;
-static uint8_t *epd_bitmap_RW = nullptr;
+
+// Two band buffer pairs let the network side decode one band while the other is written to the panel.
+static BandPipeline::Buffers bandBuffers{};
+
+// Access point and DHCP lease of the last successful connection, reused to skip the scan and DHCP on the next wake.
+struct WiFiSession
+{
+  bool isValid;
+  uint8_t bssid[6];
+  int32_t channel;
+  uint32_t localIp;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+// Kept in RTC memory so that they survive deep sleep.
+RTC_DATA_ATTR static DisplayedFrame displayedFrame{};
+RTC_DATA_ATTR static WiFiSession wifiSession{};
+RTC_DATA_ATTR static WakeTimings wakeTimings{};
+RTC_DATA_ATTR static FrameCacheIndex frameCacheIndex{};
+RTC_DATA_ATTR static UpdateSchedule updateSchedule{};
+RTC_DATA_ATTR static TlsSessionCache tlsSessionCache{};
+RTC_DATA_ATTR static RejectedFirmware rejectedFirmware{};
+
+static EventGroupHandle_t wifiEvents = nullptr;
 
 SPIClass hspi(HSPI);
 
-struct Configuration
+class WiFiNetworkClient : public NetworkClient
 {
-  String ssid;
-  String password;
-  String dashboardUrl;
-  int dashboardPort;
-  uint64_t dashboardRate;
-  String dashboardApiKey;
+public:
+  WiFiNetworkClient() { client.setTimeout(5000); }
+
+  bool connect(const char *host, uint16_t port) override { return client.connect(host, port); }
+  size_t write(const uint8_t *data, size_t length) override { return client.write(data, length); }
+  int available() override { return client.available(); }
+  int read(uint8_t *data, size_t length) override { return client.read(data, length); }
+  bool connected() override { return client.connected(); }
+  void stop() override { client.stop(); }
+
+private:
+  WiFiClient client;
 };
 
-void startDeepSleep(const Configuration &config);
-std::optional<Configuration> getConfiguration();
-void storeConfiguration(const Configuration &config);
-void clearConfiguration();
-void createConfiguration();
-void showWelcomePage(const IPAddress &ip, const String &mac);
-bool isResetRequested();
-void resetDevice();
+// mbedtls random number generator backed by the hardware RNG.
+static int getTlsRandom(void *, unsigned char *data, size_t length)
+{
+  esp_fill_random(data, length);
+  return 0;
+}
 
-bool connectToWiFi(const Configuration &config);
-bool hasSuccessfulStatusCode(WiFiClient &client);
-void fetchBinaryData(const Configuration &config);
-std::optional<uint64_t> fetchNextWaitSeconds(const Configuration &config);
-bool trySendGetRequest(WiFiClient &client, const String &url, const Configuration &config);
+void initDisplay(bool isInitial);
 
-void setup()
+// Initializes and powers the panel only when the first band of a new frame is written, so wakes that end
+// without one never touch it. Bands are written from the display task, which then also runs the init.
+class EpdFrameDisplay : public FrameDisplay
 {
-  Serial.begin(115200);
-  hspi.begin(13, 12, 14, 15); // remap hspi for EPD (swap pins)
-  display.epd2.selectSPI(hspi, SPISettings(20000000, MSBFIRST, SPI_MODE0));
-  display.init(115200);
+public:
+  // Without a known frame on the panel, the first write clears the whole controller memory.
+  // Otherwise the memory still holds the displayed frame, which delta updates build on.
+  explicit EpdFrameDisplay(bool hasDisplayedFrame) : hasDisplayedFrame(hasDisplayedFrame) {}
 
-  Serial.print("izBoard Firmware v");
-  Serial.println(FIRMWARE_VERSION);
+  void beginFrame() override {}
 
-  epd_bitmap_BW = (uint8_t *)malloc(frameBytes);
-  epd_bitmap_RW = (uint8_t *)malloc(frameBytes);
-  
-  if (!epd_bitmap_BW || !epd_bitmap_RW)
+  void writeBand(const FrameBand &band) override
   {
-    Serial.println("Failed to allocate frame buffers!");
-    ESP.restart();
+    if (!isPowered)
+    {
+      powerUp();
+    }
+
+    Panel::writeBand(display, band);
   }
 
-  if (isResetRequested())
+  bool isPanelPowered() const { return isPowered; }
+
+  void powerOff()
   {
-    Serial.println("Resetting device");
-    resetDevice();
+    if (isPowered)
+    {
+      display.powerOff();
+      onMillis = millis() - powerUpMillis;
+      isPowered = false;
+    }
   }
 
-  const auto configuration = getConfiguration();
-  if (!configuration.has_value())
+  uint32_t getInitMillis() const { return initMillis; }
+  uint32_t getOnMillis() const { return onMillis; }
+
+private:
+  void powerUp()
   {
-    createConfiguration();
-    return;
+    powerUpMillis = millis();
+    initDisplay(!hasDisplayedFrame);
+    display.setPartialWindow(0, 0, Panel::geometry.width, Panel::geometry.height);
+    markWakePhase(wakeTimings, WakePhase::DisplayInit, millis());
+    initMillis = millis() - powerUpMillis;
+    isPowered = true;
   }
 
-  if (connectToWiFi(configuration.value()))
+  const bool hasDisplayedFrame;
+  bool isPowered = false;
+  uint32_t powerUpMillis = 0;
+  uint32_t initMillis = 0;
+  uint32_t onMillis = 0;
+};
+
+// Stored frames on the LittleFS partition. LittleFS spreads writes over the flash and renames atomically,
+// so a frame being written replaces the old file only once it is complete.
+class LittleFsFrameStorage : public FrameStorage
+{
+public:
+  bool openRead(const char *path) override
   {
-    fetchBinaryData(configuration.value());
+    close();
+    file = LittleFS.open(path, "r");
+    return file;
   }
 
-  display.refresh();
-  display.powerOff();
+  size_t read(uint8_t *data, size_t length) override { return file.read(data, length); }
 
-  startDeepSleep(configuration.value());
-}
+  bool openWrite(const char *path) override
+  {
+    close();
+    snprintf(targetPath, sizeof(targetPath), "%s", path);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+    file = LittleFS.open(temporaryPath, "w");
+    isWriting = file;
+    return isWriting;
+  }
 
-void loop()
-{
-  // This function should not be reached. Restarting in case this happened.
-  ESP.restart();
-}
+  bool write(const uint8_t *data, size_t length) override { return file.write(data, length) == length; }
 
-void fetchBinaryData(const Configuration &config)
+  bool commit() override
+  {
+    file.close();
+    isWriting = false;
+    return LittleFS.rename(temporaryPath, targetPath);
+  }
+
+  void close() override
+  {
+    file.close();
+    if (isWriting)
+    {
+      LittleFS.remove(temporaryPath);
+      isWriting = false;
+    }
+  }
+
+private:
+  File file;
+  bool isWriting = false;
+  char targetPath[24] = "";
+  char temporaryPath[28] = "";
+};
+
+// Opens the Preferences namespace for as long as the store exists.
+class PreferencesSettingsStore : public SettingsStore
 {
-  Serial.println("Connecting to the remote server...");
+public:
+  explicit PreferencesSettingsStore(bool isReadOnly) { preferences.begin(CONFIGURATION_NAMESPACE, isReadOnly); }
+  ~PreferencesSettingsStore() override { preferences.end(); }
 
-  WiFiClient client;
-  client.setTimeout(5000);
-  if (!trySendGetRequest(client, "/api/render/binary?width=800&height=480", config))
+  std::string getString(const char *key, const char *defaultValue) override
   {
-    Serial.println("Failed to connect to the remote server...");
-    return;
+    return preferences.getString(key, defaultValue).c_str();
   }
 
-  if (!hasSuccessfulStatusCode(client))
+  int32_t getInt(const char *key, int32_t defaultValue) override { return preferences.getInt(key, defaultValue); }
+  uint64_t getULong64(const char *key, uint64_t defaultValue) override { return preferences.getULong64(key, defaultValue); }
+  void putString(const char *key, const std::string &value) override { preferences.putString(key, value.c_str()); }
+  void putInt(const char *key, int32_t value) override { preferences.putInt(key, value); }
+  void putULong64(const char *key, uint64_t value) override { preferences.putULong64(key, value); }
+  void clear() override { preferences.clear(); }
+
+private:
+  Preferences preferences{};
+};
+
+// Writes updates to the OTA slot that is not running. esp_ota_end() checks the structure and checksum of the image;
+// on top of that the slot is read back and compared with the SHA-256 of the delta before it is booted.
+class EspFirmwareUpdater : public FirmwareUpdater
+{
+public:
+  bool readRunning(uint32_t offset, uint8_t *data, size_t length) override
   {
-    Serial.println("The request was not successful...");
-    return;
+    return esp_partition_read(esp_ota_get_running_partition(), offset, data, length) == ESP_OK;
   }
 
-  Serial.println("Reading image content...");
-  
-  display.setPartialWindow(0, 0, displayWidth, displayHeight);
-  
-  int16_t x = 0;
-  int16_t y = 0;
+  bool isRunning(uint32_t size, const uint8_t *sha256) override
+  {
+    return hasSha256(esp_ota_get_running_partition(), size, sha256);
+  }
 
-  while ((client.connected() || client.available()) && y < displayHeight)
+  bool begin(uint32_t size) override
   {
-    const size_t bytesNeeded = static_cast<size_t>(frameBytes) * 2;
-    size_t idx = 0;
+    slot = esp_ota_get_next_update_partition(nullptr);
+    imageSize = size;
+    // Erases only as much of the slot as the image needs.
+    isWriting = slot != nullptr && size <= slot->size && esp_ota_begin(slot, size, &handle) == ESP_OK;
+    return isWriting;
+  }
+
+  bool write(const uint8_t *data, size_t length) override { return esp_ota_write(handle, data, length) == ESP_OK; }
 
-    memset(epd_bitmap_BW, 0, frameBytes);
-    memset(epd_bitmap_RW, 0, frameBytes);
+  bool finish(const uint8_t *sha256) override
+  {
+    isWriting = false;
+    return esp_ota_end(handle) == ESP_OK && hasSha256(slot, imageSize, sha256) && esp_ota_set_boot_partition(slot) == ESP_OK;
+  }
 
-    while (idx < bytesNeeded && (client.connected() || client.available()))
+  void abort() override
+  {
+    if (isWriting)
     {
-      size_t available = client.available();
-      if (available > 0)
-      {
-        size_t toRead = min(available, bytesNeeded - idx);
-        uint8_t buffer[1024];
-        size_t chunkSize = min(toRead, sizeof(buffer));
-        size_t bytesRead = client.read(buffer, chunkSize);
-        
-        for (size_t i = 0; i < bytesRead; i++)
-        {
-          if ((idx & 1) == 0)
-          {
-            epd_bitmap_BW[idx / 2] = buffer[i];
-          }
-          else
-          {
-            epd_bitmap_RW[idx / 2] = buffer[i];
-          }
-          ++idx;
-        }
-      }
-      else
-      {
-        if (!client.connected())
-        {
-          break;
-        }
-        yield();
-      }
+      esp_ota_abort(handle);
+      isWriting = false;
     }
+  }
 
-    if (idx < bytesNeeded)
+private:
+  static bool hasSha256(const esp_partition_t *partition, uint32_t size, const uint8_t *sha256)
+  {
+    if (partition == nullptr || size > partition->size)
     {
-      Serial.println("Incomplete frame data received, stopping.");
-      break;
+      return false;
     }
 
-    display.writeImage(epd_bitmap_BW, epd_bitmap_RW, x, y, frameWidth, frameHeight);
-    y += frameHeight;
+    uint8_t buffer[1024];
+    uint8_t digest[FIRMWARE_SHA256_LENGTH];
+    bool isRead = true;
+    mbedtls_sha256_context context;
+    mbedtls_sha256_init(&context);
+    mbedtls_sha256_starts_ret(&context, 0);
+    for (uint32_t offset = 0; offset < size && isRead; offset += sizeof(buffer))
+    {
+      const size_t count = size - offset < sizeof(buffer) ? size - offset : sizeof(buffer);
+      isRead = esp_partition_read(partition, offset, buffer, count) == ESP_OK;
+      mbedtls_sha256_update_ret(&context, buffer, count);
+    }
+    mbedtls_sha256_finish_ret(&context, digest);
+    mbedtls_sha256_free(&context);
+    return isRead && memcmp(digest, sha256, sizeof(digest)) == 0;
   }
-  Serial.println();
 
-  client.stop();
-}
+  const esp_partition_t *slot = nullptr;
+  esp_ota_handle_t handle = 0;
+  uint32_t imageSize = 0;
+  bool isWriting = false;
+};
 
-std::optional<uint64_t> fetchNextWaitSeconds(const Configuration &config)
+class ArduinoClock : public Clock
 {
-  Serial.println("Connecting to the remote server...");
+public:
+  uint32_t micros() override { return ::micros(); }
+  void yield() override { ::yield(); }
+};
 
-  WiFiClient client;
-  if (!trySendGetRequest(client, "/api/configuration/next-update-wait-seconds", config))
+uint64_t getDeviceMillis();
+PanelMemory getPanelMemory(bool isTls);
+void startDeepSleep(DashboardClient &dashboardClient, const Configuration &config);
+void confirmFirmware(bool hasReachedServer);
+void createConfiguration();
+void showWelcomePage(const IPAddress &ip, const String &mac);
+bool isResetRequested();
+void resetDevice();
+
+bool connectToWiFi(const Configuration &config);
+EventBits_t waitForWiFi(EventBits_t bits, uint32_t timeoutMillis);
+
+void setup()
+{
+  beginWakeCycle(wakeTimings);
+  beginUpdateSchedule(updateSchedule);
+  beginTlsSessionCache(tlsSessionCache);
+  beginRejectedFirmware(rejectedFirmware);
+  Serial.begin(115200);
+
+  Serial.print("izBoard Firmware v");
+  Serial.println(FIRMWARE_VERSION);
+
+  if (isResetRequested())
   {
-    return std::nullopt;
+    Serial.println("Resetting device");
+    resetDevice();
   }
 
-  if (!hasSuccessfulStatusCode(client))
+  std::optional<Configuration> configuration{};
   {
-    Serial.println("The request was not successful...");
-    return std::nullopt;
+    PreferencesSettingsStore settings{true};
+    configuration = getConfiguration(settings);
   }
 
-  Serial.println("Reading content...");
-  String delayString{};
-  if (client.connected() || client.available())
+  if (!configuration.has_value())
   {
-    delayString = client.readStringUntil('\n');
-    Serial.println(delayString);
+    createConfiguration();
+    return;
   }
 
-  client.stop();
-  return delayString.length() > 0
-             ? std::make_optional(strtoull(delayString.c_str(), nullptr, 10))
-             : std::nullopt;
-}
+  WiFiNetworkClient networkClient{};
+  // With a pinned server certificate the dashboard is reached over TLS; the API key never leaves the device in the clear.
+  // A fingerprint that cannot be parsed never matches, so the device does not fall back to plain HTTP.
+  uint8_t certificateFingerprint[TLS_FINGERPRINT_LENGTH] = {};
+  const bool isTls = !configuration->certificateFingerprint.empty();
+  if (isTls && !parseCertificateFingerprint(configuration->certificateFingerprint.c_str(), certificateFingerprint))
+  {
+    Serial.println("Invalid certificate fingerprint.");
+  }
+  ArduinoClock clock{};
+  TlsNetworkClient tlsClient(networkClient, clock, tlsSessionCache, certificateFingerprint, getTlsRandom);
+  EpdFrameDisplay frameDisplay{displayedFrame.etag[0] != '\0'};
+  LittleFsFrameStorage frameStorage{};
+  FrameCache frameCache(frameCacheIndex, frameStorage);
+  const bool hasFrameCache = LittleFS.begin(true);
+  if (hasFrameCache)
+  {
+    frameCache.begin();
+  }
+  else
+  {
+    Serial.println("Failed to mount the frame cache partition.");
+  }
 
-bool hasSuccessfulStatusCode(WiFiClient &client)
-{
-  Serial.println("Reading headers...");
-  bool isStatusOk = false;
-  while (client.connected() || client.available())
+  // Measured once WiFi is up, so the bands get the RAM that the connection leaves.
+  const bool isWiFiConnected = connectToWiFi(configuration.value());
+  const FrameLayout frameLayout = getFrameLayout(Panel::geometry, getPanelMemory(isTls));
+  Serial.printf("Frame in %u bands of %u rows%s.\n",
+                frameLayout.getBandCount(), frameLayout.bandRows, frameLayout.isExternalMemory ? " in PSRAM" : "");
+  DashboardClient dashboardClient(configuration.value(), frameLayout, isTls ? static_cast<NetworkClient &>(tlsClient) : networkClient,
+                                  clock, wakeTimings, hasFrameCache ? &frameCache : nullptr, FIRMWARE_BUILD);
+
+  // A manual refresh via the reset button always redraws the panel, even if the frame is unchanged.
+  const bool isManualRefresh = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0;
+  const auto fetchResult = isWiFiConnected
+                               ? dashboardClient.fetchBinaryData(frameDisplay, bandBuffers, displayedFrame, isManualRefresh)
+                               : FetchResult::Failed;
+
+  // A failed or incomplete download leaves the previous picture on the panel instead of showing a partial frame.
+  if (fetchResult == FetchResult::Updated && frameDisplay.isPanelPowered())
+  {
+    display.refresh();
+    markWakePhase(wakeTimings, WakePhase::Refresh, millis());
+  }
+  else if (fetchResult == FetchResult::Updated)
+  {
+    Serial.println("No rows of the frame changed, skipping display refresh.");
+  }
+  else if (fetchResult == FetchResult::NotModified)
+  {
+    Serial.println("Dashboard has not changed, skipping display refresh.");
+  }
+  else
   {
-    String line = client.readStringUntil('\n');
-    Serial.println(line);
+    Serial.println("No complete frame received, skipping display refresh.");
+  }
 
-    if (!isStatusOk)
-    {
-      isStatusOk = line.startsWith("HTTP/1.1 200 OK");
-    }
+  frameDisplay.powerOff();
+  setWakePanelTiming(wakeTimings, frameDisplay.getInitMillis(), frameDisplay.getOnMillis());
+  if (frameDisplay.getOnMillis() > 0)
+  {
+    Serial.printf("Panel powered for %lu ms, %lu ms of it initializing.\n",
+                  static_cast<unsigned long>(frameDisplay.getOnMillis()), static_cast<unsigned long>(frameDisplay.getInitMillis()));
+  }
+  else
+  {
+    Serial.printf("Panel left off, saving about %u ms of panel init.\n", wakeTimings.panelInitMillis);
+  }
 
-    if (line == "\r")
-    { // Headers end with an empty line
-      break;
+  confirmFirmware(fetchResult != FetchResult::Failed);
+
+  // An offered update is applied while the radio is still on, and the device restarts into it.
+  if (dashboardClient.hasFirmwareUpdate())
+  {
+    EspFirmwareUpdater firmwareUpdater{};
+    if (dashboardClient.updateFirmware(firmwareUpdater, rejectedFirmware, isTls))
+    {
+      Serial.println("Restarting into the new firmware.");
+      ESP.restart();
     }
   }
 
-  return isStatusOk;
+  startDeepSleep(dashboardClient, configuration.value());
 }
 
-bool trySendGetRequest(WiFiClient &client, const String &url, const Configuration &config)
+void loop()
+{
+  // This function should not be reached. Restarting in case this happened.
+  ESP.restart();
+}
+
+void deviceLog(const char *format, ...)
+{
+  char message[256];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(message, sizeof(message), format, arguments);
+  va_end(arguments);
+  Serial.print(message);
+}
+
+// Time kept by the RTC timer, which keeps running in deep sleep.
+uint64_t getDeviceMillis()
+{
+  timeval now;
+  gettimeofday(&now, nullptr);
+  return static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+}
+
+// With app rollback in the bootloader, a new image is booted once on probation and the previous one comes back
+// at the next boot unless it is confirmed. Arduino would confirm it right at start; it is kept on probation
+// until it has reached the dashboard server instead.
+bool verifyRollbackLater()
 {
-  if (!client.connect(config.dashboardUrl.c_str(), config.dashboardPort))
-  {
-    Serial.println("Failed to connect to the remote server...");
-    return false;
-  }
-  Serial.println("Successfully connected to the remote server!");
-  Serial.println("Sending request...");
-
-  client.println("GET " + url + " HTTP/1.1");
-  client.print("X-Api-Key: ");
-  client.println(config.dashboardApiKey);
-  client.print("Host: ");
-  client.print(config.dashboardUrl);
-  client.print(":");
-  client.println(config.dashboardPort);
-  client.println("Connection: close");
-  client.println();
   return true;
 }
 
-void startDeepSleep(const Configuration &config)
+void confirmFirmware(bool hasReachedServer)
 {
-  uint64_t waitSeconds = fetchNextWaitSeconds(config).value_or(config.dashboardRate);
-  uint64_t waitMicroseconds = waitSeconds * SEC_TO_USEC_FACTOR;
-  esp_sleep_enable_timer_wakeup(waitMicroseconds);
-  esp_sleep_enable_ext0_wakeup(RESET_WAKEUP_PIN, 1);
-  rtc_gpio_pullup_dis(RESET_WAKEUP_PIN);
-  rtc_gpio_pulldown_en(RESET_WAKEUP_PIN);
-  esp_deep_sleep_start();
+  esp_ota_img_states_t state;
+  if (!hasReachedServer || esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK ||
+      state != ESP_OTA_IMG_PENDING_VERIFY)
+  {
+    return;
+  }
+
+  esp_ota_mark_app_valid_cancel_rollback();
+  Serial.println("New firmware confirmed.");
 }
 
-std::optional<Configuration> getConfiguration()
+// Internal RAM beyond what the connection still allocates, and the largest PSRAM block on boards with PSRAM.
+PanelMemory getPanelMemory(bool isTls)
 {
-  Preferences preferences{};
-  preferences.begin(CONFIGURATION_NAMESPACE, true);
-  Configuration configuration{
-      preferences.getString(CONFIGURATION_SSID, ""),
-      preferences.getString(CONFIGURATION_PASSWORD, ""),
-      preferences.getString(CONFIGURATION_DASHBOARD_URL, ""),
-      preferences.getInt(CONFIGURATION_DASHBOARD_PORT, 80),
-      preferences.getULong64(CONFIGURATION_DASHBOARD_RATE, 60),
-      preferences.getString(CONFIGURATION_DASHBOARD_API_KEY, "")};
-  preferences.end();
-
-  return configuration.ssid.length() == 0 || configuration.dashboardUrl.length() == 0
-             ? std::nullopt
-             : std::make_optional(configuration);
+  const size_t reserve = BAND_HEAP_RESERVE + (isTls ? TLS_HEAP_RESERVE : 0);
+  const size_t freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+  return PanelMemory{
+      freeBytes > reserve ? freeBytes - reserve : 0,
+      heap_caps_get_largest_free_block(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL),
+      psramFound() ? heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) : 0};
 }
 
-void storeConfiguration(const Configuration &config)
+void startDeepSleep(DashboardClient &dashboardClient, const Configuration &config)
 {
-  Preferences preferences{};
-  preferences.begin(CONFIGURATION_NAMESPACE, false);
-  preferences.putString(CONFIGURATION_SSID, config.ssid);
-  preferences.putString(CONFIGURATION_PASSWORD, config.password);
-  preferences.putString(CONFIGURATION_DASHBOARD_URL, config.dashboardUrl);
-  preferences.putInt(CONFIGURATION_DASHBOARD_PORT, config.dashboardPort);
-  preferences.putULong64(CONFIGURATION_DASHBOARD_RATE, config.dashboardRate);
-  preferences.putString(CONFIGURATION_DASHBOARD_API_KEY, config.dashboardApiKey);
-  preferences.end();
+  const uint64_t deviceMillis = getDeviceMillis();
+  dashboardClient.syncUpdateSchedule(updateSchedule, deviceMillis);
+
+  // Without an interval from the frame response the stored schedule decides, so an unreachable server
+  // does not cost another connection attempt and the device still wakes at the next update time.
+  const auto scheduledWaitSeconds = dashboardClient.hasNextWait() ? std::nullopt : getScheduledWaitSeconds(updateSchedule, deviceMillis);
+  uint64_t waitSeconds = scheduledWaitSeconds.has_value()
+                             ? *scheduledWaitSeconds
+                             : dashboardClient.fetchNextWaitSeconds().value_or(config.dashboardRate);
+  // The interval is in server seconds; the RTC timer runs at the rate measured against the server time.
+  uint64_t waitMicroseconds = getDeviceSleepMicros(updateSchedule, waitSeconds);
+  esp_sleep_enable_timer_wakeup(waitMicroseconds);
+  esp_sleep_enable_ext0_wakeup(RESET_WAKEUP_PIN, 1);
+  rtc_gpio_pullup_dis(RESET_WAKEUP_PIN);
+  rtc_gpio_pulldown_en(RESET_WAKEUP_PIN);
+  markWakePhase(wakeTimings, WakePhase::SleepEntry, millis());
+  endWakeCycle(wakeTimings);
+  esp_deep_sleep_start();
 }
 
-void clearConfiguration()
+void initDisplay(bool isInitial)
 {
-  Preferences preferences{};
-  preferences.begin(CONFIGURATION_NAMESPACE, false);
-  preferences.clear();
-  preferences.end();
+  hspi.begin(13, 12, 14, 15); // remap hspi for EPD (swap pins)
+  display.epd2.selectSPI(hspi, SPISettings(Panel::spiClockHz, MSBFIRST, SPI_MODE0));
+  display.init(115200, isInitial);
 }
 
 void showWelcomePage(const IPAddress &ip, const String &mac)
 {
   Serial.println("Displaying welcome page...");
+  initDisplay(true);
   
   display.setRotation(0);
   display.setFullWindow();
@@ -352,13 +551,13 @@ void showWelcomePage(const IPAddress &ip, const String &mac)
     display.setTextColor(GxEPD_BLACK);
     int16_t tbx, tby; uint16_t tbw, tbh;
     display.getTextBounds("izBoard", 0, 0, &tbx, &tby, &tbw, &tbh);
-    display.setCursor((displayWidth - tbw) / 2, 60);
+    display.setCursor((Panel::geometry.width - tbw) / 2, 60);
     display.print("izBoard");
     
     // Setup mode text
     display.setFont(&FreeSans12pt7b);
     display.getTextBounds("Setup Mode", 0, 0, &tbx, &tby, &tbw, &tbh);
-    display.setCursor((displayWidth - tbw) / 2, 100);
+    display.setCursor((Panel::geometry.width - tbw) / 2, 100);
     display.print("Setup Mode");
     
     // IP Address
@@ -431,130 +630,77 @@ void createConfiguration()
   Serial.println(macAddress);
 
   // Display welcome page on e-paper
+  setDisplayedFrameETag(displayedFrame, "");
+  wifiSession.isValid = false; // a new network may be configured
+  clearTlsSession(tlsSessionCache); // and a new server
+  clearPendingWakeTimings(wakeTimings); // the timings belong to the previous dashboard
   showWelcomePage(apIP, macAddress);
 
-  // DNS server setup: redirect all domains to ESP32 AP IP
-  const byte DNS_PORT = 53;
-  DNSServer dnsServer;
-  dnsServer.start(DNS_PORT, "*", apIP);
-
-  WebServer server(80);
-  const char *htmlForm = R"rawliteral(
-    <!DOCTYPE html>
-    <html lang="en">
-
-    <head>
-        <meta charset="UTF-8">
-        <meta name="viewport" content="width=device-width, initial-scale=1">
-        <title>izBoard Setup</title>
-        <style>
-            /* Minimal Bootstrap 5 styles for used classes */
-            .container { max-width: 960px; margin-right: auto; margin-left: auto; padding-right: 12px; padding-left: 12px; }
-            .mt-5 { margin-top: 3rem !important; }
-            .text-center { text-align: center !important; }
-            .card { position: relative; display: flex; flex-direction: column; min-width: 0; word-wrap: break-word; background-color: #fff; background-clip: border-box; border: 1px solid rgba(0,0,0,.125); border-radius: .25rem; }
-            .card-header { padding: .75rem 1.25rem; margin-bottom: 0; background-color: rgba(0,0,0,.03); border-bottom: 1px solid rgba(0,0,0,.125); font-weight: 500; }
-            .card-body { flex: 1 1 auto; padding: 1.25rem; }
-            .mb-3 { margin-bottom: 1rem !important; }
-            .form-label { margin-bottom: .5rem; font-weight: 500; display: inline-block; }
-            .form-control { display: block; width: 100%; padding: .375rem .75rem; font-size: 1rem; line-height: 1.5; color: #212529; background-color: #fff; background-clip: padding-box; border: 1px solid #ced4da; border-radius: .25rem; transition: border-color .15s ease-in-out,box-shadow .15s ease-in-out; }
-            .form-control:focus { color: #212529; background-color: #fff; border-color: #86b7fe; outline: 0; box-shadow: 0 0 0 .25rem rgba(13,110,253,.25); }
-            .form-select { display: block; width: 100%; padding: .375rem 2.25rem .375rem .75rem; font-size: 1rem; line-height: 1.5; color: #212529; background-color: #fff; border: 1px solid #ced4da; border-radius: .25rem; transition: border-color .15s ease-in-out,box-shadow .15s ease-in-out; }
-            .input-group { position: relative; display: flex; flex-wrap: wrap; align-items: stretch; width: 100%; }
-            .btn { display: inline-block; font-weight: 400; line-height: 1.5; color: #fff; text-align: center; text-decoration: none; vertical-align: middle; cursor: pointer; background-color: #0d6efd; border: 1px solid #0d6efd; padding: .375rem .75rem; font-size: 1rem; border-radius: .25rem; transition: color .15s ease-in-out,background-color .15s ease-in-out,border-color .15s ease-in-out,box-shadow .15s ease-in-out; }
-            .btn-primary { color: #fff; background-color: #0d6efd; border-color: #0d6efd; }
-            .btn-primary:hover { color: #fff; background-color: #0b5ed7; border-color: #0a58ca; }
-            .w-100 { width: 100% !important; }
-        </style>
-    </head>
-
-    <body>
-
-        <div class="container mt-5">
-            <h2 class="text-center">izBoard Setup</h2>
-
-            <form action="/submit" method="post">
-                <div class="card mb-3">
-                    <div class="card-header">WLAN Setup</div>
-                    <div class="card-body">
-                        <div class="mb-3">
-                            <label for="ssid" class="form-label">SSID</label>
-                            <input type="text" class="form-control" name="ssid" id="ssid" placeholder="Enter SSID ...">
-                        </div>
-                        <div class="mb-3">
-                            <label for="password" class="form-label">Password</label>
-                            <input type="password" class="form-control" name="password" id="password"
-                                placeholder="Enter password ...">
-                        </div>
-                    </div>
-                </div>
-
-                <div class="card mb-3">
-                    <div class="card-header">Dashboard Provider</div>
-                    <div class="card-body">
-                        <div class="mb-3">
-                            <label for="dashboard_url" class="form-label">Url</label>
-                            <input type="text" class="form-control" name="dashboard_url" id="dashboard_url"
-                                placeholder="Enter url ...">
-                        </div>
-                        <div class="mb-3">
-                            <label for="dashboard_port" class="form-label">Port</label>
-                            <input type="text" class="form-control" name="dashboard_port" id="dashboard_port"
-                                placeholder="Enter port ...">
-                        </div>
-                        <div class="mb-3">
-                            <label for="dashboard_apikey" class="form-label">API Key</label>
-                            <input type="text" class="form-control" name="dashboard_apikey" id="dashboard_apikey"
-                                placeholder="Enter API key ...">
-                        </div>
-                        <div class="mb-3">
-                            <label for="time-period" class="form-label">Select Refresh Rate:</label>
-                            <div class="input-group" id="time-period">
-                                <input type="number" class="form-control" name="dashboard_rate" id="dashboard_rate" min="1" max="60"
-                                    placeholder="Enter number ...">
-                                <select class="form-select" name="dashboard_rate_unit" id="dashboard_rate_unit">
-                                    <option value="s">Seconds</option>
-                                    <option value="m">Minutes</option>
-                                    <option value="h">Hours</option>
-                                    <option value="d">Days</option>
-                                </select>
-                            </div>
-                        </div>
-                    </div>
-                </div>
-
-                <button type="submit" class="btn btn-primary w-100">Apply</button>
-            </form>
-        </div>
-    </body>
-
-    </html>
-    )rawliteral";
-  server.on("/", [&server, htmlForm]()
-            { server.send(200, "text/html", htmlForm); });
-
-  server.on("/submit", HTTP_POST, [&server, htmlForm]()
+  // Both servers run in the tasks of the network stack and answer each packet as it arrives, so this task only
+  // blinks the LED until a configuration has been stored.
+  const uint16_t DNS_PORT = 53;
+  const uint8_t address[4] = {apIP[0], apIP[1], apIP[2], apIP[3]};
+  AsyncUDP dnsServer;
+  if (dnsServer.listen(DNS_PORT))
+  {
+    dnsServer.onPacket([&address](AsyncUDPPacket &packet)
+                       {
+      uint8_t response[CAPTIVE_DNS_MAX_MESSAGE_LENGTH];
+      const size_t length = writeCaptiveDnsResponse(packet.data(), packet.length(), address, response, sizeof(response));
+      if (length > 0) {
+        packet.write(response, length);
+      } });
+  }
+
+  // The page is kept gzipped in flash and sent as is; browsers revalidate it with its entity tag.
+  AsyncWebServer server(80);
+  auto sendSetupPage = [](AsyncWebServerRequest *request, int statusCode)
+  {
+    if (statusCode == 200 && request->hasHeader("If-None-Match") && request->header("If-None-Match") == portalIndexETag) {
+      request->send(304);
+      return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse(statusCode, "text/html", portalIndexGzip, portalIndexGzipLength);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("ETag", portalIndexETag);
+    request->send(response);
+  };
+
+  std::atomic<bool> isConfigurationStored{false};
+  server.on("/", HTTP_GET, [sendSetupPage](AsyncWebServerRequest *request)
+            { sendSetupPage(request, 200); });
+
+  server.on("/submit", HTTP_POST, [sendSetupPage, &isConfigurationStored](AsyncWebServerRequest *request)
             {
-    const String ssidParam{ "ssid" };
-    const String passParam{ "password" };
-    const String urlParam{ "dashboard_url" };
-    const String portParam{ "dashboard_port" };
-    const String rateParam{ "dashboard_rate" };
-    const String rateUnitParam{ "dashboard_rate_unit" };
-    const String apiKeyParam{ "dashboard_apikey" };
+    const char *ssidParam{ "ssid" };
+    const char *passParam{ "password" };
+    const char *urlParam{ "dashboard_url" };
+    const char *portParam{ "dashboard_port" };
+    const char *rateParam{ "dashboard_rate" };
+    const char *rateUnitParam{ "dashboard_rate_unit" };
+    const char *apiKeyParam{ "dashboard_apikey" };
+    const char *certificateFingerprintParam{ "dashboard_certsha" };
     if (
-      !server.hasArg(ssidParam) || !server.hasArg(passParam) || !server.hasArg(urlParam) || !server.hasArg(portParam) || !server.hasArg(rateParam) || !server.hasArg(rateUnitParam) || !server.hasArg(apiKeyParam)) {
-      server.send(400, "text/html", htmlForm);
+      !request->hasParam(ssidParam, true) || !request->hasParam(passParam, true) || !request->hasParam(urlParam, true) || !request->hasParam(portParam, true) || !request->hasParam(rateParam, true) || !request->hasParam(rateUnitParam, true) || !request->hasParam(apiKeyParam, true)) {
+      sendSetupPage(request, 400);
       return;
     }
 
-    const String ssid{ server.arg(ssidParam) };
-    const String pass{ server.arg(passParam) };
-    const String url{ server.arg(urlParam) };
-    const int port{ server.arg(portParam).toInt() };
-    const uint64_t rate{ static_cast<uint64_t>(server.arg(rateParam).toInt()) };
-    const String unit{ server.arg(rateUnitParam) };
-    const String apiKey{ server.arg(apiKeyParam) };
+    const String ssid{ request->getParam(ssidParam, true)->value() };
+    const String pass{ request->getParam(passParam, true)->value() };
+    const String url{ request->getParam(urlParam, true)->value() };
+    const int port{ request->getParam(portParam, true)->value().toInt() };
+    const uint64_t rate{ static_cast<uint64_t>(request->getParam(rateParam, true)->value().toInt()) };
+    const String unit{ request->getParam(rateUnitParam, true)->value() };
+    const String apiKey{ request->getParam(apiKeyParam, true)->value() };
+    // The fingerprint pins the server certificate; without one the device speaks plain HTTP.
+    const String certificateFingerprint{ request->hasParam(certificateFingerprintParam, true) ? request->getParam(certificateFingerprintParam, true)->value() : String() };
+    uint8_t fingerprint[TLS_FINGERPRINT_LENGTH];
+    if (certificateFingerprint.length() > 0 && !parseCertificateFingerprint(certificateFingerprint.c_str(), fingerprint)) {
+      sendSetupPage(request, 400);
+      return;
+    }
 
     int32_t unitMultiplier{ 1 };
     if (unit.equals("m")) {
@@ -568,85 +714,129 @@ void createConfiguration()
     const uint64_t dashboardRefreshRate = (rate + 1) * unitMultiplier;
 
     Configuration config{
-      ssid,
-      pass,
-      url,
+      ssid.c_str(),
+      pass.c_str(),
+      url.c_str(),
       port,
       dashboardRefreshRate,
-      apiKey
+      apiKey.c_str(),
+      certificateFingerprint.c_str()
     };
     Serial.println("Received configuration...");
-    storeConfiguration(config);
+    {
+      PreferencesSettingsStore settings{false};
+      storeConfiguration(settings, config);
+    }
 
-    server.send(200, "text/html", "Settings saved. Rebooting...");
-    digitalWrite(LED_PIN, LOW);
-    delay(1000);
-    ESP.restart(); });
+    // The setup task restarts the device a second later, once the response is sent.
+    request->send(200, "text/html", "Settings saved. Rebooting...");
+    isConfigurationStored = true; });
 
-  auto redirectToRoot = [&server]()
+  auto redirectToRoot = [](AsyncWebServerRequest *request)
   {
-    server.sendHeader("Location", "/", true);
-    server.send(302, "text/plain", "Redirecting to setup page...");
+    request->redirect("/");
   };
 
-  server.on("/generate_204", redirectToRoot);
-  server.on("/hotspot-detect.html", redirectToRoot);
-  server.on("/ncsi.txt", redirectToRoot);
-  server.onNotFound([&server, htmlForm, &redirectToRoot]()
+  server.on("/generate_204", HTTP_ANY, redirectToRoot);
+  server.on("/hotspot-detect.html", HTTP_ANY, redirectToRoot);
+  server.on("/ncsi.txt", HTTP_ANY, redirectToRoot);
+  server.onNotFound([redirectToRoot](AsyncWebServerRequest *request)
                     {
-    if (server.uri() == "/submit") {
-      server.send(404, "text/plain", "Not found");
+    if (request->url() == "/submit") {
+      request->send(404, "text/plain", "Not found");
       return;
     }
-    redirectToRoot(); });
+    redirectToRoot(request); });
 
   server.begin();
   Serial.println("HTTP server started");
 
-  unsigned long lastBlinkTime = 0;
   bool ledState = false;
   const unsigned long blinkInterval = 500;
 
-  while (true)
+  while (!isConfigurationStored)
   {
-    dnsServer.processNextRequest();
-    server.handleClient();
-    
-    unsigned long currentTime = millis();
-    if (currentTime - lastBlinkTime >= blinkInterval)
-    {
-      lastBlinkTime = currentTime;
-      ledState = !ledState;
-      digitalWrite(LED_PIN, ledState ? HIGH : LOW);
-    }
-    
-    delay(2);
+    ledState = !ledState;
+    digitalWrite(LED_PIN, ledState ? HIGH : LOW);
+    delay(blinkInterval);
   }
+
+  digitalWrite(LED_PIN, LOW);
+  delay(1000);
+  ESP.restart();
 }
 
 bool connectToWiFi(const Configuration &config)
 {
   Serial.println("Found stored configuration!");
   Serial.println("Connecting to WiFi");
-  const auto maxConnectionTestRetries = 20;
-  auto connectionTestRetry = 0;
-  WiFi.begin(config.ssid.c_str(), config.password.c_str());
-  while (WiFi.status() != WL_CONNECTED && connectionTestRetry < maxConnectionTestRetries)
+  const unsigned long connectStart = millis();
+
+  if (wifiEvents == nullptr)
+  {
+    wifiEvents = xEventGroupCreate();
+    WiFi.onEvent([](arduino_event_id_t)
+                 { xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT); },
+                 ARDUINO_EVENT_WIFI_STA_GOT_IP);
+    WiFi.onEvent([](arduino_event_id_t)
+                 { xEventGroupSetBits(wifiEvents, WIFI_DISCONNECTED_BIT); },
+                 ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  }
+
+  // The session is kept in RTC memory, so there is no need to write WiFi settings to flash on every wake.
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+
+  bool isConnected = false;
+  if (wifiSession.isValid)
+  { // join the known access point on its channel with the previous lease, skipping the scan and DHCP
+    WiFi.config(IPAddress(wifiSession.localIp), IPAddress(wifiSession.gateway), IPAddress(wifiSession.subnet), IPAddress(wifiSession.dns));
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+    WiFi.begin(config.ssid.c_str(), config.password.c_str(), wifiSession.channel, wifiSession.bssid);
+    isConnected = waitForWiFi(WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT, WIFI_CACHED_CONNECT_TIMEOUT) & WIFI_GOT_IP_BIT;
+    if (!isConnected)
+    {
+      Serial.println("Cached WiFi session failed, falling back to a full scan");
+      wifiSession.isValid = false;
+      WiFi.disconnect();
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+  }
+
+  if (!isConnected)
   {
-    ++connectionTestRetry;
-    delay(500);
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_DISCONNECTED_BIT);
+    WiFi.begin(config.ssid.c_str(), config.password.c_str());
+    isConnected = waitForWiFi(WIFI_GOT_IP_BIT, WIFI_CONNECT_TIMEOUT) & WIFI_GOT_IP_BIT;
   }
-  if (WiFi.status() != WL_CONNECTED)
+
+  if (!isConnected)
   {
     return false;
   }
 
-  Serial.println("WiFi connected");
+  const bool isCachedSession = wifiSession.isValid;
+  memcpy(wifiSession.bssid, WiFi.BSSID(), sizeof(wifiSession.bssid));
+  wifiSession.channel = WiFi.channel();
+  wifiSession.localIp = WiFi.localIP();
+  wifiSession.gateway = WiFi.gatewayIP();
+  wifiSession.subnet = WiFi.subnetMask();
+  wifiSession.dns = WiFi.dnsIP();
+  wifiSession.isValid = true;
+
+  markWakePhase(wakeTimings, WakePhase::WiFiConnect, millis());
+  Serial.printf("WiFi connected in %lu ms (%s)\n", millis() - connectStart, isCachedSession ? "cached session" : "full scan");
   Serial.print("IP address: ");
   Serial.println(WiFi.localIP());
   return true;
 }
 
+// Blocks until one of the event bits is set by the WiFi event handlers or the timeout expires.
+EventBits_t waitForWiFi(EventBits_t bits, uint32_t timeoutMillis)
+{
+  return xEventGroupWaitBits(wifiEvents, bits, pdTRUE, pdFALSE, pdMS_TO_TICKS(timeoutMillis));
+}
+
 bool isResetRequested()
 {
   pinMode(RESET_WAKEUP_PIN, INPUT_PULLDOWN);
@@ -670,6 +860,9 @@ bool isResetRequested()
 
 void resetDevice()
 {
-  clearConfiguration();
+  {
+    PreferencesSettingsStore settings{false};
+    clearConfiguration(settings);
+  }
   ESP.restart();
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "firmware_patch.h"
+
+#include <string.h>
+
+static const uint8_t patchMagic[4] = {'I', 'Z', 'D', '1'};
+static const uint32_t rejectedMarker = 0x52464D31;
+
+enum PatchOp : uint8_t
+{
+  CopyOp = 0,
+  InsertOp = 1,
+  ReplaceOp = 2,
+  SeekOp = 3
+};
+
+static uint32_t readUint32(const uint8_t *data)
+{
+  return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+         static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+bool FirmwarePatcher::write(const uint8_t *data, size_t length)
+{
+  size_t offset = 0;
+  while (offset < length)
+  {
+    switch (state)
+    {
+    case State::Header:
+    {
+      const size_t count = length - offset < sizeof(headerBytes) - headerLength ? length - offset : sizeof(headerBytes) - headerLength;
+      memcpy(headerBytes + headerLength, data + offset, count);
+      headerLength += count;
+      offset += count;
+      if (headerLength == sizeof(headerBytes) && !beginPatch())
+      {
+        return false;
+      }
+      break;
+    }
+
+    case State::Op:
+      op = data[offset++];
+      operand = 0;
+      operandShift = 0;
+      state = State::Operand;
+      break;
+
+    case State::Operand:
+    {
+      const uint8_t byte = data[offset++];
+      if (operandShift > 35)
+      {
+        return fail("operand too long");
+      }
+      operand |= static_cast<uint64_t>(byte & 0x7F) << operandShift;
+      operandShift += 7;
+      if ((byte & 0x80) == 0 && !runOp())
+      {
+        return false;
+      }
+      break;
+    }
+
+    case State::Literal:
+    { // literal bytes go from the received data straight to the flash
+      const size_t count = length - offset < literalRemaining ? length - offset : literalRemaining;
+      if (!updater.write(data + offset, count))
+      {
+        return fail("flash write failed");
+      }
+      offset += count;
+      literalRemaining -= count;
+      writtenBytes += count;
+      if (literalRemaining == 0)
+      {
+        state = writtenBytes == header.targetSize ? State::Complete : State::Op;
+      }
+      break;
+    }
+
+    case State::Complete:
+      return fail("data after the end of the image");
+
+    case State::Failed:
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool FirmwarePatcher::beginPatch()
+{
+  if (memcmp(headerBytes, patchMagic, sizeof(patchMagic)) != 0)
+  {
+    return fail("not a firmware delta");
+  }
+
+  const uint8_t *field = headerBytes + sizeof(patchMagic);
+  header.sourceSize = readUint32(field);
+  memcpy(header.sourceSha256, field + 4, FIRMWARE_SHA256_LENGTH);
+  field += 4 + FIRMWARE_SHA256_LENGTH;
+  header.targetSize = readUint32(field);
+  memcpy(header.targetSha256, field + 4, FIRMWARE_SHA256_LENGTH);
+
+  // A delta against another build would produce a broken image, so the running one is checked before erasing anything.
+  if (!updater.isRunning(header.sourceSize, header.sourceSha256))
+  {
+    isSourceMismatch = true;
+    return fail("made for another firmware image");
+  }
+
+  if (header.targetSize == 0 || !updater.begin(header.targetSize))
+  {
+    return fail("the update slot cannot hold the image");
+  }
+
+  state = State::Op;
+  return true;
+}
+
+bool FirmwarePatcher::runOp()
+{
+  if (op != SeekOp && operand > header.targetSize - writtenBytes)
+  {
+    return fail("instruction past the end of the image");
+  }
+
+  const uint32_t length = static_cast<uint32_t>(operand);
+  switch (op)
+  {
+  case CopyOp:
+    if (!copySource(length))
+    {
+      return false;
+    }
+    break;
+
+  case InsertOp:
+  case ReplaceOp:
+    literalRemaining = length;
+    if (op == ReplaceOp)
+    {
+      sourceCursor += length;
+    }
+    state = length > 0 ? State::Literal : State::Op;
+    return true;
+
+  case SeekOp:
+  {
+    const int64_t offset = static_cast<int64_t>(operand >> 1) ^ -static_cast<int64_t>(operand & 1);
+    const int64_t cursor = static_cast<int64_t>(sourceCursor) + offset;
+    if (cursor < 0 || cursor > header.sourceSize)
+    {
+      return fail("source offset out of range");
+    }
+    sourceCursor = static_cast<uint32_t>(cursor);
+    break;
+  }
+
+  default:
+    return fail("unknown instruction");
+  }
+
+  state = writtenBytes == header.targetSize ? State::Complete : State::Op;
+  return true;
+}
+
+bool FirmwarePatcher::copySource(uint32_t length)
+{
+  if (sourceCursor > header.sourceSize || length > header.sourceSize - sourceCursor)
+  {
+    return fail("copy past the end of the running image");
+  }
+
+  while (length > 0)
+  {
+    const size_t count = length < sizeof(copyBuffer) ? length : sizeof(copyBuffer);
+    if (!updater.readRunning(sourceCursor, copyBuffer, count) || !updater.write(copyBuffer, count))
+    {
+      return fail("flash access failed");
+    }
+    sourceCursor += count;
+    writtenBytes += count;
+    length -= count;
+  }
+
+  return true;
+}
+
+bool FirmwarePatcher::fail(const char *reason)
+{
+  if (state != State::Failed)
+  {
+    deviceLog("Firmware delta rejected: %s.\n", reason);
+  }
+  state = State::Failed;
+  return false;
+}
+
+void beginRejectedFirmware(RejectedFirmware &rejected)
+{
+  if (rejected.marker == rejectedMarker && memchr(rejected.version, '\0', sizeof(rejected.version)) != nullptr)
+  {
+    return;
+  }
+
+  memset(&rejected, 0, sizeof(rejected));
+  rejected.marker = rejectedMarker;
+}
+
+bool isFirmwareRejected(const RejectedFirmware &rejected, const char *version)
+{
+  return rejected.version[0] != '\0' && strcmp(rejected.version, version) == 0;
+}
+
+void rejectFirmware(RejectedFirmware &rejected, const char *version)
+{
+  strncpy(rejected.version, version, sizeof(rejected.version) - 1);
+  rejected.version[sizeof(rejected.version) - 1] = '\0';
+}
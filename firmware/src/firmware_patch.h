@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "device_interfaces.h"
+
+#define FIRMWARE_SHA256_LENGTH 32
+#define FIRMWARE_VERSION_MAX_LENGTH 23
+#define FIRMWARE_PATCH_HEADER_LENGTH (4 + 2 * (4 + FIRMWARE_SHA256_LENGTH))
+
+// The image a firmware delta applies to and the image it produces.
+struct FirmwarePatchHeader
+{
+  uint32_t sourceSize;
+  uint8_t sourceSha256[FIRMWARE_SHA256_LENGTH];
+  uint32_t targetSize;
+  uint8_t targetSha256[FIRMWARE_SHA256_LENGTH];
+};
+
+// Applies a firmware delta while it is received and writes the new image to the inactive slot.
+// After the header (magic "IZD1", then size and SHA-256 of the source and of the target image, sizes little-endian)
+// the delta is a list of instructions, each an op byte and an unsigned LEB128 operand:
+//   0 copy n bytes of the running image from the source cursor, which advances
+//   1 insert the n literal bytes that follow
+//   2 replace: like insert, and the source cursor skips n bytes
+//   3 move the source cursor by a zigzag-coded signed offset
+// Code that moved keeps most of its bytes, so a new build is mostly copies with short replacements where
+// addresses changed. Only a small copy buffer is needed, and the delta is never stored.
+class FirmwarePatcher
+{
+public:
+  explicit FirmwarePatcher(FirmwareUpdater &updater) : updater(updater) {}
+
+  // Applies the next bytes of the delta. False once the delta is found not to apply to the running firmware,
+  // is malformed, or the flash fails; the inactive slot is then left unfinished.
+  bool write(const uint8_t *data, size_t length);
+
+  // True once the whole new image has been written; FirmwareUpdater::finish() still has to verify it.
+  bool isComplete() const { return state == State::Complete; }
+  // True if the delta was rejected because it was made for another image than the running one.
+  bool isForAnotherImage() const { return isSourceMismatch; }
+  const FirmwarePatchHeader &getHeader() const { return header; }
+
+private:
+  enum class State
+  {
+    Header,
+    Op,
+    Operand,
+    Literal,
+    Complete,
+    Failed
+  };
+
+  bool beginPatch();
+  bool runOp();
+  bool copySource(uint32_t length);
+  bool fail(const char *reason);
+
+  FirmwareUpdater &updater;
+  State state = State::Header;
+  FirmwarePatchHeader header{};
+  uint8_t headerBytes[FIRMWARE_PATCH_HEADER_LENGTH];
+  size_t headerLength = 0;
+  uint8_t op = 0;
+  uint64_t operand = 0;
+  uint8_t operandShift = 0;
+  uint32_t literalRemaining = 0;
+  uint32_t sourceCursor = 0;
+  uint32_t writtenBytes = 0;
+  bool isSourceMismatch = false;
+  uint8_t copyBuffer[512];
+};
+
+// Version whose delta was made for another image than the running one. The device keeps it in RTC memory, so that
+// later wakes skip it instead of downloading the same delta only to reject it again.
+struct RejectedFirmware
+{
+  uint32_t marker; // tells a record kept in RTC memory from garbage after a power loss
+  char version[FIRMWARE_VERSION_MAX_LENGTH + 1]; // empty if none
+};
+
+void beginRejectedFirmware(RejectedFirmware &rejected);
+bool isFirmwareRejected(const RejectedFirmware &rejected, const char *version);
+void rejectFirmware(RejectedFirmware &rejected, const char *version);
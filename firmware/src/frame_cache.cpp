@@ -0,0 +1,283 @@
+#include "frame_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t indexMarker = 0x46434931;
+static const uint32_t fileMagic = 0x46525A32;
+
+void FrameCache::begin()
+{
+  if (index.marker == indexMarker)
+  {
+    return;
+  }
+
+  memset(&index, 0, sizeof(index));
+  index.marker = indexMarker;
+
+  FileHeader header;
+  char path[24];
+  for (uint8_t slot = 0; slot < FrameCacheIndex::capacity; ++slot)
+  {
+    getPath(slot, path, sizeof(path));
+    if (storage.openRead(path) &&
+        storage.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header) &&
+        header.magic == fileMagic && memchr(header.etag, '\0', sizeof(header.etag)) != nullptr)
+    {
+      strcpy(index.slots[slot].etag, header.etag);
+    }
+    storage.close();
+  }
+
+  deviceLog("Frame cache index rebuilt from flash.\n");
+}
+
+bool FrameCache::contains(const char *etag) const
+{
+  return findSlot(etag) >= 0;
+}
+
+size_t FrameCache::appendETags(char *buffer, size_t length, size_t capacity, const char *excludedETag) const
+{
+  for (const auto &slot : index.slots)
+  {
+    const size_t etagLength = strlen(slot.etag);
+    if (etagLength == 0 || (excludedETag != nullptr && strcmp(slot.etag, excludedETag) == 0))
+    {
+      continue;
+    }
+
+    const size_t separatorLength = length > 0 ? 2 : 0;
+    if (length + separatorLength + etagLength >= capacity)
+    {
+      continue;
+    }
+
+    if (separatorLength > 0)
+    {
+      memcpy(buffer + length, ", ", separatorLength);
+      length += separatorLength;
+    }
+    memcpy(buffer + length, slot.etag, etagLength + 1);
+    length += etagLength;
+  }
+
+  return length;
+}
+
+bool FrameCache::beginStore(const char *etag, FrameEncoding encoding, const FrameLayout &layout)
+{
+  abortStore();
+  if (etag[0] == '\0' || strlen(etag) > FRAME_ETAG_MAX_LENGTH || contains(etag))
+  {
+    return false;
+  }
+
+  if (!wasSeen(etag))
+  { // frames that never come back are not worth a flash write
+    strcpy(index.seen[index.seenNext], etag);
+    index.seenNext = (index.seenNext + 1) % FrameCacheIndex::seenCapacity;
+    return false;
+  }
+
+  // A free slot, or else the least recently used one. The frame in it stays usable until the new one is committed.
+  int slot = 0;
+  for (int i = 0; i < FrameCacheIndex::capacity; ++i)
+  {
+    if (index.slots[i].etag[0] == '\0')
+    {
+      slot = i;
+      break;
+    }
+
+    if (index.slots[i].lastUsed < index.slots[slot].lastUsed)
+    {
+      slot = i;
+    }
+  }
+
+  char path[24];
+  getPath(slot, path, sizeof(path));
+  FileHeader header{fileMagic, "", static_cast<uint8_t>(encoding), layout.panel.planeCount, layout.bandRows};
+  strcpy(header.etag, etag);
+  if (!storage.openWrite(path) || !storage.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header)))
+  {
+    storage.close();
+    return false;
+  }
+
+  storingSlot = slot;
+  strcpy(storingETag, etag);
+  deviceLog("Storing frame %s in flash slot %d.\n", etag, slot);
+  return true;
+}
+
+void FrameCache::append(const uint8_t *data, size_t length)
+{
+  if (storingSlot >= 0 && !storage.write(data, length))
+  {
+    deviceLog("Failed to write the frame to flash.\n");
+    abortStore();
+  }
+}
+
+void FrameCache::commitStore()
+{
+  if (storingSlot < 0)
+  {
+    return;
+  }
+
+  auto &slot = index.slots[storingSlot];
+  storingSlot = -1;
+  if (!storage.commit())
+  {
+    deviceLog("Failed to write the frame to flash.\n");
+    return;
+  }
+
+  strcpy(slot.etag, storingETag);
+  slot.lastUsed = ++index.useCount;
+  for (auto &seen : index.seen)
+  {
+    if (strcmp(seen, storingETag) == 0)
+    {
+      seen[0] = '\0';
+    }
+  }
+}
+
+void FrameCache::abortStore()
+{
+  if (storingSlot < 0)
+  {
+    return;
+  }
+
+  storingSlot = -1;
+  storage.close();
+}
+
+bool FrameCache::openFrame(const char *etag, const FrameLayout &layout, FrameEncoding &encoding)
+{
+  const int slot = findSlot(etag);
+  if (slot < 0)
+  {
+    return false;
+  }
+
+  char path[24];
+  getPath(slot, path, sizeof(path));
+  FileHeader header;
+  if (!storage.openRead(path) ||
+      storage.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header) ||
+      header.magic != fileMagic || strncmp(header.etag, etag, sizeof(header.etag)) != 0 ||
+      header.encoding > static_cast<uint8_t>(FrameEncoding::Planar) ||
+      header.planeCount != layout.panel.planeCount || header.bandRows != layout.bandRows)
+  {
+    storage.close();
+    return false;
+  }
+
+  encoding = static_cast<FrameEncoding>(header.encoding);
+  index.slots[slot].lastUsed = ++index.useCount;
+  return true;
+}
+
+void FrameCache::remove(const char *etag)
+{
+  const int slot = findSlot(etag);
+  if (slot >= 0)
+  {
+    index.slots[slot].etag[0] = '\0';
+    index.slots[slot].lastUsed = 0;
+  }
+}
+
+void FrameCache::getPath(uint8_t slot, char *path, size_t capacity)
+{
+  snprintf(path, capacity, "/frame%u.bin", slot);
+}
+
+int FrameCache::findSlot(const char *etag) const
+{
+  if (etag == nullptr || etag[0] == '\0')
+  {
+    return -1;
+  }
+
+  for (int slot = 0; slot < FrameCacheIndex::capacity; ++slot)
+  {
+    if (strcmp(index.slots[slot].etag, etag) == 0)
+    {
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+bool FrameCache::wasSeen(const char *etag) const
+{
+  for (const auto &seen : index.seen)
+  {
+    if (strcmp(seen, etag) == 0)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool StoredFrameReader::readBytes(uint8_t *data, size_t length)
+{
+  while (length > 0)
+  {
+    if (bufferOffset == bufferLength && !fill())
+    {
+      return false;
+    }
+
+    const size_t available = bufferLength - bufferOffset;
+    const size_t count = length < available ? length : available;
+    memcpy(data, buffer + bufferOffset, count);
+    bufferOffset += count;
+    bodyOffset += count;
+    data += count;
+    length -= count;
+  }
+
+  return true;
+}
+
+bool StoredFrameReader::readBand(FrameBandDecoder &decoder)
+{
+  while (!decoder.isBandComplete())
+  {
+    if (decoder.hasError() || (bufferOffset == bufferLength && !fill()))
+    {
+      return false;
+    }
+
+    const size_t consumed = decoder.decode(buffer + bufferOffset, bufferLength - bufferOffset);
+    bufferOffset += consumed;
+    bodyOffset += consumed;
+  }
+
+  return true;
+}
+
+bool StoredFrameReader::fill()
+{
+  const size_t bytesRead = cache.read(buffer, sizeof(buffer));
+  if (bytesRead == 0)
+  {
+    return false;
+  }
+
+  bufferLength = bytesRead;
+  bufferOffset = 0;
+  return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "device_interfaces.h"
+#include "frame_decoder.h"
+#include "panel_profile.h"
+
+#define FRAME_ETAG_MAX_LENGTH 40
+
+// Frames stored in flash and frames received recently. The device keeps it in RTC memory so that a wake
+// does not need to read the file system; after a power loss it is rebuilt from the stored files.
+struct FrameCacheIndex
+{
+  static const uint8_t capacity = 6;
+  static const uint8_t seenCapacity = 8;
+
+  struct Slot
+  {
+    char etag[FRAME_ETAG_MAX_LENGTH + 1]; // empty for a free slot
+    uint32_t lastUsed;
+  };
+
+  uint32_t marker; // tells an index kept in RTC memory from garbage after a power loss
+  uint32_t useCount;
+  Slot slots[capacity];
+  char seen[seenCapacity][FRAME_ETAG_MAX_LENGTH + 1];
+  uint8_t seenNext;
+};
+
+// Keeps complete frames in flash, keyed by the frame id the server sends as ETag, so that dashboards
+// cycling through a few views are drawn from flash instead of being downloaded again.
+// To spare the flash, a frame is only written when it is received for the second time, a stored frame is
+// never written again and using one only updates the index in RTC memory. The least recently used frame is replaced.
+class FrameCache
+{
+public:
+  FrameCache(FrameCacheIndex &index, FrameStorage &storage) : index(index), storage(storage) {}
+
+  // Rebuilds the index from the stored files if RTC memory did not keep it.
+  void begin();
+
+  bool contains(const char *etag) const;
+
+  // Appends the ids of the stored frames except the excluded one to a comma-separated If-None-Match list
+  // of the given length and returns the new length. Ids that do not fit are left out.
+  size_t appendETags(char *buffer, size_t length, size_t capacity, const char *excludedETag) const;
+
+  // Starts storing a complete frame while it is received. Returns false if the frame is not stored.
+  bool beginStore(const char *etag, FrameEncoding encoding, const FrameLayout &layout);
+  void append(const uint8_t *data, size_t length);
+  // Keeps the stored frame; only called once every band is verified.
+  void commitStore();
+  void abortStore();
+
+  // Opens a stored frame for reading with read(). Fails if it was stored in other bands than the layout has.
+  bool openFrame(const char *etag, const FrameLayout &layout, FrameEncoding &encoding);
+  size_t read(uint8_t *data, size_t length) { return storage.read(data, length); }
+  void closeFrame() { storage.close(); }
+
+  // Forgets a stored frame, e.g. one that failed verification. Its file is replaced later.
+  void remove(const char *etag);
+
+private:
+  struct FileHeader
+  {
+    uint32_t magic;
+    char etag[FRAME_ETAG_MAX_LENGTH + 1];
+    uint8_t encoding;
+    uint8_t planeCount;
+    uint16_t bandRows;
+  };
+
+  static void getPath(uint8_t slot, char *path, size_t capacity);
+  int findSlot(const char *etag) const;
+  bool wasSeen(const char *etag) const;
+
+  FrameCacheIndex &index;
+  FrameStorage &storage;
+  int storingSlot = -1;
+  char storingETag[FRAME_ETAG_MAX_LENGTH + 1] = "";
+};
+
+// Reads a stored frame body in the same way as a response body.
+class StoredFrameReader : public FrameReader
+{
+public:
+  explicit StoredFrameReader(FrameCache &cache) : cache(cache) {}
+
+  bool readBytes(uint8_t *data, size_t length) override;
+  bool readBand(FrameBandDecoder &decoder) override;
+  uint32_t getBodyOffset() const override { return bodyOffset; }
+
+private:
+  bool fill();
+
+  FrameCache &cache;
+  uint8_t buffer[1024];
+  size_t bufferLength = 0;
+  size_t bufferOffset = 0;
+  uint32_t bodyOffset = 0;
+};
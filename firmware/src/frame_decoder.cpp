@@ -0,0 +1,159 @@
+#include "frame_decoder.h"
+
+#include <string.h>
+
+FrameBandDecoder::FrameBandDecoder(FrameEncoding encoding, uint16_t rowBytes, uint8_t planeCount)
+    : encoding(encoding), rowBytes(rowBytes), planeCount(planeCount)
+{
+}
+
+void FrameBandDecoder::beginBand(uint8_t *blackPlane, uint8_t *redPlane, uint16_t rows)
+{
+  black = blackPlane;
+  red = redPlane;
+  planeBytes = static_cast<size_t>(rows) * rowBytes;
+  remaining = planeBytes * planeCount;
+  interleavedIndex = 0;
+  row = 0;
+  isRedRow = false;
+  rowOutput = black;
+  rowRemaining = rowBytes;
+  runState = RunState::Header;
+  runLength = 0;
+  isMalformed = false;
+}
+
+size_t FrameBandDecoder::decode(const uint8_t *data, size_t length)
+{
+  if (isMalformed || remaining == 0)
+  {
+    return 0;
+  }
+
+  switch (encoding)
+  {
+  case FrameEncoding::Rle:
+    return decodeRle(data, length);
+  case FrameEncoding::Planar:
+    return decodePlanar(data, length);
+  default:
+    return decodeRaw(data, length);
+  }
+}
+
+size_t FrameBandDecoder::decodeRaw(const uint8_t *data, size_t length)
+{
+  const size_t count = length < remaining ? length : remaining;
+  if (planeCount == 1)
+  {
+    memcpy(black + interleavedIndex, data, count);
+    interleavedIndex += count;
+    remaining -= count;
+    return count;
+  }
+
+  for (size_t i = 0; i < count; ++i, ++interleavedIndex)
+  {
+    if ((interleavedIndex & 1) == 0)
+    {
+      black[interleavedIndex / 2] = data[i];
+    }
+    else
+    {
+      red[interleavedIndex / 2] = data[i];
+    }
+  }
+
+  remaining -= count;
+  return count;
+}
+
+size_t FrameBandDecoder::decodePlanar(const uint8_t *data, size_t length)
+{
+  size_t consumed = 0;
+  while (consumed < length && remaining > 0)
+  {
+    const bool isRed = interleavedIndex >= planeBytes;
+    const size_t planeOffset = isRed ? interleavedIndex - planeBytes : interleavedIndex;
+    const size_t planeRemaining = planeBytes - planeOffset;
+    const size_t count = length - consumed < planeRemaining ? length - consumed : planeRemaining;
+    memcpy((isRed ? red : black) + planeOffset, data + consumed, count);
+    consumed += count;
+    interleavedIndex += count;
+    remaining -= count;
+  }
+
+  return consumed;
+}
+
+size_t FrameBandDecoder::decodeRle(const uint8_t *data, size_t length)
+{
+  size_t consumed = 0;
+  while (consumed < length && remaining > 0)
+  {
+    switch (runState)
+    {
+    case RunState::Header:
+    {
+      const int8_t header = static_cast<int8_t>(data[consumed++]);
+      if (header == -128)
+      { // no-op
+        break;
+      }
+
+      runLength = header >= 0 ? header + 1 : 1 - header;
+      if (runLength > rowRemaining)
+      { // runs never cross a row
+        isMalformed = true;
+        return consumed;
+      }
+
+      runState = header >= 0 ? RunState::Literal : RunState::Repeat;
+      break;
+    }
+    case RunState::Literal:
+    {
+      const size_t available = length - consumed;
+      const size_t count = available < runLength ? available : runLength;
+      memcpy(rowOutput, data + consumed, count);
+      consumed += count;
+      rowOutput += count;
+      rowRemaining -= count;
+      remaining -= count;
+      runLength -= count;
+      break;
+    }
+    case RunState::Repeat:
+      memset(rowOutput, data[consumed++], runLength);
+      rowOutput += runLength;
+      rowRemaining -= runLength;
+      remaining -= runLength;
+      runLength = 0;
+      break;
+    }
+
+    if (runLength == 0 && runState != RunState::Header)
+    {
+      runState = RunState::Header;
+    }
+
+    if (rowRemaining == 0)
+    {
+      nextRow();
+    }
+  }
+
+  return consumed;
+}
+
+void FrameBandDecoder::nextRow()
+{
+  if (isRedRow || planeCount == 1)
+  {
+    ++row;
+  }
+
+  isRedRow = planeCount > 1 && !isRedRow;
+  rowOutput = (isRedRow ? red : black) + static_cast<size_t>(row) * rowBytes;
+  rowRemaining = rowBytes;
+}
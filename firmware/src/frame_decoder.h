@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum class FrameEncoding
+{
+  Raw, // interleaved black and red bytes
+  Rle, // per row: PackBits-coded black row, then PackBits-coded red row
+  Planar // per band: all black rows, then all red rows
+};
+
+// Expands the binary frame stream into the black and red planes of one band at a time.
+// Input may arrive in chunks of any size; the decoder never holds more than the current band.
+// Frames for black and white panels have the black plane only and read like the others without the red bytes.
+class FrameBandDecoder
+{
+public:
+  FrameBandDecoder(FrameEncoding encoding, uint16_t rowBytes, uint8_t planeCount = 2);
+
+  // Starts a band from scratch, also after an error, e.g. when an interrupted band is received again.
+  void beginBand(uint8_t *black, uint8_t *red, uint16_t rows);
+
+  // Consumes bytes until the band is complete and returns how many were used.
+  size_t decode(const uint8_t *data, size_t length);
+
+  bool isBandComplete() const { return remaining == 0 && !hasError(); }
+  bool hasError() const { return isMalformed; }
+  FrameEncoding getEncoding() const { return encoding; }
+
+private:
+  enum class RunState
+  {
+    Header,
+    Literal,
+    Repeat
+  };
+
+  size_t decodeRaw(const uint8_t *data, size_t length);
+  size_t decodeRle(const uint8_t *data, size_t length);
+  size_t decodePlanar(const uint8_t *data, size_t length);
+  void nextRow();
+
+  const FrameEncoding encoding;
+  const uint16_t rowBytes;
+  const uint8_t planeCount;
+
+  uint8_t *black = nullptr;
+  uint8_t *red = nullptr;
+  size_t planeBytes = 0;
+  size_t remaining = 0;
+
+  // Raw and planar decoding position in band bytes.
+  size_t interleavedIndex = 0;
+
+  // RLE decoding position within the current plane row.
+  uint8_t *rowOutput = nullptr;
+  uint16_t rowRemaining = 0;
+  uint16_t row = 0;
+  bool isRedRow = false;
+  RunState runState = RunState::Header;
+  uint8_t runLength = 0;
+  bool isMalformed = false;
+};
+
+// Sequential source of an encoded frame body: a server response or a frame stored in flash.
+class FrameReader
+{
+public:
+  virtual ~FrameReader() = default;
+
+  virtual bool readBytes(uint8_t *data, size_t length) = 0;
+
+  // Feeds the decoder until its band is complete.
+  virtual bool readBand(FrameBandDecoder &decoder) = 0;
+
+  // Body bytes handed out so far.
+  virtual uint32_t getBodyOffset() const = 0;
+};
@@ -0,0 +1,347 @@
+#include "http_response.h"
+
+#include <string.h>
+#include <strings.h>
+
+static const char statusPrefix[] = "HTTP/1.";
+static const uint8_t statusPrefixLength = sizeof(statusPrefix) - 1;
+
+static int hexValue(uint8_t c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+
+  if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+  {
+    return (c | 0x20) - 'a' + 10;
+  }
+
+  return -1;
+}
+
+bool HttpResponseParser::captureHeader(HttpHeaderField &field)
+{
+  if (fieldCount == maxCapturedHeaders)
+  {
+    return false;
+  }
+
+  field.isPresent = false;
+  fields[fieldCount++] = &field;
+  return true;
+}
+
+size_t HttpResponseParser::parseHeaders(const uint8_t *data, size_t length)
+{
+  size_t index = 0;
+  while (index < length && state != State::Body && state != State::Error)
+  {
+    const uint8_t c = data[index++];
+    switch (state)
+    {
+    case State::StatusVersion:
+    { // "HTTP/1.x " followed by the status code
+      bool isExpected;
+      if (versionIndex < statusPrefixLength)
+      {
+        isExpected = c == statusPrefix[versionIndex];
+      }
+      else if (versionIndex == statusPrefixLength)
+      {
+        isExpected = c >= '0' && c <= '9';
+      }
+      else
+      {
+        isExpected = c == ' ';
+      }
+
+      if (!isExpected)
+      {
+        state = State::Error;
+        break;
+      }
+
+      if (++versionIndex > statusPrefixLength + 1)
+      {
+        state = State::StatusCode;
+      }
+      break;
+    }
+    case State::StatusCode:
+      if (c >= '0' && c <= '9' && statusCode < 100)
+      {
+        statusCode = statusCode * 10 + (c - '0');
+      }
+      else if ((c == ' ' || c == '\r' || c == '\n') && statusCode >= 100)
+      {
+        state = c == '\n' ? State::LineStart : State::StatusReason;
+      }
+      else
+      {
+        state = State::Error;
+      }
+      break;
+    case State::StatusReason:
+      if (c == '\n')
+      {
+        state = State::LineStart;
+      }
+      break;
+    case State::LineStart:
+      nameLength = 0;
+      valueLength = 0;
+      isValueTruncated = false;
+      if (c == '\r' || c == '\n')
+      { // an empty line ends the headers
+        state = c == '\r' ? State::HeadersEnd : State::Body;
+        break;
+      }
+
+      name[nameLength++] = c;
+      state = State::HeaderName;
+      break;
+    case State::HeaderName:
+      if (c == ':')
+      {
+        state = State::HeaderValue;
+      }
+      else if (c == '\n')
+      { // not a header, ignored
+        state = State::LineStart;
+      }
+      else if (nameLength < sizeof(name) - 1)
+      {
+        name[nameLength++] = c;
+      }
+      else
+      { // longer than any header of interest
+        nameLength = sizeof(name);
+      }
+      break;
+    case State::HeaderValue:
+      if (c == '\n')
+      {
+        endHeaderLine();
+        if (state != State::Error)
+        {
+          state = State::LineStart;
+        }
+      }
+      else if (c == '\r' || (valueLength == 0 && (c == ' ' || c == '\t')))
+      { // skip the line ending and leading whitespace
+      }
+      else if (valueLength < sizeof(value) - 1)
+      {
+        value[valueLength++] = c;
+      }
+      else
+      {
+        isValueTruncated = true;
+      }
+      break;
+    case State::HeadersEnd:
+      state = c == '\n' ? State::Body : State::Error;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (state == State::Body)
+  {
+    bodyRemaining = contentLength;
+  }
+
+  return index;
+}
+
+void HttpResponseParser::endHeaderLine()
+{
+  if (nameLength == sizeof(name))
+  {
+    return;
+  }
+
+  while (valueLength > 0 && (value[valueLength - 1] == ' ' || value[valueLength - 1] == '\t'))
+  {
+    --valueLength;
+  }
+
+  name[nameLength] = '\0';
+  value[valueLength] = '\0';
+
+  if (strcasecmp(name, "Content-Length") == 0)
+  {
+    uint32_t length = 0;
+    for (uint8_t i = 0; i < valueLength; ++i)
+    {
+      if (value[i] < '0' || value[i] > '9' || length > (UINT32_MAX - 9) / 10)
+      {
+        state = State::Error;
+        return;
+      }
+
+      length = length * 10 + (value[i] - '0');
+    }
+
+    hasLength = !isValueTruncated && valueLength > 0;
+    contentLength = length;
+    if (!hasLength)
+    {
+      state = State::Error;
+    }
+    return;
+  }
+
+  if (strcasecmp(name, "Transfer-Encoding") == 0)
+  { // the last coding decides the framing, e.g. "gzip, chunked"
+    isChunkedBody = valueLength >= 7 && strcasecmp(value + valueLength - 7, "chunked") == 0;
+    return;
+  }
+
+  for (uint8_t i = 0; i < fieldCount; ++i)
+  {
+    HttpHeaderField &field = *fields[i];
+    if (!isValueTruncated && valueLength < field.capacity && strcasecmp(name, field.name) == 0)
+    {
+      memcpy(field.value, value, valueLength + 1);
+      field.isPresent = true;
+    }
+  }
+}
+
+bool HttpResponseParser::isBodyless() const
+{
+  return statusCode / 100 == 1 || statusCode == 204 || statusCode == 304;
+}
+
+bool HttpResponseParser::isBodyComplete() const
+{
+  if (state != State::Body)
+  {
+    return false;
+  }
+
+  if (isBodyless())
+  {
+    return true;
+  }
+
+  // Chunked framing takes precedence over a Content-Length sent alongside it.
+  return isChunkedBody ? chunkState == ChunkState::Done
+                       : hasLength && bodyRemaining == 0;
+}
+
+size_t HttpResponseParser::decodeBody(uint8_t *data, size_t length)
+{
+  if (state != State::Body || isBodyless())
+  {
+    return 0;
+  }
+
+  if (!isChunkedBody)
+  {
+    if (!hasLength)
+    { // the body ends when the server closes the connection
+      return length;
+    }
+
+    const size_t count = length < bodyRemaining ? length : bodyRemaining;
+    bodyRemaining -= count;
+    return count;
+  }
+
+  size_t output = 0;
+  size_t index = 0;
+  while (index < length && chunkState != ChunkState::Done)
+  {
+    switch (chunkState)
+    {
+    case ChunkState::Size:
+    {
+      const uint8_t c = data[index++];
+      const int digit = hexValue(c);
+      if (digit >= 0 && chunkSizeDigits < 8)
+      {
+        chunkRemaining = chunkRemaining * 16 + digit;
+        ++chunkSizeDigits;
+      }
+      else if (chunkSizeDigits > 0 && (c == ';' || c == ' ' || c == '\t' || c == '\r'))
+      {
+        chunkState = ChunkState::Extension;
+      }
+      else if (chunkSizeDigits > 0 && c == '\n')
+      {
+        chunkState = chunkRemaining == 0 ? ChunkState::Trailer : ChunkState::Data;
+        isTrailerLineEmpty = true;
+      }
+      else
+      {
+        state = State::Error;
+        return output;
+      }
+      break;
+    }
+    case ChunkState::Extension:
+      if (data[index++] == '\n')
+      {
+        chunkState = chunkRemaining == 0 ? ChunkState::Trailer : ChunkState::Data;
+        isTrailerLineEmpty = true;
+      }
+      break;
+    case ChunkState::Data:
+    {
+      const size_t available = length - index;
+      const size_t count = available < chunkRemaining ? available : chunkRemaining;
+      if (output != index)
+      { // close the gap left by the chunk header
+        memmove(data + output, data + index, count);
+      }
+
+      output += count;
+      index += count;
+      chunkRemaining -= count;
+      if (chunkRemaining == 0)
+      {
+        chunkState = ChunkState::DataEnd;
+      }
+      break;
+    }
+    case ChunkState::DataEnd:
+    {
+      const uint8_t c = data[index++];
+      if (c == '\n')
+      {
+        chunkState = ChunkState::Size;
+        chunkSizeDigits = 0;
+      }
+      else if (c != '\r')
+      {
+        state = State::Error;
+        return output;
+      }
+      break;
+    }
+    case ChunkState::Trailer:
+    {
+      const uint8_t c = data[index++];
+      if (c == '\n')
+      {
+        chunkState = isTrailerLineEmpty ? ChunkState::Done : ChunkState::Trailer;
+        isTrailerLineEmpty = true;
+      }
+      else if (c != '\r')
+      {
+        isTrailerLineEmpty = false;
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  return output;
+}
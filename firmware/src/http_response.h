@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Response header whose value the parser copies into a caller-owned buffer.
+struct HttpHeaderField
+{
+  const char *name; // matched case-insensitively
+  char *value;
+  size_t capacity; // including the terminator; longer values are not captured
+  bool isPresent;
+};
+
+// Incremental HTTP/1.x response parser that works on caller-provided buffers without heap allocations.
+// Header bytes are consumed first; afterwards the body framing (Content-Length, chunked transfer
+// encoding or read-until-close) is removed from raw body bytes in place.
+class HttpResponseParser
+{
+public:
+  static const uint8_t maxCapturedHeaders = 12;
+
+  // Registers a header to capture. Must be called before parsing starts.
+  bool captureHeader(HttpHeaderField &field);
+
+  // Consumes header bytes up to and including the blank line and returns how many were used.
+  size_t parseHeaders(const uint8_t *data, size_t length);
+
+  // Strips chunk framing from raw body bytes in place and returns how many body bytes
+  // are now at the start of data. Bytes beyond the end of the body are dropped.
+  size_t decodeBody(uint8_t *data, size_t length);
+
+  bool isHeaderComplete() const { return state == State::Body; }
+  bool hasError() const { return state == State::Error; }
+
+  // True once the framing says the body has ended. Responses without framing end when the connection closes.
+  bool isBodyComplete() const;
+
+  int getStatusCode() const { return statusCode; }
+  bool isChunked() const { return isChunkedBody; }
+  bool hasContentLength() const { return hasLength; }
+  uint32_t getContentLength() const { return contentLength; }
+
+private:
+  enum class State
+  {
+    StatusVersion,
+    StatusCode,
+    StatusReason,
+    LineStart,
+    HeaderName,
+    HeaderValue,
+    HeadersEnd,
+    Body,
+    Error
+  };
+
+  enum class ChunkState
+  {
+    Size,
+    Extension,
+    Data,
+    DataEnd,
+    Trailer,
+    Done
+  };
+
+  void endHeaderLine();
+  bool isBodyless() const;
+
+  State state = State::StatusVersion;
+  uint8_t versionIndex = 0;
+  int statusCode = 0;
+
+  char name[24] = {};
+  uint8_t nameLength = 0;
+  char value[64] = {};
+  uint8_t valueLength = 0;
+  bool isValueTruncated = false;
+
+  HttpHeaderField *fields[maxCapturedHeaders] = {};
+  uint8_t fieldCount = 0;
+
+  bool hasLength = false;
+  uint32_t contentLength = 0;
+  uint32_t bodyRemaining = 0;
+
+  bool isChunkedBody = false;
+  ChunkState chunkState = ChunkState::Size;
+  uint32_t chunkRemaining = 0;
+  uint8_t chunkSizeDigits = 0;
+  bool isTrailerLineEmpty = true;
+};
@@ -0,0 +1,28 @@
+#include "panel_profile.h"
+
+#include "band_pipeline.h"
+
+FrameLayout getFrameLayout(const PanelGeometry &panel, const PanelMemory &memory)
+{
+  // Splitting the frame across the slots costs no more memory than one whole-frame band, and lets the
+  // display task write one band while the next one is received.
+  const uint16_t splitRows = (panel.height + BandPipeline::maxSlots - 1) / BandPipeline::maxSlots;
+  const FrameLayout externalLayout{panel, splitRows, BandPipeline::maxSlots, true};
+  if (externalLayout.getBandPlaneBytes() * panel.planeCount * BandPipeline::maxSlots <= memory.largestExternalBlock)
+  {
+    return externalLayout;
+  }
+
+  for (uint16_t bandCount = BandPipeline::maxSlots; bandCount < panel.height; ++bandCount)
+  {
+    const uint16_t rows = (panel.height + bandCount - 1) / bandCount;
+    const FrameLayout layout{panel, rows, BandPipeline::maxSlots, false};
+    if (layout.getBandPlaneBytes() <= memory.largestInternalBlock &&
+        layout.getBandPlaneBytes() * panel.planeCount * BandPipeline::maxSlots <= memory.internalBytes)
+    {
+      return layout;
+    }
+  }
+
+  return FrameLayout{panel, 1, 1, false};
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "device_interfaces.h"
+
+// Resolution and plane format of a panel: black and white panels take the black plane only.
+struct PanelGeometry
+{
+  uint16_t width;
+  uint16_t height;
+  uint8_t planeCount; // 1 for black and white panels, 2 with the red plane
+
+  constexpr uint16_t getRowBytes() const { return width / 8; }
+  constexpr size_t getFrameBytes() const { return static_cast<size_t>(height) * getRowBytes() * planeCount; }
+};
+
+// Memory the band buffers may use, measured once the network connection has taken its share.
+struct PanelMemory
+{
+  size_t internalBytes; // free internal RAM left for the band buffers
+  size_t largestInternalBlock; // each plane of a band is a single allocation
+  size_t largestExternalBlock; // PSRAM; 0 on boards without it
+};
+
+// How frames are received and written: the panel geometry the server renders for, and the bands the rows
+// are sent and written in. The server caps delta regions at the band height and stored frames keep it.
+struct FrameLayout
+{
+  PanelGeometry panel;
+  uint16_t bandRows;
+  uint8_t slotCount; // bands in flight between the network and the display task
+  bool isExternalMemory; // the buffers are in PSRAM
+
+  constexpr size_t getBandPlaneBytes() const { return static_cast<size_t>(bandRows) * panel.getRowBytes(); }
+  constexpr uint16_t getBandCount() const { return (panel.height + bandRows - 1) / bandRows; }
+};
+
+// Holds the whole frame in PSRAM when the board has enough of it, as one band per pipeline slot. Otherwise
+// splits the panel into the fewest bands of equal height whose buffers fit the internal RAM. Either way two
+// bands are in flight, so that receiving overlaps with writing. Band heights only step between such even
+// splits, so small changes of the free heap from wake to wake keep the layout, and with it the stored frames.
+FrameLayout getFrameLayout(const PanelGeometry &panel, const PanelMemory &memory);
+
+// Compile-time description of a supported panel: the GxEPD2 display class and driver it is driven with,
+// its plane format and SPI clock. Resolution comes from the driver. The display class keeps its own page
+// buffer for drawing text and graphics, which only the welcome page uses; frames are written past it in
+// bands, so the page buffer is kept small and leaves the RAM to the band buffers.
+template <template <typename, uint16_t> class DisplayClass, typename DriverClass, uint8_t PlaneCount, uint32_t SpiClockHz>
+struct PanelProfile
+{
+  static_assert(DriverClass::WIDTH % 8 == 0, "panel rows are sent as whole bytes");
+  static_assert(PlaneCount == 1 || PlaneCount == 2, "frames have a black and an optional red plane");
+
+  static constexpr size_t pageBufferBytes = 16384;
+  static constexpr PanelGeometry geometry{DriverClass::WIDTH, DriverClass::HEIGHT, PlaneCount};
+  static constexpr uint32_t spiClockHz = SpiClockHz;
+  static constexpr uint16_t pageHeight =
+      DriverClass::HEIGHT < pageBufferBytes / (geometry.getRowBytes() * PlaneCount)
+          ? DriverClass::HEIGHT
+          : pageBufferBytes / (geometry.getRowBytes() * PlaneCount);
+
+  using Driver = DriverClass;
+  using Display = DisplayClass<DriverClass, pageHeight>;
+
+  static void writeBand(Display &display, const FrameBand &band)
+  {
+    if constexpr (PlaneCount == 1)
+    {
+      display.writeImage(band.black, 0, band.y, geometry.width, band.rows);
+    }
+    else
+    {
+      display.writeImage(band.black, band.red, 0, band.y, geometry.width, band.rows);
+    }
+  }
+};
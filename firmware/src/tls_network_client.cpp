@@ -0,0 +1,224 @@
+#include "tls_network_client.h"
+
+#include <mbedtls/sha256.h>
+#include <string.h>
+
+TlsNetworkClient::~TlsNetworkClient()
+{
+  stop();
+  if (isSetUp)
+  {
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&config);
+  }
+}
+
+bool TlsNetworkClient::connect(const char *host, uint16_t port)
+{
+  stop();
+  isResumed = false;
+  if (!setUp() || !transport.connect(host, port))
+  {
+    return false;
+  }
+
+  mbedtls_ssl_session_reset(&ssl);
+  mbedtls_ssl_set_hostname(&ssl, host);
+  const uint32_t serverId = getTlsServerId(host, port, fingerprint);
+  size_t sessionLength = 0;
+  const uint8_t *sessionData = getTlsSession(sessionCache, serverId, sessionLength);
+  if (sessionData != nullptr)
+  {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_session_load(&session, sessionData, sessionLength) != 0 || mbedtls_ssl_set_session(&ssl, &session) != 0)
+    {
+      clearTlsSession(sessionCache);
+      sessionData = nullptr;
+    }
+    mbedtls_ssl_session_free(&session);
+  }
+
+  isCertificateVerified = false;
+  isPinMatched = false;
+  const uint32_t handshakeStart = clock.micros();
+  int result;
+  while ((result = mbedtls_ssl_handshake(&ssl)) == MBEDTLS_ERR_SSL_WANT_READ || result == MBEDTLS_ERR_SSL_WANT_WRITE)
+  {
+    if (!transport.connected() || clock.micros() - handshakeStart > TLS_HANDSHAKE_TIMEOUT * 1000UL)
+    {
+      break;
+    }
+    clock.yield();
+  }
+
+  // The certificate is only verified in a full handshake; a resumed session was pinned when it was negotiated.
+  const bool isSessionReused = sessionData != nullptr && !isCertificateVerified;
+  if (result != 0 || (!isSessionReused && !isPinMatched))
+  {
+    if (result != 0)
+    {
+      deviceLog("TLS handshake failed (-0x%04x).\n", static_cast<unsigned>(-result));
+    }
+    else
+    {
+      deviceLog("Server certificate does not match the pinned fingerprint.\n");
+    }
+    clearTlsSession(sessionCache);
+    transport.stop();
+    return false;
+  }
+  recordTlsHandshake(sessionCache, isSessionReused, (clock.micros() - handshakeStart) / 1000);
+  storeSession(serverId);
+
+  isResumed = isSessionReused;
+  isConnected = true;
+  isPeerClosed = false;
+  return true;
+}
+
+size_t TlsNetworkClient::write(const uint8_t *data, size_t length)
+{
+  size_t written = 0;
+  while (written < length && isConnected)
+  {
+    const int result = mbedtls_ssl_write(&ssl, data + written, length - written);
+    if (result > 0)
+    {
+      written += result;
+    }
+    else if (result != MBEDTLS_ERR_SSL_WANT_WRITE && result != MBEDTLS_ERR_SSL_WANT_READ)
+    {
+      break;
+    }
+    else if (!transport.connected())
+    {
+      break;
+    }
+  }
+
+  return written;
+}
+
+int TlsNetworkClient::available()
+{
+  if (isConnected && mbedtls_ssl_get_bytes_avail(&ssl) == 0 && transport.available() > 0)
+  { // decrypts the next record without taking any of it
+    handleReadResult(mbedtls_ssl_read(&ssl, nullptr, 0));
+  }
+
+  return isConnected ? mbedtls_ssl_get_bytes_avail(&ssl) : 0;
+}
+
+int TlsNetworkClient::read(uint8_t *data, size_t length)
+{
+  if (!isConnected)
+  {
+    return 0;
+  }
+
+  const int result = mbedtls_ssl_read(&ssl, data, length);
+  handleReadResult(result);
+  return result > 0 ? result : 0;
+}
+
+bool TlsNetworkClient::connected()
+{
+  return isConnected && (mbedtls_ssl_get_bytes_avail(&ssl) > 0 || (!isPeerClosed && transport.connected()));
+}
+
+void TlsNetworkClient::stop()
+{
+  if (isConnected)
+  {
+    mbedtls_ssl_close_notify(&ssl);
+    isConnected = false;
+  }
+  transport.stop();
+}
+
+bool TlsNetworkClient::setUp()
+{
+  if (isSetUp)
+  {
+    return true;
+  }
+
+  mbedtls_ssl_init(&ssl);
+  mbedtls_ssl_config_init(&config);
+  isSetUp = true;
+  if (mbedtls_ssl_config_defaults(&config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT) != 0)
+  {
+    return false;
+  }
+
+  // Chain errors are cleared by the verify callback, which checks the pin instead.
+  mbedtls_ssl_conf_authmode(&config, MBEDTLS_SSL_VERIFY_OPTIONAL);
+  mbedtls_ssl_conf_verify(&config, verifyCertificate, this);
+  mbedtls_ssl_conf_rng(&config, random, nullptr);
+  mbedtls_ssl_conf_session_tickets(&config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+  if (mbedtls_ssl_setup(&ssl, &config) != 0)
+  {
+    return false;
+  }
+
+  mbedtls_ssl_set_bio(&ssl, this, sendToTransport, receiveFromTransport, nullptr);
+  return true;
+}
+
+// Keeps the session, or the ticket the server may have renewed, for the next wake.
+void TlsNetworkClient::storeSession(uint32_t serverId)
+{
+  static uint8_t sessionData[TLS_SESSION_MAX_LENGTH];
+  size_t sessionLength = 0;
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  if (mbedtls_ssl_get_session(&ssl, &session) != 0 ||
+      mbedtls_ssl_session_save(&session, sessionData, sizeof(sessionData), &sessionLength) != 0 ||
+      !storeTlsSession(sessionCache, serverId, sessionData, sessionLength))
+  {
+    deviceLog("TLS session cannot be kept for the next wake.\n");
+    clearTlsSession(sessionCache);
+  }
+  mbedtls_ssl_session_free(&session);
+}
+
+void TlsNetworkClient::handleReadResult(int result)
+{
+  if (result == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || result == 0)
+  {
+    isPeerClosed = true;
+  }
+}
+
+int TlsNetworkClient::sendToTransport(void *context, const unsigned char *data, size_t length)
+{
+  const size_t written = static_cast<TlsNetworkClient *>(context)->transport.write(data, length);
+  return written > 0 ? static_cast<int>(written) : MBEDTLS_ERR_SSL_WANT_WRITE;
+}
+
+int TlsNetworkClient::receiveFromTransport(void *context, unsigned char *data, size_t length)
+{
+  NetworkClient &transport = static_cast<TlsNetworkClient *>(context)->transport;
+  if (transport.available() <= 0)
+  { // 0 tells the TLS layer that the connection has ended
+    return transport.connected() ? MBEDTLS_ERR_SSL_WANT_READ : 0;
+  }
+
+  return transport.read(data, length);
+}
+
+int TlsNetworkClient::verifyCertificate(void *context, mbedtls_x509_crt *certificate, int depth, uint32_t *flags)
+{
+  auto *client = static_cast<TlsNetworkClient *>(context);
+  client->isCertificateVerified = true;
+  if (depth == 0)
+  {
+    uint8_t digest[TLS_FINGERPRINT_LENGTH];
+    mbedtls_sha256_ret(certificate->raw.p, certificate->raw.len, digest, 0);
+    client->isPinMatched = memcmp(digest, client->fingerprint, sizeof(digest)) == 0;
+  }
+
+  *flags = 0;
+  return 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mbedtls/ssl.h>
+#include "device_interfaces.h"
+#include "tls_session.h"
+
+#define TLS_HANDSHAKE_TIMEOUT 10000
+
+// Speaks TLS over a plain network client. The session is kept in a TlsSessionCache, which the device holds in
+// RTC memory, so most wakes resume it with an abbreviated handshake. Instead of a CA chain, the server
+// certificate is pinned by its SHA-256 fingerprint, which also covers self-signed certificates. The TLS context
+// is only set up on the first connect.
+// Built with the mbedtls of the ESP-IDF on the device and against the system mbedtls 2.28 on the host.
+class TlsNetworkClient : public NetworkClient
+{
+public:
+  // Fills data with random bytes and returns 0, as mbedtls expects of its random number generator.
+  using RandomSource = int (*)(void *context, unsigned char *data, size_t length);
+
+  TlsNetworkClient(NetworkClient &transport, Clock &clock, TlsSessionCache &sessionCache, const uint8_t *fingerprint,
+                   RandomSource random)
+      : transport(transport), clock(clock), sessionCache(sessionCache), fingerprint(fingerprint), random(random) {}
+
+  ~TlsNetworkClient() override;
+
+  bool connect(const char *host, uint16_t port) override;
+  size_t write(const uint8_t *data, size_t length) override;
+  int available() override;
+  int read(uint8_t *data, size_t length) override;
+  bool connected() override;
+  void stop() override;
+
+  // True if the last connect resumed the cached session instead of verifying the certificate again.
+  bool isSessionResumed() const { return isResumed; }
+
+private:
+  bool setUp();
+  void storeSession(uint32_t serverId);
+  void handleReadResult(int result);
+
+  static int sendToTransport(void *context, const unsigned char *data, size_t length);
+  static int receiveFromTransport(void *context, unsigned char *data, size_t length);
+  static int verifyCertificate(void *context, mbedtls_x509_crt *certificate, int depth, uint32_t *flags);
+
+  NetworkClient &transport;
+  Clock &clock;
+  TlsSessionCache &sessionCache;
+  const uint8_t *fingerprint;
+  RandomSource random;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config config;
+  bool isSetUp = false;
+  bool isConnected = false;
+  bool isPeerClosed = false;
+  bool isCertificateVerified = false;
+  bool isPinMatched = false;
+  bool isResumed = false;
+};
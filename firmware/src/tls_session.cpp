@@ -0,0 +1,111 @@
+#include "tls_session.h"
+
+#include <string.h>
+#include "crc32.h"
+#include "device_interfaces.h"
+
+static const uint32_t cacheMarker = 0x544C5331;
+
+void beginTlsSessionCache(TlsSessionCache &cache)
+{
+  if (cache.marker == cacheMarker && cache.length <= TLS_SESSION_MAX_LENGTH)
+  {
+    return;
+  }
+
+  memset(&cache, 0, sizeof(cache));
+  cache.marker = cacheMarker;
+}
+
+uint32_t getTlsServerId(const char *host, uint16_t port, const uint8_t *fingerprint)
+{
+  uint32_t id = updateCrc32(0, reinterpret_cast<const uint8_t *>(host), strlen(host));
+  const uint8_t portBytes[] = {static_cast<uint8_t>(port >> 8), static_cast<uint8_t>(port)};
+  id = updateCrc32(id, portBytes, sizeof(portBytes));
+  return updateCrc32(id, fingerprint, TLS_FINGERPRINT_LENGTH);
+}
+
+const uint8_t *getTlsSession(const TlsSessionCache &cache, uint32_t serverId, size_t &length)
+{
+  if (cache.length == 0 || cache.serverId != serverId)
+  {
+    return nullptr;
+  }
+
+  length = cache.length;
+  return cache.data;
+}
+
+bool storeTlsSession(TlsSessionCache &cache, uint32_t serverId, const uint8_t *data, size_t length)
+{
+  if (length == 0 || length > TLS_SESSION_MAX_LENGTH)
+  {
+    clearTlsSession(cache);
+    return false;
+  }
+
+  memcpy(cache.data, data, length);
+  cache.length = length;
+  cache.serverId = serverId;
+  return true;
+}
+
+void clearTlsSession(TlsSessionCache &cache)
+{
+  cache.length = 0;
+  cache.serverId = 0;
+}
+
+void recordTlsHandshake(TlsSessionCache &cache, bool isResumed, uint32_t millis)
+{
+  if (isResumed)
+  {
+    cache.resumedHandshakeMillis = millis;
+    deviceLog("TLS session resumed in %lu ms (last full handshake %lu ms).\n",
+              static_cast<unsigned long>(millis), static_cast<unsigned long>(cache.fullHandshakeMillis));
+  }
+  else
+  {
+    cache.fullHandshakeMillis = millis;
+    deviceLog("Full TLS handshake in %lu ms (last resumed handshake %lu ms).\n",
+              static_cast<unsigned long>(millis), static_cast<unsigned long>(cache.resumedHandshakeMillis));
+  }
+}
+
+static int getHexValue(char c)
+{
+  return c >= '0' && c <= '9'   ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                : -1;
+}
+
+bool parseCertificateFingerprint(const char *text, uint8_t *fingerprint)
+{
+  size_t digits = 0;
+  for (const char *c = text; *c != '\0'; ++c)
+  {
+    if (*c == ':' || *c == ' ')
+    {
+      continue;
+    }
+
+    const int value = getHexValue(*c);
+    if (value < 0 || digits == TLS_FINGERPRINT_LENGTH * 2)
+    {
+      return false;
+    }
+
+    if (digits % 2 == 0)
+    {
+      fingerprint[digits / 2] = value << 4;
+    }
+    else
+    {
+      fingerprint[digits / 2] |= value;
+    }
+    ++digits;
+  }
+
+  return digits == TLS_FINGERPRINT_LENGTH * 2;
+}
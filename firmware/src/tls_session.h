@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TLS_SESSION_MAX_LENGTH 2048
+#define TLS_FINGERPRINT_LENGTH 32
+
+// TLS session of the last connection to the dashboard server. The device keeps it in RTC memory so that
+// the next wake resumes it with an abbreviated handshake instead of a full one with its public key operations.
+// It also keeps the last duration of both kinds of handshake, which the log compares.
+struct TlsSessionCache
+{
+  uint32_t marker; // tells a cache kept in RTC memory from garbage after a power loss
+  uint32_t serverId; // the session is only offered to the server it was negotiated with
+  uint16_t length; // 0 without a session
+  uint8_t data[TLS_SESSION_MAX_LENGTH]; // serialized by the TLS library
+  uint32_t fullHandshakeMillis;
+  uint32_t resumedHandshakeMillis;
+};
+
+void beginTlsSessionCache(TlsSessionCache &cache);
+
+// Identifies a server by host, port and pinned certificate, so that changing any of them drops the session.
+uint32_t getTlsServerId(const char *host, uint16_t port, const uint8_t *fingerprint);
+
+// Returns the stored session for the server, or nullptr.
+const uint8_t *getTlsSession(const TlsSessionCache &cache, uint32_t serverId, size_t &length);
+
+// Returns false if the session does not fit, which leaves the cache without one.
+bool storeTlsSession(TlsSessionCache &cache, uint32_t serverId, const uint8_t *data, size_t length);
+
+void clearTlsSession(TlsSessionCache &cache);
+
+// Records the duration of a handshake and logs it next to the last one of the other kind.
+void recordTlsHandshake(TlsSessionCache &cache, bool isResumed, uint32_t millis);
+
+// Parses a SHA-256 certificate fingerprint written as 64 hex digits, optionally separated by colons or spaces.
+bool parseCertificateFingerprint(const char *text, uint8_t *fingerprint);
@@ -0,0 +1,141 @@
+#include "update_schedule.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "device_interfaces.h"
+
+static const uint32_t scheduleMarker = 0x55534331;
+static const int64_t secondsPerDay = 86400;
+
+// Syncs closer together than this cannot measure the clock rate precisely with whole server seconds.
+static const uint64_t minRateIntervalMillis = 30 * 60 * 1000;
+// Clock rates outside this range come from a server clock that was set, not from drift.
+static const float minClockRate = 0.9f;
+static const float maxClockRate = 1.1f;
+// Local server times that moved by about this much between syncs went through a daylight saving time change.
+static const double timeChangeSeconds = 3600;
+static const double timeChangeToleranceSeconds = 60;
+
+static double estimateServerSeconds(const UpdateSchedule &schedule, uint32_t syncSecondsOfDay, uint64_t deviceMillis)
+{
+  const double elapsedSeconds = (deviceMillis - schedule.syncDeviceMillis) / 1000.0;
+  return syncSecondsOfDay + elapsedSeconds * schedule.clockRate;
+}
+
+void beginUpdateSchedule(UpdateSchedule &schedule)
+{
+  if (schedule.marker == scheduleMarker)
+  {
+    return;
+  }
+
+  memset(&schedule, 0, sizeof(schedule));
+  schedule.marker = scheduleMarker;
+  schedule.clockRate = 1.0f;
+}
+
+void syncUpdateScheduleTime(UpdateSchedule &schedule, uint32_t serverSecondsOfDay,
+                            std::optional<uint32_t> serverUtcSecondsOfDay, uint64_t deviceMillis)
+{
+  if (schedule.isSynced && deviceMillis >= schedule.syncDeviceMillis)
+  {
+    const uint64_t elapsedMillis = deviceMillis - schedule.syncDeviceMillis;
+    if (elapsedMillis < minRateIntervalMillis)
+    { // the older sync stays the reference until the interval is long enough to measure
+      return;
+    }
+
+    const bool isUtc = schedule.hasSyncUtc && serverUtcSecondsOfDay.has_value();
+    const uint32_t syncSecondsOfDay = isUtc ? schedule.syncUtcSecondsOfDay : schedule.syncSecondsOfDay;
+    const uint32_t secondsOfDay = isUtc ? *serverUtcSecondsOfDay : serverSecondsOfDay;
+
+    // Server times of day repeat daily, so the one nearest to the estimate is taken as the real server time.
+    const double estimatedSeconds = estimateServerSeconds(schedule, syncSecondsOfDay, deviceMillis);
+    const double serverSeconds = secondsOfDay + secondsPerDay * round((estimatedSeconds - secondsOfDay) / secondsPerDay);
+    const float measuredRate = static_cast<float>((serverSeconds - syncSecondsOfDay) / (elapsedMillis / 1000.0));
+    // Over a day an hour is only a rate of 1.04, so a local time change is recognized by the offset itself.
+    const bool isTimeChange = !isUtc && fabs(fabs(estimatedSeconds - serverSeconds) - timeChangeSeconds) <= timeChangeToleranceSeconds;
+    if (isTimeChange)
+    {
+      deviceLog("Server time moved by an hour since the last sync, keeping the clock rate.\n");
+    }
+    else if (measuredRate >= minClockRate && measuredRate <= maxClockRate)
+    {
+      // Later measurements are averaged with the earlier ones to smooth out the whole-second resolution.
+      schedule.clockRate = schedule.isClockRateMeasured ? (schedule.clockRate + measuredRate) / 2 : measuredRate;
+      schedule.isClockRateMeasured = true;
+      deviceLog("Device clock off by %d s since the last sync, rate %.5f.\n",
+                static_cast<int>(estimatedSeconds - serverSeconds), schedule.clockRate);
+    }
+  }
+
+  schedule.isSynced = true;
+  schedule.syncSecondsOfDay = serverSecondsOfDay;
+  schedule.hasSyncUtc = serverUtcSecondsOfDay.has_value();
+  schedule.syncUtcSecondsOfDay = serverUtcSecondsOfDay.value_or(0);
+  schedule.syncDeviceMillis = deviceMillis;
+}
+
+bool setUpdateTimes(UpdateSchedule &schedule, const char *text)
+{
+  schedule.id[0] = '\0';
+  schedule.count = 0;
+
+  const char *separator = strchr(text, ';');
+  if (separator == nullptr || separator == text || separator - text > UPDATE_SCHEDULE_ID_MAX_LENGTH)
+  {
+    return false;
+  }
+
+  const char *position = separator + 1;
+  uint8_t count = 0;
+  while (*position != '\0')
+  {
+    char *end;
+    const unsigned long seconds = strtoul(position, &end, 10);
+    if (end == position || seconds >= secondsPerDay || count == UpdateSchedule::capacity ||
+        (count > 0 && seconds <= schedule.times[count - 1]))
+    {
+      return false;
+    }
+
+    if (*end != ',' && *end != '\0')
+    {
+      return false;
+    }
+
+    schedule.times[count++] = seconds;
+    position = *end == ',' ? end + 1 : end;
+  }
+
+  memcpy(schedule.id, text, separator - text);
+  schedule.id[separator - text] = '\0';
+  schedule.count = count;
+  return true;
+}
+
+std::optional<uint64_t> getScheduledWaitSeconds(const UpdateSchedule &schedule, uint64_t deviceMillis)
+{
+  if (!schedule.isSynced || schedule.count == 0 || deviceMillis < schedule.syncDeviceMillis)
+  {
+    return std::nullopt;
+  }
+
+  const uint32_t secondsOfDay = static_cast<uint64_t>(estimateServerSeconds(schedule, schedule.syncSecondsOfDay, deviceMillis)) % secondsPerDay;
+  for (uint8_t i = 0; i < schedule.count; ++i)
+  {
+    if (schedule.times[i] > secondsOfDay)
+    {
+      return schedule.times[i] - secondsOfDay;
+    }
+  }
+
+  return schedule.times[0] + secondsPerDay - secondsOfDay;
+}
+
+uint64_t getDeviceSleepMicros(const UpdateSchedule &schedule, uint64_t serverSeconds)
+{
+  const float clockRate = schedule.marker == scheduleMarker && schedule.clockRate > 0 ? schedule.clockRate : 1.0f;
+  return static_cast<uint64_t>(ceil(serverSeconds * 1000000.0 / clockRate));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+
+#define UPDATE_SCHEDULE_ID_MAX_LENGTH 16
+
+// Daily update times of the dashboard and the server time of day at the last sync. The device keeps it in
+// RTC memory so that it can plan its sleep when the server cannot be reached, and measures how fast its own
+// clock runs against the server time between syncs to correct the sleep duration. The update times are in
+// server local time; the clock rate is measured against UTC, which daylight saving time does not move.
+struct UpdateSchedule
+{
+  static const uint8_t capacity = 64;
+
+  uint32_t marker; // tells a schedule kept in RTC memory from garbage after a power loss
+  char id[UPDATE_SCHEDULE_ID_MAX_LENGTH + 1]; // changes on the server whenever the update times do; empty if unknown
+  uint8_t count;
+  uint32_t times[capacity]; // seconds after midnight in server local time, ascending
+  bool isSynced;
+  uint32_t syncSecondsOfDay; // server local time of day at the last sync
+  bool hasSyncUtc;
+  uint32_t syncUtcSecondsOfDay; // server UTC time of day at the last sync, if the server sent it
+  uint64_t syncDeviceMillis; // device clock at the last sync
+  float clockRate; // server seconds per device second
+  bool isClockRateMeasured;
+};
+
+void beginUpdateSchedule(UpdateSchedule &schedule);
+
+// Records the server time of day received at the given device time. Refines the clock rate from the previous
+// sync if enough time has passed since then. Without the UTC time of day of both syncs, the local times are
+// compared and an offset of about an hour is taken as a daylight saving time change.
+void syncUpdateScheduleTime(UpdateSchedule &schedule, uint32_t serverSecondsOfDay,
+                            std::optional<uint32_t> serverUtcSecondsOfDay, uint64_t deviceMillis);
+
+// Stores the update times from "<id>;<seconds after midnight>,..." as sent by the server.
+// Returns false and forgets the times if the text is malformed or holds more times than fit.
+bool setUpdateTimes(UpdateSchedule &schedule, const char *text);
+
+// Server seconds until the next update time, estimated from the last sync. Empty without a sync or update times.
+std::optional<uint64_t> getScheduledWaitSeconds(const UpdateSchedule &schedule, uint64_t deviceMillis);
+
+// Microseconds the device clock needs to measure the given number of server seconds.
+uint64_t getDeviceSleepMicros(const UpdateSchedule &schedule, uint64_t serverSeconds);
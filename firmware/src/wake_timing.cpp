@@ -0,0 +1,96 @@
+#include "wake_timing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t phaseCount = static_cast<uint8_t>(WakePhase::Count);
+
+void beginWakeCycle(WakeTimings &timings)
+{
+  memset(&timings.current, 0, sizeof(timings.current));
+  if (timings.pendingCount > WakeTimings::capacity || timings.pendingNext >= WakeTimings::capacity)
+  { // RTC memory holds garbage after a power loss
+    clearPendingWakeTimings(timings);
+    timings.panelInitMillis = 0;
+  }
+}
+
+void markWakePhase(WakeTimings &timings, WakePhase phase, uint32_t millis)
+{
+  uint32_t &phaseEnd = timings.current.phaseEndMillis[static_cast<uint8_t>(phase)];
+  if (phaseEnd == 0)
+  { // 0 means "not reached", so a phase ending in the first millisecond is reported as 1
+    phaseEnd = millis > 0 ? millis : 1;
+  }
+}
+
+void setWakeBandTiming(WakeTimings &timings, uint16_t bandCount, uint32_t bandWriteMillis)
+{
+  timings.current.bandCount = bandCount;
+  timings.current.bandWriteMillis = bandWriteMillis < UINT16_MAX ? bandWriteMillis : UINT16_MAX;
+}
+
+void setWakePanelTiming(WakeTimings &timings, uint32_t panelInitMillis, uint32_t panelOnMillis)
+{
+  timings.current.panelOnMillis = panelOnMillis < UINT16_MAX ? panelOnMillis : UINT16_MAX;
+  if (panelOnMillis > 0)
+  {
+    timings.panelInitMillis = panelInitMillis < UINT16_MAX ? panelInitMillis : UINT16_MAX;
+  }
+}
+
+void endWakeCycle(WakeTimings &timings)
+{
+  timings.pending[timings.pendingNext] = timings.current;
+  timings.pendingNext = (timings.pendingNext + 1) % WakeTimings::capacity;
+  if (timings.pendingCount < WakeTimings::capacity)
+  {
+    ++timings.pendingCount;
+  }
+}
+
+size_t formatPendingWakeTimings(const WakeTimings &timings, char *buffer, size_t capacity)
+{
+  if (capacity == 0)
+  {
+    return 0;
+  }
+
+  size_t length = 0;
+  buffer[0] = '\0';
+  const uint8_t first = (timings.pendingNext + WakeTimings::capacity - timings.pendingCount) % WakeTimings::capacity;
+  for (uint8_t i = 0; i < timings.pendingCount; ++i)
+  {
+    const WakeCycleTiming &cycle = timings.pending[(first + i) % WakeTimings::capacity];
+    char entry[128];
+    size_t entryLength = 0;
+    for (uint8_t phase = 0; phase < phaseCount; ++phase)
+    {
+      entryLength += snprintf(entry + entryLength, sizeof(entry) - entryLength, "%lu,",
+                              static_cast<unsigned long>(cycle.phaseEndMillis[phase]));
+    }
+    entryLength += snprintf(entry + entryLength, sizeof(entry) - entryLength, "%u,%u,%u",
+                            cycle.bandCount, cycle.bandWriteMillis, cycle.panelOnMillis);
+
+    const size_t separatorLength = length > 0 ? 1 : 0;
+    if (length + separatorLength + entryLength >= capacity)
+    {
+      break;
+    }
+
+    if (separatorLength > 0)
+    {
+      buffer[length++] = ';';
+    }
+    memcpy(buffer + length, entry, entryLength + 1);
+    length += entryLength;
+  }
+
+  return length;
+}
+
+void clearPendingWakeTimings(WakeTimings &timings)
+{
+  timings.pendingCount = 0;
+  timings.pendingNext = 0;
+}
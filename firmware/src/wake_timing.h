@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Phases of a wake cycle, in the order the server expects them in a report.
+enum class WakePhase : uint8_t
+{
+  DisplayInit,
+  WiFiConnect,
+  TcpConnect,
+  HeadersReceived,
+  FirstBodyByte,
+  BandsWritten,
+  Refresh,
+  SleepEntry,
+  Count
+};
+
+// Milliseconds since boot at which each phase ended; 0 for phases the cycle did not reach.
+// The panel is only initialized once a new frame is drawn, so DisplayInit can end after the network phases.
+struct WakeCycleTiming
+{
+  uint32_t phaseEndMillis[static_cast<uint8_t>(WakePhase::Count)];
+  uint16_t bandCount;
+  uint16_t bandWriteMillis;
+  uint16_t panelOnMillis; // from the start of the panel init until it was powered off; 0 if it stayed off
+};
+
+// Timings of the running cycle plus a ring of finished cycles that have not been reported yet.
+// The device keeps it in RTC memory, so cycles that fail to reach the server are sent on a later wake.
+struct WakeTimings
+{
+  static const uint8_t capacity = 8;
+
+  WakeCycleTiming current;
+  WakeCycleTiming pending[capacity];
+  uint8_t pendingCount;
+  uint8_t pendingNext;
+  uint16_t panelInitMillis; // the last measured panel init, which a wake without a new frame saves
+};
+
+void beginWakeCycle(WakeTimings &timings);
+
+// Records the end of a phase. Only the first mark of a phase in a cycle counts.
+void markWakePhase(WakeTimings &timings, WakePhase phase, uint32_t millis);
+
+void setWakeBandTiming(WakeTimings &timings, uint16_t bandCount, uint32_t bandWriteMillis);
+
+// Records how long the panel was initializing and powered in the running cycle.
+void setWakePanelTiming(WakeTimings &timings, uint32_t panelInitMillis, uint32_t panelOnMillis);
+
+// Moves the running cycle into the ring, replacing the oldest entry when it is full.
+void endWakeCycle(WakeTimings &timings);
+
+// Writes the pending cycles, oldest first, as "phase,...,bandCount,bandWriteMillis,panelOnMillis;..." and returns
+// the length, or 0 if there is nothing to report. Cycles that do not fit the buffer are left out.
+size_t formatPendingWakeTimings(const WakeTimings &timings, char *buffer, size_t capacity);
+
+void clearPendingWakeTimings(WakeTimings &timings);
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <openssl/sha.h>
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include "firmware_patch.h"
+
+// The running image and the inactive slot in memory. Like an OTA partition, the running slot is larger than the
+// image, and reads past the image return erased flash.
+class MemoryFirmwareUpdater : public FirmwareUpdater
+{
+public:
+  static const size_t partitionBytes = 64 * 1024;
+
+  explicit MemoryFirmwareUpdater(const std::string &running) : running(running) {}
+
+  bool readRunning(uint32_t offset, uint8_t *data, size_t length) override
+  {
+    if (offset > partitionBytes || length > partitionBytes - offset)
+    {
+      return false;
+    }
+
+    const size_t imageBytes = offset < running.size() ? std::min(length, running.size() - offset) : 0;
+    memcpy(data, running.data() + offset, imageBytes);
+    memset(data + imageBytes, 0xFF, length - imageBytes);
+    return true;
+  }
+
+  bool isRunning(uint32_t size, const uint8_t *sha256) override
+  {
+    return size == running.size() && memcmp(getSha256(running).data(), sha256, FIRMWARE_SHA256_LENGTH) == 0;
+  }
+
+  bool begin(uint32_t) override
+  {
+    isBegun = true;
+    slot.clear();
+    return true;
+  }
+
+  bool write(const uint8_t *data, size_t length) override
+  {
+    slot.append(reinterpret_cast<const char *>(data), length);
+    return true;
+  }
+
+  bool finish(const uint8_t *sha256) override
+  {
+    isBootSlotSet = memcmp(getSha256(slot).data(), sha256, FIRMWARE_SHA256_LENGTH) == 0;
+    return isBootSlotSet;
+  }
+
+  void abort() override { slot.clear(); }
+
+  static std::string getSha256(const std::string &data)
+  {
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const uint8_t *>(data.data()), data.size(), digest);
+    return std::string(reinterpret_cast<const char *>(digest), sizeof(digest));
+  }
+
+  std::string running;
+  std::string slot;
+  bool isBegun = false;
+  bool isBootSlotSet = false;
+};
+
+// Writes a firmware delta in the format FirmwarePatcher reads, see firmware_patch.h.
+class FirmwareDeltaBuilder
+{
+public:
+  FirmwareDeltaBuilder(const std::string &source, const std::string &target)
+      : FirmwareDeltaBuilder(source.size(), MemoryFirmwareUpdater::getSha256(source), target) {}
+
+  FirmwareDeltaBuilder(uint32_t sourceSize, const std::string &sourceSha256, const std::string &target)
+  {
+    delta = "IZD1";
+    appendUint32(sourceSize);
+    delta += sourceSha256;
+    appendUint32(target.size());
+    delta += MemoryFirmwareUpdater::getSha256(target);
+  }
+
+  FirmwareDeltaBuilder &copy(uint64_t length) { return op(0, length); }
+  FirmwareDeltaBuilder &insert(const std::string &bytes) { return op(1, bytes.size()).raw(bytes); }
+  FirmwareDeltaBuilder &replace(const std::string &bytes) { return op(2, bytes.size()).raw(bytes); }
+  FirmwareDeltaBuilder &seek(int64_t offset) // zigzag-coded
+  {
+    return op(3, static_cast<uint64_t>(offset) << 1 ^ static_cast<uint64_t>(offset >> 63));
+  }
+
+  FirmwareDeltaBuilder &op(uint8_t code, uint64_t operand)
+  {
+    delta += static_cast<char>(code);
+    do
+    { // unsigned LEB128
+      const uint8_t byte = operand & 0x7F;
+      operand >>= 7;
+      delta += static_cast<char>(operand != 0 ? byte | 0x80 : byte);
+    } while (operand != 0);
+    return *this;
+  }
+
+  FirmwareDeltaBuilder &raw(const std::string &bytes)
+  {
+    delta += bytes;
+    return *this;
+  }
+
+  const std::string &build() const { return delta; }
+
+private:
+  void appendUint32(uint32_t value)
+  {
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+      delta += static_cast<char>(value >> shift);
+    }
+  }
+
+  std::string delta;
+};
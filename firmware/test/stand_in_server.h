@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Local TCP server standing in for the dashboard server in host tests. It listens on a free loopback port
+// and hands every accepted connection to the handler on its own thread, one connection at a time.
+class StandInServer
+{
+public:
+  using ConnectionHandler = std::function<void(int socket)>;
+
+  explicit StandInServer(ConnectionHandler handler) : handler(std::move(handler))
+  {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLength = sizeof(address);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, 4) != 0 || getsockname(listener, reinterpret_cast<sockaddr *>(&address), &addressLength) != 0)
+    {
+      return;
+    }
+
+    port = ntohs(address.sin_port);
+    thread = std::thread([this] { run(); });
+  }
+
+  ~StandInServer()
+  {
+    isStopping = true;
+    if (thread.joinable())
+    {
+      thread.join();
+    }
+    if (listener >= 0)
+    {
+      close(listener);
+    }
+  }
+
+  // 0 if the server could not listen.
+  uint16_t getPort() const { return port; }
+  size_t getConnectionCount() const { return connectionCount; }
+
+private:
+  void run()
+  {
+    while (!isStopping)
+    {
+      pollfd descriptor{listener, POLLIN, 0};
+      if (poll(&descriptor, 1, 20) <= 0)
+      {
+        continue;
+      }
+
+      const int connection = accept(listener, nullptr, nullptr);
+      if (connection < 0)
+      {
+        continue;
+      }
+
+      ++connectionCount;
+      handler(connection);
+      close(connection);
+    }
+  }
+
+  ConnectionHandler handler;
+  int listener = -1;
+  uint16_t port = 0;
+  std::atomic<bool> isStopping{false};
+  std::atomic<size_t> connectionCount{0};
+  std::thread thread;
+};
+
+// Reads a request up to the blank line after its headers; the device only sends GET requests.
+inline std::string receiveRequestHead(int socket)
+{
+  std::string request;
+  char data[512];
+  while (request.find("\r\n\r\n") == std::string::npos)
+  {
+    const ssize_t count = recv(socket, data, sizeof(data), 0);
+    if (count <= 0)
+    {
+      break;
+    }
+    request.append(data, count);
+  }
+
+  return request;
+}
+
+inline void sendAll(int socket, const std::string &data)
+{
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+    const ssize_t count = send(socket, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (count <= 0)
+    {
+      return;
+    }
+    sent += count;
+  }
+}
+
+// Answers every request with the response the handler builds for it and keeps the requests for the test.
+class StandInHttpServer
+{
+public:
+  using Responder = std::function<std::string(const std::string &request)>;
+
+  explicit StandInHttpServer(Responder responder)
+      : responder(std::move(responder)), server([this](int socket) { serve(socket); }) {}
+
+  uint16_t getPort() const { return server.getPort(); }
+
+  std::vector<std::string> getRequests()
+  {
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    return requests;
+  }
+
+private:
+  void serve(int socket)
+  {
+    const std::string request = receiveRequestHead(socket);
+    {
+      std::lock_guard<std::mutex> lock(requestsMutex);
+      requests.push_back(request);
+    }
+    sendAll(socket, responder(request));
+    shutdown(socket, SHUT_WR);
+  }
+
+  Responder responder;
+  std::mutex requestsMutex;
+  std::vector<std::string> requests;
+  StandInServer server; // last, so that it stops before the members it uses are destroyed
+};
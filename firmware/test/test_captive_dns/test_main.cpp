@@ -0,0 +1,221 @@
+// Answers of the captive portal DNS responder to queries from clients of the setup access point, which can send
+// anything. Queries are kept in vectors of their exact size, so that the address sanitizer catches any read past them.
+
+#include <random>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "captive_dns.h"
+
+void deviceLog(const char *, ...) {}
+
+static const uint8_t address[4] = {192, 168, 4, 1};
+static const uint16_t typeA = 1;
+static const uint16_t typeAaaa = 28;
+static const uint16_t typeOpt = 41;
+static const uint16_t typeAny = 255;
+
+static void appendUint16(std::vector<uint8_t> &data, uint16_t value)
+{
+  data.push_back(static_cast<uint8_t>(value >> 8));
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+// A standard query with recursion desired for name, a dotted name, and an EDNS OPT record if asked for.
+static std::vector<uint8_t> buildQuery(const std::string &name, uint16_t type, bool hasEdns = false)
+{
+  std::vector<uint8_t> query{0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, hasEdns ? uint8_t{1} : uint8_t{0}};
+  size_t start = 0;
+  while (start < name.size())
+  {
+    const size_t end = std::min(name.find('.', start), name.size());
+    query.push_back(static_cast<uint8_t>(end - start));
+    query.insert(query.end(), name.begin() + start, name.begin() + end);
+    start = end + 1;
+  }
+  query.push_back(0);
+  appendUint16(query, type);
+  appendUint16(query, 1); // IN
+
+  if (hasEdns)
+  {
+    query.push_back(0); // root
+    appendUint16(query, typeOpt);
+    appendUint16(query, 1232); // UDP payload size
+    query.insert(query.end(), {0, 0, 0, 0}); // extended flags
+    appendUint16(query, 0); // no options
+  }
+
+  return query;
+}
+
+static std::vector<uint8_t> respond(const std::vector<uint8_t> &query, size_t capacity = CAPTIVE_DNS_MAX_MESSAGE_LENGTH)
+{
+  std::vector<uint8_t> response(capacity);
+  response.resize(writeCaptiveDnsResponse(query.data(), query.size(), address, response.data(), capacity));
+  return response;
+}
+
+static uint16_t readUint16(const std::vector<uint8_t> &data, size_t offset)
+{
+  return static_cast<uint16_t>(data[offset] << 8 | data[offset + 1]);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_a_query_gets_the_device_address()
+{
+  const std::vector<uint8_t> query = buildQuery("connectivitycheck.gstatic.com", typeA);
+  const std::vector<uint8_t> response = respond(query);
+  TEST_ASSERT_EQUAL(query.size() + 16, response.size());
+  TEST_ASSERT_EQUAL(0x1234, readUint16(response, 0)); // id echoed
+  TEST_ASSERT_EQUAL(0x8500, readUint16(response, 2)); // response, authoritative, recursion desired, no error
+  TEST_ASSERT_EQUAL(1, readUint16(response, 4));
+  TEST_ASSERT_EQUAL(1, readUint16(response, 6));
+  TEST_ASSERT_EQUAL_MEMORY(query.data() + 12, response.data() + 12, query.size() - 12);
+
+  const size_t answer = query.size();
+  TEST_ASSERT_EQUAL(0xC00C, readUint16(response, answer)); // points to the question name
+  TEST_ASSERT_EQUAL(typeA, readUint16(response, answer + 2));
+  TEST_ASSERT_EQUAL(1, readUint16(response, answer + 4));
+  TEST_ASSERT_EQUAL(4, readUint16(response, answer + 10));
+  TEST_ASSERT_EQUAL_MEMORY(address, response.data() + answer + 12, 4);
+}
+
+void test_any_query_gets_the_device_address()
+{
+  const std::vector<uint8_t> response = respond(buildQuery("example.com", typeAny));
+  TEST_ASSERT_GREATER_THAN(0, response.size());
+  TEST_ASSERT_EQUAL(1, readUint16(response, 6));
+}
+
+// Clients asking for an IPv6 address get none, and fall back to the A record.
+void test_other_types_get_an_empty_answer()
+{
+  const std::vector<uint8_t> query = buildQuery("example.com", typeAaaa);
+  const std::vector<uint8_t> response = respond(query);
+  TEST_ASSERT_EQUAL(query.size(), response.size());
+  TEST_ASSERT_EQUAL(0x8500, readUint16(response, 2));
+  TEST_ASSERT_EQUAL(0, readUint16(response, 6));
+}
+
+void test_edns_additional_records_are_dropped()
+{
+  const std::vector<uint8_t> plain = buildQuery("example.com", typeA);
+  const std::vector<uint8_t> query = buildQuery("example.com", typeA, true);
+  const std::vector<uint8_t> response = respond(query);
+  TEST_ASSERT_EQUAL(plain.size() + 16, response.size());
+  TEST_ASSERT_EQUAL(0, readUint16(response, 10)); // no additional records
+  TEST_ASSERT_EQUAL_MEMORY(address, response.data() + response.size() - 4, 4);
+}
+
+void test_truncated_header_is_ignored()
+{
+  const std::vector<uint8_t> query = buildQuery("example.com", typeA);
+  for (size_t length = 0; length < 12; ++length)
+  {
+    TEST_ASSERT_EQUAL(0, respond(std::vector<uint8_t>(query.begin(), query.begin() + length)).size());
+  }
+}
+
+// Cut anywhere in the question, the query is ignored without reading past it.
+void test_truncated_question_is_ignored()
+{
+  const std::vector<uint8_t> query = buildQuery("captive.apple.com", typeA);
+  for (size_t length = 12; length < query.size(); ++length)
+  {
+    TEST_ASSERT_EQUAL(0, respond(std::vector<uint8_t>(query.begin(), query.begin() + length)).size());
+  }
+}
+
+void test_label_running_past_the_query_is_ignored()
+{
+  std::vector<uint8_t> query = buildQuery("example.com", typeA);
+  query[12] = 63; // "example" claims 63 bytes
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+
+  query = buildQuery("example.com", typeA);
+  query[20] = 200; // "com" claims more than any label can hold
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+}
+
+void test_compression_pointer_in_question_is_ignored()
+{
+  std::vector<uint8_t> query = buildQuery("example.com", typeA);
+  query[20] = 0xC0; // "com" replaced by a pointer to the start of the name
+  query[21] = 12;
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+
+  // Read as a label length, the pointer would skip 193 bytes; padding makes the skip land on a zero byte.
+  query.resize(query.size() + 250, 0);
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+
+  query = buildQuery("example.com", typeA);
+  query[12] = 0x40; // reserved label type
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+}
+
+void test_responses_and_other_opcodes_are_ignored()
+{
+  std::vector<uint8_t> query = buildQuery("example.com", typeA);
+  query[2] |= 0x80; // a response
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+
+  query = buildQuery("example.com", typeA);
+  query[2] |= 0x10; // opcode 2, status
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+
+  query = buildQuery("example.com", typeA);
+  query[5] = 2; // two questions
+  TEST_ASSERT_EQUAL(0, respond(query).size());
+}
+
+void test_response_larger_than_capacity_is_not_written()
+{
+  const std::vector<uint8_t> query = buildQuery("example.com", typeA);
+  const size_t length = query.size() + 16;
+  TEST_ASSERT_EQUAL(0, respond(query, length - 1).size());
+  TEST_ASSERT_EQUAL(length, respond(query, length).size());
+
+  const std::vector<uint8_t> empty = buildQuery("example.com", typeAaaa);
+  TEST_ASSERT_EQUAL(0, respond(empty, empty.size() - 1).size());
+  TEST_ASSERT_EQUAL(empty.size(), respond(empty, empty.size()).size());
+}
+
+// Random bytes after a valid header never make the responder read past the query or write past the response.
+void test_random_queries_stay_within_bounds()
+{
+  std::mt19937 random(7);
+  for (int iteration = 0; iteration < 20000; ++iteration)
+  {
+    std::vector<uint8_t> query = buildQuery("example.com", typeA, iteration % 2 == 0);
+    query.resize(12 + random() % 40);
+    for (size_t i = 12; i < query.size(); ++i)
+    {
+      query[i] = random() % 4 == 0 ? static_cast<uint8_t>(random() % 8) : static_cast<uint8_t>(random());
+    }
+
+    const size_t capacity = 12 + random() % 64;
+    const std::vector<uint8_t> response = respond(query, capacity);
+    TEST_ASSERT_LESS_OR_EQUAL(capacity, response.size());
+  }
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_a_query_gets_the_device_address);
+  RUN_TEST(test_any_query_gets_the_device_address);
+  RUN_TEST(test_other_types_get_an_empty_answer);
+  RUN_TEST(test_edns_additional_records_are_dropped);
+  RUN_TEST(test_truncated_header_is_ignored);
+  RUN_TEST(test_truncated_question_is_ignored);
+  RUN_TEST(test_label_running_past_the_query_is_ignored);
+  RUN_TEST(test_compression_pointer_in_question_is_ignored);
+  RUN_TEST(test_responses_and_other_opcodes_are_ignored);
+  RUN_TEST(test_response_larger_than_capacity_is_not_written);
+  RUN_TEST(test_random_queries_stay_within_bounds);
+  return UNITY_END();
+}
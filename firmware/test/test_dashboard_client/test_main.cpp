@@ -0,0 +1,311 @@
+// Runs the frame fetch path against a local stand-in for the dashboard server over real TCP connections.
+
+#include <random>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "dashboard_client.h"
+#include "fakes.h"
+#include "firmware_delta.h"
+#include "simulated_link.h"
+#include "stand_in_server.h"
+#include "update_schedule.h"
+
+static const PanelGeometry panel{64, 32, 2};
+static const FrameLayout layout{panel, 16, BandPipeline::maxSlots, false};
+static const char frameETag[] = "\"f1\"";
+
+void deviceLog(const char *, ...) {}
+
+// A raw frame: per band, black and red bytes interleaved.
+static std::string buildRawFrame(std::vector<uint8_t> &black, std::vector<uint8_t> &red)
+{
+  const size_t planeBytes = static_cast<size_t>(panel.height) * panel.getRowBytes();
+  black.resize(planeBytes);
+  red.resize(planeBytes);
+  std::string body;
+  for (size_t i = 0; i < planeBytes; ++i)
+  {
+    black[i] = static_cast<uint8_t>(i * 7);
+    red[i] = static_cast<uint8_t>(~i);
+    body += static_cast<char>(black[i]);
+    body += static_cast<char>(red[i]);
+  }
+
+  return body;
+}
+
+static std::string buildResponse(const std::string &body, size_t sentBytes)
+{
+  return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " + std::to_string(body.size()) +
+         "\r\nETag: " + frameETag + "\r\n\r\n" + body.substr(0, sentBytes);
+}
+
+// Answers with 304 when the device reports the current frame, as the server does.
+static std::string respondWithFrame(const std::string &request, const std::string &body)
+{
+  if (request.find(std::string("If-None-Match: ") + frameETag) != std::string::npos)
+  {
+    return std::string("HTTP/1.1 304 Not Modified\r\nETag: ") + frameETag + "\r\n\r\n";
+  }
+
+  return buildResponse(body, body.size());
+}
+
+struct Device
+{
+  explicit Device(uint16_t port)
+      : config{"ssid", "password", "127.0.0.1", port, 60, "api-key", ""},
+        client(link, random), clock(std::chrono::steady_clock::now()), display(panel.width, panel.height),
+        dashboardClient(config, layout, client, clock, wakeTimings, nullptr, "Test/0.1.0") {}
+
+  ~Device()
+  {
+    for (uint8_t slot = 0; slot < buffers.count; ++slot)
+    {
+      free(buffers.black[slot]);
+      free(buffers.red[slot]);
+    }
+  }
+
+  FetchResult fetch(bool isManualRefresh = false)
+  {
+    return dashboardClient.fetchBinaryData(display, buffers, displayedFrame, isManualRefresh);
+  }
+
+  Configuration config;
+  LinkProfile link{};
+  std::mt19937 random{1};
+  SimulatedLinkClient client;
+  DeviceClock clock;
+  WakeTimings wakeTimings{};
+  MemoryFrameDisplay display;
+  BandPipeline::Buffers buffers{};
+  DisplayedFrame displayedFrame{};
+  DashboardClient dashboardClient;
+};
+
+// A delta that inserts the whole target image, made for the given source image.
+static std::string buildFirmwareDelta(const std::string &source, const std::string &target)
+{
+  return FirmwareDeltaBuilder(source, target).insert(target).build();
+}
+
+// Offers version 0.2.0 with every frame and serves the delta.
+static std::string respondWithFirmwareUpdate(const std::string &request, const std::string &frame, const std::string &delta)
+{
+  if (request.rfind("GET /api/firmware/delta?to=0.2.0 ", 0) == 0)
+  {
+    return "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: " + std::to_string(delta.size()) +
+           "\r\n\r\n" + delta;
+  }
+
+  std::string response = buildResponse(frame, frame.size());
+  return response.insert(response.find("\r\n") + 2, "X-Firmware-Update: 0.2.0\r\n");
+}
+
+// Sends the local and the UTC server time of day with every frame and serves the update times.
+static std::string respondWithUpdateSchedule(const std::string &request, const std::string &frame)
+{
+  if (request.rfind("GET /api/configuration/update-schedule ", 0) == 0)
+  {
+    return "HTTP/1.1 200 OK\r\nContent-Length: 13\r\n\r\ns1;3600,72000";
+  }
+
+  std::string response = buildResponse(frame, frame.size());
+  return response.insert(response.find("\r\n") + 2, "X-Update-Schedule: 28800,21600;s1\r\n");
+}
+
+static size_t countFirmwareRequests(const std::vector<std::string> &requests)
+{
+  size_t count = 0;
+  for (const std::string &request : requests)
+  {
+    count += request.rfind("GET /api/firmware/delta", 0) == 0 ? 1 : 0;
+  }
+
+  return count;
+}
+
+static RejectedFirmware newRejectedFirmware()
+{
+  RejectedFirmware rejected;
+  memset(&rejected, 0xA5, sizeof(rejected)); // RTC memory after a power loss
+  beginRejectedFirmware(rejected);
+  return rejected;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_new_frame_is_drawn_and_remembered()
+{
+  std::vector<uint8_t> black, red;
+  const std::string body = buildRawFrame(black, red);
+  StandInHttpServer server([&](const std::string &request) { return respondWithFrame(request, body); });
+  Device device(server.getPort());
+
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+  TEST_ASSERT_EQUAL_STRING(frameETag, device.displayedFrame.etag);
+  TEST_ASSERT_EQUAL(layout.getBandCount(), device.display.getBandCount());
+  TEST_ASSERT_EQUAL_MEMORY(black.data(), device.display.getBlack().data(), black.size());
+  TEST_ASSERT_EQUAL_MEMORY(red.data(), device.display.getRed().data(), red.size());
+  TEST_ASSERT_TRUE(server.getRequests().at(0).find("If-None-Match") == std::string::npos);
+}
+
+void test_unchanged_frame_is_neither_downloaded_nor_drawn()
+{
+  std::vector<uint8_t> black, red;
+  const std::string body = buildRawFrame(black, red);
+  StandInHttpServer server([&](const std::string &request) { return respondWithFrame(request, body); });
+  Device device(server.getPort());
+  setDisplayedFrameETag(device.displayedFrame, frameETag);
+
+  TEST_ASSERT_EQUAL(FetchResult::NotModified, device.fetch());
+  TEST_ASSERT_TRUE(server.getRequests().at(0).find(std::string("If-None-Match: ") + frameETag + "\r\n") != std::string::npos);
+  TEST_ASSERT_EQUAL_STRING(frameETag, device.displayedFrame.etag);
+  TEST_ASSERT_EQUAL(0, device.display.getBandCount());
+  TEST_ASSERT_EQUAL(0, device.buffers.count);
+}
+
+void test_manual_refresh_redraws_unchanged_frame()
+{
+  std::vector<uint8_t> black, red;
+  const std::string body = buildRawFrame(black, red);
+  StandInHttpServer server([&](const std::string &request) { return respondWithFrame(request, body); });
+  Device device(server.getPort());
+  setDisplayedFrameETag(device.displayedFrame, frameETag);
+
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch(true));
+  TEST_ASSERT_TRUE(server.getRequests().at(0).find("If-None-Match") == std::string::npos);
+  TEST_ASSERT_EQUAL(layout.getBandCount(), device.display.getBandCount());
+}
+
+void test_incomplete_frame_is_not_remembered()
+{
+  std::vector<uint8_t> black, red;
+  const std::string body = buildRawFrame(black, red);
+  StandInHttpServer server([&](const std::string &) { return buildResponse(body, body.size() / 2 + 3); });
+  Device device(server.getPort());
+  setDisplayedFrameETag(device.displayedFrame, "\"f0\"");
+
+  TEST_ASSERT_EQUAL(FetchResult::Failed, device.fetch());
+  // The panel no longer holds the old frame either, so the next wake downloads the new one in full.
+  TEST_ASSERT_EQUAL_STRING("", device.displayedFrame.etag);
+}
+
+void test_unreachable_server_leaves_panel_alone()
+{
+  uint16_t port;
+  {
+    StandInHttpServer server([](const std::string &) { return std::string(); });
+    port = server.getPort();
+  }
+  Device device(port);
+  setDisplayedFrameETag(device.displayedFrame, frameETag);
+
+  TEST_ASSERT_EQUAL(FetchResult::Failed, device.fetch());
+  TEST_ASSERT_EQUAL_STRING(frameETag, device.displayedFrame.etag);
+  TEST_ASSERT_EQUAL(0, device.display.getBandCount());
+  TEST_ASSERT_EQUAL(0, device.buffers.count);
+}
+
+void test_firmware_update_is_written_from_pinned_server()
+{
+  std::vector<uint8_t> black, red;
+  const std::string frame = buildRawFrame(black, red);
+  const std::string running(300, 'a');
+  const std::string update(100, 'b');
+  const std::string delta = buildFirmwareDelta(running, update);
+  StandInHttpServer server([&](const std::string &request) { return respondWithFirmwareUpdate(request, frame, delta); });
+  Device device(server.getPort());
+  MemoryFirmwareUpdater updater(running);
+  RejectedFirmware rejected = newRejectedFirmware();
+
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+  TEST_ASSERT_TRUE(device.dashboardClient.hasFirmwareUpdate());
+  TEST_ASSERT_TRUE(device.dashboardClient.updateFirmware(updater, rejected, true));
+  TEST_ASSERT_TRUE(updater.isBootSlotSet);
+  TEST_ASSERT_TRUE(updater.slot == update);
+  TEST_ASSERT_EQUAL_STRING("", rejected.version);
+}
+
+void test_firmware_update_is_refused_without_pinned_server()
+{
+  std::vector<uint8_t> black, red;
+  const std::string frame = buildRawFrame(black, red);
+  const std::string running(300, 'a');
+  const std::string delta = buildFirmwareDelta(running, std::string(100, 'b'));
+  StandInHttpServer server([&](const std::string &request) { return respondWithFirmwareUpdate(request, frame, delta); });
+  Device device(server.getPort());
+  MemoryFirmwareUpdater updater(running);
+  RejectedFirmware rejected = newRejectedFirmware();
+
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+  TEST_ASSERT_FALSE(device.dashboardClient.updateFirmware(updater, rejected, false));
+  TEST_ASSERT_FALSE(updater.isBootSlotSet);
+  TEST_ASSERT_EQUAL(0, countFirmwareRequests(server.getRequests()));
+}
+
+// A delta for another running image is downloaded once; the version is then skipped on later wakes.
+void test_firmware_for_another_image_is_skipped_on_later_wakes()
+{
+  std::vector<uint8_t> black, red;
+  const std::string frame = buildRawFrame(black, red);
+  const std::string delta = buildFirmwareDelta(std::string(300, 'c'), std::string(100, 'b'));
+  StandInHttpServer server([&](const std::string &request) { return respondWithFirmwareUpdate(request, frame, delta); });
+  MemoryFirmwareUpdater updater(std::string(300, 'a'));
+  RejectedFirmware rejected = newRejectedFirmware();
+  {
+    Device device(server.getPort());
+    TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+    TEST_ASSERT_FALSE(device.dashboardClient.updateFirmware(updater, rejected, true));
+    TEST_ASSERT_EQUAL_STRING("0.2.0", rejected.version);
+  }
+
+  RejectedFirmware nextWake;
+  memcpy(&nextWake, &rejected, sizeof(rejected));
+  beginRejectedFirmware(nextWake);
+  Device device(server.getPort());
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+  TEST_ASSERT_TRUE(device.dashboardClient.hasFirmwareUpdate());
+  TEST_ASSERT_FALSE(device.dashboardClient.updateFirmware(updater, nextWake, true));
+  TEST_ASSERT_FALSE(updater.isBootSlotSet);
+  TEST_ASSERT_EQUAL(1, countFirmwareRequests(server.getRequests()));
+}
+
+// The frame response carries the local and the UTC server time of day; the update times are fetched once.
+void test_update_schedule_is_synced_from_the_frame_response()
+{
+  std::vector<uint8_t> black, red;
+  const std::string body = buildRawFrame(black, red);
+  StandInHttpServer server([&](const std::string &request) { return respondWithUpdateSchedule(request, body); });
+  Device device(server.getPort());
+  UpdateSchedule schedule;
+  memset(&schedule, 0, sizeof(schedule));
+  beginUpdateSchedule(schedule);
+
+  TEST_ASSERT_EQUAL(FetchResult::Updated, device.fetch());
+  device.dashboardClient.syncUpdateSchedule(schedule, 1000);
+  TEST_ASSERT_EQUAL(28800, schedule.syncSecondsOfDay);
+  TEST_ASSERT_TRUE(schedule.hasSyncUtc);
+  TEST_ASSERT_EQUAL(21600, schedule.syncUtcSecondsOfDay);
+  TEST_ASSERT_EQUAL_STRING("s1", schedule.id);
+  TEST_ASSERT_EQUAL(2, schedule.count);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_new_frame_is_drawn_and_remembered);
+  RUN_TEST(test_unchanged_frame_is_neither_downloaded_nor_drawn);
+  RUN_TEST(test_manual_refresh_redraws_unchanged_frame);
+  RUN_TEST(test_incomplete_frame_is_not_remembered);
+  RUN_TEST(test_unreachable_server_leaves_panel_alone);
+  RUN_TEST(test_firmware_update_is_written_from_pinned_server);
+  RUN_TEST(test_firmware_update_is_refused_without_pinned_server);
+  RUN_TEST(test_firmware_for_another_image_is_skipped_on_later_wakes);
+  RUN_TEST(test_update_schedule_is_synced_from_the_frame_response);
+  return UNITY_END();
+}
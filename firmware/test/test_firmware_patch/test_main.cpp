@@ -0,0 +1,224 @@
+// Applying firmware deltas to the inactive slot, and rejecting the ones that do not apply to the running image
+// or are malformed before they can produce a broken image.
+
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "firmware_delta.h"
+#include "firmware_patch.h"
+
+void deviceLog(const char *, ...) {}
+
+static std::string source;
+static std::string target;
+
+// Running image bytes 0-255 followed by 0-255 again.
+static std::string buildSource()
+{
+  std::string image;
+  for (int i = 0; i < 512; ++i)
+  {
+    image += static_cast<char>(i);
+  }
+
+  return image;
+}
+
+// Copies, a replacement, a seek back and an insertion, as moved code produces them; target is built alongside.
+static std::string buildDelta()
+{
+  target = source.substr(0, 100) + std::string(10, 'R') + source.substr(110, 50) + source.substr(100, 20) + "tail!";
+  return FirmwareDeltaBuilder(source, target)
+      .copy(100)
+      .replace(std::string(10, 'R'))
+      .copy(50)
+      .seek(-60)
+      .copy(20)
+      .insert("tail!")
+      .build();
+}
+
+static bool apply(FirmwarePatcher &patcher, const std::string &delta)
+{
+  return patcher.write(reinterpret_cast<const uint8_t *>(delta.data()), delta.size());
+}
+
+void setUp()
+{
+  source = buildSource();
+}
+
+void tearDown() {}
+
+void test_delta_produces_the_target()
+{
+  const std::string delta = buildDelta();
+  MemoryFirmwareUpdater updater(source);
+  FirmwarePatcher patcher(updater);
+  TEST_ASSERT_TRUE(apply(patcher, delta));
+  TEST_ASSERT_TRUE(patcher.isComplete());
+  TEST_ASSERT_TRUE(updater.slot == target);
+  TEST_ASSERT_TRUE(updater.finish(patcher.getHeader().targetSha256));
+  TEST_ASSERT_EQUAL(target.size(), patcher.getHeader().targetSize);
+}
+
+// The delta arrives in network chunks that can end anywhere: in the header, an operand or a literal.
+void test_delta_split_at_every_boundary()
+{
+  const std::string delta = buildDelta();
+  for (size_t split = 0; split <= delta.size(); ++split)
+  {
+    MemoryFirmwareUpdater updater(source);
+    FirmwarePatcher patcher(updater);
+    TEST_ASSERT_TRUE(apply(patcher, delta.substr(0, split)));
+    TEST_ASSERT_TRUE(apply(patcher, delta.substr(split)));
+    TEST_ASSERT_TRUE(patcher.isComplete());
+    TEST_ASSERT_TRUE(updater.slot == target);
+  }
+
+  MemoryFirmwareUpdater updater(source);
+  FirmwarePatcher patcher(updater);
+  for (const char byte : delta)
+  {
+    TEST_ASSERT_TRUE(apply(patcher, std::string(1, byte)));
+  }
+  TEST_ASSERT_TRUE(patcher.isComplete());
+  TEST_ASSERT_TRUE(updater.slot == target);
+}
+
+void test_wrong_magic_is_rejected()
+{
+  std::string delta = buildDelta();
+  delta[3] = '2';
+  MemoryFirmwareUpdater updater(source);
+  FirmwarePatcher patcher(updater);
+  TEST_ASSERT_FALSE(apply(patcher, delta));
+  TEST_ASSERT_FALSE(patcher.isForAnotherImage());
+  TEST_ASSERT_FALSE(updater.isBegun);
+  // Later data is refused too.
+  TEST_ASSERT_FALSE(apply(patcher, "x"));
+}
+
+// Nothing is erased when the delta was made for another running image.
+void test_delta_for_another_image_is_rejected_before_writing()
+{
+  const std::string sha256 = MemoryFirmwareUpdater::getSha256(source);
+  std::string otherSha256 = sha256;
+  otherSha256[31] ^= 1;
+  const std::string deltas[] = {
+      FirmwareDeltaBuilder(source.size() - 1, sha256, "x").insert("x").build(),
+      FirmwareDeltaBuilder(source.size(), otherSha256, "x").insert("x").build()};
+  for (const std::string &delta : deltas)
+  {
+    MemoryFirmwareUpdater updater(source);
+    FirmwarePatcher patcher(updater);
+    TEST_ASSERT_FALSE(apply(patcher, delta));
+    TEST_ASSERT_TRUE(patcher.isForAnotherImage());
+    TEST_ASSERT_FALSE(updater.isBegun);
+    TEST_ASSERT_FALSE(patcher.isComplete());
+  }
+}
+
+void test_rejected_version_is_remembered()
+{
+  RejectedFirmware rejected;
+  memset(&rejected, 0xA5, sizeof(rejected)); // RTC memory after a power loss
+  beginRejectedFirmware(rejected);
+  TEST_ASSERT_EQUAL_STRING("", rejected.version);
+  TEST_ASSERT_FALSE(isFirmwareRejected(rejected, ""));
+  TEST_ASSERT_FALSE(isFirmwareRejected(rejected, "0.2.0"));
+
+  rejectFirmware(rejected, "0.2.0");
+  TEST_ASSERT_TRUE(isFirmwareRejected(rejected, "0.2.0"));
+  TEST_ASSERT_FALSE(isFirmwareRejected(rejected, "0.2.1"));
+  TEST_ASSERT_FALSE(isFirmwareRejected(rejected, "0.2"));
+
+  // Kept across a wake, and replaced by the next rejected version.
+  beginRejectedFirmware(rejected);
+  TEST_ASSERT_TRUE(isFirmwareRejected(rejected, "0.2.0"));
+  rejectFirmware(rejected, "0.3.0");
+  TEST_ASSERT_FALSE(isFirmwareRejected(rejected, "0.2.0"));
+  TEST_ASSERT_TRUE(isFirmwareRejected(rejected, "0.3.0"));
+
+  // A version too long for the record is cut off rather than overflowing it.
+  const std::string longVersion(FIRMWARE_VERSION_MAX_LENGTH + 8, '9');
+  rejectFirmware(rejected, longVersion.c_str());
+  TEST_ASSERT_EQUAL(FIRMWARE_VERSION_MAX_LENGTH, strlen(rejected.version));
+}
+
+// Each delta is cut off where it goes wrong; the patcher rejects it and never completes.
+static void assertRejected(const std::string &delta)
+{
+  MemoryFirmwareUpdater updater(source);
+  FirmwarePatcher patcher(updater);
+  TEST_ASSERT_FALSE(apply(patcher, delta));
+  TEST_ASSERT_FALSE(patcher.isComplete());
+  TEST_ASSERT_FALSE(patcher.isForAnotherImage());
+  TEST_ASSERT_FALSE(apply(patcher, std::string(1, '\0')));
+}
+
+void test_copy_past_the_end_of_the_running_image_is_rejected()
+{
+  const std::string image(600, 'x');
+  assertRejected(FirmwareDeltaBuilder(source, image).copy(513).build());
+  assertRejected(FirmwareDeltaBuilder(source, image).seek(500).copy(13).build());
+}
+
+void test_seek_out_of_range_is_rejected()
+{
+  const std::string image(100, 'x');
+  assertRejected(FirmwareDeltaBuilder(source, image).seek(-1).build());
+  assertRejected(FirmwareDeltaBuilder(source, image).seek(513).build());
+  assertRejected(FirmwareDeltaBuilder(source, image).seek(10).seek(-11).build());
+  // Replacements move the cursor too.
+  assertRejected(FirmwareDeltaBuilder(source, std::string(600, 'R')).replace(std::string(513, 'R')).seek(0).build());
+}
+
+void test_overlong_operand_is_rejected()
+{
+  // Six continuation bytes already hold more bits than any image size; the seventh is refused.
+  assertRejected(FirmwareDeltaBuilder(source, std::string(100, 'x')).raw(std::string(1, '\0') + std::string(7, '\x80')).build());
+}
+
+void test_instruction_past_the_end_of_the_image_is_rejected()
+{
+  const std::string image(100, 'x');
+  assertRejected(FirmwareDeltaBuilder(source, image).copy(101).build());
+  assertRejected(FirmwareDeltaBuilder(source, image).insert(std::string(101, 'x')).build());
+  assertRejected(FirmwareDeltaBuilder(source, image).copy(60).insert(std::string(41, 'x')).build());
+}
+
+void test_unknown_instruction_is_rejected()
+{
+  assertRejected(FirmwareDeltaBuilder(source, std::string(100, 'x')).op(4, 1).build());
+}
+
+void test_data_after_the_end_of_the_image_is_rejected()
+{
+  MemoryFirmwareUpdater updater(source);
+  FirmwarePatcher patcher(updater);
+  TEST_ASSERT_FALSE(apply(patcher, buildDelta() + '\0'));
+
+  // Also when it arrives in a later chunk.
+  MemoryFirmwareUpdater laterUpdater(source);
+  FirmwarePatcher laterPatcher(laterUpdater);
+  TEST_ASSERT_TRUE(apply(laterPatcher, buildDelta()));
+  TEST_ASSERT_FALSE(apply(laterPatcher, std::string(1, '\0')));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_delta_produces_the_target);
+  RUN_TEST(test_delta_split_at_every_boundary);
+  RUN_TEST(test_wrong_magic_is_rejected);
+  RUN_TEST(test_delta_for_another_image_is_rejected_before_writing);
+  RUN_TEST(test_rejected_version_is_remembered);
+  RUN_TEST(test_copy_past_the_end_of_the_running_image_is_rejected);
+  RUN_TEST(test_seek_out_of_range_is_rejected);
+  RUN_TEST(test_overlong_operand_is_rejected);
+  RUN_TEST(test_instruction_past_the_end_of_the_image_is_rejected);
+  RUN_TEST(test_unknown_instruction_is_rejected);
+  RUN_TEST(test_data_after_the_end_of_the_image_is_rejected);
+  return UNITY_END();
+}
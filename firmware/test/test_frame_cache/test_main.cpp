@@ -0,0 +1,208 @@
+// Stores, evicts and reopens frames in the flash frame cache backed by the emulated flash of the host benchmark.
+
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "band_pipeline.h"
+#include "fakes.h"
+#include "frame_cache.h"
+
+static const FrameLayout layout{{64, 32, 2}, 16, BandPipeline::maxSlots, false};
+
+void deviceLog(const char *, ...) {}
+
+struct Cache
+{
+  Cache() : storage(clock, 0), cache(index, storage) { cache.begin(); }
+
+  HostClock clock{};
+  MemoryFrameStorage storage;
+  FrameCacheIndex index{};
+  FrameCache cache;
+};
+
+static std::vector<uint8_t> frameBody(const char *etag)
+{
+  std::vector<uint8_t> body(300);
+  for (size_t i = 0; i < body.size(); ++i)
+  {
+    body[i] = static_cast<uint8_t>(i + etag[1]);
+  }
+
+  return body;
+}
+
+// Receives the frame once, as the client does: beginStore, the body in pieces and a commit.
+static bool receive(FrameCache &cache, const char *etag)
+{
+  if (!cache.beginStore(etag, FrameEncoding::Rle, layout))
+  {
+    return false;
+  }
+
+  const std::vector<uint8_t> body = frameBody(etag);
+  cache.append(body.data(), 100);
+  cache.append(body.data() + 100, body.size() - 100);
+  cache.commitStore();
+  return true;
+}
+
+static void assertStored(FrameCache &cache, const char *etag)
+{
+  FrameEncoding encoding = FrameEncoding::Raw;
+  TEST_ASSERT_TRUE_MESSAGE(cache.openFrame(etag, layout, encoding), etag);
+  TEST_ASSERT_EQUAL(FrameEncoding::Rle, encoding);
+
+  const std::vector<uint8_t> expected = frameBody(etag);
+  std::vector<uint8_t> body(expected.size() + 1);
+  TEST_ASSERT_EQUAL(expected.size(), cache.read(body.data(), body.size()));
+  TEST_ASSERT_EQUAL_MEMORY(expected.data(), body.data(), expected.size());
+  cache.closeFrame();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_frame_is_stored_on_its_second_download()
+{
+  Cache cache;
+  TEST_ASSERT_FALSE(receive(cache.cache, "\"a\""));
+  TEST_ASSERT_FALSE(cache.cache.contains("\"a\""));
+  TEST_ASSERT_EQUAL(0, cache.storage.getCommitCount());
+
+  TEST_ASSERT_TRUE(receive(cache.cache, "\"a\""));
+  TEST_ASSERT_TRUE(cache.cache.contains("\"a\""));
+  TEST_ASSERT_EQUAL(1, cache.storage.getCommitCount());
+  assertStored(cache.cache, "\"a\"");
+
+  // A stored frame is never written again.
+  TEST_ASSERT_FALSE(receive(cache.cache, "\"a\""));
+  TEST_ASSERT_EQUAL(1, cache.storage.getCommitCount());
+}
+
+void test_aborted_store_keeps_nothing()
+{
+  Cache cache;
+  receive(cache.cache, "\"a\"");
+  TEST_ASSERT_TRUE(cache.cache.beginStore("\"a\"", FrameEncoding::Rle, layout));
+  cache.cache.append(frameBody("\"a\"").data(), 10);
+  cache.cache.abortStore();
+
+  TEST_ASSERT_FALSE(cache.cache.contains("\"a\""));
+  TEST_ASSERT_EQUAL(0, cache.storage.getCommitCount());
+  FrameEncoding encoding;
+  TEST_ASSERT_FALSE(cache.cache.openFrame("\"a\"", layout, encoding));
+}
+
+void test_least_recently_used_frame_is_replaced()
+{
+  Cache cache;
+  const char *etags[] = {"\"a\"", "\"b\"", "\"c\"", "\"d\"", "\"e\"", "\"f\""};
+  for (const char *etag : etags)
+  {
+    receive(cache.cache, etag);
+    TEST_ASSERT_TRUE(receive(cache.cache, etag));
+  }
+
+  // Drawing "a" makes "b" the least recently used frame.
+  assertStored(cache.cache, "\"a\"");
+  receive(cache.cache, "\"g\"");
+  TEST_ASSERT_TRUE(receive(cache.cache, "\"g\""));
+
+  TEST_ASSERT_FALSE(cache.cache.contains("\"b\""));
+  for (const char *etag : {"\"a\"", "\"c\"", "\"d\"", "\"e\"", "\"f\"", "\"g\""})
+  {
+    assertStored(cache.cache, etag);
+  }
+}
+
+void test_removed_slot_is_reused_first()
+{
+  Cache cache;
+  for (const char *etag : {"\"a\"", "\"b\""})
+  {
+    receive(cache.cache, etag);
+    receive(cache.cache, etag);
+  }
+
+  cache.cache.remove("\"a\"");
+  TEST_ASSERT_FALSE(cache.cache.contains("\"a\""));
+  receive(cache.cache, "\"c\"");
+  TEST_ASSERT_TRUE(receive(cache.cache, "\"c\""));
+  TEST_ASSERT_EQUAL_STRING("\"c\"", cache.index.slots[0].etag);
+  assertStored(cache.cache, "\"b\"");
+}
+
+void test_index_is_rebuilt_from_the_stored_files()
+{
+  Cache cache;
+  for (const char *etag : {"\"a\"", "\"b\"", "\"c\""})
+  {
+    receive(cache.cache, etag);
+    receive(cache.cache, etag);
+  }
+  // An interrupted write leaves no file behind.
+  receive(cache.cache, "\"d\"");
+  cache.cache.beginStore("\"d\"", FrameEncoding::Rle, layout);
+  cache.cache.append(frameBody("\"d\"").data(), 10);
+  cache.cache.abortStore();
+
+  // After a power loss RTC memory holds garbage.
+  memset(&cache.index, 0xA5, sizeof(cache.index));
+  FrameCache rebuilt(cache.index, cache.storage);
+  rebuilt.begin();
+
+  for (const char *etag : {"\"a\"", "\"b\"", "\"c\""})
+  {
+    assertStored(rebuilt, etag);
+  }
+  TEST_ASSERT_FALSE(rebuilt.contains("\"d\""));
+  // Frames received before the power loss count as new again.
+  TEST_ASSERT_FALSE(receive(rebuilt, "\"d\""));
+  TEST_ASSERT_TRUE(receive(rebuilt, "\"d\""));
+}
+
+void test_frame_stored_for_other_bands_is_not_opened()
+{
+  Cache cache;
+  receive(cache.cache, "\"a\"");
+  receive(cache.cache, "\"a\"");
+
+  FrameEncoding encoding;
+  const FrameLayout otherBands{layout.panel, 8, layout.slotCount, false};
+  const FrameLayout otherPlanes{{64, 32, 1}, 16, layout.slotCount, false};
+  TEST_ASSERT_FALSE(cache.cache.openFrame("\"a\"", otherBands, encoding));
+  TEST_ASSERT_FALSE(cache.cache.openFrame("\"a\"", otherPlanes, encoding));
+}
+
+void test_stored_etags_are_listed_within_capacity()
+{
+  Cache cache;
+  for (const char *etag : {"\"a\"", "\"b\"", "\"c\""})
+  {
+    receive(cache.cache, etag);
+    receive(cache.cache, etag);
+  }
+
+  char buffer[32] = "\"x\"";
+  TEST_ASSERT_EQUAL(strlen("\"x\", \"a\", \"c\""), cache.cache.appendETags(buffer, strlen(buffer), sizeof(buffer), "\"b\""));
+  TEST_ASSERT_EQUAL_STRING("\"x\", \"a\", \"c\"", buffer);
+
+  char small[10] = "";
+  TEST_ASSERT_EQUAL(strlen("\"a\", \"b\""), cache.cache.appendETags(small, 0, sizeof(small), nullptr));
+  TEST_ASSERT_EQUAL_STRING("\"a\", \"b\"", small);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_is_stored_on_its_second_download);
+  RUN_TEST(test_aborted_store_keeps_nothing);
+  RUN_TEST(test_least_recently_used_frame_is_replaced);
+  RUN_TEST(test_removed_slot_is_reused_first);
+  RUN_TEST(test_index_is_rebuilt_from_the_stored_files);
+  RUN_TEST(test_frame_stored_for_other_bands_is_not_opened);
+  RUN_TEST(test_stored_etags_are_listed_within_capacity);
+  return UNITY_END();
+}
@@ -0,0 +1,249 @@
+// Round trips of frames through the server's encodings and the streaming band decoder.
+
+#include <random>
+#include <unity.h>
+#include <vector>
+#include "frame_decoder.h"
+
+void deviceLog(const char *, ...) {}
+
+struct Planes
+{
+  std::vector<uint8_t> black;
+  std::vector<uint8_t> red; // empty for black and white frames
+};
+
+// PackBits as the server codes each row, see PackBits.cs.
+static void appendPackBits(std::vector<uint8_t> &output, const uint8_t *row, size_t length)
+{
+  size_t position = 0;
+  while (position < length)
+  {
+    size_t runLength = 1;
+    while (position + runLength < length && runLength < 128 && row[position + runLength] == row[position])
+    {
+      ++runLength;
+    }
+
+    if (runLength > 1)
+    {
+      output.push_back(static_cast<uint8_t>(1 - static_cast<int>(runLength)));
+      output.push_back(row[position]);
+      position += runLength;
+      continue;
+    }
+
+    const size_t literalStart = position;
+    while (position < length && position - literalStart < 128 &&
+           !(position + 1 < length && row[position] == row[position + 1]))
+    {
+      ++position;
+    }
+
+    output.push_back(static_cast<uint8_t>(position - literalStart - 1));
+    output.insert(output.end(), row + literalStart, row + position);
+  }
+}
+
+// Encodes the rows [firstRow, firstRow + rows) of the planes as one band.
+static std::vector<uint8_t> encodeBand(const Planes &planes, FrameEncoding encoding, uint16_t rowBytes, uint16_t firstRow, uint16_t rows)
+{
+  const bool hasRed = !planes.red.empty();
+  const size_t offset = static_cast<size_t>(firstRow) * rowBytes;
+  const size_t length = static_cast<size_t>(rows) * rowBytes;
+  std::vector<uint8_t> band;
+  switch (encoding)
+  {
+  case FrameEncoding::Raw:
+    for (size_t i = offset; i < offset + length; ++i)
+    {
+      band.push_back(planes.black[i]);
+      if (hasRed)
+      {
+        band.push_back(planes.red[i]);
+      }
+    }
+    break;
+  case FrameEncoding::Planar:
+    band.insert(band.end(), planes.black.begin() + offset, planes.black.begin() + offset + length);
+    if (hasRed)
+    {
+      band.insert(band.end(), planes.red.begin() + offset, planes.red.begin() + offset + length);
+    }
+    break;
+  case FrameEncoding::Rle:
+    for (size_t row = offset; row < offset + length; row += rowBytes)
+    {
+      appendPackBits(band, planes.black.data() + row, rowBytes);
+      if (hasRed)
+      {
+        appendPackBits(band, planes.red.data() + row, rowBytes);
+      }
+    }
+    break;
+  }
+
+  return band;
+}
+
+// Encodes the frame band by band, decodes the whole stream in chunks of the given size and checks that every
+// band consumes exactly its own bytes and comes out as it went in.
+static void assertRoundTrip(const Planes &planes, FrameEncoding encoding, uint16_t rowBytes, uint16_t bandRows, size_t chunkBytes)
+{
+  const uint8_t planeCount = planes.red.empty() ? 1 : 2;
+  const uint16_t height = static_cast<uint16_t>(planes.black.size() / rowBytes);
+  std::vector<uint8_t> stream;
+  for (uint16_t y = 0; y < height; y += bandRows)
+  {
+    const std::vector<uint8_t> band = encodeBand(planes, encoding, rowBytes, y, std::min<uint16_t>(bandRows, height - y));
+    stream.insert(stream.end(), band.begin(), band.end());
+  }
+
+  FrameBandDecoder decoder(encoding, rowBytes, planeCount);
+  std::vector<uint8_t> black(static_cast<size_t>(bandRows) * rowBytes);
+  std::vector<uint8_t> red(planeCount == 2 ? black.size() : 0);
+  size_t position = 0;
+  for (uint16_t y = 0; y < height; y += bandRows)
+  {
+    const uint16_t rows = std::min<uint16_t>(bandRows, height - y);
+    decoder.beginBand(black.data(), planeCount == 2 ? red.data() : nullptr, rows);
+    while (!decoder.isBandComplete())
+    {
+      TEST_ASSERT_FALSE(decoder.hasError());
+      TEST_ASSERT_TRUE_MESSAGE(position < stream.size(), "stream ended inside a band");
+      const size_t length = std::min(chunkBytes, stream.size() - position);
+      const size_t consumed = decoder.decode(stream.data() + position, length);
+      TEST_ASSERT_TRUE(consumed > 0);
+      TEST_ASSERT_LESS_OR_EQUAL(length, consumed);
+      position += consumed;
+    }
+
+    const size_t offset = static_cast<size_t>(y) * rowBytes;
+    const size_t length = static_cast<size_t>(rows) * rowBytes;
+    TEST_ASSERT_EQUAL_MEMORY(planes.black.data() + offset, black.data(), length);
+    if (planeCount == 2)
+    {
+      TEST_ASSERT_EQUAL_MEMORY(planes.red.data() + offset, red.data(), length);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(stream.size(), position);
+}
+
+static void assertAllRoundTrips(const Planes &planes, uint16_t rowBytes, uint16_t bandRows)
+{
+  for (const FrameEncoding encoding : {FrameEncoding::Raw, FrameEncoding::Rle, FrameEncoding::Planar})
+  {
+    for (const size_t chunkBytes : {size_t{1}, size_t{7}, size_t{1460}, size_t{1} << 20})
+    {
+      assertRoundTrip(planes, encoding, rowBytes, bandRows, chunkBytes);
+    }
+  }
+}
+
+static Planes makePlanes(uint16_t rowBytes, uint16_t height, bool hasRed, uint8_t (*pixel)(size_t index, std::mt19937 &random))
+{
+  std::mt19937 random(42);
+  Planes planes;
+  const size_t length = static_cast<size_t>(rowBytes) * height;
+  for (size_t i = 0; i < length; ++i)
+  {
+    planes.black.push_back(pixel(i, random));
+    if (hasRed)
+    {
+      planes.red.push_back(pixel(i + length, random));
+    }
+  }
+
+  return planes;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Every row is one long run that continues into the next row, which the row-wise coding has to split.
+void test_white_frame_runs_continue_across_rows()
+{
+  const Planes planes = makePlanes(100, 48, true, [](size_t, std::mt19937 &) { return uint8_t{0xFF}; });
+  assertAllRoundTrips(planes, 100, 16);
+}
+
+// Rows longer than the longest PackBits run, with runs ending exactly at the row end.
+void test_runs_longer_than_a_packbits_run()
+{
+  const Planes planes = makePlanes(200, 10, true, [](size_t index, std::mt19937 &) {
+    return static_cast<uint8_t>(index % 200 < 130 ? 0x00 : index % 200 < 199 ? 0xFF : 0x0F);
+  });
+  assertAllRoundTrips(planes, 200, 4);
+}
+
+// Sparse content like a dashboard: mostly white with short literal runs.
+void test_sparse_frame()
+{
+  const Planes planes = makePlanes(100, 40, true, [](size_t, std::mt19937 &random) {
+    return static_cast<uint8_t>(random() % 16 == 0 ? random() : 0xFF);
+  });
+  assertAllRoundTrips(planes, 100, 16);
+}
+
+// Noise only compresses into literal runs; the band height does not divide the frame.
+void test_noise_with_partial_last_band()
+{
+  const Planes planes = makePlanes(100, 37, true, [](size_t, std::mt19937 &random) { return static_cast<uint8_t>(random()); });
+  assertAllRoundTrips(planes, 100, 16);
+}
+
+void test_black_and_white_frame()
+{
+  const Planes planes = makePlanes(100, 40, false, [](size_t index, std::mt19937 &random) {
+    return static_cast<uint8_t>(index % 3 == 0 ? random() : 0xFF);
+  });
+  assertAllRoundTrips(planes, 100, 16);
+}
+
+void test_run_crossing_row_end_is_malformed()
+{
+  // Rows of 4 bytes: a repeat run of 5 would spill into the next row.
+  const uint8_t stream[] = {static_cast<uint8_t>(-4), 0xFF};
+  uint8_t black[8];
+  uint8_t red[8];
+  FrameBandDecoder decoder(FrameEncoding::Rle, 4, 2);
+  decoder.beginBand(black, red, 2);
+  decoder.decode(stream, sizeof(stream));
+  TEST_ASSERT_TRUE(decoder.hasError());
+  TEST_ASSERT_FALSE(decoder.isBandComplete());
+
+  // A new band starts over after the error.
+  const uint8_t valid[] = {static_cast<uint8_t>(-3), 0x01, static_cast<uint8_t>(-3), 0x02,
+                           static_cast<uint8_t>(-3), 0x03, 3, 0x04, 0x05, 0x06, 0x07};
+  decoder.beginBand(black, red, 2);
+  TEST_ASSERT_EQUAL(sizeof(valid), decoder.decode(valid, sizeof(valid)));
+  TEST_ASSERT_TRUE(decoder.isBandComplete());
+  const uint8_t expectedBlack[] = {0x01, 0x01, 0x01, 0x01, 0x03, 0x03, 0x03, 0x03};
+  const uint8_t expectedRed[] = {0x02, 0x02, 0x02, 0x02, 0x04, 0x05, 0x06, 0x07};
+  TEST_ASSERT_EQUAL_MEMORY(expectedBlack, black, sizeof(black));
+  TEST_ASSERT_EQUAL_MEMORY(expectedRed, red, sizeof(red));
+}
+
+void test_literal_crossing_row_end_is_malformed()
+{
+  const uint8_t stream[] = {4, 1, 2, 3, 4, 5};
+  uint8_t black[4];
+  FrameBandDecoder decoder(FrameEncoding::Rle, 4, 1);
+  decoder.beginBand(black, nullptr, 1);
+  decoder.decode(stream, sizeof(stream));
+  TEST_ASSERT_TRUE(decoder.hasError());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_white_frame_runs_continue_across_rows);
+  RUN_TEST(test_runs_longer_than_a_packbits_run);
+  RUN_TEST(test_sparse_frame);
+  RUN_TEST(test_noise_with_partial_last_band);
+  RUN_TEST(test_black_and_white_frame);
+  RUN_TEST(test_run_crossing_row_end_is_malformed);
+  RUN_TEST(test_literal_crossing_row_end_is_malformed);
+  return UNITY_END();
+}
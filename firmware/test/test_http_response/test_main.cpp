@@ -0,0 +1,360 @@
+// Unit tests and a seeded differential fuzz of the incremental HTTP response parser and the response reader.
+
+#include <random>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include "dashboard_client.h"
+#include "http_response.h"
+
+void deviceLog(const char *, ...) {}
+
+// Parses a whole response fed in the given pieces and collects the decoded body.
+struct ParsedResponse
+{
+  bool isHeaderComplete = false;
+  bool hasError = false;
+  bool isBodyComplete = false;
+  std::string body;
+};
+
+static ParsedResponse parse(HttpResponseParser &parser, const std::string &response, const std::vector<size_t> &pieces)
+{
+  ParsedResponse parsed;
+  size_t position = 0;
+  for (size_t piece : pieces)
+  {
+    std::vector<uint8_t> data(response.begin() + position, response.begin() + position + piece);
+    position += piece;
+    size_t offset = 0;
+    if (!parser.isHeaderComplete())
+    {
+      offset = parser.parseHeaders(data.data(), data.size());
+      TEST_ASSERT_LESS_OR_EQUAL(data.size(), offset);
+    }
+
+    const size_t bodyBytes = parser.decodeBody(data.data() + offset, data.size() - offset);
+    TEST_ASSERT_LESS_OR_EQUAL(data.size() - offset, bodyBytes);
+    parsed.body.append(reinterpret_cast<const char *>(data.data() + offset), bodyBytes);
+  }
+
+  parsed.isHeaderComplete = parser.isHeaderComplete();
+  parsed.hasError = parser.hasError();
+  parsed.isBodyComplete = parser.isBodyComplete();
+  return parsed;
+}
+
+static ParsedResponse parse(HttpResponseParser &parser, const std::string &response)
+{
+  return parse(parser, response, {response.size()});
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_content_length_body_and_captured_headers()
+{
+  char etag[16] = "";
+  char encoding[8] = "";
+  HttpHeaderField etagField{"ETag", etag, sizeof(etag), false};
+  HttpHeaderField encodingField{"X-Frame-Encoding", encoding, sizeof(encoding), false};
+  HttpResponseParser parser{};
+  TEST_ASSERT_TRUE(parser.captureHeader(etagField));
+  TEST_ASSERT_TRUE(parser.captureHeader(encodingField));
+
+  const ParsedResponse parsed = parse(parser, "HTTP/1.1 200 OK\r\netag:  \"f1\" \r\nContent-Length: 5\r\n\r\nhelloEXTRA");
+  TEST_ASSERT_FALSE(parsed.hasError);
+  TEST_ASSERT_TRUE(parsed.isBodyComplete);
+  TEST_ASSERT_EQUAL(200, parser.getStatusCode());
+  TEST_ASSERT_EQUAL(5, parser.getContentLength());
+  TEST_ASSERT_EQUAL_STRING("hello", parsed.body.c_str());
+  TEST_ASSERT_TRUE(etagField.isPresent);
+  TEST_ASSERT_EQUAL_STRING("\"f1\"", etag);
+  TEST_ASSERT_FALSE(encodingField.isPresent);
+}
+
+void test_value_longer_than_field_is_not_captured()
+{
+  char etag[4] = "";
+  HttpHeaderField etagField{"ETag", etag, sizeof(etag), false};
+  HttpResponseParser parser{};
+  parser.captureHeader(etagField);
+
+  parse(parser, "HTTP/1.1 304 Not Modified\r\nETag: \"long\"\r\n\r\n");
+  TEST_ASSERT_FALSE(etagField.isPresent);
+  TEST_ASSERT_TRUE(parser.isBodyComplete());
+}
+
+void test_capture_is_limited_to_max_captured_headers()
+{
+  char value[4];
+  HttpHeaderField fields[HttpResponseParser::maxCapturedHeaders + 1];
+  HttpResponseParser parser{};
+  for (uint8_t i = 0; i < HttpResponseParser::maxCapturedHeaders; ++i)
+  {
+    fields[i] = HttpHeaderField{"X-Header", value, sizeof(value), false};
+    TEST_ASSERT_TRUE(parser.captureHeader(fields[i]));
+  }
+
+  fields[HttpResponseParser::maxCapturedHeaders] = HttpHeaderField{"X-Header", value, sizeof(value), false};
+  TEST_ASSERT_FALSE(parser.captureHeader(fields[HttpResponseParser::maxCapturedHeaders]));
+}
+
+void test_chunked_body_with_extensions_and_trailers()
+{
+  HttpResponseParser parser{};
+  const ParsedResponse parsed = parse(parser,
+                                      "HTTP/1.1 200 OK\r\nContent-Length: 99\r\nTransfer-Encoding: gzip, chunked\r\n\r\n"
+                                      "4;name=value\r\nWiki\r\nA\r\npedia in c\r\n0\r\nX-Trailer: 1\r\n\r\n");
+  TEST_ASSERT_FALSE(parsed.hasError);
+  TEST_ASSERT_TRUE(parser.isChunked());
+  TEST_ASSERT_TRUE(parsed.isBodyComplete);
+  TEST_ASSERT_EQUAL_STRING("Wikipedia in c", parsed.body.c_str());
+}
+
+void test_body_without_framing_ends_with_the_connection()
+{
+  HttpResponseParser parser{};
+  const ParsedResponse parsed = parse(parser, "HTTP/1.0 200 OK\nServer: test\n\nbody until close");
+  TEST_ASSERT_FALSE(parsed.hasError);
+  TEST_ASSERT_FALSE(parsed.isBodyComplete);
+  TEST_ASSERT_EQUAL_STRING("body until close", parsed.body.c_str());
+}
+
+void test_malformed_responses_are_errors()
+{
+  const char *responses[] = {
+      "HTTP/2 200 OK\r\n\r\n",
+      "HTTP/1.1 20 OK\r\n\r\n",
+      "HTTP/1.1 2000 OK\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: 12a\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: 99999999999\r\n\r\n",
+      "HTTP/1.1 200 OK\r\n\rX",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nZ\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n123456789\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabX\r\n",
+  };
+
+  for (const char *response : responses)
+  {
+    HttpResponseParser parser{};
+    TEST_ASSERT_TRUE_MESSAGE(parse(parser, response).hasError, response);
+  }
+}
+
+// Builds a random valid response, remembers what a correct parser has to report for it and checks the parser
+// against that for random splits of the bytes.
+void test_random_responses_in_random_pieces()
+{
+  std::mt19937 random(7);
+  const char *codings[] = {"length", "chunked", "close"};
+  for (int iteration = 0; iteration < 3000; ++iteration)
+  {
+    const std::string coding = codings[random() % 3];
+    std::string body;
+    const size_t bodyLength = random() % 3 == 0 ? 0 : random() % 3000;
+    for (size_t i = 0; i < bodyLength; ++i)
+    {
+      body += static_cast<char>(random());
+    }
+
+    const int statusCode = random() % 4 == 0 ? 304 : 200;
+    const std::string etag = "\"" + std::to_string(random() % 100000) + "\"";
+    const bool hasEtag = random() % 2 == 0;
+    std::string response = "HTTP/1." + std::to_string(random() % 2) + " " + std::to_string(statusCode) + " Reason\r\n";
+    if (hasEtag)
+    {
+      response += (random() % 2 == 0 ? "ETag:" : "etag:\t ") + etag + "\r\n";
+    }
+    for (int header = random() % 4; header > 0; --header)
+    {
+      response += "X-Unrelated-" + std::to_string(header) + ": " + std::string(random() % 120, 'v') + "\r\n";
+    }
+
+    const bool hasBody = statusCode != 304;
+    std::string expectedBody = hasBody ? body : "";
+    if (coding == "length")
+    {
+      response += "Content-Length: " + std::to_string(expectedBody.size()) + "\r\n\r\n" + expectedBody;
+    }
+    else if (coding == "chunked")
+    {
+      response += "Transfer-Encoding: chunked\r\n\r\n";
+      for (size_t offset = 0; offset < expectedBody.size();)
+      {
+        const size_t length = std::min<size_t>(1 + random() % 700, expectedBody.size() - offset);
+        char size[16];
+        snprintf(size, sizeof(size), random() % 2 == 0 ? "%zx" : "%zX", length);
+        response += std::string(size) + (random() % 3 == 0 ? ";ext=1" : "") + "\r\n" + expectedBody.substr(offset, length) + "\r\n";
+        offset += length;
+      }
+      response += random() % 2 == 0 ? "0\r\n\r\n" : "0\r\nTrailer: x\r\n\r\n";
+    }
+    else
+    {
+      response += "\r\n" + expectedBody;
+    }
+
+    // Bytes after the end of a framed body belong to nothing and must be dropped.
+    const bool isFramed = coding != "close" || !hasBody;
+    if (isFramed)
+    {
+      response += "GARBAGE";
+    }
+
+    std::vector<size_t> pieces;
+    for (size_t position = 0; position < response.size();)
+    {
+      const size_t piece = std::min<size_t>(random() % 4 == 0 ? 1 : 1 + random() % 1500, response.size() - position);
+      pieces.push_back(piece);
+      position += piece;
+    }
+
+    char etagValue[FRAME_ETAG_MAX_LENGTH + 1] = "";
+    HttpHeaderField etagField{"ETag", etagValue, sizeof(etagValue), false};
+    HttpResponseParser parser{};
+    parser.captureHeader(etagField);
+    const ParsedResponse parsed = parse(parser, response, pieces);
+
+    TEST_ASSERT_FALSE_MESSAGE(parsed.hasError, response.substr(0, 200).c_str());
+    TEST_ASSERT_TRUE(parsed.isHeaderComplete);
+    TEST_ASSERT_EQUAL(statusCode, parser.getStatusCode());
+    TEST_ASSERT_EQUAL(isFramed, parsed.isBodyComplete);
+    TEST_ASSERT_EQUAL(hasEtag, etagField.isPresent);
+    if (hasEtag)
+    {
+      TEST_ASSERT_EQUAL_STRING(etag.c_str(), etagValue);
+    }
+    TEST_ASSERT_EQUAL(expectedBody.size(), parsed.body.size());
+    TEST_ASSERT_TRUE(parsed.body == expectedBody);
+  }
+}
+
+// Random bytes and corrupted responses must never make the parser read or write outside the buffers it is given.
+void test_corrupted_responses_stay_in_bounds()
+{
+  std::mt19937 random(11);
+  const std::string valid = "HTTP/1.1 200 OK\r\nETag: \"abc\"\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n";
+  for (int iteration = 0; iteration < 20000; ++iteration)
+  {
+    std::string response = valid;
+    if (iteration % 2 == 0)
+    {
+      for (int flips = 1 + random() % 4; flips > 0; --flips)
+      {
+        response[random() % response.size()] = static_cast<char>(random());
+      }
+    }
+    else
+    {
+      response.resize(random() % 200);
+      for (char &c : response)
+      {
+        c = static_cast<char>(random() % 2 == 0 ? random() : "HTTP/1.1 200\r\n:0123456789abcdef;"[random() % 32]);
+      }
+    }
+
+    std::vector<size_t> pieces;
+    for (size_t position = 0; position < response.size();)
+    {
+      const size_t piece = std::min<size_t>(1 + random() % 16, response.size() - position);
+      pieces.push_back(piece);
+      position += piece;
+    }
+
+    char etag[8] = "";
+    HttpHeaderField etagField{"ETag", etag, sizeof(etag), false};
+    HttpResponseParser parser{};
+    parser.captureHeader(etagField);
+    const ParsedResponse parsed = parse(parser, response, pieces);
+    TEST_ASSERT_LESS_OR_EQUAL(response.size(), parsed.body.size());
+    TEST_ASSERT_LESS_OR_EQUAL(sizeof(etag) - 1, strlen(etag));
+  }
+}
+
+// Clock that only moves when the reader yields, so timeouts run instantly.
+class StepClock : public Clock
+{
+public:
+  uint32_t micros() override { return now; }
+  void yield() override { now += 1000; }
+
+  uint32_t now = 1;
+};
+
+// Connection that delivers a fixed response and then stays open without sending anything more.
+class StalledClient : public NetworkClient
+{
+public:
+  explicit StalledClient(const std::string &response) : response(response) {}
+
+  bool connect(const char *, uint16_t) override { return true; }
+  size_t write(const uint8_t *, size_t length) override { return length; }
+  int available() override { return static_cast<int>(response.size() - position); }
+  int read(uint8_t *data, size_t length) override
+  {
+    const size_t count = std::min(length, response.size() - position);
+    memcpy(data, response.data() + position, count);
+    position += count;
+    return static_cast<int>(count);
+  }
+  bool connected() override { return true; }
+  void stop() override {}
+
+private:
+  std::string response;
+  size_t position = 0;
+};
+
+void test_reader_stops_at_the_framed_end_without_waiting_for_close()
+{
+  StepClock clock;
+  StalledClient client("HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nbody");
+  ResponseReader reader(client, clock);
+  TEST_ASSERT_TRUE(reader.readHeaders());
+
+  uint8_t data[16];
+  TEST_ASSERT_EQUAL(4, reader.read(data, sizeof(data)));
+  TEST_ASSERT_EQUAL(0, reader.read(data, sizeof(data)));
+  TEST_ASSERT_EQUAL(1, clock.now);
+}
+
+void test_reader_gives_up_on_a_stalled_body()
+{
+  StepClock clock;
+  StalledClient client("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\npart");
+  ResponseReader reader(client, clock);
+  TEST_ASSERT_TRUE(reader.readHeaders());
+
+  uint8_t data[16];
+  TEST_ASSERT_EQUAL(4, reader.read(data, sizeof(data)));
+  TEST_ASSERT_EQUAL(0, reader.read(data, sizeof(data)));
+  TEST_ASSERT_GREATER_OR_EQUAL(ResponseReader::idleTimeoutMicros, clock.now - 1);
+  TEST_ASSERT_LESS_THAN(ResponseReader::idleTimeoutMicros + 2000, clock.now);
+}
+
+void test_reader_gives_up_on_stalled_headers()
+{
+  StepClock clock;
+  StalledClient client("HTTP/1.1 200 OK\r\nContent-Le");
+  ResponseReader reader(client, clock);
+  TEST_ASSERT_FALSE(reader.readHeaders());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_content_length_body_and_captured_headers);
+  RUN_TEST(test_value_longer_than_field_is_not_captured);
+  RUN_TEST(test_capture_is_limited_to_max_captured_headers);
+  RUN_TEST(test_chunked_body_with_extensions_and_trailers);
+  RUN_TEST(test_body_without_framing_ends_with_the_connection);
+  RUN_TEST(test_malformed_responses_are_errors);
+  RUN_TEST(test_random_responses_in_random_pieces);
+  RUN_TEST(test_corrupted_responses_stay_in_bounds);
+  RUN_TEST(test_reader_stops_at_the_framed_end_without_waiting_for_close);
+  RUN_TEST(test_reader_gives_up_on_a_stalled_body);
+  RUN_TEST(test_reader_gives_up_on_stalled_headers);
+  return UNITY_END();
+}
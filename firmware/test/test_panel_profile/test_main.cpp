@@ -0,0 +1,66 @@
+// Band layouts chosen for the free memory of a wake.
+
+#include <unity.h>
+#include "band_pipeline.h"
+#include "panel_profile.h"
+
+static const PanelGeometry panel{800, 480, 2};
+
+void deviceLog(const char *, ...) {}
+
+void setUp() {}
+void tearDown() {}
+
+void test_psram_holds_the_whole_frame_in_two_bands()
+{
+  const FrameLayout layout = getFrameLayout(panel, PanelMemory{40000, 30000, 4 * 1024 * 1024});
+  TEST_ASSERT_TRUE(layout.isExternalMemory);
+  TEST_ASSERT_EQUAL(BandPipeline::maxSlots, layout.slotCount);
+  TEST_ASSERT_EQUAL(240, layout.bandRows);
+  TEST_ASSERT_EQUAL(2, layout.getBandCount());
+}
+
+void test_frame_fitting_internal_ram_is_still_split_for_overlap()
+{
+  const FrameLayout layout = getFrameLayout(panel, PanelMemory{panel.getFrameBytes(), panel.getFrameBytes(), 0});
+  TEST_ASSERT_FALSE(layout.isExternalMemory);
+  TEST_ASSERT_EQUAL(BandPipeline::maxSlots, layout.slotCount);
+  TEST_ASSERT_EQUAL(240, layout.bandRows);
+}
+
+void test_bands_shrink_to_the_free_internal_ram()
+{
+  // Two slots of two planes of 160 rows need 64000 bytes, of 240 rows 96000.
+  const FrameLayout layout = getFrameLayout(panel, PanelMemory{70000, 60000, 0});
+  TEST_ASSERT_EQUAL(BandPipeline::maxSlots, layout.slotCount);
+  TEST_ASSERT_EQUAL(160, layout.bandRows);
+  TEST_ASSERT_EQUAL(3, layout.getBandCount());
+
+  // The largest block limits a single plane of a band.
+  TEST_ASSERT_EQUAL(120, getFrameLayout(panel, PanelMemory{70000, 15000, 0}).bandRows);
+}
+
+void test_psram_too_small_for_the_frame_is_not_used()
+{
+  const FrameLayout layout = getFrameLayout(panel, PanelMemory{70000, 60000, panel.getFrameBytes() - 1});
+  TEST_ASSERT_FALSE(layout.isExternalMemory);
+  TEST_ASSERT_EQUAL(160, layout.bandRows);
+}
+
+void test_single_row_without_overlap_when_nothing_fits()
+{
+  const FrameLayout layout = getFrameLayout(panel, PanelMemory{100, 100, 0});
+  TEST_ASSERT_EQUAL(1, layout.bandRows);
+  TEST_ASSERT_EQUAL(1, layout.slotCount);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_psram_holds_the_whole_frame_in_two_bands);
+  RUN_TEST(test_frame_fitting_internal_ram_is_still_split_for_overlap);
+  RUN_TEST(test_bands_shrink_to_the_free_internal_ram);
+  RUN_TEST(test_psram_too_small_for_the_frame_is_not_used);
+  RUN_TEST(test_single_row_without_overlap_when_nothing_fits);
+  return UNITY_END();
+}
@@ -0,0 +1,144 @@
+// Checks the setup portal page embedded by scripts/embed_portal.py against src/index.html, independently of the
+// script's own minifier: the embedded bytes are inflated with zlib and compared with the source page.
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unity.h>
+#include <vector>
+#include <zlib.h>
+#include "portal_assets.h"
+
+void deviceLog(const char *, ...) {}
+
+static std::string readSourcePage()
+{
+  std::ifstream file("src/index.html", std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::string inflateEmbeddedPage()
+{
+  z_stream stream{};
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) // gzip wrapper
+  {
+    return "";
+  }
+
+  std::string page;
+  char output[4096];
+  stream.next_in = const_cast<Bytef *>(portalIndexGzip);
+  stream.avail_in = portalIndexGzipLength;
+  int status = Z_OK;
+  while (status == Z_OK)
+  {
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = sizeof(output);
+    status = inflate(&stream, Z_NO_FLUSH);
+    page.append(output, sizeof(output) - stream.avail_out);
+  }
+
+  const bool isComplete = status == Z_STREAM_END && stream.avail_in == 0;
+  inflateEnd(&stream);
+  return isComplete ? page : "";
+}
+
+// Drops CSS comments and all whitespace, and the optional semicolon before a closing brace.
+static std::string normalize(const std::string &page)
+{
+  std::string normalized;
+  for (size_t i = 0; i < page.size(); ++i)
+  {
+    if (page.compare(i, 2, "/*") == 0)
+    {
+      i = page.find("*/", i + 2) + 1;
+      continue;
+    }
+
+    if (!isspace(static_cast<unsigned char>(page[i])))
+    {
+      normalized += page[i];
+    }
+  }
+
+  for (size_t position; (position = normalized.find(";}")) != std::string::npos;)
+  {
+    normalized.erase(position, 1);
+  }
+
+  return normalized;
+}
+
+// The opening tags with the given names in page order, whitespace inside them collapsed to single spaces.
+static std::vector<std::string> findTags(const std::string &page, const std::vector<std::string> &names)
+{
+  std::vector<std::string> tags;
+  for (size_t start = page.find('<'); start != std::string::npos; start = page.find('<', start + 1))
+  {
+    const size_t end = page.find('>', start);
+    std::string tag;
+    for (size_t i = start; i <= end; ++i)
+    {
+      const bool isSpace = isspace(static_cast<unsigned char>(page[i]));
+      if (!isSpace || (tag.back() != ' ' && page[i + 1] != '>'))
+      {
+        tag += isSpace ? ' ' : page[i];
+      }
+    }
+
+    for (const std::string &name : names)
+    {
+      if (tag.compare(1, name.size(), name) == 0 && (tag[name.size() + 1] == ' ' || tag[name.size() + 1] == '>'))
+      {
+        tags.push_back(tag);
+      }
+    }
+  }
+
+  return tags;
+}
+
+static std::string source;
+static std::string embedded;
+
+void setUp() {}
+void tearDown() {}
+
+void test_embedded_page_inflates()
+{
+  TEST_ASSERT_FALSE(source.empty());
+  TEST_ASSERT_FALSE(embedded.empty());
+  TEST_ASSERT_LESS_OR_EQUAL(source.size(), embedded.size());
+  TEST_ASSERT_TRUE(embedded.find("</html>") != std::string::npos);
+}
+
+void test_embedded_page_matches_the_source_but_for_whitespace_and_comments()
+{
+  TEST_ASSERT_TRUE(normalize(source) == normalize(embedded));
+}
+
+void test_forms_inputs_and_scripts_survive()
+{
+  const std::vector<std::string> names{"form", "input", "select", "option", "button", "label", "script"};
+  const std::vector<std::string> sourceTags = findTags(source, names);
+  const std::vector<std::string> embeddedTags = findTags(embedded, names);
+  TEST_ASSERT_GREATER_THAN(0, sourceTags.size());
+  TEST_ASSERT_EQUAL(sourceTags.size(), embeddedTags.size());
+  for (size_t i = 0; i < sourceTags.size(); ++i)
+  {
+    TEST_ASSERT_EQUAL_STRING(sourceTags[i].c_str(), embeddedTags[i].c_str());
+  }
+  TEST_ASSERT_TRUE(embedded.find("<form action=\"/submit\" method=\"post\">") != std::string::npos);
+}
+
+int main()
+{
+  source = readSourcePage();
+  embedded = inflateEmbeddedPage();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_embedded_page_inflates);
+  RUN_TEST(test_embedded_page_matches_the_source_but_for_whitespace_and_comments);
+  RUN_TEST(test_forms_inputs_and_scripts_survive);
+  return UNITY_END();
+}
@@ -0,0 +1,232 @@
+// Runs the device TLS client, built against mbedtls, against a local OpenSSL server with a self-signed certificate.
+
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <atomic>
+#include <random>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "simulated_link.h"
+#include "stand_in_server.h"
+#include "tls_network_client.h"
+
+void deviceLog(const char *, ...) {}
+
+static int getRandom(void *, unsigned char *data, size_t length)
+{
+  return RAND_bytes(data, static_cast<int>(length)) == 1 ? 0 : -1;
+}
+
+// TLS server with a freshly generated self-signed certificate. It answers every line it receives with "pong"
+// and records whether the client resumed a session.
+class StandInTlsServer
+{
+public:
+  StandInTlsServer() : server([this](int socket) { serve(socket); })
+  {
+    EVP_PKEY *key = EVP_EC_gen("P-256");
+    X509 *certificate = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), 3600);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(certificate), "CN", MBSTRING_ASC,
+                               reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(certificate, X509_get_subject_name(certificate));
+    X509_set_pubkey(certificate, key);
+    X509_sign(certificate, key, EVP_sha256());
+
+    unsigned int length = 0;
+    X509_digest(certificate, EVP_sha256(), fingerprint, &length);
+
+    // The device speaks TLS 1.2; session tickets are on by default.
+    context = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+    SSL_CTX_use_certificate(context, certificate);
+    SSL_CTX_use_PrivateKey(context, key);
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    isReady = true;
+  }
+
+  ~StandInTlsServer() { SSL_CTX_free(context); }
+
+  uint16_t getPort() const { return server.getPort(); }
+  const uint8_t *getFingerprint() const { return fingerprint; }
+  size_t getHandshakeCount() const { return handshakeCount; }
+  size_t getResumedCount() const { return resumedCount; }
+
+private:
+  void serve(int socket)
+  {
+    while (!isReady)
+    {
+      std::this_thread::yield();
+    }
+
+    SSL *ssl = SSL_new(context);
+    SSL_set_fd(ssl, socket);
+    if (SSL_accept(ssl) == 1)
+    {
+      ++handshakeCount;
+      resumedCount += SSL_session_reused(ssl) ? 1 : 0;
+      char data[256];
+      std::string received;
+      int count;
+      while (received.find('\n') == std::string::npos && (count = SSL_read(ssl, data, sizeof(data))) > 0)
+      {
+        received.append(data, count);
+      }
+      if (!received.empty())
+      {
+        SSL_write(ssl, "pong\n", 5);
+      }
+      SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+  }
+
+  uint8_t fingerprint[TLS_FINGERPRINT_LENGTH] = {};
+  SSL_CTX *context = nullptr;
+  std::atomic<bool> isReady{false};
+  std::atomic<size_t> handshakeCount{0};
+  std::atomic<size_t> resumedCount{0};
+  StandInServer server; // last, so that it stops before the members it uses are destroyed
+};
+
+// A device wake: the TLS client over a TCP transport, with the session cache the device keeps in RTC memory.
+struct Device
+{
+  Device(TlsSessionCache &sessionCache, const uint8_t *fingerprint)
+      : transport(link, random), clock(std::chrono::steady_clock::now()),
+        client(transport, clock, sessionCache, fingerprint, getRandom) {}
+
+  // Sends a line and waits for the answer.
+  std::string exchange(const char *line)
+  {
+    client.write(reinterpret_cast<const uint8_t *>(line), strlen(line));
+    std::string received;
+    uint8_t data[64];
+    while (received.find('\n') == std::string::npos && client.connected())
+    {
+      if (client.available() == 0)
+      {
+        clock.yield();
+        continue;
+      }
+
+      const int count = client.read(data, sizeof(data));
+      received.append(reinterpret_cast<const char *>(data), count);
+    }
+
+    return received;
+  }
+
+  LinkProfile link{};
+  std::mt19937 random{1};
+  SimulatedLinkClient transport;
+  DeviceClock clock;
+  TlsNetworkClient client;
+};
+
+static TlsSessionCache newSessionCache()
+{
+  TlsSessionCache cache;
+  memset(&cache, 0xA5, sizeof(cache)); // RTC memory after a power loss
+  beginTlsSessionCache(cache);
+  return cache;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_wrong_pin_is_rejected()
+{
+  StandInTlsServer server;
+  TlsSessionCache cache = newSessionCache();
+  uint8_t wrongPin[TLS_FINGERPRINT_LENGTH];
+  memcpy(wrongPin, server.getFingerprint(), sizeof(wrongPin));
+  wrongPin[0] ^= 1;
+
+  Device device(cache, wrongPin);
+  TEST_ASSERT_FALSE(device.client.connect("127.0.0.1", server.getPort()));
+  TEST_ASSERT_FALSE(device.client.connected());
+  TEST_ASSERT_EQUAL(0, cache.length);
+}
+
+void test_right_pin_is_accepted()
+{
+  StandInTlsServer server;
+  TlsSessionCache cache = newSessionCache();
+
+  Device device(cache, server.getFingerprint());
+  TEST_ASSERT_TRUE(device.client.connect("127.0.0.1", server.getPort()));
+  TEST_ASSERT_FALSE(device.client.isSessionResumed());
+  const std::string answer = device.exchange("ping\n");
+  TEST_ASSERT_EQUAL_STRING("pong\n", answer.c_str());
+  device.client.stop();
+
+  TEST_ASSERT_GREATER_THAN(0, cache.length);
+  TEST_ASSERT_EQUAL(1, server.getHandshakeCount());
+  TEST_ASSERT_EQUAL(0, server.getResumedCount());
+}
+
+// The session is saved into the cache by one wake and loaded from a copy of it, as kept in RTC memory, by the next.
+void test_session_resumes_after_save_and_load()
+{
+  StandInTlsServer server;
+  TlsSessionCache cache = newSessionCache();
+  {
+    Device device(cache, server.getFingerprint());
+    TEST_ASSERT_TRUE(device.client.connect("127.0.0.1", server.getPort()));
+    device.exchange("ping\n");
+  }
+
+  TlsSessionCache nextWake;
+  memcpy(&nextWake, &cache, sizeof(cache));
+  beginTlsSessionCache(nextWake);
+  Device device(nextWake, server.getFingerprint());
+  TEST_ASSERT_TRUE(device.client.connect("127.0.0.1", server.getPort()));
+  TEST_ASSERT_TRUE(device.client.isSessionResumed());
+  const std::string answer = device.exchange("ping\n");
+  TEST_ASSERT_EQUAL_STRING("pong\n", answer.c_str());
+  TEST_ASSERT_EQUAL(2, server.getHandshakeCount());
+  TEST_ASSERT_EQUAL(1, server.getResumedCount());
+  TEST_ASSERT_GREATER_THAN(0, nextWake.length);
+}
+
+// A session negotiated with one server is not offered to another, which has to pass the pin check itself.
+void test_session_of_another_server_is_not_offered()
+{
+  StandInTlsServer first;
+  StandInTlsServer second;
+  TlsSessionCache cache = newSessionCache();
+  {
+    Device device(cache, first.getFingerprint());
+    TEST_ASSERT_TRUE(device.client.connect("127.0.0.1", first.getPort()));
+    device.exchange("ping\n");
+  }
+
+  {
+    Device device(cache, first.getFingerprint());
+    TEST_ASSERT_FALSE(device.client.connect("127.0.0.1", second.getPort()));
+    TEST_ASSERT_EQUAL(0, second.getResumedCount());
+  }
+
+  Device device(cache, second.getFingerprint());
+  TEST_ASSERT_TRUE(device.client.connect("127.0.0.1", second.getPort()));
+  TEST_ASSERT_FALSE(device.client.isSessionResumed());
+  TEST_ASSERT_EQUAL(0, second.getResumedCount());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_wrong_pin_is_rejected);
+  RUN_TEST(test_right_pin_is_accepted);
+  RUN_TEST(test_session_resumes_after_save_and_load);
+  RUN_TEST(test_session_of_another_server_is_not_offered);
+  return UNITY_END();
+}
@@ -0,0 +1,185 @@
+// The update schedule kept in RTC memory: parsing the update times, planning sleep from them, and measuring
+// the device clock against the server time.
+
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "update_schedule.h"
+
+void deviceLog(const char *, ...) {}
+
+static const uint64_t millisPerDay = 86400000;
+
+static UpdateSchedule newSchedule()
+{
+  UpdateSchedule schedule;
+  memset(&schedule, 0xA5, sizeof(schedule)); // RTC memory after a power loss
+  beginUpdateSchedule(schedule);
+  return schedule;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_update_times_are_parsed()
+{
+  UpdateSchedule schedule = newSchedule();
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s1;0,3600,86399"));
+  TEST_ASSERT_EQUAL_STRING("s1", schedule.id);
+  TEST_ASSERT_EQUAL(3, schedule.count);
+  TEST_ASSERT_EQUAL(0, schedule.times[0]);
+  TEST_ASSERT_EQUAL(3600, schedule.times[1]);
+  TEST_ASSERT_EQUAL(86399, schedule.times[2]);
+
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s2;"));
+  TEST_ASSERT_EQUAL_STRING("s2", schedule.id);
+  TEST_ASSERT_EQUAL(0, schedule.count);
+}
+
+void test_malformed_update_times_are_forgotten()
+{
+  std::string tooMany = "s1;";
+  for (int i = 0; i <= UpdateSchedule::capacity; ++i)
+  {
+    tooMany += std::to_string(i) + (i < UpdateSchedule::capacity ? "," : "");
+  }
+
+  const char *const malformed[] = {
+      "0,3600",                    // no id
+      ";0,3600",                   // empty id
+      "0123456789abcdefg;0",       // id too long
+      "s1;3600,0",                 // not ascending
+      "s1;3600,3600",              // repeated
+      "s1;86400",                  // past the end of the day
+      "s1;60;120",                 // second separator
+      "s1;60,x",                   // not a number
+      "s1;,60",                    // empty time
+      "s1;-60",                    // negative
+      tooMany.c_str()};
+  for (const char *text : malformed)
+  {
+    UpdateSchedule schedule = newSchedule();
+    TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s0;60"));
+    TEST_ASSERT_FALSE_MESSAGE(setUpdateTimes(schedule, text), text);
+    TEST_ASSERT_EQUAL_STRING("", schedule.id);
+    TEST_ASSERT_EQUAL(0, schedule.count);
+  }
+}
+
+void test_wait_is_empty_without_sync_or_times()
+{
+  UpdateSchedule schedule = newSchedule();
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s1;3600"));
+  TEST_ASSERT_FALSE(getScheduledWaitSeconds(schedule, 0).has_value());
+
+  syncUpdateScheduleTime(schedule, 0, std::nullopt, 0);
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s2;"));
+  TEST_ASSERT_FALSE(getScheduledWaitSeconds(schedule, 0).has_value());
+}
+
+void test_wait_wraps_to_the_first_time_of_the_next_day()
+{
+  UpdateSchedule schedule = newSchedule();
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s1;3600,72000"));
+  syncUpdateScheduleTime(schedule, 80000, 74000, 5000);
+
+  TEST_ASSERT_EQUAL(10000, *getScheduledWaitSeconds(schedule, 5000));
+  TEST_ASSERT_EQUAL(9000, *getScheduledWaitSeconds(schedule, 5000 + 1000 * 1000));
+  // Past midnight, and exactly at an update time, the next one is taken.
+  TEST_ASSERT_EQUAL(68400, *getScheduledWaitSeconds(schedule, 5000 + 10000 * 1000));
+  TEST_ASSERT_EQUAL(1, *getScheduledWaitSeconds(schedule, 5000 + 9999 * 1000));
+}
+
+void test_drift_is_measured_against_the_server_clock()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, 21600, 0);
+  // The device clock runs 1% fast: a server day takes 87264 device seconds.
+  syncUpdateScheduleTime(schedule, 28800, 21600, 87264 * 1000);
+  TEST_ASSERT_TRUE(schedule.isClockRateMeasured);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 86400.0f / 87264, schedule.clockRate);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 3636.0f, getDeviceSleepMicros(schedule, 3600) / 1e6f);
+}
+
+void test_syncs_too_close_together_keep_the_older_reference()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, 21600, 0);
+  syncUpdateScheduleTime(schedule, 29400, 22200, 600 * 1000);
+  TEST_ASSERT_FALSE(schedule.isClockRateMeasured);
+  TEST_ASSERT_EQUAL(28800, schedule.syncSecondsOfDay);
+  TEST_ASSERT_EQUAL_UINT64(0, schedule.syncDeviceMillis);
+}
+
+// A dashboard that updates daily syncs once a day. Spring-forward moves the local time an hour ahead, which over a
+// day looks like a clock rate of 1.042; measured against UTC it is no drift at all.
+void test_daylight_saving_change_is_not_drift()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, 21600, 0);
+  syncUpdateScheduleTime(schedule, 32400, 21600, millisPerDay);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, schedule.clockRate);
+  TEST_ASSERT_EQUAL_UINT64(3600000000ULL, getDeviceSleepMicros(schedule, 3600));
+
+  // Fall-back an hour the other way.
+  syncUpdateScheduleTime(schedule, 28800, 21600, 2 * millisPerDay);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, schedule.clockRate);
+  // The schedule itself is looked up in the new local time.
+  TEST_ASSERT_TRUE(setUpdateTimes(schedule, "s1;30000"));
+  TEST_ASSERT_EQUAL(1200, *getScheduledWaitSeconds(schedule, 2 * millisPerDay));
+}
+
+// Drift across a time change: the local offset of 2736 s is neither drift nor an hour, UTC shows the drift alone.
+void test_drift_across_daylight_saving_change_is_measured_against_utc()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, 21600, 0);
+  syncUpdateScheduleTime(schedule, 32400, 21600, 87264 * 1000);
+  TEST_ASSERT_TRUE(schedule.isClockRateMeasured);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 86400.0f / 87264, schedule.clockRate);
+}
+
+// Servers that only send the local time of day: an offset of about an hour is taken as a time change.
+void test_daylight_saving_change_without_utc_keeps_the_clock_rate()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, std::nullopt, 0);
+  syncUpdateScheduleTime(schedule, 32400, std::nullopt, millisPerDay);
+  TEST_ASSERT_FALSE(schedule.isClockRateMeasured);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, schedule.clockRate);
+  TEST_ASSERT_EQUAL(32400, schedule.syncSecondsOfDay);
+
+  // Real drift is still measured from the local time.
+  syncUpdateScheduleTime(schedule, 32400, std::nullopt, 2 * millisPerDay + 864 * 1000);
+  TEST_ASSERT_TRUE(schedule.isClockRateMeasured);
+  TEST_ASSERT_FLOAT_WITHIN(1e-5f, 86400.0f / 87264, schedule.clockRate);
+}
+
+// A server that starts sending UTC is compared in local time once, then in UTC.
+void test_utc_is_only_compared_with_utc()
+{
+  UpdateSchedule schedule = newSchedule();
+  syncUpdateScheduleTime(schedule, 28800, std::nullopt, 0);
+  syncUpdateScheduleTime(schedule, 28800, 21600, millisPerDay);
+  TEST_ASSERT_TRUE(schedule.hasSyncUtc);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, schedule.clockRate);
+
+  syncUpdateScheduleTime(schedule, 32400, 21600, 2 * millisPerDay);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, schedule.clockRate);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_update_times_are_parsed);
+  RUN_TEST(test_malformed_update_times_are_forgotten);
+  RUN_TEST(test_wait_is_empty_without_sync_or_times);
+  RUN_TEST(test_wait_wraps_to_the_first_time_of_the_next_day);
+  RUN_TEST(test_drift_is_measured_against_the_server_clock);
+  RUN_TEST(test_syncs_too_close_together_keep_the_older_reference);
+  RUN_TEST(test_daylight_saving_change_is_not_drift);
+  RUN_TEST(test_drift_across_daylight_saving_change_is_measured_against_utc);
+  RUN_TEST(test_daylight_saving_change_without_utc_keeps_the_clock_rate);
+  RUN_TEST(test_utc_is_only_compared_with_utc);
+  return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// The ring of wake cycle timings kept in RTC memory and the report sent with the next frame request.
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "wake_timing.h"
+
+void deviceLog(const char *, ...) {}
+
+static const size_t reportCapacity = 800; // the buffer DashboardClient formats the report into
+
+static WakeTimings newWakeTimings()
+{
+  WakeTimings timings;
+  memset(&timings, 0xA5, sizeof(timings)); // RTC memory after a power loss
+  beginWakeCycle(timings);
+  return timings;
+}
+
+// A cycle whose values all start with marker, so that it can be found in the report.
+static void runCycle(WakeTimings &timings, uint32_t marker)
+{
+  beginWakeCycle(timings);
+  for (uint8_t phase = 0; phase < static_cast<uint8_t>(WakePhase::Count); ++phase)
+  {
+    markWakePhase(timings, static_cast<WakePhase>(phase), marker * 10 + phase);
+  }
+  setWakeBandTiming(timings, 3, marker);
+  setWakePanelTiming(timings, 1, marker);
+  endWakeCycle(timings);
+}
+
+static std::string format(const WakeTimings &timings, size_t capacity = reportCapacity)
+{
+  std::string report(capacity, '\0');
+  report.resize(formatPendingWakeTimings(timings, &report[0], capacity));
+  return report;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_garbage_after_power_loss_is_cleared()
+{
+  const WakeTimings timings = newWakeTimings();
+  TEST_ASSERT_EQUAL(0, timings.pendingCount);
+  TEST_ASSERT_EQUAL(0, timings.panelInitMillis);
+  TEST_ASSERT_EQUAL(0, format(timings).size());
+}
+
+void test_only_the_first_mark_of_a_phase_counts()
+{
+  WakeTimings timings = newWakeTimings();
+  markWakePhase(timings, WakePhase::WiFiConnect, 0);
+  markWakePhase(timings, WakePhase::WiFiConnect, 500);
+  markWakePhase(timings, WakePhase::TcpConnect, 700);
+  markWakePhase(timings, WakePhase::TcpConnect, 900);
+  endWakeCycle(timings);
+
+  // A phase ending at 0 ms is reported as 1, since 0 means it was not reached.
+  const std::string report = format(timings);
+  TEST_ASSERT_EQUAL_STRING("0,1,700,0,0,0,0,0,0,0,0", report.c_str());
+}
+
+void test_long_timings_saturate()
+{
+  WakeTimings timings = newWakeTimings();
+  setWakeBandTiming(timings, 6, 70000);
+  setWakePanelTiming(timings, 80000, 90000);
+  endWakeCycle(timings);
+  TEST_ASSERT_EQUAL(UINT16_MAX, timings.panelInitMillis);
+  const std::string report = format(timings);
+  TEST_ASSERT_EQUAL_STRING("0,0,0,0,0,0,0,0,6,65535,65535", report.c_str());
+
+  // A wake that leaves the panel off keeps the last measured init.
+  beginWakeCycle(timings);
+  setWakePanelTiming(timings, 0, 0);
+  TEST_ASSERT_EQUAL(UINT16_MAX, timings.panelInitMillis);
+}
+
+void test_ring_wraps_and_reports_oldest_first()
+{
+  WakeTimings timings = newWakeTimings();
+  for (uint32_t cycle = 1; cycle <= WakeTimings::capacity + 3; ++cycle)
+  {
+    runCycle(timings, cycle);
+  }
+  TEST_ASSERT_EQUAL(WakeTimings::capacity, timings.pendingCount);
+
+  // The three oldest cycles were replaced; the report starts with the fourth.
+  const std::string report = format(timings);
+  TEST_ASSERT_EQUAL(0, report.find("40,41,"));
+  TEST_ASSERT_TRUE(report.find(",3,11,11") != std::string::npos);
+  TEST_ASSERT_TRUE(report.find(",3,3,3") == std::string::npos);
+  TEST_ASSERT_EQUAL(WakeTimings::capacity - 1, std::count(report.begin(), report.end(), ';'));
+
+  clearPendingWakeTimings(timings);
+  TEST_ASSERT_EQUAL(0, format(timings).size());
+  runCycle(timings, 12);
+  TEST_ASSERT_EQUAL(0, format(timings).find("120,121,"));
+}
+
+void test_cycles_that_do_not_fit_are_left_out()
+{
+  WakeTimings timings = newWakeTimings();
+  for (uint32_t cycle = 0; cycle < WakeTimings::capacity; ++cycle)
+  {
+    beginWakeCycle(timings);
+    for (uint8_t phase = 0; phase < static_cast<uint8_t>(WakePhase::Count); ++phase)
+    {
+      markWakePhase(timings, static_cast<WakePhase>(phase), 4000000000U + cycle);
+    }
+    setWakeBandTiming(timings, 65535, 65535);
+    setWakePanelTiming(timings, 65535, 65535);
+    endWakeCycle(timings);
+  }
+
+  // Each cycle takes 105 characters, so seven fit 800 bytes with their separators and the newest is left out.
+  const std::string report = format(timings);
+  TEST_ASSERT_EQUAL(7 * 105 + 6, report.size());
+  TEST_ASSERT_TRUE(report.find("4000000006,") != std::string::npos);
+  TEST_ASSERT_TRUE(report.find("4000000007,") == std::string::npos);
+
+  // A buffer too small for one cycle gives an empty report.
+  TEST_ASSERT_EQUAL(0, format(timings, 105).size());
+  TEST_ASSERT_EQUAL(105, format(timings, 106).size());
+  TEST_ASSERT_EQUAL(0, formatPendingWakeTimings(timings, nullptr, 0));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_garbage_after_power_loss_is_cleared);
+  RUN_TEST(test_only_the_first_mark_of_a_phase_counts);
+  RUN_TEST(test_long_timings_saturate);
+  RUN_TEST(test_ring_wraps_and_reports_oldest_first);
+  RUN_TEST(test_cycles_that_do_not_fit_are_left_out);
+  return UNITY_END();
+}
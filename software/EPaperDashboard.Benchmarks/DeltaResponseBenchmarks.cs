@@ -0,0 +1,88 @@
+using BenchmarkDotNet.Attributes;
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Services.Rendering;
+using EPaperDashboard.Utilities;
+using SixLabors.ImageSharp;
+using SixLabors.ImageSharp.PixelFormats;
+
+namespace EPaperDashboard.Benchmarks;
+
+/// <summary>
+/// Compares writing a delta response from a <see cref="FrameDeltaStream"/> with encoding the whole delta
+/// into a <see cref="MemoryStream"/> first, as the binary endpoint did before.
+/// </summary>
+[MemoryDiagnoser]
+public class DeltaResponseBenchmarks
+{
+	private BlackRedWhitePlanes _frame = null!;
+	private IReadOnlyList<FrameRegion> _regions = null!;
+
+	public static IEnumerable<FramePackingBenchmarks.PanelSize> PanelSizes => FramePackingBenchmarks.PanelSizes;
+
+	[ParamsSource(nameof(PanelSizes))]
+	public FramePackingBenchmarks.PanelSize Panel { get; set; } = null!;
+
+	[Params(FrameEncodings.Rle, FrameEncodings.Planar)]
+	public string Encoding { get; set; } = null!;
+
+	[GlobalSetup]
+	public void Setup()
+	{
+		// The lower half of the dashboard changes between the two frames.
+		var previous = CreateFrame(Panel.Height);
+		_frame = CreateFrame(Panel.Height / 2);
+		_regions = _frame.GetChangedRegions(previous, 160);
+
+		var expected = new MemoryStream();
+		BinaryFrameWriter.WriteDelta(_frame, _regions, Encoding, expected, hasChecksums: true);
+		var actual = new MemoryStream();
+		using var deltaStream = new FrameDeltaStream(_frame, _regions, Encoding, hasChecksums: true);
+		deltaStream.CopyTo(actual);
+		if (!expected.ToArray().SequenceEqual(actual.ToArray()))
+		{
+			throw new InvalidOperationException($"The delta stream differs from the written delta at {Panel}.");
+		}
+	}
+
+	[Benchmark(Baseline = true)]
+	public long WriteToMemoryStream()
+	{
+		var stream = new MemoryStream();
+		BinaryFrameWriter.WriteDelta(_frame, _regions, Encoding, stream, hasChecksums: true);
+		stream.Seek(0, SeekOrigin.Begin);
+		stream.CopyTo(Stream.Null);
+		return stream.Length;
+	}
+
+	[Benchmark]
+	public long ReadDeltaStream()
+	{
+		using var stream = new FrameDeltaStream(_frame, _regions, Encoding, hasChecksums: true);
+		stream.CopyTo(Stream.Null);
+		return stream.Length;
+	}
+
+	private BlackRedWhitePlanes CreateFrame(int changedFromRow)
+	{
+		var random = new Random(Panel.Width);
+		var changedRandom = new Random(Panel.Height);
+		var palette = Palettes.RedBlackWhite.Select(c => c.ToPixel<Rgba32>()).ToArray();
+		using var image = new Image<Rgba32>(Panel.Width, Panel.Height);
+		image.ProcessPixelRows(accessor =>
+		{
+			for (var y = 0; y < accessor.Height; y++)
+			{
+				var rowRandom = y < changedFromRow ? random : changedRandom;
+				var row = accessor.GetRowSpan(y);
+				for (var x = 0; x < row.Length;)
+				{
+					var runLength = Math.Min(rowRandom.Next(1, 64), row.Length - x);
+					row.Slice(x, runLength).Fill(palette[rowRandom.Next(palette.Length)]);
+					x += runLength;
+				}
+			}
+		});
+
+		return BlackRedWhitePlanes.FromImageRows(image);
+	}
+}
@@ -0,0 +1,55 @@
+using System.Diagnostics;
+using EPaperDashboard.Services.Firmware;
+
+namespace EPaperDashboard.Benchmarks;
+
+/// <summary>
+/// Writes the delta between two firmware images as the server does and reports its size and how long it
+/// took. The delta written with <c>--output</c> can be applied with the firmware's patch tool.
+/// </summary>
+/// <example>dotnet run -c Release -- firmware-delta old.bin new.bin [--output delta.bin] [--iterations 5]</example>
+public static class FirmwareDeltaCommand
+{
+	public const string Command = "firmware-delta";
+
+	public static async Task RunAsync(string[] args)
+	{
+		if (args.Length < 2)
+		{
+			Console.Error.WriteLine($"usage: {Command} <running.bin> <new.bin> [--output <delta.bin>] [--iterations <count>]");
+			return;
+		}
+
+		var source = await File.ReadAllBytesAsync(args[0]);
+		var target = await File.ReadAllBytesAsync(args[1]);
+		var iterationCount = int.Parse(GetOption(args, "--iterations") ?? "5");
+
+		// The first delta also compiles the writer, so it is not measured.
+		var delta = FirmwareDeltaWriter.Write(source, target);
+		var durations = new double[iterationCount];
+		for (var iteration = 0; iteration < iterationCount; iteration++)
+		{
+			var start = Stopwatch.GetTimestamp();
+			FirmwareDeltaWriter.Write(source, target);
+			durations[iteration] = Stopwatch.GetElapsedTime(start).TotalMilliseconds;
+		}
+
+		Array.Sort(durations);
+		Console.WriteLine($"{"running",10} {"new",10} {"delta",10} {"ratio",7} {"min ms",8} {"median ms",10}");
+		Console.WriteLine(
+			$"{source.Length,10} {target.Length,10} {delta.Length,10} {100.0 * delta.Length / target.Length,6:F1}% " +
+			$"{durations.FirstOrDefault(),8:F1} {(iterationCount > 0 ? durations[iterationCount / 2] : 0),10:F1}");
+
+		var output = GetOption(args, "--output");
+		if (output is not null)
+		{
+			await File.WriteAllBytesAsync(output, delta);
+		}
+	}
+
+	private static string? GetOption(string[] args, string name)
+	{
+		var index = Array.IndexOf(args, name);
+		return index >= 0 && index + 1 < args.Length ? args[index + 1] : null;
+	}
+}
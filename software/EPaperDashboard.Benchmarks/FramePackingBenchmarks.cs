@@ -0,0 +1,74 @@
+using BenchmarkDotNet.Attributes;
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Utilities;
+using SixLabors.ImageSharp;
+using SixLabors.ImageSharp.PixelFormats;
+using SixLabors.ImageSharp.Processing;
+
+namespace EPaperDashboard.Benchmarks;
+
+/// <summary>
+/// Compares packing a quantized frame row by row with the former rotate-then-pack-columns path of the binary endpoint.
+/// </summary>
+[MemoryDiagnoser]
+public class FramePackingBenchmarks
+{
+	private Image<Rgba32> _image = null!;
+
+	public record PanelSize(int Width, int Height)
+	{
+		public override string ToString() => $"{Width}x{Height}";
+	}
+
+	public static IEnumerable<PanelSize> PanelSizes =>
+	[
+		new(800, 480),
+		new(1304, 984),
+		new(1600, 1200)
+	];
+
+	[ParamsSource(nameof(PanelSizes))]
+	public PanelSize Panel { get; set; } = null!;
+
+	[GlobalSetup]
+	public void Setup()
+	{
+		// Horizontal runs of palette colors, roughly like text and lines on a dashboard.
+		var random = new Random(Panel.Width);
+		var palette = Palettes.RedBlackWhite.Select(c => c.ToPixel<Rgba32>()).ToArray();
+		_image = new Image<Rgba32>(Panel.Width, Panel.Height);
+		_image.ProcessPixelRows(accessor =>
+		{
+			for (var y = 0; y < accessor.Height; y++)
+			{
+				var row = accessor.GetRowSpan(y);
+				for (var x = 0; x < row.Length;)
+				{
+					var runLength = Math.Min(random.Next(1, 64), row.Length - x);
+					row.Slice(x, runLength).Fill(palette[random.Next(palette.Length)]);
+					x += runLength;
+				}
+			}
+		});
+
+		var expected = RotateThenPackColumns();
+		var actual = PackRows();
+		if (!expected.Black.SequenceEqual(actual.Black) || !expected.Red.SequenceEqual(actual.Red))
+		{
+			throw new InvalidOperationException($"Row packing differs from the rotated column packing at {Panel}.");
+		}
+	}
+
+	[GlobalCleanup]
+	public void Cleanup() => _image.Dispose();
+
+	[Benchmark(Baseline = true)]
+	public BlackRedWhitePlanes RotateThenPackColumns()
+	{
+		using var rotated = _image.Clone(x => x.RotateFlip(RotateMode.Rotate90, FlipMode.Horizontal));
+		return BlackRedWhitePlanes.FromImage(rotated);
+	}
+
+	[Benchmark]
+	public BlackRedWhitePlanes PackRows() => BlackRedWhitePlanes.FromImageRows(_image);
+}
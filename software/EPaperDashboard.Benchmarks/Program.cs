@@ -0,0 +1,16 @@
+using BenchmarkDotNet.Running;
+using EPaperDashboard.Benchmarks;
+
+if (args.FirstOrDefault() == RenderLoadTest.Command)
+{
+	await RenderLoadTest.RunAsync(args[1..]);
+	return;
+}
+
+if (args.FirstOrDefault() == FirmwareDeltaCommand.Command)
+{
+	await FirmwareDeltaCommand.RunAsync(args[1..]);
+	return;
+}
+
+BenchmarkSwitcher.FromAssembly(typeof(Program).Assembly).Run(args);
@@ -0,0 +1,152 @@
+using System.Diagnostics;
+using System.Diagnostics.Metrics;
+using EPaperDashboard.Services.Rendering;
+using Microsoft.Extensions.Logging.Abstractions;
+using Microsoft.Playwright;
+
+namespace EPaperDashboard.Benchmarks;
+
+/// <summary>
+/// Sends concurrent render requests to a <see cref="BrowserPool"/>, the way waking devices do,
+/// and reports latency percentiles, throughput and how latency splits into queue wait and render time.
+/// Needs the Playwright Chromium build to be installed.
+/// </summary>
+/// <example>dotnet run -c Release -- render-load --pool 2 --requests 64 --concurrency 1,4,16 [--launch-per-render]</example>
+public static class RenderLoadTest
+{
+	public const string Command = "render-load";
+
+	private const int Width = 800;
+	private const int Height = 480;
+
+	public static async Task RunAsync(string[] args)
+	{
+		var poolSize = int.Parse(GetOption(args, "--pool") ?? "2");
+		var requestCount = int.Parse(GetOption(args, "--requests") ?? "64");
+		var concurrencyLevels = (GetOption(args, "--concurrency") ?? "1,4,16").Split(',').Select(int.Parse).ToArray();
+		var isLaunchPerRender = args.Contains("--launch-per-render");
+
+		Console.WriteLine($"{"mode",-18} {"clients",8} {"requests",9} {"p50 ms",9} {"p99 ms",9} {"req/s",8} {"wait ms",9} {"render ms",10}");
+		foreach (var concurrency in concurrencyLevels)
+		{
+			if (isLaunchPerRender)
+			{
+				await RunLevelAsync("launch-per-render", concurrency, requestCount, RenderWithNewBrowserAsync);
+				continue;
+			}
+
+			await using var pool = new BrowserPool(NullLogger<BrowserPool>.Instance, poolSize, int.MaxValue, TimeSpan.FromHours(1));
+
+			// Every browser is launched before measuring, as the server does at startup.
+			await Task.WhenAll(Enumerable.Range(0, pool.Size).Select(_ => RenderWithPoolAsync(pool)));
+			await RunLevelAsync($"pool of {pool.Size}", concurrency, requestCount, () => RenderWithPoolAsync(pool));
+		}
+	}
+
+	private static async Task RunLevelAsync(string mode, int concurrency, int requestCount, Func<Task> render)
+	{
+		using var metrics = new RenderMetricsListener();
+		var latencies = new double[requestCount];
+		var start = Stopwatch.GetTimestamp();
+		await Parallel.ForEachAsync(
+			Enumerable.Range(0, requestCount),
+			new ParallelOptions { MaxDegreeOfParallelism = concurrency },
+			async (request, _) =>
+			{
+				var requestStart = Stopwatch.GetTimestamp();
+				await render();
+				latencies[request] = Stopwatch.GetElapsedTime(requestStart).TotalMilliseconds;
+			});
+		var elapsed = Stopwatch.GetElapsedTime(start);
+
+		Array.Sort(latencies);
+		Console.WriteLine(
+			$"{mode,-18} {concurrency,8} {requestCount,9} {Percentile(latencies, 50),9:F0} {Percentile(latencies, 99),9:F0} " +
+			$"{requestCount / elapsed.TotalSeconds,8:F1} {metrics.MeanQueueWait,9:F0} {metrics.MeanRenderDuration,10:F0}");
+	}
+
+	private static Task<byte[]> RenderWithPoolAsync(BrowserPool pool) =>
+		pool.RenderPageAsync(Width, Height, RenderPageAsync);
+
+	// The behavior before pooling: a browser is launched and closed for every render.
+	private static async Task RenderWithNewBrowserAsync()
+	{
+		using var playwright = await Playwright.CreateAsync();
+		await using var browser = await playwright.Chromium.LaunchAsync();
+		var page = await browser.NewPageAsync();
+		await page.SetViewportSizeAsync(Width, Height);
+		await RenderPageAsync(page);
+	}
+
+	private static async Task<byte[]> RenderPageAsync(IPage page)
+	{
+		await page.SetContentAsync(DashboardHtml, new PageSetContentOptions { WaitUntil = WaitUntilState.NetworkIdle });
+		return await page.ScreenshotAsync(new PageScreenshotOptions { Type = ScreenshotType.Png });
+	}
+
+	// Nearest-rank percentile of an ascending array.
+	private static double Percentile(double[] sorted, int percentile) =>
+		sorted[Math.Max(0, (int)Math.Ceiling(percentile / 100.0 * sorted.Length) - 1)];
+
+	private static string? GetOption(string[] args, string name)
+	{
+		var index = Array.IndexOf(args, name);
+		return index >= 0 && index + 1 < args.Length ? args[index + 1] : null;
+	}
+
+	private static readonly string DashboardHtml = $"""
+		<html>
+		<body style="margin:0;font-family:sans-serif;width:{Width}px;height:{Height}px">
+			<div style="display:grid;grid-template-columns:repeat(4,1fr);gap:8px;padding:8px">
+				{string.Concat(Enumerable.Range(0, 16).Select(i => $"<div style=\"border:2px solid black;padding:8px\"><h2 style=\"color:{(i % 3 == 0 ? "red" : "black")}\">Sensor {i}</h2><p>{20 + i}.5 &deg;C</p></div>"))}
+			</div>
+		</body>
+		</html>
+		""";
+
+	/// <summary>
+	/// Averages the queue wait and render duration recorded by the pool while it is alive.
+	/// </summary>
+	private sealed class RenderMetricsListener : IDisposable
+	{
+		private readonly MeterListener _listener = new();
+		private double _queueWaitTotal;
+		private long _queueWaitCount;
+		private double _renderDurationTotal;
+		private long _renderDurationCount;
+
+		public RenderMetricsListener()
+		{
+			_listener.InstrumentPublished = (instrument, listener) =>
+			{
+				if (instrument.Meter.Name == BrowserPool.MeterName)
+				{
+					listener.EnableMeasurementEvents(instrument);
+				}
+			};
+			_listener.SetMeasurementEventCallback<double>((instrument, value, _, _) =>
+			{
+				lock (_listener)
+				{
+					if (instrument.Name == "render.queue.wait")
+					{
+						_queueWaitTotal += value;
+						_queueWaitCount++;
+					}
+					else if (instrument.Name == "render.duration")
+					{
+						_renderDurationTotal += value;
+						_renderDurationCount++;
+					}
+				}
+			});
+			_listener.Start();
+		}
+
+		public double MeanQueueWait => _queueWaitCount > 0 ? _queueWaitTotal / _queueWaitCount : 0;
+
+		public double MeanRenderDuration => _renderDurationCount > 0 ? _renderDurationTotal / _renderDurationCount : 0;
+
+		public void Dispose() => _listener.Dispose();
+	}
+}
@@ -17,30 +17,24 @@ public class ConfigurationApiController(DashboardService dashboardService) : Con
     [HttpGet("next-update-wait-seconds")]
     public IActionResult GetNextUpdateWait([FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey)
     {
-        var now = DateTime.Now;
         return _dashboardService
             .GetDashboardByApiKey(apiKey)
-            .Bind(d => GetNextUpdateTime(now, d.UpdateTimes))
+            .Bind(d => _dashboardService.GetNextUpdateWait(d, DateTime.Now))
             .Match(
-                nextUpdate => Content(((long)(nextUpdate - now).TotalSeconds).ToString(), "text/plain", Encoding.UTF8),
+                wait => Content(((long)wait.TotalSeconds).ToString(), "text/plain", Encoding.UTF8),
                 () => (IActionResult)NotFound("No upcoming update times found.")
             );
+    }
 
-        Maybe<DateTime> GetNextUpdateTime(DateTime now, List<TimeOnly>? updateTimes)
-        {
-            if (updateTimes is null || !updateTimes.Any())
-            {
-                return Maybe.None;
-            }
-
-            var today = now.Date;
-            var tomorrow = today.AddDays(1);
-            var times = updateTimes.OrderBy(t => t).ToList();
-            return times
-                .Select(t => today.Add(t.ToTimeSpan()))
-                .Append(tomorrow.Add(times.First().ToTimeSpan()))
-                .Where(dt => dt > now)
-                .TryFirst();
-        }
+    [HttpGet("update-schedule")]
+    public IActionResult GetUpdateSchedule([FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey)
+    {
+        return _dashboardService
+            .GetDashboardByApiKey(apiKey)
+            .Map(_dashboardService.GetUpdateSchedule)
+            .Match(
+                schedule => Content(schedule, "text/plain", Encoding.ASCII),
+                () => (IActionResult)NotFound("Dashboard not found.")
+            );
     }
 }
@@ -3,6 +3,7 @@ using Microsoft.AspNetCore.Authorization;
 using System.Security.Claims;
 using LiteDB;
 using EPaperDashboard.Services;
+using EPaperDashboard.Services.Rendering;
 using EPaperDashboard.Models;
 
 namespace EPaperDashboard.Controllers;
@@ -10,10 +11,13 @@ namespace EPaperDashboard.Controllers;
 [ApiController]
 [Route("api/dashboards")]
 [Authorize]
-public class DashboardApiController(DashboardService dashboardService, UserService userService) : BaseApiController
+public class DashboardApiController(DashboardService dashboardService, UserService userService, WakeTimingService wakeTimingService, PrerenderedFrameStore prerenderedFrameStore, EncodedFrameCache encodedFrameCache) : BaseApiController
 {
     private readonly DashboardService _dashboardService = dashboardService;
     private readonly UserService _userService = userService;
+    private readonly WakeTimingService _wakeTimingService = wakeTimingService;
+    private readonly PrerenderedFrameStore _prerenderedFrameStore = prerenderedFrameStore;
+    private readonly EncodedFrameCache _encodedFrameCache = encodedFrameCache;
 
     [HttpGet]
     public IActionResult GetDashboards()
@@ -67,6 +71,34 @@ public class DashboardApiController(DashboardService dashboardService, UserServi
         return Ok(DashboardResponseDto.FromDashboard(dashboard.Value));
     }
 
+    [HttpGet("{id}/wake-timings")]
+    public IActionResult GetWakeTimings(string id)
+    {
+        ObjectId objectId;
+        try
+        {
+            objectId = new ObjectId(id);
+        }
+        catch
+        {
+            return BadRequest(new { message = "Invalid dashboard ID." });
+        }
+
+        var dashboard = _dashboardService.GetDashboardById(objectId);
+        if (dashboard.HasNoValue)
+        {
+            return NotFound(new { message = "Dashboard not found." });
+        }
+
+        // Verify user owns this dashboard
+        if (dashboard.Value.UserId != CurrentUserId)
+        {
+            return Forbid();
+        }
+
+        return Ok(_wakeTimingService.GetPercentiles(objectId));
+    }
+
     [HttpPost]
     public IActionResult CreateDashboard([FromBody] CreateDashboardRequest request)
     {
@@ -148,6 +180,8 @@ public class DashboardApiController(DashboardService dashboardService, UserServi
         }
 
         _dashboardService.UpdateDashboard(updatedDashboard);
+        _prerenderedFrameStore.RemoveFrames(objectId);
+        _encodedFrameCache.Remove(objectId);
 
         return Ok(DashboardResponseDto.FromDashboard(updatedDashboard));
     }
@@ -178,6 +212,9 @@ public class DashboardApiController(DashboardService dashboardService, UserServi
         }
 
         _dashboardService.DeleteDashboard(new ObjectId(id));
+        _wakeTimingService.DeleteSamples(new ObjectId(id));
+        _prerenderedFrameStore.RemoveFrames(new ObjectId(id));
+        _encodedFrameCache.Remove(new ObjectId(id));
 
         return Ok(new { message = "Dashboard deleted successfully." });
     }
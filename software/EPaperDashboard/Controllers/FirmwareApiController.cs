@@ -0,0 +1,32 @@
+using System.ComponentModel.DataAnnotations;
+using Microsoft.AspNetCore.Mvc;
+using Microsoft.AspNetCore.Authorization;
+using EPaperDashboard.Utilities;
+using EPaperDashboard.Services.Firmware;
+
+namespace EPaperDashboard.Controllers;
+
+[ApiController]
+[Route("api/firmware")]
+[Authorize(Policy = "ApiKeyPolicy")]
+public class FirmwareApiController(FirmwareUpdateService firmwareUpdateService) : ControllerBase
+{
+    private readonly FirmwareUpdateService _firmwareUpdateService = firmwareUpdateService;
+
+    /// <summary>
+    /// The delta from the firmware the device reports running to version <paramref name="to"/>, as
+    /// advertised in the X-Firmware-Update header of the frame response.
+    /// </summary>
+    [HttpGet("delta")]
+    public IActionResult GetDelta(
+        [FromHeader(Name = HttpHeaderNames.FirmwareVersionHeaderName)] string? firmwareVersion,
+        [Required][FromQuery] string to)
+    {
+        return _firmwareUpdateService
+            .GetDelta(firmwareVersion, to)
+            .Match(
+                delta => File(delta, "application/octet-stream"),
+                () => (IActionResult)NotFound("No firmware delta for this device.")
+            );
+    }
+}
@@ -1,8 +1,6 @@
 ﻿using Microsoft.AspNetCore.Mvc;
 using EPaperDashboard.Services.Rendering;
-using SixLabors.ImageSharp.Processing;
 using System.ComponentModel.DataAnnotations;
-using System.Text.Json;
 using EPaperDashboard.Utilities;
 using CSharpFunctionalExtensions;
 using EPaperDashboard.Models.Rendering;
@@ -10,10 +8,12 @@ using SixLabors.ImageSharp.Formats.Bmp;
 using SixLabors.ImageSharp.Formats;
 using SixLabors.ImageSharp.Formats.Jpeg;
 using SixLabors.ImageSharp.Formats.Png;
-using SixLabors.ImageSharp.Processing.Processors.Dithering;
 using Microsoft.AspNetCore.Authorization;
 using EPaperDashboard.Models;
 using EPaperDashboard.Services;
+using EPaperDashboard.Services.Firmware;
+using Microsoft.Net.Http.Headers;
+using System.Security.Cryptography;
 
 namespace EPaperDashboard.Controllers;
 
@@ -23,17 +23,83 @@ namespace EPaperDashboard.Controllers;
 public sealed class RenderToImageController(
 	IPageToImageRenderingService renderingService,
 	DashboardService dashboardService,
-	DashboardHtmlRenderingService dashboardHtmlRenderingService,
+	DashboardImageRenderer dashboardImageRenderer,
+	FrameHistoryService frameHistoryService,
+	PrerenderedFrameStore prerenderedFrameStore,
+	EncodedFrameCache encodedFrameCache,
+	DashboardUpdateRecorder dashboardUpdateRecorder,
+	WakeTimingService wakeTimingService,
+	FirmwareUpdateService firmwareUpdateService,
 	IDeploymentStrategy deploymentStrategy) : ControllerBase
 {
+	private const int DefaultBandHeight = 160;
+	private const string NoScheduledUpdate = "none";
+
+	/// <param name="encoding">Comma-separated encodings the device accepts; the smallest resulting frame is sent.</param>
+	/// <param name="since">Frame id (ETag) shown by the device; enables a delta response with only the changed rows.</param>
+	/// <param name="bandHeight">Largest number of rows the device can write at once; caps the height of delta regions.</param>
+	/// <param name="checksum">"crc32" follows every band or delta region with a checksum of its rows.</param>
+	/// <param name="planes">1 for black and white panels: red is drawn black and only the black plane is sent.</param>
+	/// <param name="wakeTimings">Timings of the device's previous wake cycles, stored for the dashboard's percentiles.</param>
+	/// <param name="firmwareVersion">Firmware build of the device, "profile/version"; a newer build of the profile is advertised in X-Firmware-Update.</param>
+	/// <remarks>The next wake interval is returned in the X-Next-Update-Wait-Seconds header, also on 304 responses,
+	/// so devices do not need a second request before going to sleep. Frames of scheduled dashboards are usually
+	/// rendered shortly before the device wakes up; the dashboard is only rendered on demand when there is no such frame.
+	/// Devices requesting the same frame at about the same time share one render. Range requests with an If-Range
+	/// frame id are served from the same encoded frame, so a device can resume an interrupted download.
+	/// If-None-Match may list several frame ids, e.g. frames the device keeps in flash; the ETag of the 304 response
+	/// tells the device which of them is current.</remarks>
 	[HttpGet("binary")]
 	public async Task<IActionResult> GetAsBinary(
 		[Required][FromQuery] Size imageSize,
 		[FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey,
-		[FromQuery] bool shouldDither = false) =>
-		await RenderImage(apiKey, imageSize, "bin", image => image
-			.Quantize(Palettes.RedBlackWhite, GetDither(shouldDither))
-			.RotateFlip(RotateMode.Rotate90, FlipMode.Horizontal));
+		[FromQuery] bool shouldDither = false,
+		[FromQuery] string encoding = FrameEncodings.Raw,
+		[FromQuery] string? since = null,
+		[FromQuery] int bandHeight = DefaultBandHeight,
+		[FromQuery] string? checksum = null,
+		[FromQuery] int planes = 2,
+		[FromHeader(Name = HttpHeaderNames.WakeTimingsHeaderName)] string? wakeTimings = null,
+		[FromHeader(Name = HttpHeaderNames.FirmwareVersionHeaderName)] string? firmwareVersion = null)
+	{
+		var acceptedEncodings = encoding.Split(',', StringSplitOptions.TrimEntries | StringSplitOptions.RemoveEmptyEntries);
+		var hasChecksums = checksum == FrameEncodings.Crc32Checksum;
+		var hasRed = planes != 1;
+
+		var dashboardResult = dashboardService.GetDashboardByApiKey(apiKey);
+		if (dashboardResult.HasNoValue)
+		{
+			return NotFound("Dashboard not found for this API key");
+		}
+
+		var dashboard = dashboardResult.Value;
+		if (!string.IsNullOrWhiteSpace(wakeTimings))
+		{
+			wakeTimingService.AddSamples(dashboard.Id, wakeTimings);
+		}
+
+		// Remembering the request lets the pre-renderer prepare the same frame before the next wake.
+		var frameRequest = new FrameRequest(dashboard.Id, imageSize, shouldDither);
+		prerenderedFrameStore.RecordRequest(frameRequest, DateTimeOffset.Now);
+
+		bandHeight = Math.Max(1, bandHeight);
+		var frameFormat = $"binary:{string.Join(',', acceptedEncodings)}:{bandHeight}{(hasChecksums ? ":" + FrameEncodings.Crc32Checksum : "")}{(hasRed ? "" : ":bw")}";
+		var frameKey = new EncodedFrameKey(dashboard.Id, imageSize, frameFormat, shouldDither);
+		var frameResult = await encodedFrameCache.GetOrRenderAsync(
+			frameKey,
+			() => RenderBinaryFrame(dashboard, frameRequest, acceptedEncodings, bandHeight, hasChecksums, hasRed));
+		if (frameResult.IsFailure)
+		{
+			return StatusCode(frameResult.Error.StatusCode, frameResult.Error.Message);
+		}
+
+		dashboardUpdateRecorder.RecordUpdate(dashboard.Id, DateTimeOffset.UtcNow);
+		SetNextUpdateWaitHeader(dashboard);
+		firmwareUpdateService
+			.GetUpdateVersion(firmwareVersion)
+			.Execute(version => Response.Headers[HttpHeaderNames.FirmwareUpdateHeaderName] = version);
+		return ConvertToBinaryResult(frameResult.Value, apiKey, since, bandHeight, hasChecksums);
+	}
 
 	[HttpGet("converted")]
 	public async Task<IActionResult> GetAsConvertedsImage(
@@ -41,21 +107,21 @@ public sealed class RenderToImageController(
 		[FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey,
 		[FromQuery] string format = "jpeg",
 		[FromQuery] bool shouldDither = false) =>
-		await RenderImage(apiKey, imageSize, format, image =>
-			image.Quantize(Palettes.RedBlackWhite, GetDither(shouldDither)));
+		await RenderImage(apiKey, imageSize, format, shouldDither, image =>
+			image.Quantize(Palettes.RedBlackWhite, DashboardImageRenderer.GetDither(shouldDither)));
 
 	[HttpGet("original")]
 	public async Task<IActionResult> GetAsImage(
 		[Required][FromQuery] Size imageSize,
 		[FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey,
 		[FromQuery] string format = "jpeg") =>
-		await RenderImage(apiKey, imageSize, format);
+		await RenderImage(apiKey, imageSize, format, shouldDither: false);
 
 	[HttpGet("health")]
 	public async Task<IActionResult> GetHealth([FromHeader(Name = HttpHeaderNames.ApiKeyHeaderName)] string apiKey) =>
 		await dashboardService
 			.GetDashboardByApiKey(apiKey)
-			.Bind(d => GetDashboardUri(d, deploymentStrategy))
+			.Bind(d => DashboardImageRenderer.GetDashboardUri(d, deploymentStrategy))
 			.Match(
 				Some: async (uri, _) => (IActionResult)Ok(await renderingService.GetHealth(uri)),
 				None: _ => Task.FromResult<IActionResult>(NotFound()));
@@ -64,6 +130,7 @@ public sealed class RenderToImageController(
 		string apiKey,
 		Size imageSize,
 		string format,
+		bool shouldDither,
 		Func<IImage, IImage>? transform = null)
 	{
 		var dashboardResult = dashboardService.GetDashboardByApiKey(apiKey);
@@ -73,142 +140,121 @@ public sealed class RenderToImageController(
 		}
 
 		var dashboard = dashboardResult.Value;
-
-		if (dashboard.RenderingMode == RenderingMode.Custom)
+		var frameKey = new EncodedFrameKey(dashboard.Id, imageSize, $"{(transform is null ? "original" : "converted")}:{format}", shouldDither);
+		var frameResult = await encodedFrameCache.GetOrRenderAsync(frameKey, async () =>
 		{
-			return await RenderCustomLayoutImage(dashboard, imageSize, format, transform);
-		}
-		else
+			var imageResult = await dashboardImageRenderer.RenderAsync(dashboard, imageSize);
+			if (imageResult.IsFailure)
+			{
+				return imageResult.Error;
+			}
+
+			return await EncodeImage(transform?.Invoke(imageResult.Value) ?? imageResult.Value, format);
+		});
+		if (frameResult.IsFailure)
 		{
-			return await RenderHomeAssistantImage(dashboard, imageSize, format, transform);
+			return StatusCode(frameResult.Error.StatusCode, frameResult.Error.Message);
 		}
+
+		dashboardUpdateRecorder.RecordUpdate(dashboard.Id, DateTimeOffset.UtcNow);
+
+		// The entity tag lets devices send If-None-Match and receive 304 Not Modified
+		// when the encoded frame is identical to the one they already display.
+		var frame = frameResult.Value;
+		return File(frame.Content, frame.ContentType, lastModified: null, entityTag: new EntityTagHeaderValue($"\"{frame.EntityTag}\""));
 	}
 
-	private async Task<IActionResult> RenderCustomLayoutImage(
-		Dashboard dashboard,
-		Size imageSize,
-		string format,
-		Func<IImage, IImage>? transform = null)
+	private static async Task<EncodedFrame> EncodeImage(IImage image, string format)
 	{
-		if (dashboard.LayoutConfig == null)
-		{
-			return BadRequest("Dashboard has no layout configuration. Open the designer and create a layout first.");
-		}
-
 		var (contentType, encoder) = GetEncoder(format);
+		using var outStream = new MemoryStream();
+		await image.SaveAsync(outStream, encoder);
+		return new EncodedFrame(outStream.ToArray(), contentType, GetEntityTag(outStream));
+	}
 
-		try
+	private async Task<Result<EncodedFrame, RenderFailure>> RenderBinaryFrame(Dashboard dashboard, FrameRequest frameRequest, IReadOnlyCollection<string> acceptedEncodings, int bandHeight, bool hasChecksums, bool hasRed)
+	{
+		var planes = prerenderedFrameStore.GetFrame(frameRequest, DateTimeOffset.Now);
+		if (planes.HasNoValue)
 		{
-			// Serialize LayoutConfig object to JSON with camelCase naming for JavaScript compatibility
-			var serializerOptions = new JsonSerializerOptions
+			var planesResult = await dashboardImageRenderer.RenderFrameAsync(dashboard, frameRequest.ImageSize, frameRequest.ShouldDither);
+			if (planesResult.IsFailure)
 			{
-				PropertyNamingPolicy = JsonNamingPolicy.CamelCase,
-				WriteIndented = false
-			};
-			var layoutConfigJson = System.Text.Json.JsonSerializer.Serialize(dashboard.LayoutConfig, serializerOptions);
-
-			var html = await dashboardHtmlRenderingService.RenderDashboardHtmlAsync(
-				dashboard.Id.ToString(),
-				layoutConfigJson);
-
-			var size = new Size(
-				dashboard.LayoutConfig.Width > 0 ? dashboard.LayoutConfig.Width : imageSize.Width,
-				dashboard.LayoutConfig.Height > 0 ? dashboard.LayoutConfig.Height : imageSize.Height);
-
-			var imageResult = await renderingService.RenderHtmlAsync(html, size);
-			if (imageResult.IsFailure)
-				return StatusCode(500, imageResult.Error);
-
-			var resultImage = transform?.Invoke(imageResult.Value) ?? imageResult.Value;
+				return planesResult.Error;
+			}
 
-			dashboard.LastUpdateTime = DateTimeOffset.UtcNow;
-			dashboardService.UpdateDashboard(dashboard);
-
-			return await ConvertToResult(resultImage, encoder, contentType);
-		}
-		catch (Exception ex)
-		{
-			return StatusCode(500, $"Failed to render dashboard image: {ex.Message}");
+			planes = planesResult.Value;
 		}
-	}
 
-	private async Task<IActionResult> RenderHomeAssistantImage(
-		Dashboard dashboard,
-		Size imageSize,
-		string format,
-		Func<IImage, IImage>? transform = null)
-	{
-		var dashboardInfo = GetDashboardInfo(dashboard, deploymentStrategy);
-		if (dashboardInfo.HasNoValue)
+		// Pre-rendered frames are shared by all panels of a size, so black and white ones are derived from them here.
+		if (!hasRed)
 		{
-			return NotFound("Dashboard configuration incomplete. Ensure Host, Path, and Access Token are set.");
+			planes = planes.Value.ToBlackWhite();
 		}
 
-		var (contentType, encoder) = GetEncoder(format);
-		var authStrategy = new HassAuthStrategy(dashboardInfo.Value.Tokens);
+		var (encoding, content) = BinaryFrameWriter.WriteSmallestFrame(planes.Value, acceptedEncodings, bandHeight, hasChecksums);
+		return new EncodedFrame(content, "application/octet-stream", planes.Value.ComputeFrameId(), encoding, planes.Value);
+	}
 
-		var result = await renderingService
-			.RenderDashboardAsync(dashboardInfo.Value.DashboardUri, imageSize, authStrategy)
-			.Map(image => transform?.Invoke(image) ?? image);
+	private IActionResult ConvertToBinaryResult(EncodedFrame frame, string apiKey, string? since, int bandHeight, bool hasChecksums)
+	{
+		var planes = frame.Planes!;
+		var previousFrame = string.IsNullOrWhiteSpace(since)
+			? Maybe<BlackRedWhitePlanes>.None
+			: frameHistoryService.GetFrame(apiKey, since.Trim('"'));
+		frameHistoryService.AddFrame(apiKey, frame.EntityTag, planes);
 
-		if (result.IsSuccess)
+		Response.Headers[HttpHeaderNames.FrameEncodingHeaderName] = frame.Encoding;
+		if (!planes.HasRed)
 		{
-			dashboard.LastUpdateTime = DateTimeOffset.UtcNow;
-			dashboardService.UpdateDashboard(dashboard);
+			Response.Headers[HttpHeaderNames.FramePlanesHeaderName] = "1";
 		}
-
-		return await result.Match(
-			image => ConvertToResult(image, encoder, contentType),
-			error => Task.FromResult<IActionResult>(BadRequest(error)));
-	}
-
-	private static Maybe<(Uri DashboardUri, HassTokens Tokens)> GetDashboardInfo(Dashboard dashboard, IDeploymentStrategy deploymentStrategy)
-	{
-		var host = dashboard.Host;
-		if (string.IsNullOrWhiteSpace(host) && deploymentStrategy.IsHomeAssistantAddon)
+		if (hasChecksums)
 		{
-			host = Constants.HomeAssistantCoreUrl;
+			Response.Headers[HttpHeaderNames.FrameChecksumHeaderName] = FrameEncodings.Crc32Checksum;
 		}
 
-		if (string.IsNullOrWhiteSpace(dashboard.AccessToken)
-			|| !Uri.TryCreate(host, UriKind.Absolute, out var hostUri)
-			|| !Uri.TryCreate(dashboard.Path, UriKind.Relative, out var pathUri))
+		// The frame id does not depend on encoding or delta, so If-None-Match compares picture content.
+		var entityTag = new EntityTagHeaderValue($"\"{frame.EntityTag}\"");
+		if (previousFrame.HasValue)
 		{
-			return Maybe.None;
-		}
+			// The delta is sized without encoding it; its regions are encoded while the response body is written.
+			var regions = planes.GetChangedRegions(previousFrame.Value, bandHeight);
+			var deltaStream = new FrameDeltaStream(planes, regions, frame.Encoding!, hasChecksums);
 
-		var hassUrl = hostUri.AbsoluteUri.TrimEnd('/');
-		
-		// For OAuth-generated long-lived tokens, ClientId is not used for auth
-		// Use ClientUri if configured, otherwise use the HA host URL as a placeholder
-		var clientId = EnvironmentConfiguration.ClientUri?.AbsoluteUri.TrimEnd('/') ?? hassUrl;
-		
-		return (new Uri(hostUri, pathUri), new HassTokens(dashboard.AccessToken, "Bearer", hassUrl, clientId));
-	}
+			// Heavily changed frames are cheaper to send whole.
+			if (deltaStream.Length < frame.Content.Length)
+			{
+				Response.Headers[HttpHeaderNames.FrameDeltaHeaderName] = since!.Trim('"');
+				// A resumed delta is computed again from the same two frames, so byte ranges refer to the same content.
+				// The result sends the length as Content-Length and disposes the stream, returning its pooled buffer.
+				return File(deltaStream, frame.ContentType, lastModified: null, entityTag: entityTag, enableRangeProcessing: true);
+			}
 
-	private static Maybe<Uri> GetDashboardUri(Dashboard dashboard, IDeploymentStrategy deploymentStrategy)
-	{
-		var host = dashboard.Host;
-		if (string.IsNullOrWhiteSpace(host) && deploymentStrategy.IsHomeAssistantAddon)
-		{
-			host = Constants.HomeAssistantCoreUrl;
+			deltaStream.Dispose();
 		}
 
-		return Uri.TryCreate(host, UriKind.Absolute, out var hostUri) &&
-			Uri.TryCreate(dashboard.Path, UriKind.Relative, out var pathUri)
-			? new Uri(hostUri, pathUri)
-			: Maybe.None;
+		return File(frame.Content, frame.ContentType, lastModified: null, entityTag: entityTag, enableRangeProcessing: true);
 	}
 
-	private static IDither? GetDither(bool shouldDither) =>
-		shouldDither ? KnownDitherings.JarvisJudiceNinke : null;
+	// Computed after rendering, so the interval starts close to the moment the device receives it.
+	// The server time of day keeps the schedule stored on the device in step; the id tells it when to fetch a new one.
+	// The update times are in local time, while the device measures its clock drift against the UTC time of day,
+	// which daylight saving time does not move.
+	private void SetNextUpdateWaitHeader(Dashboard dashboard)
+	{
+		var now = DateTime.Now;
+		Response.Headers[HttpHeaderNames.NextUpdateWaitHeaderName] = dashboardService
+			.GetNextUpdateWait(dashboard, now)
+			.Match(wait => ((long)wait.TotalSeconds).ToString(), () => NoScheduledUpdate);
+		Response.Headers[HttpHeaderNames.UpdateScheduleHeaderName] =
+			$"{(int)now.TimeOfDay.TotalSeconds},{(int)now.ToUniversalTime().TimeOfDay.TotalSeconds};{dashboardService.GetUpdateScheduleId(dashboard)}";
+	}
 
-	private async Task<IActionResult> ConvertToResult(IImage image, IImageEncoder encoder, string contentType)
+	private static string GetEntityTag(MemoryStream stream)
 	{
-		var outStream = new MemoryStream();
-		await image.SaveAsync(outStream, encoder);
-		outStream.Seek(0, SeekOrigin.Begin);
-		return File(outStream, contentType);
+		var hash = SHA256.HashData(stream.GetBuffer().AsSpan(0, (int)stream.Length));
+		return Convert.ToHexString(hash, 0, 8).ToLowerInvariant();
 	}
 
 	private static (string contentType, IImageEncoder encoder) GetEncoder(string format) => format switch
@@ -217,6 +263,7 @@ public sealed class RenderToImageController(
 		"bmp" => ("image/bmp", new BmpEncoder()),
 		"png" => ("image/png", new PngEncoder()),
 		"bin" => ("application/octet-stream", new BlackRedWhiteBinaryEncoder()),
+		"rle" => ("application/octet-stream", new BlackRedWhiteRleEncoder()),
 		_ => throw new NotSupportedException($"Format is not supported: {format}")
 	};
 }
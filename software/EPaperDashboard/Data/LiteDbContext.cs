@@ -20,10 +20,14 @@ public sealed class LiteDbContext
         );
         
         _db = new(Path.Combine(EnvironmentConfiguration.ConfigDir, "epaperdashboard.db"), mapper);
+
+        // Samples are read and trimmed per dashboard on every frame request that reports timings.
+        WakeCycleSamples.EnsureIndex(s => s.DashboardId);
     }
 
     public ILiteCollection<User> Users => _db.GetCollection<User>("users");
     public ILiteCollection<Dashboard> Dashboards => _db.GetCollection<Dashboard>("dashboards");
+    public ILiteCollection<WakeCycleSample> WakeCycleSamples => _db.GetCollection<WakeCycleSample>("wake_cycle_samples");
 
     private static BsonValue JsonElementToBsonValue(SystemTextJson.JsonElement element)
     {
@@ -0,0 +1,237 @@
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Runtime.Intrinsics;
+using System.Security.Cryptography;
+using SixLabors.ImageSharp;
+using SixLabors.ImageSharp.PixelFormats;
+
+namespace EPaperDashboard.Models.Rendering;
+
+/// <summary>
+/// Black and red bit planes of a quantized image in device row order.
+/// A cleared bit marks an inked pixel; the first pixel of a row is the most significant bit of its first byte.
+/// </summary>
+public sealed class BlackRedWhitePlanes
+{
+	private BlackRedWhitePlanes(int rows, int bytesPerRow, bool hasRed = true)
+	{
+		Rows = rows;
+		BytesPerRow = bytesPerRow;
+		HasRed = hasRed;
+		Black = new byte[rows * bytesPerRow];
+		Red = new byte[rows * bytesPerRow];
+	}
+
+	public int Rows { get; }
+
+	/// <summary>
+	/// False for frames of black and white panels, whose red plane is blank and is not sent.
+	/// </summary>
+	public bool HasRed { get; }
+
+	public int BytesPerRow { get; }
+
+	public byte[] Black { get; }
+
+	public byte[] Red { get; }
+
+	public ReadOnlySpan<byte> GetBlackRow(int row) => Black.AsSpan(row * BytesPerRow, BytesPerRow);
+
+	public ReadOnlySpan<byte> GetRedRow(int row) => Red.AsSpan(row * BytesPerRow, BytesPerRow);
+
+	/// <summary>
+	/// Identifies the frame content independently of the encoding it is sent in.
+	/// </summary>
+	public string ComputeFrameId()
+	{
+		using var hash = IncrementalHash.CreateHash(HashAlgorithmName.SHA256);
+		hash.AppendData(Black);
+		hash.AppendData(Red);
+		return Convert.ToHexString(hash.GetCurrentHash(), 0, 8).ToLowerInvariant();
+	}
+
+	/// <summary>
+	/// Returns the planes for a black and white panel, on which red pixels are drawn black.
+	/// </summary>
+	public BlackRedWhitePlanes ToBlackWhite()
+	{
+		var planes = new BlackRedWhitePlanes(Rows, BytesPerRow, hasRed: false);
+		for (var i = 0; i < Black.Length; i++)
+		{
+			planes.Black[i] = (byte)(Black[i] & Red[i]);
+		}
+
+		planes.Red.AsSpan().Fill(0xFF);
+		return planes;
+	}
+
+	/// <summary>
+	/// Returns the row ranges that differ from <paramref name="previous"/>, each at most <paramref name="maxRegionRows"/> high.
+	/// </summary>
+	public IReadOnlyList<FrameRegion> GetChangedRegions(BlackRedWhitePlanes previous, int maxRegionRows)
+	{
+		var isGeometryChanged = previous.Rows != Rows || previous.BytesPerRow != BytesPerRow;
+		var regions = new List<FrameRegion>();
+		var regionStart = -1;
+		for (var row = 0; row <= Rows; row++)
+		{
+			var isChanged = row < Rows
+				&& (isGeometryChanged
+					|| !GetBlackRow(row).SequenceEqual(previous.GetBlackRow(row))
+					|| !GetRedRow(row).SequenceEqual(previous.GetRedRow(row)));
+
+			if (isChanged && regionStart < 0)
+			{
+				regionStart = row;
+			}
+
+			if (regionStart >= 0 && (!isChanged || row - regionStart == maxRegionRows))
+			{
+				regions.Add(new FrameRegion(regionStart, row - regionStart));
+				regionStart = isChanged ? row : -1;
+			}
+		}
+
+		return regions;
+	}
+
+	/// <summary>
+	/// Packs every image row as a device row. Gives the same planes as <see cref="FromImage"/> on the image
+	/// rotated by 90 degrees and flipped horizontally, without the extra passes over the image.
+	/// </summary>
+	public static BlackRedWhitePlanes FromImageRows<TPixel>(Image<TPixel> image)
+		where TPixel : unmanaged, IPixel<TPixel>
+	{
+		if (image.Width % 8 != 0)
+		{
+			throw new ArgumentException("The device row length should be multiple of 8");
+		}
+
+		var planes = new BlackRedWhitePlanes(image.Height, image.Width / 8);
+		var black = Color.Black.ToPixel<TPixel>();
+		var red = Color.Red.ToPixel<TPixel>();
+		image.ProcessPixelRows(accessor =>
+		{
+			for (var y = 0; y < accessor.Height; y++)
+			{
+				var blackRow = planes.Black.AsSpan(y * planes.BytesPerRow, planes.BytesPerRow);
+				var redRow = planes.Red.AsSpan(y * planes.BytesPerRow, planes.BytesPerRow);
+				if (typeof(TPixel) == typeof(Rgba32))
+				{
+					PackRow(
+						MemoryMarshal.Cast<TPixel, uint>(accessor.GetRowSpan(y)),
+						Unsafe.As<TPixel, uint>(ref black),
+						Unsafe.As<TPixel, uint>(ref red),
+						blackRow,
+						redRow);
+				}
+				else
+				{
+					PackRow<TPixel>(accessor.GetRowSpan(y), black, red, blackRow, redRow);
+				}
+			}
+		});
+
+		return planes;
+	}
+
+	public static BlackRedWhitePlanes FromImage<TPixel>(Image<TPixel> image)
+		where TPixel : unmanaged, IPixel<TPixel>
+	{
+		if (image.Height % 8 != 0)
+		{
+			throw new ArgumentException("The device row length should be multiple of 8");
+		}
+
+		var planes = new BlackRedWhitePlanes(image.Width, image.Height / 8);
+		planes.Black.AsSpan().Fill(0xFF);
+		planes.Red.AsSpan().Fill(0xFF);
+
+		var black = Color.Black.ToPixel<TPixel>();
+		var red = Color.Red.ToPixel<TPixel>();
+		for (var x = 0; x < image.Width; x++)
+		{
+			for (var y = 0; y < image.Height; y++)
+			{
+				var index = x * planes.BytesPerRow + y / 8;
+				var resetBits = (byte)~(0x01 << (7 - (y % 8)));
+				var pixel = image[x, y];
+				if (pixel.Equals(black))
+				{
+					planes.Black[index] &= resetBits;
+				}
+				else if (pixel.Equals(red))
+				{
+					planes.Red[index] &= resetBits;
+				}
+			}
+		}
+
+		return planes;
+	}
+
+	// Compares eight pixels per output byte at once. The comparison mask has the leftmost pixel
+	// in its least significant bit, so it is bit-reversed before it becomes the plane byte.
+	private static void PackRow(ReadOnlySpan<uint> pixels, uint black, uint red, Span<byte> blackRow, Span<byte> redRow)
+	{
+		ref var first = ref MemoryMarshal.GetReference(pixels);
+		var index = 0;
+		if (Vector256.IsHardwareAccelerated)
+		{
+			var blackVector = Vector256.Create(black);
+			var redVector = Vector256.Create(red);
+			for (; index < blackRow.Length; index++)
+			{
+				var vector = Vector256.LoadUnsafe(ref first, (nuint)index * 8);
+				blackRow[index] = ToPlaneByte(Vector256.Equals(vector, blackVector).ExtractMostSignificantBits());
+				redRow[index] = ToPlaneByte(Vector256.Equals(vector, redVector).ExtractMostSignificantBits());
+			}
+		}
+		else if (Vector128.IsHardwareAccelerated)
+		{
+			var blackVector = Vector128.Create(black);
+			var redVector = Vector128.Create(red);
+			for (; index < blackRow.Length; index++)
+			{
+				var left = Vector128.LoadUnsafe(ref first, (nuint)index * 8);
+				var right = Vector128.LoadUnsafe(ref first, (nuint)index * 8 + 4);
+				blackRow[index] = ToPlaneByte(Vector128.Equals(left, blackVector).ExtractMostSignificantBits()
+					| Vector128.Equals(right, blackVector).ExtractMostSignificantBits() << 4);
+				redRow[index] = ToPlaneByte(Vector128.Equals(left, redVector).ExtractMostSignificantBits()
+					| Vector128.Equals(right, redVector).ExtractMostSignificantBits() << 4);
+			}
+		}
+
+		PackRow<uint>(pixels[(index * 8)..], black, red, blackRow[index..], redRow[index..]);
+	}
+
+	// Reverses the eight mask bits with multiplications and inverts them, as inked pixels are cleared bits.
+	[MethodImpl(MethodImplOptions.AggressiveInlining)]
+	private static byte ToPlaneByte(uint mask) =>
+		(byte)~((((mask * 0x0802u) & 0x22110u) | ((mask * 0x8020u) & 0x88440u)) * 0x10101u >> 16);
+
+	private static void PackRow<TPixel>(ReadOnlySpan<TPixel> pixels, TPixel black, TPixel red, Span<byte> blackRow, Span<byte> redRow)
+		where TPixel : IEquatable<TPixel>
+	{
+		for (var index = 0; index < blackRow.Length; index++)
+		{
+			byte blackByte = 0xFF;
+			byte redByte = 0xFF;
+			var group = pixels.Slice(index * 8, 8);
+			for (var bit = 0; bit < 8; bit++)
+			{
+				if (group[bit].Equals(black))
+				{
+					blackByte &= (byte)~(0x80 >> bit);
+				}
+				else if (group[bit].Equals(red))
+				{
+					redByte &= (byte)~(0x80 >> bit);
+				}
+			}
+
+			blackRow[index] = blackByte;
+			redRow[index] = redByte;
+		}
+	}
+}
@@ -0,0 +1,6 @@
+namespace EPaperDashboard.Models.Rendering;
+
+/// <summary>
+/// A range of device rows sent as one block of a delta frame.
+/// </summary>
+public readonly record struct FrameRegion(int Row, int RowCount);
@@ -16,4 +16,9 @@ public interface IImage
     Task SaveJpegAsync(Stream outStream);
 
     Task SaveAsync(Stream outStream, IImageEncoder encoder);
+
+    /// <summary>
+    /// Packs the quantized image with every image row becoming a device row.
+    /// </summary>
+    BlackRedWhitePlanes ToBlackRedWhitePlanes();
 }
@@ -41,6 +41,8 @@ where TPixel : unmanaged, IPixel<TPixel>
     public async Task SaveAsync(Stream outStream, IImageEncoder encoder) => await _image.SaveAsync(outStream, encoder);
 
     public async Task SaveJpegAsync(Stream outStream) => await _image.SaveAsJpegAsync(outStream);
+
+    public BlackRedWhitePlanes ToBlackRedWhitePlanes() => BlackRedWhitePlanes.FromImageRows(_image);
 }
 
 
@@ -0,0 +1,38 @@
+using LiteDB;
+
+namespace EPaperDashboard.Models
+{
+    /// <summary>
+    /// Phases of a device wake cycle, in the order the firmware reports them.
+    /// </summary>
+    public enum WakePhase
+    {
+        DisplayInit = 0,
+        WiFiConnect = 1,
+        TcpConnect = 2,
+        HeadersReceived = 3,
+        FirstBodyByte = 4,
+        BandsWritten = 5,
+        Refresh = 6,
+        SleepEntry = 7
+    }
+
+    /// <summary>
+    /// Timing of one wake cycle as reported by a device. Phase values are milliseconds since boot
+    /// at which the phase ended, indexed by <see cref="WakePhase"/>; 0 when the phase was not reached.
+    /// </summary>
+    public class WakeCycleSample
+    {
+        [BsonId]
+        public ObjectId Id { get; set; } = ObjectId.Empty;
+        public ObjectId DashboardId { get; set; } = ObjectId.Empty;
+        public DateTimeOffset ReceivedAt { get; set; }
+        public int[] PhaseEndMilliseconds { get; set; } = [];
+        public int BandCount { get; set; }
+        public int BandWriteMilliseconds { get; set; }
+        /// <summary>
+        /// Time from the start of the panel init until it was powered off; 0 when the cycle left the panel off.
+        /// </summary>
+        public int PanelOnMilliseconds { get; set; }
+    }
+}
@@ -1,4 +1,5 @@
 using EPaperDashboard.Services.Rendering;
+using EPaperDashboard.Services.Firmware;
 using EPaperDashboard.Utilities;
 using EPaperDashboard.Data;
 using Microsoft.AspNetCore.Authentication.Cookies;
@@ -88,11 +89,24 @@ builder.Services
 	.AddSingleton<LiteDbContext>()
 	.AddSingleton<UserService>()
 	.AddSingleton<DashboardService>()
+	.AddSingleton<WakeTimingService>()
+	.AddSingleton<FirmwareUpdateService>()
 	.AddSingleton<HomeAssistantAuthService>()
+	.AddSingleton<HomeAssistantSessionPool>()
 	.AddSingleton<HomeAssistantService>()
 	.AddSingleton<DashboardHtmlRenderingService>()
-	.AddHostedService<DashboardScheduleMonitorService>();
-
+	.AddSingleton<FrameHistoryService>()
+	.AddSingleton<DashboardImageRenderer>()
+	.AddSingleton<PrerenderedFrameStore>()
+	.AddSingleton<EncodedFrameCache>()
+	.AddSingleton<DashboardUpdateRecorder>()
+	.AddHostedService(provider => provider.GetRequiredService<DashboardUpdateRecorder>())
+	.AddSingleton<BrowserPool>()
+	.AddHostedService(provider => provider.GetRequiredService<BrowserPool>())
+	.AddHostedService<DashboardScheduleMonitorService>()
+	.AddHostedService<FramePrerenderService>();
+
+builder.Services.AddMemoryCache();
 builder.Services.AddHttpClient(Constants.DashboardHttpClientName);
 builder.Services.AddHttpClient(Constants.HassHttpClientName);
 
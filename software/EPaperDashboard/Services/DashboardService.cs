@@ -2,6 +2,8 @@ using CSharpFunctionalExtensions;
 using EPaperDashboard.Data;
 using EPaperDashboard.Models;
 using LiteDB;
+using System.Security.Cryptography;
+using System.Text;
 
 namespace EPaperDashboard.Services;
 
@@ -18,6 +20,18 @@ public sealed class DashboardService(LiteDbContext dbContext)
     public void UpdateDashboard(Dashboard dashboard) => _dbContext
         .Dashboards.Update(dashboard);
 
+    /// <summary>
+    /// Sets only the last update time, on the stored dashboard, so that edits made meanwhile are kept.
+    /// </summary>
+    public void SetLastUpdateTime(ObjectId dashboardId, DateTimeOffset lastUpdateTime) => _dbContext
+        .Dashboards.FindById(dashboardId)
+        .AsMaybe()
+        .Execute(dashboard =>
+        {
+            dashboard.LastUpdateTime = lastUpdateTime;
+            _dbContext.Dashboards.Update(dashboard);
+        });
+
     public void DeleteDashboard(ObjectId dashboardId) => _dbContext
         .Dashboards.Delete(dashboardId);
 
@@ -29,4 +43,43 @@ public sealed class DashboardService(LiteDbContext dbContext)
 
     public IEnumerable<Dashboard> GetAllDashboards() => _dbContext
         .Dashboards.FindAll();
+
+    public Maybe<TimeSpan> GetNextUpdateWait(Dashboard dashboard, DateTime now)
+    {
+        if (dashboard.UpdateTimes is null || dashboard.UpdateTimes.Count == 0)
+        {
+            return Maybe.None;
+        }
+
+        var today = now.Date;
+        var tomorrow = today.AddDays(1);
+        var times = dashboard.UpdateTimes.OrderBy(t => t).ToList();
+        return times
+            .Select(t => today.Add(t.ToTimeSpan()))
+            .Append(tomorrow.Add(times.First().ToTimeSpan()))
+            .Where(dt => dt > now)
+            .TryFirst()
+            .Map(nextUpdate => nextUpdate - now);
+    }
+
+    /// <summary>
+    /// Update times as "&lt;id&gt;;&lt;seconds after local midnight&gt;,..." in ascending order. Devices keep the
+    /// schedule to plan their sleep when the server cannot be reached and fetch it again when the id changes.
+    /// </summary>
+    public string GetUpdateSchedule(Dashboard dashboard)
+    {
+        var times = FormatUpdateTimes(dashboard);
+        return $"{GetUpdateScheduleId(times)};{times}";
+    }
+
+    public string GetUpdateScheduleId(Dashboard dashboard) => GetUpdateScheduleId(FormatUpdateTimes(dashboard));
+
+    private static string FormatUpdateTimes(Dashboard dashboard) => string.Join(',', (dashboard.UpdateTimes ?? [])
+        .Select(t => (int)t.ToTimeSpan().TotalSeconds)
+        .Distinct()
+        .Order());
+
+    private static string GetUpdateScheduleId(string times) => Convert
+        .ToHexString(SHA256.HashData(Encoding.ASCII.GetBytes(times)), 0, 4)
+        .ToLowerInvariant();
 }
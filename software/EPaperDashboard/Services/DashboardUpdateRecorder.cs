@@ -0,0 +1,64 @@
+using System.Collections.Concurrent;
+using LiteDB;
+
+namespace EPaperDashboard.Services;
+
+/// <summary>
+/// Records when dashboards were last delivered to a device without writing to the database on the request path.
+/// Deliveries are collected in memory and written once per dashboard per flush, so a burst of devices
+/// on the same dashboard costs a single write.
+/// </summary>
+public class DashboardUpdateRecorder : BackgroundService
+{
+    private static readonly TimeSpan FlushInterval = TimeSpan.FromSeconds(2);
+
+    private readonly ILogger<DashboardUpdateRecorder> _logger;
+    private readonly DashboardService _dashboardService;
+    private readonly ConcurrentDictionary<ObjectId, DateTimeOffset> _pendingUpdates = new();
+
+    public DashboardUpdateRecorder(
+        ILogger<DashboardUpdateRecorder> logger,
+        DashboardService dashboardService)
+    {
+        _logger = logger;
+        _dashboardService = dashboardService;
+    }
+
+    public void RecordUpdate(ObjectId dashboardId, DateTimeOffset updateTime) =>
+        _pendingUpdates.AddOrUpdate(dashboardId, updateTime, (_, pending) => pending > updateTime ? pending : updateTime);
+
+    public override async Task StopAsync(CancellationToken cancellationToken)
+    {
+        await base.StopAsync(cancellationToken);
+        Flush();
+    }
+
+    protected override async Task ExecuteAsync(CancellationToken stoppingToken)
+    {
+        using var timer = new PeriodicTimer(FlushInterval);
+        while (await timer.WaitForNextTickAsync(stoppingToken))
+        {
+            Flush();
+        }
+    }
+
+    private void Flush()
+    {
+        foreach (var dashboardId in _pendingUpdates.Keys)
+        {
+            if (!_pendingUpdates.TryRemove(dashboardId, out var updateTime))
+            {
+                continue;
+            }
+
+            try
+            {
+                _dashboardService.SetLastUpdateTime(dashboardId, updateTime);
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error recording the last update of dashboard {DashboardId}", dashboardId);
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+using System.Buffers.Binary;
+using System.Security.Cryptography;
+
+namespace EPaperDashboard.Services.Firmware;
+
+/// <summary>
+/// Writes firmware deltas in the format the device applies while downloading (see firmware_patch.h):
+/// a header with the size and SHA-256 of the running and of the new image, followed by instructions that
+/// copy from the running image, insert literal bytes, replace bytes or move the source cursor.
+/// </summary>
+/// <remarks>
+/// A new build moves code around and changes the addresses in it, so most of the new image is found in
+/// the old one either where the previous match ended or elsewhere. Matches are found through an index of
+/// the old image, and short changes between two matches become replacements that need no cursor move.
+/// </remarks>
+public static class FirmwareDeltaWriter
+{
+	public const int HeaderLength = 4 + 2 * (sizeof(uint) + SHA256.HashSizeInBytes);
+
+	private const byte CopyOp = 0;
+	private const byte InsertOp = 1;
+	private const byte ReplaceOp = 2;
+	private const byte SeekOp = 3;
+
+	// Bytes of the new image looked up in the index of the old one.
+	private const int KeyLength = sizeof(ulong);
+
+	// A match elsewhere costs a cursor move, so it has to be longer than one continuing the last match.
+	private const int RelocatedMatchLength = 16;
+	private const int ContinuedMatchLength = 6;
+
+	private static ReadOnlySpan<byte> Magic => "IZD1"u8;
+
+	public static byte[] Write(byte[] source, byte[] target)
+	{
+		var stream = new MemoryStream();
+		Write(source, target, stream);
+		return stream.ToArray();
+	}
+
+	public static void Write(ReadOnlySpan<byte> source, ReadOnlySpan<byte> target, Stream stream)
+	{
+		WriteHeader(source, target, stream);
+		var index = IndexSource(source);
+		var cursor = 0;
+		var literalStart = 0;
+		var position = 0;
+		while (position < target.Length)
+		{
+			var (matchStart, matchLength) = FindMatch(source, target, index, position, cursor + position - literalStart);
+			if (matchLength == 0)
+			{
+				position++;
+				continue;
+			}
+
+			var literalLength = position - literalStart;
+			if (literalLength > 0)
+			{
+				// Literal bytes that took the place of as many old ones leave the cursor at the next match.
+				var isReplacement = matchStart == cursor + literalLength;
+				WriteOp(isReplacement ? ReplaceOp : InsertOp, (ulong)literalLength, stream);
+				stream.Write(target[literalStart..position]);
+				if (isReplacement)
+				{
+					cursor += literalLength;
+				}
+			}
+
+			if (matchStart != cursor)
+			{
+				var offset = (long)matchStart - cursor;
+				WriteOp(SeekOp, (ulong)((offset << 1) ^ (offset >> 63)), stream);
+			}
+
+			WriteOp(CopyOp, (ulong)matchLength, stream);
+			cursor = matchStart + matchLength;
+			position += matchLength;
+			literalStart = position;
+		}
+
+		if (position > literalStart)
+		{
+			WriteOp(InsertOp, (ulong)(position - literalStart), stream);
+			stream.Write(target[literalStart..position]);
+		}
+	}
+
+	private static void WriteHeader(ReadOnlySpan<byte> source, ReadOnlySpan<byte> target, Stream stream)
+	{
+		Span<byte> header = stackalloc byte[HeaderLength];
+		Magic.CopyTo(header);
+		var field = header[Magic.Length..];
+		BinaryPrimitives.WriteUInt32LittleEndian(field, (uint)source.Length);
+		SHA256.HashData(source, field[sizeof(uint)..]);
+		field = field[(sizeof(uint) + SHA256.HashSizeInBytes)..];
+		BinaryPrimitives.WriteUInt32LittleEndian(field, (uint)target.Length);
+		SHA256.HashData(target, field[sizeof(uint)..]);
+		stream.Write(header);
+	}
+
+	// The first position of every key in the old image; repeated keys are mostly padding and tables.
+	private static Dictionary<ulong, int> IndexSource(ReadOnlySpan<byte> source)
+	{
+		var index = new Dictionary<ulong, int>(Math.Max(0, source.Length - KeyLength + 1));
+		for (var position = 0; position + KeyLength <= source.Length; position++)
+		{
+			index.TryAdd(BinaryPrimitives.ReadUInt64LittleEndian(source[position..]), position);
+		}
+
+		return index;
+	}
+
+	private static (int Start, int Length) FindMatch(
+		ReadOnlySpan<byte> source,
+		ReadOnlySpan<byte> target,
+		Dictionary<ulong, int> index,
+		int position,
+		int continuation)
+	{
+		var match = (Start: 0, Length: 0);
+		if (continuation < source.Length)
+		{
+			var length = source[continuation..].CommonPrefixLength(target[position..]);
+			if (length >= ContinuedMatchLength)
+			{
+				match = (continuation, length);
+			}
+		}
+
+		if (position + KeyLength <= target.Length
+			&& index.TryGetValue(BinaryPrimitives.ReadUInt64LittleEndian(target[position..]), out var candidate))
+		{
+			var length = source[candidate..].CommonPrefixLength(target[position..]);
+			if (length >= RelocatedMatchLength && length > match.Length)
+			{
+				match = (candidate, length);
+			}
+		}
+
+		return match;
+	}
+
+	private static void WriteOp(byte op, ulong operand, Stream stream)
+	{
+		stream.WriteByte(op);
+		do
+		{
+			var next = operand >> 7;
+			stream.WriteByte((byte)((operand & 0x7F) | (next != 0 ? 0x80UL : 0)));
+			operand = next;
+		}
+		while (operand != 0);
+	}
+}
@@ -0,0 +1,170 @@
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Text.RegularExpressions;
+using CSharpFunctionalExtensions;
+using EPaperDashboard.Utilities;
+
+namespace EPaperDashboard.Services.Firmware;
+
+/// <summary>
+/// A firmware build as devices report it: the panel profile it was compiled for and its version,
+/// e.g. <c>Gdew075z08/0.1.0</c>.
+/// </summary>
+public sealed record FirmwareBuild(string Profile, Version Version)
+{
+	private static readonly Regex ProfilePattern = new("^[A-Za-z0-9_-]{1,32}$", RegexOptions.Compiled);
+
+	public static Maybe<FirmwareBuild> Parse(string? build)
+	{
+		var separator = build?.IndexOf('/') ?? -1;
+		if (separator < 0)
+		{
+			return Maybe<FirmwareBuild>.None;
+		}
+
+		var profile = build![..separator];
+		return ProfilePattern.IsMatch(profile) && Version.TryParse(build[(separator + 1)..], out var version)
+			? new FirmwareBuild(profile, version)
+			: Maybe<FirmwareBuild>.None;
+	}
+
+	public override string ToString() => $"{Profile}/{Version}";
+}
+
+/// <summary>
+/// Offers devices the newest firmware built for their panel profile, as a delta against the image they run.
+/// Images are kept as built, as <c>&lt;profile&gt;/&lt;version&gt;.bin</c> in the firmware directory, and an
+/// update is only offered when the image the device runs is there too. Concurrent requests for a pair of
+/// images wait for a single delta, which is then kept in memory for a while, so a fleet waking after a release
+/// shares it. The kept deltas are bounded in bytes and the ones closest to expiry are evicted first.
+/// </summary>
+public sealed class FirmwareUpdateService(ILogger<FirmwareUpdateService> logger)
+{
+	private const string ImageExtension = ".bin";
+
+	private readonly ILogger<FirmwareUpdateService> _logger = logger;
+	private readonly string _firmwareDir = EnvironmentConfiguration.FirmwareDir;
+	private readonly TimeSpan _ttl = EnvironmentConfiguration.FirmwareDeltaCacheTtl;
+	private readonly long _maxBytes = EnvironmentConfiguration.FirmwareDeltaCacheMaxBytes;
+	private readonly ConcurrentDictionary<string, Lazy<byte[]>> _inFlight = new();
+	private readonly ConcurrentDictionary<string, (byte[] Delta, DateTimeOffset ExpiresAt)> _deltas = new();
+	private readonly object _storeLock = new();
+
+	private long _totalBytes;
+
+	/// <summary>
+	/// The version to update <paramref name="build"/> to, if a newer image of its profile is available.
+	/// </summary>
+	public Maybe<string> GetUpdateVersion(string? build) =>
+		FirmwareBuild.Parse(build)
+			.Bind(running => GetLatestVersion(running.Profile)
+				.Where(latest => latest > running.Version && File.Exists(GetImagePath(running)))
+				.Map(latest => latest.ToString()));
+
+	/// <summary>
+	/// The delta from the image <paramref name="build"/> runs to version <paramref name="toVersion"/> of the same profile.
+	/// </summary>
+	public Maybe<byte[]> GetDelta(string? build, string toVersion)
+	{
+		if (FirmwareBuild.Parse(build).TryGetValue(out var running) is false
+			|| Version.TryParse(toVersion, out var version) is false
+			|| version <= running.Version)
+		{
+			return Maybe<byte[]>.None;
+		}
+
+		var target = running with { Version = version };
+		var sourceFile = new FileInfo(GetImagePath(running));
+		var targetFile = new FileInfo(GetImagePath(target));
+		if (!sourceFile.Exists || !targetFile.Exists)
+		{
+			return Maybe<byte[]>.None;
+		}
+
+		// A replaced image gets a new write time and so a new delta.
+		var key = $"{running}>{version}@{sourceFile.LastWriteTimeUtc.Ticks}:{targetFile.LastWriteTimeUtc.Ticks}";
+		if (_deltas.TryGetValue(key, out var entry) && DateTimeOffset.UtcNow < entry.ExpiresAt)
+		{
+			return entry.Delta;
+		}
+
+		var flight = _inFlight.GetOrAdd(key, _ => new Lazy<byte[]>(() => WriteDelta(running, target, sourceFile, targetFile)));
+		try
+		{
+			var delta = flight.Value;
+			Store(key, delta);
+			return delta;
+		}
+		finally
+		{
+			_inFlight.TryRemove(KeyValuePair.Create(key, flight));
+		}
+	}
+
+	private byte[] WriteDelta(FirmwareBuild running, FirmwareBuild target, FileInfo sourceFile, FileInfo targetFile)
+	{
+		var start = Stopwatch.GetTimestamp();
+		var delta = FirmwareDeltaWriter.Write(File.ReadAllBytes(sourceFile.FullName), File.ReadAllBytes(targetFile.FullName));
+		_logger.LogInformation(
+			"Firmware delta {From} to {To}: {DeltaBytes} bytes for a {ImageBytes} byte image, written in {ElapsedMs:F0} ms",
+			running, target.Version, delta.Length, targetFile.Length, Stopwatch.GetElapsedTime(start).TotalMilliseconds);
+		return delta;
+	}
+
+	private void Store(string key, byte[] delta)
+	{
+		if (_ttl <= TimeSpan.Zero || delta.Length > _maxBytes)
+		{
+			return;
+		}
+
+		lock (_storeLock)
+		{
+			var now = DateTimeOffset.UtcNow;
+			if (_deltas.TryGetValue(key, out var entry) && now < entry.ExpiresAt)
+			{
+				return;
+			}
+
+			RemoveEntry(key);
+			foreach (var (expiredKey, _) in _deltas.Where(e => e.Value.ExpiresAt <= now))
+			{
+				RemoveEntry(expiredKey);
+			}
+
+			while (_totalBytes + delta.Length > _maxBytes && !_deltas.IsEmpty)
+			{
+				RemoveEntry(_deltas.MinBy(e => e.Value.ExpiresAt).Key);
+			}
+
+			_deltas[key] = (delta, now + _ttl);
+			_totalBytes += delta.Length;
+		}
+	}
+
+	private void RemoveEntry(string key)
+	{
+		if (_deltas.TryRemove(key, out var entry))
+		{
+			_totalBytes -= entry.Delta.Length;
+		}
+	}
+
+	private Maybe<Version> GetLatestVersion(string profile)
+	{
+		var directory = Path.Combine(_firmwareDir, profile);
+		if (!Directory.Exists(directory))
+		{
+			return Maybe<Version>.None;
+		}
+
+		return Maybe.From(Directory
+			.EnumerateFiles(directory, "*" + ImageExtension)
+			.Select(path => Version.TryParse(Path.GetFileNameWithoutExtension(path), out var version) ? version : null)
+			.OfType<Version>()
+			.Max());
+	}
+
+	private string GetImagePath(FirmwareBuild build) =>
+		Path.Combine(_firmwareDir, build.Profile, build.Version + ImageExtension);
+}
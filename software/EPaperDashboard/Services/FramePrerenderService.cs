@@ -0,0 +1,109 @@
+using System.Diagnostics;
+using EPaperDashboard.Models;
+using EPaperDashboard.Services.Rendering;
+using EPaperDashboard.Utilities;
+
+namespace EPaperDashboard.Services;
+
+/// <summary>
+/// Renders the frames of scheduled dashboards shortly before their devices wake up, so that the
+/// binary endpoint can answer from a ready frame instead of keeping the device awake during the render.
+/// </summary>
+public class FramePrerenderService : BackgroundService
+{
+    private static readonly TimeSpan CheckInterval = TimeSpan.FromSeconds(10);
+
+    // Device clocks drift during deep sleep, so a frame stays valid for a while after the scheduled wake.
+    private static readonly TimeSpan ValidityAfterWake = TimeSpan.FromMinutes(5);
+
+    private readonly ILogger<FramePrerenderService> _logger;
+    private readonly DashboardService _dashboardService;
+    private readonly DashboardImageRenderer _renderer;
+    private readonly PrerenderedFrameStore _frameStore;
+    private readonly TimeSpan _lead;
+
+    public FramePrerenderService(
+        ILogger<FramePrerenderService> logger,
+        DashboardService dashboardService,
+        DashboardImageRenderer renderer,
+        PrerenderedFrameStore frameStore)
+    {
+        _logger = logger;
+        _dashboardService = dashboardService;
+        _renderer = renderer;
+        _frameStore = frameStore;
+        _lead = EnvironmentConfiguration.FramePrerenderLead;
+    }
+
+    protected override async Task ExecuteAsync(CancellationToken stoppingToken)
+    {
+        if (_lead <= TimeSpan.Zero)
+        {
+            _logger.LogInformation("Frame pre-rendering is disabled");
+            return;
+        }
+
+        _logger.LogInformation("Frame Prerender Service started with a lead of {Lead}", _lead);
+
+        while (!stoppingToken.IsCancellationRequested)
+        {
+            try
+            {
+                await PrerenderDueFrames();
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error pre-rendering scheduled frames");
+            }
+
+            await Task.Delay(CheckInterval, stoppingToken);
+        }
+    }
+
+    private async Task PrerenderDueFrames()
+    {
+        var now = DateTimeOffset.Now;
+        var renders = new List<Task>();
+        foreach (var request in _frameStore.GetRecentRequests(now))
+        {
+            var dashboard = _dashboardService.GetDashboardById(request.DashboardId);
+            if (dashboard.HasNoValue)
+            {
+                continue;
+            }
+
+            // Same schedule computation as the wait sent to the device.
+            var wait = _dashboardService.GetNextUpdateWait(dashboard.Value, now.DateTime);
+            if (wait.HasNoValue || wait.Value > _lead)
+            {
+                continue;
+            }
+
+            var validUntil = now + wait.Value + ValidityAfterWake;
+            if (_frameStore.HasFrameValidUntil(request, validUntil))
+            {
+                continue;
+            }
+
+            renders.Add(PrerenderFrame(request, dashboard.Value, validUntil));
+        }
+
+        await Task.WhenAll(renders);
+    }
+
+    private async Task PrerenderFrame(FrameRequest request, Dashboard dashboard, DateTimeOffset validUntil)
+    {
+        var renderStart = Stopwatch.GetTimestamp();
+        var result = await _renderer.RenderFrameAsync(dashboard, request.ImageSize, request.ShouldDither);
+        if (result.IsFailure)
+        {
+            _logger.LogWarning("Failed to pre-render dashboard {DashboardName} (ID: {DashboardId}): {Error}",
+                dashboard.Name, dashboard.Id, result.Error.Message);
+            return;
+        }
+
+        _frameStore.AddFrame(request, result.Value, validUntil);
+        _logger.LogInformation("Pre-rendered dashboard {DashboardName} (ID: {DashboardId}) in {RenderMilliseconds:F0} ms, valid until {ValidUntil}",
+            dashboard.Name, dashboard.Id, Stopwatch.GetElapsedTime(renderStart).TotalMilliseconds, validUntil);
+    }
+}
@@ -5,17 +5,22 @@ using System.Text;
 using LiteDB;
 using CSharpFunctionalExtensions;
 using EPaperDashboard.Models;
+using EPaperDashboard.Utilities;
 
 namespace EPaperDashboard.Services;
 
 public class HomeAssistantService(
     ILogger<HomeAssistantService> logger,
     DashboardService dashboardService,
-    IDeploymentStrategy deploymentStrategy)
+    IDeploymentStrategy deploymentStrategy,
+    HomeAssistantSessionPool sessionPool,
+    IHttpClientFactory httpClientFactory)
 {
     private readonly ILogger<HomeAssistantService> _logger = logger;
     private readonly DashboardService _dashboardService = dashboardService;
     private readonly IDeploymentStrategy _deploymentStrategy = deploymentStrategy;
+    private readonly HomeAssistantSessionPool _sessionPool = sessionPool;
+    private readonly IHttpClientFactory _httpClientFactory = httpClientFactory;
     private int _messageId = 2;
 
     private (string host, string token) GetHostAndToken(Dashboard dashboard)
@@ -176,12 +181,10 @@ public class HomeAssistantService(
 
         try
         {
-            using var ws = await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, token);
+            var session = await _sessionPool.GetSessionAsync(hostUrl, token);
 
-            var messageId = _messageId++;
-            await SendMessageAsync(ws, new
+            var response = await session.SendCommandAsync(new
             {
-                id = messageId,
                 type = "call_service",
                 domain = "todo",
                 service = "get_items",
@@ -192,7 +195,6 @@ public class HomeAssistantService(
                 return_response = true
             });
 
-            var response = await ReceiveMessageAsync(ws);
             _logger.LogDebug("HomeAssistant FetchTodoItems raw response: {Response}", response);
 
             var json = System.Text.Json.JsonSerializer.Deserialize<JsonElement>(response);
@@ -259,7 +261,6 @@ public class HomeAssistantService(
                 _logger.LogWarning("Todo items fetch returned unsuccessful response or missing result property. Response was: {Response}", response);
             }
 
-            await ws.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", CancellationToken.None);
             return items;
         }
         catch (WebSocketException)
@@ -300,15 +301,13 @@ public class HomeAssistantService(
 
         try
         {
-            using var ws = await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, token);
+            var session = await _sessionPool.GetSessionAsync(hostUrl, token);
 
-            var messageId = _messageId++;
             var now = DateTime.UtcNow;
             var endTime = now.AddHours(durationHours);
             
-            await SendMessageAsync(ws, new
+            var response = await session.SendCommandAsync(new
             {
-                id = messageId,
                 type = "call_service",
                 domain = "calendar",
                 service = "get_events",
@@ -324,7 +323,6 @@ public class HomeAssistantService(
                 return_response = true
             });
 
-            var response = await ReceiveMessageAsync(ws);
             _logger.LogDebug("HomeAssistant FetchCalendarEvents raw response: {Response}", response);
 
             var json = System.Text.Json.JsonSerializer.Deserialize<JsonElement>(response);
@@ -397,7 +395,6 @@ public class HomeAssistantService(
                 _logger.LogWarning("Calendar events fetch returned unsuccessful response. Response was: {Response}", response);
             }
 
-            await ws.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", CancellationToken.None);
             return events;
         }
         catch (WebSocketException)
@@ -439,13 +436,10 @@ public class HomeAssistantService(
 
         try
         {
-            using var ws = await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, token);
+            var session = await _sessionPool.GetSessionAsync(hostUrl, token);
 
-            var messageId = _messageId++;
-            
-            await SendMessageAsync(ws, new
+            var response = await session.SendCommandAsync(new
             {
-                id = messageId,
                 type = "call_service",
                 domain = "weather",
                 service = "get_forecasts",
@@ -460,7 +454,6 @@ public class HomeAssistantService(
                 return_response = true
             });
 
-            var response = await ReceiveMessageAsync(ws);
             _logger.LogDebug("HomeAssistant FetchWeatherForecast raw response: {Response}", response);
 
             var json = System.Text.Json.JsonSerializer.Deserialize<JsonElement>(response);
@@ -538,7 +531,6 @@ public class HomeAssistantService(
                 _logger.LogWarning("Weather forecast fetch returned unsuccessful response. Response was: {Response}", response);
             }
 
-            await ws.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", CancellationToken.None);
             return forecastData;
         }
         catch (WebSocketException)
@@ -578,16 +570,13 @@ public class HomeAssistantService(
 
         try
         {
-            using var ws = await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, token);
+            var session = await _sessionPool.GetSessionAsync(hostUrl, token);
 
-            var messageId = _messageId++;
-            await SendMessageAsync(ws, new
+            var response = await session.SendCommandAsync(new
             {
-                id = messageId,
                 type = "get_states"
             });
 
-            var response = await ReceiveMessageAsync(ws);
             _logger.LogDebug("HomeAssistant FetchRssFeedEntries raw response: {Response}", response);
 
             var json = System.Text.Json.JsonSerializer.Deserialize<JsonElement>(response);
@@ -639,7 +628,6 @@ public class HomeAssistantService(
                 _logger.LogWarning("RSS feed entries fetch returned unsuccessful response or missing result property");
             }
 
-            await ws.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", CancellationToken.None);
             return entries;
         }
         catch (WebSocketException)
@@ -850,15 +838,13 @@ public class HomeAssistantService(
 
         try
         {
-            using var ws = await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, token);
+            var session = await _sessionPool.GetSessionAsync(hostUrl, token);
 
-            await SendMessageAsync(ws, new
+            var statesResponse = await session.SendCommandAsync(new
             {
-                id = 1,
                 type = "get_states"
             });
 
-            var statesResponse = await ReceiveMessageAsync(ws);
             var statesResult = System.Text.Json.JsonSerializer.Deserialize<JsonElement>(statesResponse);
 
             var entityStates = new List<HassEntityState>();
@@ -894,7 +880,6 @@ public class HomeAssistantService(
                 }
             }
 
-            await ws.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", CancellationToken.None);
 
             return entityStates;
         }
@@ -937,7 +922,7 @@ public class HomeAssistantService(
 
         try
         {
-            using (var httpClient = new HttpClient())
+            using (var httpClient = _httpClientFactory.CreateClient(Constants.HassHttpClientName))
             {
                 // Set authorization header
                 httpClient.DefaultRequestHeaders.Add("Authorization", $"Bearer {dashboard.AccessToken}");
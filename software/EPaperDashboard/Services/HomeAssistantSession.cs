@@ -0,0 +1,161 @@
+using System.Collections.Concurrent;
+using System.Net.WebSockets;
+using System.Text;
+using System.Text.Json;
+
+namespace EPaperDashboard.Services;
+
+/// <summary>
+/// An authenticated Home Assistant WebSocket connection that carries several commands at once.
+/// Each command gets its own message id and responses are matched back by id, so the commands of a render
+/// run concurrently instead of each opening, authenticating and closing a connection.
+/// </summary>
+public sealed class HomeAssistantSession : IAsyncDisposable
+{
+    private static readonly TimeSpan CommandTimeout = TimeSpan.FromSeconds(30);
+
+    private readonly ClientWebSocket _webSocket;
+    private readonly SemaphoreSlim _sendLock = new(1, 1);
+    private readonly ConcurrentDictionary<int, TaskCompletionSource<string>> _pendingCommands = new();
+    private readonly CancellationTokenSource _receiveCancellation = new();
+    private readonly Task _receiveLoop;
+    private int _lastMessageId;
+    private long _lastUsedTicks = DateTimeOffset.UtcNow.UtcTicks;
+
+    private HomeAssistantSession(ClientWebSocket webSocket)
+    {
+        _webSocket = webSocket;
+        _receiveLoop = Task.Run(ReceiveLoopAsync);
+    }
+
+    public bool IsOpen => _webSocket.State == WebSocketState.Open && !_receiveLoop.IsCompleted;
+
+    public DateTimeOffset LastUsed => new(Interlocked.Read(ref _lastUsedTicks), TimeSpan.Zero);
+
+    public static async Task<HomeAssistantSession> ConnectAsync(string hostUrl, string accessToken) =>
+        new(await WebSocketHelpers.ConnectAndAuthenticateAsync(hostUrl, accessToken));
+
+    /// <summary>
+    /// Sends a command without an id and returns the raw result message for it.
+    /// </summary>
+    public async Task<string> SendCommandAsync(object command)
+    {
+        Interlocked.Exchange(ref _lastUsedTicks, DateTimeOffset.UtcNow.UtcTicks);
+
+        var message = JsonSerializer.SerializeToNode(command)!.AsObject();
+        var response = new TaskCompletionSource<string>(TaskCreationOptions.RunContinuationsAsynchronously);
+        var messageId = 0;
+
+        await _sendLock.WaitAsync();
+        try
+        {
+            // Home Assistant rejects ids that are not larger than the previous one, so they are assigned in send order.
+            messageId = ++_lastMessageId;
+            message["id"] = messageId;
+            _pendingCommands[messageId] = response;
+
+            if (_receiveLoop.IsCompleted)
+            {
+                throw new WebSocketException("The Home Assistant connection is closed.");
+            }
+
+            await _webSocket.SendAsync(Encoding.UTF8.GetBytes(message.ToJsonString()), WebSocketMessageType.Text, true, CancellationToken.None);
+        }
+        catch
+        {
+            _pendingCommands.TryRemove(messageId, out _);
+            throw;
+        }
+        finally
+        {
+            _sendLock.Release();
+        }
+
+        try
+        {
+            return await response.Task.WaitAsync(CommandTimeout);
+        }
+        finally
+        {
+            _pendingCommands.TryRemove(messageId, out _);
+        }
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        try
+        {
+            using var timeout = new CancellationTokenSource(TimeSpan.FromSeconds(5));
+            if (_webSocket.State == WebSocketState.Open)
+            {
+                await _webSocket.CloseAsync(WebSocketCloseStatus.NormalClosure, "Done", timeout.Token);
+            }
+        }
+        catch
+        {
+            // The connection may already be gone.
+        }
+
+        _receiveCancellation.Cancel();
+        await _receiveLoop;
+        _webSocket.Dispose();
+        _receiveCancellation.Dispose();
+    }
+
+    private async Task ReceiveLoopAsync()
+    {
+        var buffer = new byte[1024 * 16];
+        using var message = new MemoryStream();
+        Exception? failure = null;
+
+        try
+        {
+            while (_webSocket.State == WebSocketState.Open)
+            {
+                var result = await _webSocket.ReceiveAsync(new ArraySegment<byte>(buffer), _receiveCancellation.Token);
+                if (result.MessageType == WebSocketMessageType.Close)
+                {
+                    break;
+                }
+
+                // Results such as get_states span many frames.
+                message.Write(buffer, 0, result.Count);
+                if (!result.EndOfMessage)
+                {
+                    continue;
+                }
+
+                Dispatch(Encoding.UTF8.GetString(message.GetBuffer(), 0, (int)message.Length));
+                message.SetLength(0);
+            }
+        }
+        catch (Exception ex)
+        {
+            failure = ex;
+        }
+
+        var closed = failure as WebSocketException ?? new WebSocketException("The Home Assistant connection was closed.", failure);
+        foreach (var (_, pending) in _pendingCommands)
+        {
+            pending.TrySetException(closed);
+        }
+    }
+
+    private void Dispatch(string message)
+    {
+        try
+        {
+            using var json = JsonDocument.Parse(message);
+            if (json.RootElement.TryGetProperty("id", out var id)
+                && id.TryGetInt32(out var messageId)
+                && _pendingCommands.TryRemove(messageId, out var pending))
+            {
+                pending.TrySetResult(message);
+            }
+        }
+        catch (JsonException)
+        {
+            // Messages that are not JSON cannot belong to a command.
+        }
+    }
+}
@@ -0,0 +1,99 @@
+using System.Collections.Concurrent;
+
+namespace EPaperDashboard.Services;
+
+/// <summary>
+/// Keeps Home Assistant sessions open across renders, one per host and access token, so that a render
+/// does not pay for a WebSocket handshake and authentication. Dropped connections, e.g. after a
+/// Home Assistant restart, are replaced on next use and unused sessions are closed after a while.
+/// </summary>
+public sealed class HomeAssistantSessionPool(ILogger<HomeAssistantSessionPool> logger) : IAsyncDisposable
+{
+    private static readonly TimeSpan IdleTimeout = TimeSpan.FromMinutes(10);
+
+    private readonly ILogger<HomeAssistantSessionPool> _logger = logger;
+    private readonly ConcurrentDictionary<(string HostUrl, string AccessToken), Lazy<Task<HomeAssistantSession>>> _sessions = new();
+
+    public async Task<HomeAssistantSession> GetSessionAsync(string hostUrl, string accessToken)
+    {
+        CloseIdleSessions();
+
+        var session = await GetOrConnectAsync(hostUrl, accessToken);
+        if (session.IsOpen)
+        {
+            return session;
+        }
+
+        _logger.LogInformation("Reconnecting closed Home Assistant session to {HostUrl}", hostUrl);
+        return await GetOrConnectAsync(hostUrl, accessToken);
+    }
+
+    public async ValueTask DisposeAsync()
+    {
+        foreach (var key in _sessions.Keys)
+        {
+            if (_sessions.TryRemove(key, out var connecting))
+            {
+                await CloseAsync(connecting);
+            }
+        }
+    }
+
+    private async Task<HomeAssistantSession> GetOrConnectAsync(string hostUrl, string accessToken)
+    {
+        var key = (hostUrl, accessToken);
+        var connecting = _sessions.GetOrAdd(key, _ => new Lazy<Task<HomeAssistantSession>>(() =>
+            HomeAssistantSession.ConnectAsync(hostUrl, accessToken)));
+
+        HomeAssistantSession session;
+        try
+        {
+            session = await connecting.Value;
+        }
+        catch
+        {
+            // Failed connections are not kept, so the next render tries again.
+            _sessions.TryRemove(KeyValuePair.Create(key, connecting));
+            throw;
+        }
+
+        if (!session.IsOpen && _sessions.TryRemove(KeyValuePair.Create(key, connecting)))
+        {
+            _ = CloseAsync(connecting);
+        }
+
+        return session;
+    }
+
+    private void CloseIdleSessions()
+    {
+        var idleSince = DateTimeOffset.UtcNow - IdleTimeout;
+        foreach (var (key, connecting) in _sessions)
+        {
+            if (connecting.IsValueCreated
+                && connecting.Value.IsCompletedSuccessfully
+                && connecting.Value.Result.LastUsed < idleSince
+                && _sessions.TryRemove(KeyValuePair.Create(key, connecting)))
+            {
+                _ = CloseAsync(connecting);
+            }
+        }
+    }
+
+    private async Task CloseAsync(Lazy<Task<HomeAssistantSession>> connecting)
+    {
+        if (!connecting.IsValueCreated)
+        {
+            return;
+        }
+
+        try
+        {
+            await (await connecting.Value).DisposeAsync();
+        }
+        catch (Exception ex)
+        {
+            _logger.LogDebug(ex, "Failed to close a Home Assistant session");
+        }
+    }
+}
@@ -1,3 +1,4 @@
+using System.Buffers;
 using SixLabors.ImageSharp;
 using SixLabors.ImageSharp.Formats;
 
@@ -5,6 +6,8 @@ namespace EPaperDashboard.Services.Rendering;
 
 public sealed class BlackRedWhiteBinaryEncoder : ImageEncoder
 {
+	private const int WriteBlockBytes = 4096;
+
 	protected override void Encode<TPixel>(Image<TPixel> image, Stream stream, CancellationToken cancellationToken)
 	{
 		var imagePixelCount = image.Width * image.Height;
@@ -13,31 +16,52 @@ public sealed class BlackRedWhiteBinaryEncoder : ImageEncoder
 			throw new ArgumentException("The number of image pixels should be multiple of 8");
 		}
 
-		byte blackByte = 0xFF;
-		byte redByte = 0xFF;
-		
-		for (var currentPixel = 0; currentPixel < imagePixelCount;)
+		// Pixels are taken column by column; a byte may continue into the next column.
+		// Byte pairs are collected in a pooled buffer and written in blocks rather than byte by byte.
+		var black = Color.Black.ToPixel<TPixel>();
+		var red = Color.Red.ToPixel<TPixel>();
+		var buffer = ArrayPool<byte>.Shared.Rent(WriteBlockBytes);
+		try
 		{
-			for (var bitCount = 0; bitCount < 8 && currentPixel < imagePixelCount; bitCount++, currentPixel++)
+			var length = 0;
+			byte blackByte = 0xFF;
+			byte redByte = 0xFF;
+			var bit = 0;
+			for (var x = 0; x < image.Width; x++)
 			{
-				var x = currentPixel / image.Height;
-				var y = currentPixel % image.Height;
-				var resetBits = (byte)~(0x01 << (7 - (currentPixel % 8)));
-				if (image[x, y].Equals(Color.Black.ToPixel<TPixel>()))
+				for (var y = 0; y < image.Height; y++)
 				{
-					blackByte &= resetBits;
-				}
+					var pixel = image[x, y];
+					if (pixel.Equals(black))
+					{
+						blackByte &= (byte)~(0x80 >> bit);
+					}
+					else if (pixel.Equals(red))
+					{
+						redByte &= (byte)~(0x80 >> bit);
+					}
 
-				if (image[x, y].Equals(Color.Red.ToPixel<TPixel>()))
-				{
-					redByte &= resetBits;
+					if (++bit == 8)
+					{
+						buffer[length++] = blackByte;
+						buffer[length++] = redByte;
+						blackByte = 0xFF;
+						redByte = 0xFF;
+						bit = 0;
+						if (length == WriteBlockBytes)
+						{
+							stream.Write(buffer, 0, length);
+							length = 0;
+						}
+					}
 				}
 			}
 
-			stream.WriteByte(blackByte);
-			stream.WriteByte(redByte);
-			blackByte = 0xFF;
-			redByte = 0xFF;
+			stream.Write(buffer, 0, length);
+		}
+		finally
+		{
+			ArrayPool<byte>.Shared.Return(buffer);
 		}
 	}
 }
\ No newline at end of file
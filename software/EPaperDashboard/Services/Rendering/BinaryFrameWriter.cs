@@ -0,0 +1,193 @@
+using System.Buffers.Binary;
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Utilities;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Writes black and red planes in the binary formats understood by the firmware.
+/// Frames without a red plane (<see cref="BlackRedWhitePlanes.HasRed"/>) are written with the black plane only.
+/// </summary>
+public static class BinaryFrameWriter
+{
+	internal const int DeltaHeaderLength = sizeof(ushort);
+	internal const int RegionHeaderLength = 2 * sizeof(ushort);
+
+	/// <summary>
+	/// Writes the whole frame with the accepted encoding that gives the smallest result, sizing every encoding
+	/// first so that only the chosen one is written, straight into an array of its exact length.
+	/// Falls back to <see cref="FrameEncodings.Raw"/> when none of the negotiable encodings is accepted.
+	/// </summary>
+	public static (string Encoding, byte[] Content) WriteSmallestFrame(
+		BlackRedWhitePlanes planes,
+		IReadOnlyCollection<string> acceptedEncodings,
+		int bandHeight,
+		bool hasChecksums = false)
+	{
+		(string Encoding, long Length)? smallest = null;
+		foreach (var encoding in FrameEncodings.Negotiable.Where(acceptedEncodings.Contains))
+		{
+			var length = GetFrameLength(planes, bandHeight, encoding, hasChecksums);
+			if (smallest is null || length < smallest.Value.Length)
+			{
+				smallest = (encoding, length);
+			}
+		}
+
+		var (smallestEncoding, frameLength) = smallest
+			?? (FrameEncodings.Raw, GetFrameLength(planes, bandHeight, FrameEncodings.Raw, hasChecksums));
+		var content = new byte[frameLength];
+		WriteFrame(planes, bandHeight, smallestEncoding, new MemoryStream(content), hasChecksums);
+		return (smallestEncoding, content);
+	}
+
+	/// <summary>
+	/// Returns the number of bytes <see cref="WriteFrame"/> writes, without encoding the frame.
+	/// </summary>
+	public static long GetFrameLength(BlackRedWhitePlanes planes, int bandHeight, string encoding, bool hasChecksums = false)
+	{
+		var length = 0L;
+		for (var row = 0; row < planes.Rows; row += bandHeight)
+		{
+			length += GetBandLength(planes, row, Math.Min(bandHeight, planes.Rows - row), encoding, hasChecksums);
+		}
+
+		return length;
+	}
+
+	/// <summary>
+	/// Returns the number of bytes a band or delta region of the given rows takes, including its checksum.
+	/// </summary>
+	public static int GetBandLength(BlackRedWhitePlanes planes, int firstRow, int rowCount, string encoding, bool hasChecksums)
+	{
+		var checksumLength = hasChecksums ? sizeof(uint) : 0;
+		if (encoding != FrameEncodings.Rle)
+		{
+			return rowCount * planes.BytesPerRow * (planes.HasRed ? 2 : 1) + checksumLength;
+		}
+
+		var length = checksumLength;
+		for (var row = firstRow; row < firstRow + rowCount; row++)
+		{
+			length += PackBits.GetEncodedLength(planes.GetBlackRow(row));
+			if (planes.HasRed)
+			{
+				length += PackBits.GetEncodedLength(planes.GetRedRow(row));
+			}
+		}
+
+		return length;
+	}
+
+	/// <param name="hasChecksums">Follows every band with the CRC-32 of its decoded black and red rows,
+	/// so the device can verify each band before writing it and resume an interrupted download after the last good one.</param>
+	public static void WriteFrame(BlackRedWhitePlanes planes, int bandHeight, string encoding, Stream stream, bool hasChecksums = false)
+	{
+		for (var row = 0; row < planes.Rows; row += bandHeight)
+		{
+			WriteBand(planes, row, Math.Min(bandHeight, planes.Rows - row), encoding, stream, hasChecksums);
+		}
+	}
+
+	public static void WriteRows(BlackRedWhitePlanes planes, int firstRow, int rowCount, string encoding, Stream stream)
+	{
+		if (encoding == FrameEncodings.Planar)
+		{
+			stream.Write(planes.Black.AsSpan(firstRow * planes.BytesPerRow, rowCount * planes.BytesPerRow));
+			if (planes.HasRed)
+			{
+				stream.Write(planes.Red.AsSpan(firstRow * planes.BytesPerRow, rowCount * planes.BytesPerRow));
+			}
+
+			return;
+		}
+
+		// A single plane is written like raw or RLE rows without the red ones.
+		if (!planes.HasRed)
+		{
+			for (var row = firstRow; row < firstRow + rowCount; row++)
+			{
+				if (encoding == FrameEncodings.Rle)
+				{
+					PackBits.Encode(planes.GetBlackRow(row), stream);
+				}
+				else
+				{
+					stream.Write(planes.GetBlackRow(row));
+				}
+			}
+
+			return;
+		}
+
+		Span<byte> interleaved = stackalloc byte[planes.BytesPerRow * 2];
+		for (var row = firstRow; row < firstRow + rowCount; row++)
+		{
+			var black = planes.GetBlackRow(row);
+			var red = planes.GetRedRow(row);
+			if (encoding == FrameEncodings.Rle)
+			{
+				PackBits.Encode(black, stream);
+				PackBits.Encode(red, stream);
+				continue;
+			}
+
+			for (var i = 0; i < black.Length; i++)
+			{
+				interleaved[2 * i] = black[i];
+				interleaved[2 * i + 1] = red[i];
+			}
+
+			stream.Write(interleaved);
+		}
+	}
+
+	/// <summary>
+	/// Writes the region count followed by each region's first row, row count and rows,
+	/// all as little-endian 16-bit values, so the device can place every region on its own.
+	/// With checksums, every region is followed by a checksum like a band of a whole frame.
+	/// </summary>
+	public static void WriteDelta(BlackRedWhitePlanes planes, IReadOnlyList<FrameRegion> regions, string encoding, Stream stream, bool hasChecksums = false)
+	{
+		WriteDeltaHeader(regions.Count, stream);
+		foreach (var region in regions)
+		{
+			WriteRegion(planes, region, encoding, stream, hasChecksums);
+		}
+	}
+
+	internal static void WriteDeltaHeader(int regionCount, Stream stream)
+	{
+		Span<byte> header = stackalloc byte[DeltaHeaderLength];
+		BinaryPrimitives.WriteUInt16LittleEndian(header, (ushort)regionCount);
+		stream.Write(header);
+	}
+
+	internal static void WriteRegion(BlackRedWhitePlanes planes, FrameRegion region, string encoding, Stream stream, bool hasChecksums)
+	{
+		Span<byte> header = stackalloc byte[RegionHeaderLength];
+		BinaryPrimitives.WriteUInt16LittleEndian(header, (ushort)region.Row);
+		BinaryPrimitives.WriteUInt16LittleEndian(header[2..], (ushort)region.RowCount);
+		stream.Write(header);
+		WriteBand(planes, region.Row, region.RowCount, encoding, stream, hasChecksums);
+	}
+
+	private static void WriteBand(BlackRedWhitePlanes planes, int firstRow, int rowCount, string encoding, Stream stream, bool hasChecksums)
+	{
+		WriteRows(planes, firstRow, rowCount, encoding, stream);
+		if (!hasChecksums)
+		{
+			return;
+		}
+
+		// The checksum covers the decoded planes rather than the encoded bytes, so it also catches decoding errors.
+		var checksum = Crc32.Update(0, planes.Black.AsSpan(firstRow * planes.BytesPerRow, rowCount * planes.BytesPerRow));
+		if (planes.HasRed)
+		{
+			checksum = Crc32.Update(checksum, planes.Red.AsSpan(firstRow * planes.BytesPerRow, rowCount * planes.BytesPerRow));
+		}
+		Span<byte> trailer = stackalloc byte[4];
+		BinaryPrimitives.WriteUInt32LittleEndian(trailer, checksum);
+		stream.Write(trailer);
+	}
+}
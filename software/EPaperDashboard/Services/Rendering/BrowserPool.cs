@@ -0,0 +1,340 @@
+using System.Diagnostics;
+using System.Diagnostics.Metrics;
+using System.Threading.Channels;
+using EPaperDashboard.Utilities;
+using Microsoft.Playwright;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Keeps a bounded number of Chromium instances running so that renders do not pay for a browser launch.
+/// A render leases a browser exclusively; when every browser is busy, requests queue up to a limit and
+/// are rejected beyond it. Browsers are relaunched after a number of renders or a maximum age to cap
+/// memory growth, and whenever they are found disconnected.
+/// </summary>
+public sealed class BrowserPool : IHostedService, IAsyncDisposable
+{
+	public const string MeterName = "EPaperDashboard.Rendering";
+
+	private const int RendersPerBrowser = 200;
+	private static readonly TimeSpan QueueTimeout = TimeSpan.FromSeconds(60);
+
+	private readonly ILogger<BrowserPool> _logger;
+	private readonly Channel<BrowserSlot> _idleSlots;
+	private readonly BrowserSlot[] _slots;
+	private readonly int _queueLimit;
+	private readonly TimeSpan _maxBrowserAge;
+	private readonly SemaphoreSlim _playwrightLock = new(1, 1);
+	private readonly Meter _meter = new(MeterName);
+	private readonly Histogram<double> _queueWait;
+	private readonly Histogram<double> _renderDuration;
+	private readonly Counter<long> _rejectedRenders;
+
+	private IPlaywright? _playwright;
+	private int _queuedRenders;
+	private int _consecutiveLaunchFailures;
+
+	public BrowserPool(ILogger<BrowserPool> logger)
+		: this(logger, EnvironmentConfiguration.RenderBrowserPoolSize, EnvironmentConfiguration.RenderQueueLimit, EnvironmentConfiguration.RenderBrowserMaxAge)
+	{
+	}
+
+	public BrowserPool(ILogger<BrowserPool> logger, int size, int queueLimit, TimeSpan maxBrowserAge)
+	{
+		_logger = logger;
+		_queueLimit = Math.Max(0, queueLimit);
+		_maxBrowserAge = maxBrowserAge;
+		_slots = Enumerable.Range(0, Math.Max(1, size)).Select(_ => new BrowserSlot()).ToArray();
+		_idleSlots = Channel.CreateUnbounded<BrowserSlot>();
+		foreach (var slot in _slots)
+		{
+			_idleSlots.Writer.TryWrite(slot);
+		}
+
+		_queueWait = _meter.CreateHistogram<double>("render.queue.wait", "ms", "Time a render waited for a free browser");
+		_renderDuration = _meter.CreateHistogram<double>("render.duration", "ms", "Time a render held a browser");
+		_rejectedRenders = _meter.CreateCounter<long>("render.rejected", description: "Renders rejected because the queue was full");
+		_meter.CreateObservableGauge("render.queue.length", () => Volatile.Read(ref _queuedRenders), description: "Renders waiting for a free browser");
+	}
+
+	public int Size => _slots.Length;
+
+	/// <summary>
+	/// False while browsers fail to launch, e.g. because Chromium is not installed.
+	/// </summary>
+	public bool IsAvailable => Volatile.Read(ref _consecutiveLaunchFailures) == 0;
+
+	/// <summary>
+	/// Runs <paramref name="render"/> with exclusive use of a pooled browser. The render should create
+	/// its own context and close it, so that cookies and storage do not leak between dashboards.
+	/// </summary>
+	public Task<T> RenderAsync<T>(Func<IBrowser, Task<T>> render, CancellationToken cancellationToken = default) =>
+		LeaseAsync(slot => render(slot.Browser!), cancellationToken);
+
+	/// <summary>
+	/// Runs <paramref name="render"/> on the browser's reusable page, resized to the requested viewport.
+	/// Only for content that needs no authorization; the page is replaced if a render fails.
+	/// </summary>
+	public Task<T> RenderPageAsync<T>(int width, int height, Func<IPage, Task<T>> render, CancellationToken cancellationToken = default) =>
+		LeaseAsync(async slot =>
+		{
+			if (slot.Page is null || slot.Page.IsClosed)
+			{
+				slot.Page = await slot.Browser!.NewPageAsync();
+			}
+
+			try
+			{
+				await slot.Page.SetViewportSizeAsync(width, height);
+				return await render(slot.Page);
+			}
+			catch
+			{
+				await ClosePageAsync(slot);
+				throw;
+			}
+		}, cancellationToken);
+
+	public Task StartAsync(CancellationToken cancellationToken)
+	{
+		// Launching happens in the background so that a missing browser does not block startup.
+		_ = Task.Run(WarmUpAsync, CancellationToken.None);
+		return Task.CompletedTask;
+	}
+
+	public async Task StopAsync(CancellationToken cancellationToken) => await DisposeAsync();
+
+	public async ValueTask DisposeAsync()
+	{
+		_idleSlots.Writer.TryComplete();
+		foreach (var slot in _slots)
+		{
+			await CloseBrowserAsync(slot);
+		}
+
+		_playwright?.Dispose();
+		_playwright = null;
+		_meter.Dispose();
+	}
+
+	private async Task<T> LeaseAsync<T>(Func<BrowserSlot, Task<T>> render, CancellationToken cancellationToken)
+	{
+		var slot = await AcquireAsync(cancellationToken);
+		var isRecycleNeeded = false;
+		try
+		{
+			await EnsureLaunchedAsync(slot);
+
+			var renderStart = Stopwatch.GetTimestamp();
+			try
+			{
+				return await render(slot);
+			}
+			finally
+			{
+				_renderDuration.Record(Stopwatch.GetElapsedTime(renderStart).TotalMilliseconds);
+				slot.RenderCount++;
+				isRecycleNeeded = IsRecycleNeeded(slot);
+			}
+		}
+		finally
+		{
+			if (isRecycleNeeded)
+			{
+				// The replacement is launched after the response, off the request path; the slot returns once it is up.
+				_ = Task.Run(async () =>
+				{
+					await RecycleAsync(slot);
+					_idleSlots.Writer.TryWrite(slot);
+				}, CancellationToken.None);
+			}
+			else
+			{
+				_idleSlots.Writer.TryWrite(slot);
+			}
+		}
+	}
+
+	private async Task<BrowserSlot> AcquireAsync(CancellationToken cancellationToken)
+	{
+		if (_idleSlots.Reader.TryRead(out var idleSlot))
+		{
+			_queueWait.Record(0);
+			return idleSlot;
+		}
+
+		if (Interlocked.Increment(ref _queuedRenders) > _queueLimit)
+		{
+			Interlocked.Decrement(ref _queuedRenders);
+			_rejectedRenders.Add(1);
+			throw new InvalidOperationException($"All {Size} renderers are busy and {_queueLimit} renders are already queued.");
+		}
+
+		var waitStart = Stopwatch.GetTimestamp();
+		try
+		{
+			using var timeout = CancellationTokenSource.CreateLinkedTokenSource(cancellationToken);
+			timeout.CancelAfter(QueueTimeout);
+			return await _idleSlots.Reader.ReadAsync(timeout.Token);
+		}
+		catch (OperationCanceledException) when (!cancellationToken.IsCancellationRequested)
+		{
+			throw new TimeoutException($"No renderer became free within {QueueTimeout.TotalSeconds} seconds.");
+		}
+		finally
+		{
+			Interlocked.Decrement(ref _queuedRenders);
+			var waitMilliseconds = Stopwatch.GetElapsedTime(waitStart).TotalMilliseconds;
+			_queueWait.Record(waitMilliseconds);
+			_logger.LogDebug("Render waited {WaitMilliseconds:F0} ms for a browser", waitMilliseconds);
+		}
+	}
+
+	private async Task WarmUpAsync()
+	{
+		foreach (var slot in _slots)
+		{
+			if (!_idleSlots.Reader.TryRead(out var idleSlot))
+			{
+				return;
+			}
+
+			try
+			{
+				await EnsureLaunchedAsync(idleSlot);
+			}
+			catch (Exception ex)
+			{
+				_logger.LogWarning(ex, "Failed to launch a browser while warming up the pool");
+				_idleSlots.Writer.TryWrite(idleSlot);
+				return;
+			}
+
+			_idleSlots.Writer.TryWrite(idleSlot);
+		}
+
+		_logger.LogInformation("Browser pool warmed up with {Size} browsers", Size);
+	}
+
+	private async Task EnsureLaunchedAsync(BrowserSlot slot)
+	{
+		if (slot.Browser is { IsConnected: true } && !IsRecycleNeeded(slot))
+		{
+			return;
+		}
+
+		await CloseBrowserAsync(slot);
+
+		try
+		{
+			var playwright = await GetPlaywrightAsync();
+			var launchStart = Stopwatch.GetTimestamp();
+			slot.Browser = await playwright.Chromium.LaunchAsync(GetLaunchOptions());
+			slot.LaunchedAt = DateTimeOffset.UtcNow;
+			slot.RenderCount = 0;
+			Interlocked.Exchange(ref _consecutiveLaunchFailures, 0);
+			_logger.LogInformation("Launched pooled browser in {LaunchMilliseconds:F0} ms", Stopwatch.GetElapsedTime(launchStart).TotalMilliseconds);
+		}
+		catch
+		{
+			Interlocked.Increment(ref _consecutiveLaunchFailures);
+			throw;
+		}
+	}
+
+	private async Task RecycleAsync(BrowserSlot slot)
+	{
+		_logger.LogInformation("Recycling pooled browser after {RenderCount} renders", slot.RenderCount);
+		try
+		{
+			await EnsureLaunchedAsync(slot);
+		}
+		catch (Exception ex)
+		{
+			// The slot launches again on its next lease.
+			_logger.LogWarning(ex, "Failed to relaunch a recycled browser");
+		}
+	}
+
+	private bool IsRecycleNeeded(BrowserSlot slot) =>
+		slot.RenderCount >= RendersPerBrowser || DateTimeOffset.UtcNow - slot.LaunchedAt >= _maxBrowserAge;
+
+	private async Task<IPlaywright> GetPlaywrightAsync()
+	{
+		await _playwrightLock.WaitAsync();
+		try
+		{
+			return _playwright ??= await Playwright.CreateAsync();
+		}
+		finally
+		{
+			_playwrightLock.Release();
+		}
+	}
+
+	private static async Task ClosePageAsync(BrowserSlot slot)
+	{
+		try
+		{
+			if (slot.Page is not null)
+			{
+				await slot.Page.CloseAsync();
+			}
+		}
+		catch
+		{
+			// Closing fails when the browser is already gone.
+		}
+
+		slot.Page = null;
+	}
+
+	private async Task CloseBrowserAsync(BrowserSlot slot)
+	{
+		await ClosePageAsync(slot);
+		if (slot.Browser is null)
+		{
+			return;
+		}
+
+		try
+		{
+			await slot.Browser.CloseAsync();
+		}
+		catch (Exception ex)
+		{
+			_logger.LogDebug(ex, "Failed to close a pooled browser");
+		}
+
+		slot.Browser = null;
+	}
+
+	/// <summary>
+	/// Gets browser launch options with appropriate security settings.
+	/// When running as root (e.g., in Home Assistant addon), disables sandbox.
+	/// </summary>
+	private static BrowserTypeLaunchOptions GetLaunchOptions()
+	{
+		var options = new BrowserTypeLaunchOptions();
+
+		// Chromium doesn't allow running as root without --no-sandbox
+		// This is safe in containerized environments like HA addons
+		if (Environment.UserName == "root" || Environment.GetEnvironmentVariable("USER") == "root")
+		{
+			options.Args = new[] { "--no-sandbox", "--disable-setuid-sandbox" };
+		}
+
+		return options;
+	}
+
+	private sealed class BrowserSlot
+	{
+		public IBrowser? Browser { get; set; }
+
+		public IPage? Page { get; set; }
+
+		public DateTimeOffset LaunchedAt { get; set; }
+
+		public int RenderCount { get; set; }
+	}
+}
@@ -0,0 +1,37 @@
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// CRC-32 as used by zlib and Ethernet (reflected polynomial 0xEDB88320), computed the same way by the firmware.
+/// </summary>
+public static class Crc32
+{
+	private static readonly uint[] Table = CreateTable();
+
+	public static uint Update(uint crc, ReadOnlySpan<byte> data)
+	{
+		crc = ~crc;
+		foreach (var value in data)
+		{
+			crc = Table[(crc ^ value) & 0xFF] ^ (crc >> 8);
+		}
+
+		return ~crc;
+	}
+
+	private static uint[] CreateTable()
+	{
+		var table = new uint[256];
+		for (uint i = 0; i < table.Length; i++)
+		{
+			var crc = i;
+			for (var bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) != 0 ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+			}
+
+			table[i] = crc;
+		}
+
+		return table;
+	}
+}
@@ -1,6 +1,8 @@
 using System.Globalization;
 using System.Text;
 using System.Text.Json;
+using CSharpFunctionalExtensions;
+using Microsoft.Extensions.Caching.Memory;
 using QRCoder;
 
 namespace EPaperDashboard.Services.Rendering;
@@ -12,11 +14,16 @@ namespace EPaperDashboard.Services.Rendering;
 public sealed class DashboardHtmlRenderingService(
     HomeAssistantService homeAssistantService,
     ILogger<DashboardHtmlRenderingService> logger,
-    IWebHostEnvironment webHostEnvironment)
+    IWebHostEnvironment webHostEnvironment,
+    IMemoryCache cache)
 {
+    private static readonly TimeSpan CalendarCacheDuration = TimeSpan.FromMinutes(5);
+    private static readonly TimeSpan ForecastCacheDuration = TimeSpan.FromMinutes(15);
+
     private readonly HomeAssistantService _homeAssistantService = homeAssistantService;
     private readonly ILogger<DashboardHtmlRenderingService> _logger = logger;
     private readonly IWebHostEnvironment _env = webHostEnvironment;
+    private readonly IMemoryCache _cache = cache;
     private string? _cachedWidgetCss;
 
     // =============================================
@@ -258,81 +265,45 @@ public sealed class DashboardHtmlRenderingService(
         // Collect all entity IDs needed across all widgets
         var entityIds = CollectEntityIds(layout);
 
-        // Fetch all entity states in one call
-        if (entityIds.Count > 0)
-        {
-            var statesResult = await _homeAssistantService.FetchEntityStates(dashboardId, entityIds.ToArray());
-            if (statesResult.IsSuccess)
-            {
-                foreach (var state in statesResult.Value)
-                    data.EntityStates[state.EntityId] = state;
-            }
-            else
-            {
-                _logger.LogWarning("SSR: Failed to fetch entity states: {Error}", statesResult.Error);
-            }
-        }
+        // All requests are started at once; they share one Home Assistant connection and run concurrently.
+        var statesTask = entityIds.Count > 0
+            ? _homeAssistantService.FetchEntityStates(dashboardId, entityIds.ToArray())
+            : null;
 
         // Fetch todo items per widget
-        foreach (var widget in layout.Widgets.Where(w => w.Type == "todo"))
-        {
-            var entityId = GetStringProp(widget.Config, "entityId");
-            if (!string.IsNullOrEmpty(entityId))
-            {
-                var result = await _homeAssistantService.FetchTodoItems(dashboardId, entityId);
-                if (result.IsSuccess) data.TodoItems[entityId] = result.Value;
-            }
-        }
-
-        // Fetch calendar events per widget
-        foreach (var widget in layout.Widgets.Where(w => w.Type == "calendar"))
-        {
-            var entityId = GetStringProp(widget.Config, "entityId");
-            if (!string.IsNullOrEmpty(entityId))
-            {
-                var result = await _homeAssistantService.FetchCalendarEvents(dashboardId, entityId, 168);
-                if (result.IsSuccess) data.CalendarEvents[entityId] = result.Value;
-            }
-        }
-
-        // Fetch weather forecasts per widget
-        foreach (var widget in layout.Widgets.Where(w => w.Type == "weather-forecast"))
-        {
-            var entityId = GetStringProp(widget.Config, "entityId");
-            var forecastMode = GetStringProp(widget.Config, "forecastMode") ?? "daily";
-            var forecastType = forecastMode == "hourly" ? "hourly" : "daily";
-            if (!string.IsNullOrEmpty(entityId))
-            {
-                var result = await _homeAssistantService.FetchWeatherForecast(dashboardId, entityId, forecastType);
-                if (result.IsSuccess
-                    && result.Value.TryGetValue("forecast", out var forecastVal)
-                    && forecastVal is List<object?> forecastList)
-                {
-                    data.WeatherForecasts[entityId] = forecastList;
-                }
-            }
-        }
+        var todoTasks = GetWidgetEntityIds(layout, "todo")
+            .Select(async entityId => (entityId, result: await _homeAssistantService.FetchTodoItems(dashboardId, entityId)))
+            .ToList();
+
+        // Fetch calendar events per widget; they change slowly, so recent results are reused
+        var calendarTasks = GetWidgetEntityIds(layout, "calendar")
+            .Select(async entityId => (entityId, result: await GetOrFetchAsync(
+                $"calendar:{dashboardId}:{entityId}",
+                CalendarCacheDuration,
+                () => _homeAssistantService.FetchCalendarEvents(dashboardId, entityId, 168))))
+            .ToList();
+
+        // Fetch weather forecasts per widget; forecasts are updated hourly at most
+        var forecastTasks = layout.Widgets
+            .Where(w => w.Type == "weather-forecast")
+            .Select(w => (
+                entityId: GetStringProp(w.Config, "entityId"),
+                forecastType: GetStringProp(w.Config, "forecastMode") == "hourly" ? "hourly" : "daily"))
+            .Where(f => !string.IsNullOrEmpty(f.entityId))
+            .Distinct()
+            .Select(async f => (f.entityId, result: await GetOrFetchAsync(
+                $"forecast:{dashboardId}:{f.entityId}:{f.forecastType}",
+                ForecastCacheDuration,
+                () => _homeAssistantService.FetchWeatherForecast(dashboardId, f.entityId!, f.forecastType))))
+            .ToList();
 
         // Fetch RSS feed entries per widget
-        foreach (var widget in layout.Widgets.Where(w => w.Type == "rss-feed"))
-        {
-            var entityId = GetStringProp(widget.Config, "entityId");
-            if (!string.IsNullOrEmpty(entityId))
-            {
-                var result = await _homeAssistantService.FetchRssFeedEntries(dashboardId, entityId);
-                if (result.IsSuccess)
-                {
-                    data.RssFeedEntries[entityId] = result.Value;
-                    _logger.LogDebug("SSR: Fetched {Count} RSS entries for {EntityId}", result.Value.Count, entityId);
-                }
-                else
-                {
-                    _logger.LogWarning("SSR: Failed to fetch RSS entries for {EntityId}: {Error}", entityId, result.Error);
-                }
-            }
-        }
+        var rssTasks = GetWidgetEntityIds(layout, "rss-feed")
+            .Select(async entityId => (entityId, result: await _homeAssistantService.FetchRssFeedEntries(dashboardId, entityId)))
+            .ToList();
 
         // Fetch entity history for graph widgets
+        var historyTasks = new List<Task<Result<Dictionary<string, List<HistoryState>>, string>>>();
         foreach (var widget in layout.Widgets.Where(w => w.Type == "graph"))
         {
             if (widget.Config.TryGetProperty("series", out var series) && series.ValueKind == JsonValueKind.Array)
@@ -356,16 +327,67 @@ public sealed class DashboardHtmlRenderingService(
                         _ => 24
                     };
 
-                    var result = await _homeAssistantService.FetchEntityHistory(dashboardId, graphEntityIds, hours);
-                    if (result.IsSuccess)
-                    {
-                        foreach (var (entityId, states) in result.Value)
-                            data.HistoryData[entityId] = states;
-                    }
+                    historyTasks.Add(_homeAssistantService.FetchEntityHistory(dashboardId, graphEntityIds, hours));
                 }
             }
         }
 
+        if (statesTask != null)
+        {
+            var statesResult = await statesTask;
+            if (statesResult.IsSuccess)
+            {
+                foreach (var state in statesResult.Value)
+                    data.EntityStates[state.EntityId] = state;
+            }
+            else
+            {
+                _logger.LogWarning("SSR: Failed to fetch entity states: {Error}", statesResult.Error);
+            }
+        }
+
+        foreach (var (entityId, result) in await Task.WhenAll(todoTasks))
+        {
+            if (result.IsSuccess) data.TodoItems[entityId] = result.Value;
+        }
+
+        foreach (var (entityId, result) in await Task.WhenAll(calendarTasks))
+        {
+            if (result.IsSuccess) data.CalendarEvents[entityId] = result.Value;
+        }
+
+        foreach (var (entityId, result) in await Task.WhenAll(forecastTasks))
+        {
+            if (result.IsSuccess
+                && result.Value.TryGetValue("forecast", out var forecastVal)
+                && forecastVal is List<object?> forecastList)
+            {
+                data.WeatherForecasts[entityId!] = forecastList;
+            }
+        }
+
+        foreach (var (entityId, result) in await Task.WhenAll(rssTasks))
+        {
+            if (result.IsSuccess)
+            {
+                data.RssFeedEntries[entityId] = result.Value;
+                _logger.LogDebug("SSR: Fetched {Count} RSS entries for {EntityId}", result.Value.Count, entityId);
+            }
+            else
+            {
+                _logger.LogWarning("SSR: Failed to fetch RSS entries for {EntityId}: {Error}", entityId, result.Error);
+            }
+        }
+
+        foreach (var result in await Task.WhenAll(historyTasks))
+        {
+            if (result.IsSuccess)
+            {
+                foreach (var (entityId, states) in result.Value)
+                    data.HistoryData[entityId] = states;
+            }
+        }
+
         // Load inline SVG icon
         try
         {
@@ -381,6 +403,32 @@ public sealed class DashboardHtmlRenderingService(
         return data;
     }
 
+    private static IEnumerable<string> GetWidgetEntityIds(LayoutConfig layout, string widgetType) => layout.Widgets
+        .Where(w => w.Type == widgetType)
+        .Select(w => GetStringProp(w.Config, "entityId"))
+        .Where(id => !string.IsNullOrEmpty(id))
+        .Cast<string>()
+        .Distinct();
+
+    /// <summary>
+    /// Returns a recent successful result for <paramref name="key"/> or fetches it; failures are not cached.
+    /// </summary>
+    private async Task<Result<T, string>> GetOrFetchAsync<T>(string key, TimeSpan duration, Func<Task<Result<T, string>>> fetch)
+    {
+        if (_cache.TryGetValue<T>(key, out var cached) && cached is not null)
+        {
+            return cached;
+        }
+
+        var result = await fetch();
+        if (result.IsSuccess)
+        {
+            _cache.Set(key, result.Value, duration);
+        }
+
+        return result;
+    }
+
     private static HashSet<string> CollectEntityIds(LayoutConfig layout)
     {
         var ids = new HashSet<string>();
@@ -0,0 +1,132 @@
+using System.Text.Json;
+using CSharpFunctionalExtensions;
+using EPaperDashboard.Models;
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Utilities;
+using SixLabors.ImageSharp.Processing;
+using SixLabors.ImageSharp.Processing.Processors.Dithering;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Reason a dashboard could not be rendered, with the status code the render endpoints answer with.
+/// </summary>
+public sealed record RenderFailure(int StatusCode, string Message);
+
+/// <summary>
+/// Renders a dashboard into an image, either from its custom layout or from its Home Assistant page.
+/// Shared by the render endpoints and the background pre-rendering of scheduled frames.
+/// </summary>
+public sealed class DashboardImageRenderer(
+	IPageToImageRenderingService renderingService,
+	DashboardHtmlRenderingService dashboardHtmlRenderingService,
+	IDeploymentStrategy deploymentStrategy)
+{
+	private static readonly JsonSerializerOptions LayoutSerializerOptions = new()
+	{
+		PropertyNamingPolicy = JsonNamingPolicy.CamelCase,
+		WriteIndented = false
+	};
+
+	public Task<Result<IImage, RenderFailure>> RenderAsync(Dashboard dashboard, Size imageSize) =>
+		dashboard.RenderingMode == RenderingMode.Custom
+			? RenderCustomLayoutImage(dashboard, imageSize)
+			: RenderHomeAssistantImage(dashboard, imageSize);
+
+	/// <summary>
+	/// Renders the frame sent to devices: quantized to the panel colors, with every image row a device row.
+	/// </summary>
+	public async Task<Result<BlackRedWhitePlanes, RenderFailure>> RenderFrameAsync(Dashboard dashboard, Size imageSize, bool shouldDither) =>
+		(await RenderAsync(dashboard, imageSize))
+			.Map(image => image
+				.Quantize(Palettes.RedBlackWhite, GetDither(shouldDither))
+				.ToBlackRedWhitePlanes());
+
+	public static IDither? GetDither(bool shouldDither) =>
+		shouldDither ? KnownDitherings.JarvisJudiceNinke : null;
+
+	public static Maybe<Uri> GetDashboardUri(Dashboard dashboard, IDeploymentStrategy deploymentStrategy)
+	{
+		var host = dashboard.Host;
+		if (string.IsNullOrWhiteSpace(host) && deploymentStrategy.IsHomeAssistantAddon)
+		{
+			host = Constants.HomeAssistantCoreUrl;
+		}
+
+		return Uri.TryCreate(host, UriKind.Absolute, out var hostUri) &&
+			Uri.TryCreate(dashboard.Path, UriKind.Relative, out var pathUri)
+			? new Uri(hostUri, pathUri)
+			: Maybe.None;
+	}
+
+	private async Task<Result<IImage, RenderFailure>> RenderCustomLayoutImage(Dashboard dashboard, Size imageSize)
+	{
+		if (dashboard.LayoutConfig == null)
+		{
+			return new RenderFailure(StatusCodes.Status400BadRequest, "Dashboard has no layout configuration. Open the designer and create a layout first.");
+		}
+
+		try
+		{
+			// Serialize LayoutConfig object to JSON with camelCase naming for JavaScript compatibility
+			var layoutConfigJson = JsonSerializer.Serialize(dashboard.LayoutConfig, LayoutSerializerOptions);
+
+			var html = await dashboardHtmlRenderingService.RenderDashboardHtmlAsync(
+				dashboard.Id.ToString(),
+				layoutConfigJson);
+
+			var size = new Size(
+				dashboard.LayoutConfig.Width > 0 ? dashboard.LayoutConfig.Width : imageSize.Width,
+				dashboard.LayoutConfig.Height > 0 ? dashboard.LayoutConfig.Height : imageSize.Height);
+
+			var imageResult = await renderingService.RenderHtmlAsync(html, size);
+			return imageResult.IsSuccess
+				? Result.Success<IImage, RenderFailure>(imageResult.Value)
+				: new RenderFailure(StatusCodes.Status500InternalServerError, imageResult.Error);
+		}
+		catch (Exception ex)
+		{
+			return new RenderFailure(StatusCodes.Status500InternalServerError, $"Failed to render dashboard image: {ex.Message}");
+		}
+	}
+
+	private async Task<Result<IImage, RenderFailure>> RenderHomeAssistantImage(Dashboard dashboard, Size imageSize)
+	{
+		var dashboardInfo = GetDashboardInfo(dashboard, deploymentStrategy);
+		if (dashboardInfo.HasNoValue)
+		{
+			return new RenderFailure(StatusCodes.Status404NotFound, "Dashboard configuration incomplete. Ensure Host, Path, and Access Token are set.");
+		}
+
+		var authStrategy = new HassAuthStrategy(dashboardInfo.Value.Tokens);
+
+		var result = await renderingService.RenderDashboardAsync(dashboardInfo.Value.DashboardUri, imageSize, authStrategy);
+		return result.IsSuccess
+			? Result.Success<IImage, RenderFailure>(result.Value)
+			: new RenderFailure(StatusCodes.Status400BadRequest, result.Error);
+	}
+
+	private static Maybe<(Uri DashboardUri, HassTokens Tokens)> GetDashboardInfo(Dashboard dashboard, IDeploymentStrategy deploymentStrategy)
+	{
+		var host = dashboard.Host;
+		if (string.IsNullOrWhiteSpace(host) && deploymentStrategy.IsHomeAssistantAddon)
+		{
+			host = Constants.HomeAssistantCoreUrl;
+		}
+
+		if (string.IsNullOrWhiteSpace(dashboard.AccessToken)
+			|| !Uri.TryCreate(host, UriKind.Absolute, out var hostUri)
+			|| !Uri.TryCreate(dashboard.Path, UriKind.Relative, out var pathUri))
+		{
+			return Maybe.None;
+		}
+
+		var hassUrl = hostUri.AbsoluteUri.TrimEnd('/');
+
+		// For OAuth-generated long-lived tokens, ClientId is not used for auth
+		// Use ClientUri if configured, otherwise use the HA host URL as a placeholder
+		var clientId = EnvironmentConfiguration.ClientUri?.AbsoluteUri.TrimEnd('/') ?? hassUrl;
+
+		return (new Uri(hostUri, pathUri), new HassTokens(dashboard.AccessToken, "Bearer", hassUrl, clientId));
+	}
+}
@@ -0,0 +1,157 @@
+using System.Collections.Concurrent;
+using System.Diagnostics.Metrics;
+using CSharpFunctionalExtensions;
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Utilities;
+using LiteDB;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Identifies a response of the render endpoints; devices asking for the same key get the same bytes.
+/// </summary>
+public sealed record EncodedFrameKey(ObjectId DashboardId, Size ImageSize, string Format, bool ShouldDither);
+
+/// <summary>
+/// An encoded response body and its entity tag, without quotes; for binary frames the tag is the frame id.
+/// Binary frames keep their planes, which deltas and the frame history need.
+/// </summary>
+public sealed record EncodedFrame(byte[] Content, string ContentType, string EntityTag, string? Encoding = null, BlackRedWhitePlanes? Planes = null)
+{
+	public long Bytes => Content.Length + (Planes is null ? 0 : Planes.Black.Length + Planes.Red.Length);
+}
+
+/// <summary>
+/// Shares renders between devices showing the same dashboard. Concurrent requests for the same key wait for
+/// a single render, and its result is kept for a short time so that devices waking in a burst do not render again.
+/// The cache is bounded in bytes and evicts the entries closest to expiry first.
+/// </summary>
+public sealed class EncodedFrameCache : IDisposable
+{
+	private readonly ConcurrentDictionary<EncodedFrameKey, Task<Result<EncodedFrame, RenderFailure>>> _inFlight = new();
+	private readonly ConcurrentDictionary<EncodedFrameKey, (EncodedFrame Frame, DateTimeOffset ExpiresAt)> _entries = new();
+	private readonly object _storeLock = new();
+	private readonly TimeSpan _ttl;
+	private readonly long _maxBytes;
+	private readonly Meter _meter = new(BrowserPool.MeterName);
+	private readonly Counter<long> _hits;
+	private readonly Counter<long> _misses;
+	private readonly Counter<long> _coalesced;
+
+	private long _totalBytes;
+
+	public EncodedFrameCache()
+		: this(EnvironmentConfiguration.RenderCacheTtl, EnvironmentConfiguration.RenderCacheMaxBytes)
+	{
+	}
+
+	public EncodedFrameCache(TimeSpan ttl, long maxBytes)
+	{
+		_ttl = ttl;
+		_maxBytes = maxBytes;
+		_hits = _meter.CreateCounter<long>("render.cache.hits", description: "Responses served from the frame cache");
+		_misses = _meter.CreateCounter<long>("render.cache.misses", description: "Responses not found in the frame cache");
+		_coalesced = _meter.CreateCounter<long>("render.cache.coalesced", description: "Cache misses that waited for a render already in flight");
+		_meter.CreateObservableGauge("render.cache.size", () => Interlocked.Read(ref _totalBytes), "By", "Bytes held by the frame cache");
+	}
+
+	/// <summary>
+	/// Returns the cached frame for <paramref name="key"/>, joins the render in flight for it, or starts
+	/// <paramref name="render"/>. Failures are shared with the waiting requests but not cached.
+	/// </summary>
+	public async Task<Result<EncodedFrame, RenderFailure>> GetOrRenderAsync(EncodedFrameKey key, Func<Task<Result<EncodedFrame, RenderFailure>>> render)
+	{
+		if (_entries.TryGetValue(key, out var entry) && DateTimeOffset.UtcNow < entry.ExpiresAt)
+		{
+			_hits.Add(1);
+			return entry.Frame;
+		}
+
+		_misses.Add(1);
+		var completion = new TaskCompletionSource<Result<EncodedFrame, RenderFailure>>(TaskCreationOptions.RunContinuationsAsynchronously);
+		var flight = _inFlight.GetOrAdd(key, completion.Task);
+		if (flight != completion.Task)
+		{
+			_coalesced.Add(1);
+			return await flight;
+		}
+
+		try
+		{
+			var result = await render();
+
+			// A dashboard edit during the render removes the flight; its result is then stale and not cached.
+			if (result.IsSuccess && _inFlight.TryGetValue(key, out var current) && current == flight)
+			{
+				Store(key, result.Value);
+			}
+
+			completion.SetResult(result);
+			return result;
+		}
+		catch (Exception ex)
+		{
+			completion.SetException(ex);
+			throw;
+		}
+		finally
+		{
+			_inFlight.TryRemove(KeyValuePair.Create(key, flight));
+		}
+	}
+
+	/// <summary>
+	/// Drops the frames of a dashboard whose content or settings changed.
+	/// </summary>
+	public void Remove(ObjectId dashboardId)
+	{
+		foreach (var key in _inFlight.Keys.Where(k => k.DashboardId == dashboardId))
+		{
+			_inFlight.TryRemove(key, out _);
+		}
+
+		lock (_storeLock)
+		{
+			foreach (var key in _entries.Keys.Where(k => k.DashboardId == dashboardId))
+			{
+				RemoveEntry(key);
+			}
+		}
+	}
+
+	public void Dispose() => _meter.Dispose();
+
+	private void Store(EncodedFrameKey key, EncodedFrame frame)
+	{
+		if (_ttl <= TimeSpan.Zero || frame.Bytes > _maxBytes)
+		{
+			return;
+		}
+
+		lock (_storeLock)
+		{
+			var now = DateTimeOffset.UtcNow;
+			RemoveEntry(key);
+			foreach (var (expiredKey, _) in _entries.Where(e => e.Value.ExpiresAt <= now))
+			{
+				RemoveEntry(expiredKey);
+			}
+
+			while (_totalBytes + frame.Bytes > _maxBytes && !_entries.IsEmpty)
+			{
+				RemoveEntry(_entries.MinBy(e => e.Value.ExpiresAt).Key);
+			}
+
+			_entries[key] = (frame, now + _ttl);
+			Interlocked.Add(ref _totalBytes, frame.Bytes);
+		}
+	}
+
+	private void RemoveEntry(EncodedFrameKey key)
+	{
+		if (_entries.TryRemove(key, out var entry))
+		{
+			Interlocked.Add(ref _totalBytes, -entry.Frame.Bytes);
+		}
+	}
+}
@@ -0,0 +1,142 @@
+using System.Buffers;
+using EPaperDashboard.Models.Rendering;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Reads the body written by <see cref="BinaryFrameWriter.WriteDelta"/> while encoding it one region at a time.
+/// Only the region being read is held, in a buffer rented from the shared pool, so sending a delta does not
+/// allocate its whole body and the first region goes out before the later ones are encoded.
+/// The length is computed up front for Content-Length, and seeking to the start of a byte range
+/// encodes only the region the range starts in.
+/// </summary>
+public sealed class FrameDeltaStream : Stream
+{
+	private readonly BlackRedWhitePlanes _planes;
+	private readonly IReadOnlyList<FrameRegion> _regions;
+	private readonly string _encoding;
+	private readonly bool _hasChecksums;
+
+	// Segment 0 is the region count, segment i + 1 is region i; the last entry is the end of the body.
+	private readonly long[] _segmentStarts;
+	private readonly int _largestSegmentLength;
+
+	private byte[]? _buffer;
+	private int _bufferedSegment = -1;
+	private long _position;
+	private bool _isDisposed;
+
+	public FrameDeltaStream(BlackRedWhitePlanes planes, IReadOnlyList<FrameRegion> regions, string encoding, bool hasChecksums = false)
+	{
+		_planes = planes;
+		_regions = regions;
+		_encoding = encoding;
+		_hasChecksums = hasChecksums;
+
+		_segmentStarts = new long[regions.Count + 2];
+		_segmentStarts[1] = BinaryFrameWriter.DeltaHeaderLength;
+		_largestSegmentLength = BinaryFrameWriter.DeltaHeaderLength;
+		for (var i = 0; i < regions.Count; i++)
+		{
+			var length = BinaryFrameWriter.RegionHeaderLength
+				+ BinaryFrameWriter.GetBandLength(planes, regions[i].Row, regions[i].RowCount, encoding, hasChecksums);
+			_segmentStarts[i + 2] = _segmentStarts[i + 1] + length;
+			_largestSegmentLength = Math.Max(_largestSegmentLength, length);
+		}
+	}
+
+	public override bool CanRead => true;
+
+	public override bool CanSeek => true;
+
+	public override bool CanWrite => false;
+
+	public override long Length => _segmentStarts[^1];
+
+	public override long Position
+	{
+		get => _position;
+		set => _position = Math.Clamp(value, 0, Length);
+	}
+
+	public override int Read(Span<byte> buffer)
+	{
+		ObjectDisposedException.ThrowIf(_isDisposed, this);
+		var read = 0;
+		while (read < buffer.Length && _position < Length)
+		{
+			var index = Array.BinarySearch(_segmentStarts, _position);
+			var segment = index >= 0 ? index : ~index - 1;
+			var segmentBytes = EncodeSegment(segment);
+			var count = (int)Math.Min(buffer.Length - read, _segmentStarts[segment + 1] - _position);
+			segmentBytes.Slice((int)(_position - _segmentStarts[segment]), count).CopyTo(buffer[read..]);
+			read += count;
+			_position += count;
+		}
+
+		return read;
+	}
+
+	public override int Read(byte[] buffer, int offset, int count) => Read(buffer.AsSpan(offset, count));
+
+	// Encoding is CPU work on data already in memory, so the asynchronous reads complete synchronously.
+	public override ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default) =>
+		ValueTask.FromResult(Read(buffer.Span));
+
+	public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken) =>
+		Task.FromResult(Read(buffer.AsSpan(offset, count)));
+
+	public override long Seek(long offset, SeekOrigin origin)
+	{
+		Position = origin switch
+		{
+			SeekOrigin.Begin => offset,
+			SeekOrigin.Current => _position + offset,
+			SeekOrigin.End => Length + offset,
+			_ => throw new ArgumentOutOfRangeException(nameof(origin))
+		};
+		return _position;
+	}
+
+	public override void Flush()
+	{
+	}
+
+	public override void SetLength(long value) => throw new NotSupportedException();
+
+	public override void Write(byte[] buffer, int offset, int count) => throw new NotSupportedException();
+
+	protected override void Dispose(bool disposing)
+	{
+		_isDisposed = true;
+		if (_buffer is not null)
+		{
+			ArrayPool<byte>.Shared.Return(_buffer);
+			_buffer = null;
+		}
+
+		base.Dispose(disposing);
+	}
+
+	private ReadOnlySpan<byte> EncodeSegment(int segment)
+	{
+		var length = (int)(_segmentStarts[segment + 1] - _segmentStarts[segment]);
+		_buffer ??= ArrayPool<byte>.Shared.Rent(_largestSegmentLength);
+		if (segment != _bufferedSegment)
+		{
+			var stream = new MemoryStream(_buffer, 0, length);
+			if (segment == 0)
+			{
+				BinaryFrameWriter.WriteDeltaHeader(_regions.Count, stream);
+			}
+			else
+			{
+				BinaryFrameWriter.WriteRegion(_planes, _regions[segment - 1], _encoding, stream, _hasChecksums);
+			}
+
+			_bufferedSegment = segment;
+		}
+
+		return _buffer.AsSpan(0, length);
+	}
+}
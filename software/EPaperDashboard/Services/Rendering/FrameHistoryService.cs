@@ -0,0 +1,30 @@
+using System.Collections.Concurrent;
+using CSharpFunctionalExtensions;
+using EPaperDashboard.Models.Rendering;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Remembers the most recent frames sent to each device so that later requests can be answered with a delta.
+/// </summary>
+public sealed class FrameHistoryService
+{
+	private const int FramesPerDevice = 2;
+
+	private readonly ConcurrentDictionary<string, (string FrameId, BlackRedWhitePlanes Planes)[]> _frames = new();
+
+	public Maybe<BlackRedWhitePlanes> GetFrame(string apiKey, string frameId) =>
+		_frames.TryGetValue(apiKey, out var frames)
+			? frames.TryFirst(f => f.FrameId == frameId).Map(f => f.Planes)
+			: Maybe<BlackRedWhitePlanes>.None;
+
+	public void AddFrame(string apiKey, string frameId, BlackRedWhitePlanes planes) =>
+		_frames.AddOrUpdate(
+			apiKey,
+			_ => [(frameId, planes)],
+			(_, frames) => frames
+				.Where(f => f.FrameId != frameId)
+				.Prepend((frameId, planes))
+				.Take(FramesPerDevice)
+				.ToArray());
+}
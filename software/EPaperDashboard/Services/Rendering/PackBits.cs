@@ -0,0 +1,60 @@
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// PackBits run-length coding: a header byte n in 0..127 is followed by n + 1 literal bytes,
+/// a header byte n in -127..-1 is followed by one byte repeated 1 - n times.
+/// </summary>
+public static class PackBits
+{
+	private const int MaxRunLength = 128;
+
+	public static void Encode(ReadOnlySpan<byte> source, Stream destination) => WriteRuns(source, destination);
+
+	/// <summary>
+	/// Returns the number of bytes <see cref="Encode(ReadOnlySpan{byte}, Stream)"/> writes for <paramref name="source"/>.
+	/// </summary>
+	public static int GetEncodedLength(ReadOnlySpan<byte> source) => WriteRuns(source, null);
+
+	// Returns the encoded length; without a destination the runs are only counted.
+	private static int WriteRuns(ReadOnlySpan<byte> source, Stream? destination)
+	{
+		var length = 0;
+		var position = 0;
+		while (position < source.Length)
+		{
+			var runLength = 1;
+			while (position + runLength < source.Length
+				&& runLength < MaxRunLength
+				&& source[position + runLength] == source[position])
+			{
+				runLength++;
+			}
+
+			if (runLength > 1)
+			{
+				destination?.WriteByte((byte)(1 - runLength));
+				destination?.WriteByte(source[position]);
+				length += 2;
+				position += runLength;
+				continue;
+			}
+
+			var literalStart = position;
+			while (position < source.Length && position - literalStart < MaxRunLength)
+			{
+				if (position + 1 < source.Length && source[position] == source[position + 1])
+				{
+					break;
+				}
+
+				position++;
+			}
+
+			destination?.WriteByte((byte)(position - literalStart - 1));
+			destination?.Write(source[literalStart..position]);
+			length += 1 + position - literalStart;
+		}
+
+		return length;
+	}
+}
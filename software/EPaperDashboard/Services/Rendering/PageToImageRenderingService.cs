@@ -8,10 +8,12 @@ namespace EPaperDashboard.Services.Rendering;
 internal sealed class PageToImageRenderingService(
 	IHttpClientFactory httpClientFactory,
 	IImageFactory imageFactory,
+	BrowserPool browserPool,
 	ILogger<PageToImageRenderingService> logger) : IPageToImageRenderingService
 {
 	private readonly IHttpClientFactory _httpClientFactory = httpClientFactory;
 	private readonly IImageFactory _imageFactory = imageFactory;
+	private readonly BrowserPool _browserPool = browserPool;
 	private readonly ILogger<PageToImageRenderingService> _logger = logger;
 
 	public async Task<Health> GetHealth(Uri dashboardUri)
@@ -28,7 +30,7 @@ internal sealed class PageToImageRenderingService(
 		dashboardHealth.TapError(error => 
 			_logger.LogError(error, "Dashboard health check failed for {DashboardUri}", dashboardUri));
 
-		return new Health(true, dashboardHealth.GetValueOrDefault());
+		return new Health(_browserPool.IsAvailable, dashboardHealth.GetValueOrDefault());
 	}
 
 	public Task<Result<IImage>> RenderDashboardAsync(
@@ -41,22 +43,21 @@ internal sealed class PageToImageRenderingService(
 		
 		_logger.LogInformation("Attempting to render dashboard at {DashboardUri}", dashboardUri);
 		
-		using var playwright = await Playwright.CreateAsync();
-		await using var browser = await playwright.Chromium.LaunchAsync(GetLaunchOptions());
-		
-		var context = await browser.NewContextAsync(new BrowserNewContextOptions
-		{
-			ViewportSize = new ViewportSize { Width = size.Width, Height = size.Height }
-		});
-
-		var page = await context.NewPageAsync();
-		var dashboardPage = new DashboardPage(page, dashboardUri);
-
 		try
 		{
-			await authrorizationStrategy.AuthorizeAsync(dashboardPage);
-			
-			var screenshot = await dashboardPage.TakeScreenshotAsync();
+			var screenshot = await _browserPool.RenderAsync(async browser =>
+			{
+				// A context per render keeps the access tokens in local storage apart between dashboards.
+				await using var context = await browser.NewContextAsync(new BrowserNewContextOptions
+				{
+					ViewportSize = new ViewportSize { Width = size.Width, Height = size.Height }
+				});
+
+				var page = await context.NewPageAsync();
+				var dashboardPage = new DashboardPage(page, dashboardUri);
+				await authrorizationStrategy.AuthorizeAsync(dashboardPage);
+				return await dashboardPage.TakeScreenshotAsync();
+			});
 			
 			_logger.LogInformation("Successfully rendered dashboard {DashboardUri} ({Size} bytes)", 
 				dashboardUri, screenshot.Length);
@@ -75,43 +76,20 @@ internal sealed class PageToImageRenderingService(
 	{
 		Guard.NotNull(html);
 
-		using var playwright = await Playwright.CreateAsync();
-		await using var browser = await playwright.Chromium.LaunchAsync(GetLaunchOptions());
-
-		var context = await browser.NewContextAsync(new BrowserNewContextOptions
+		// The HTML carries its own data, so a page can be reused across renders.
+		var screenshot = await _browserPool.RenderPageAsync(size.Width, size.Height, async page =>
 		{
-			ViewportSize = new ViewportSize { Width = size.Width, Height = size.Height }
-		});
+			await page.SetContentAsync(html, new PageSetContentOptions
+			{
+				WaitUntil = WaitUntilState.NetworkIdle,
+				Timeout = 10000
+			});
 
-		var page = await context.NewPageAsync();
-		await page.SetContentAsync(html, new PageSetContentOptions
-		{
-			WaitUntil = WaitUntilState.NetworkIdle,
-			Timeout = 10000
+			return await page.ScreenshotAsync(new PageScreenshotOptions { Type = ScreenshotType.Png });
 		});
 
-		var screenshot = await page.ScreenshotAsync(new PageScreenshotOptions { Type = ScreenshotType.Png });
-
 		_logger.LogInformation("Rendered SSR HTML ({Size} bytes)", screenshot.Length);
 
 		return _imageFactory.Load(screenshot);
 	});
-
-	/// <summary>
-	/// Gets browser launch options with appropriate security settings.
-	/// When running as root (e.g., in Home Assistant addon), disables sandbox.
-	/// </summary>
-	private static BrowserTypeLaunchOptions GetLaunchOptions()
-	{
-		var options = new BrowserTypeLaunchOptions();
-		
-		// Chromium doesn't allow running as root without --no-sandbox
-		// This is safe in containerized environments like HA addons
-		if (Environment.UserName == "root" || Environment.GetEnvironmentVariable("USER") == "root")
-		{
-			options.Args = new[] { "--no-sandbox", "--disable-setuid-sandbox" };
-		}
-		
-		return options;
-	}
 }
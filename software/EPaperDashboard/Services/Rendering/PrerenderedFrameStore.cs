@@ -0,0 +1,64 @@
+using System.Collections.Concurrent;
+using CSharpFunctionalExtensions;
+using EPaperDashboard.Models.Rendering;
+using LiteDB;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// What a device asks the binary endpoint for; frames are pre-rendered per request shape.
+/// </summary>
+public sealed record FrameRequest(ObjectId DashboardId, Size ImageSize, bool ShouldDither);
+
+/// <summary>
+/// Frames rendered ahead of a scheduled device wake, together with the request shapes devices have used,
+/// so that the background pre-renderer knows what to render.
+/// </summary>
+public sealed class PrerenderedFrameStore
+{
+	private static readonly TimeSpan RequestRetention = TimeSpan.FromDays(7);
+
+	private readonly ConcurrentDictionary<FrameRequest, DateTimeOffset> _requests = new();
+	private readonly ConcurrentDictionary<FrameRequest, (BlackRedWhitePlanes Planes, DateTimeOffset ValidUntil)> _frames = new();
+
+	public void RecordRequest(FrameRequest request, DateTimeOffset now) => _requests[request] = now;
+
+	/// <summary>
+	/// Returns the request shapes seen recently and forgets older ones, e.g. of replaced devices.
+	/// </summary>
+	public IReadOnlyList<FrameRequest> GetRecentRequests(DateTimeOffset now)
+	{
+		foreach (var (request, lastSeen) in _requests)
+		{
+			if (now - lastSeen > RequestRetention)
+			{
+				_requests.TryRemove(request, out _);
+				_frames.TryRemove(request, out _);
+			}
+		}
+
+		return [.. _requests.Keys];
+	}
+
+	public void AddFrame(FrameRequest request, BlackRedWhitePlanes planes, DateTimeOffset validUntil) =>
+		_frames[request] = (planes, validUntil);
+
+	public bool HasFrameValidUntil(FrameRequest request, DateTimeOffset validUntil) =>
+		_frames.TryGetValue(request, out var frame) && frame.ValidUntil >= validUntil;
+
+	public Maybe<BlackRedWhitePlanes> GetFrame(FrameRequest request, DateTimeOffset now) =>
+		_frames.TryGetValue(request, out var frame) && now <= frame.ValidUntil
+			? frame.Planes
+			: Maybe<BlackRedWhitePlanes>.None;
+
+	/// <summary>
+	/// Drops the frames of a dashboard whose content or settings changed.
+	/// </summary>
+	public void RemoveFrames(ObjectId dashboardId)
+	{
+		foreach (var request in _frames.Keys.Where(r => r.DashboardId == dashboardId))
+		{
+			_frames.TryRemove(request, out _);
+		}
+	}
+}
@@ -0,0 +1,19 @@
+using EPaperDashboard.Models.Rendering;
+using EPaperDashboard.Utilities;
+using SixLabors.ImageSharp;
+using SixLabors.ImageSharp.Formats;
+
+namespace EPaperDashboard.Services.Rendering;
+
+/// <summary>
+/// Encodes every device row as a PackBits-coded black row followed by a PackBits-coded red row.
+/// Runs never cross a row, so the device can expand the stream into bands of any height.
+/// </summary>
+public sealed class BlackRedWhiteRleEncoder : ImageEncoder
+{
+	protected override void Encode<TPixel>(Image<TPixel> image, Stream stream, CancellationToken cancellationToken)
+	{
+		var planes = BlackRedWhitePlanes.FromImage(image);
+		BinaryFrameWriter.WriteRows(planes, 0, planes.Rows, FrameEncodings.Rle, stream);
+	}
+}
@@ -0,0 +1,116 @@
+using EPaperDashboard.Data;
+using EPaperDashboard.Models;
+using LiteDB;
+
+namespace EPaperDashboard.Services;
+
+/// <summary>
+/// Stores the wake cycle timings that devices upload with their frame requests and summarizes them per dashboard.
+/// </summary>
+public sealed class WakeTimingService(LiteDbContext dbContext)
+{
+    private const int SamplesPerDashboard = 500;
+    private static readonly int PhaseCount = Enum.GetValues<WakePhase>().Length;
+
+    private readonly LiteDbContext _dbContext = dbContext;
+
+    /// <summary>
+    /// Parses a report of the form <c>cycle;cycle;...</c> where each cycle lists the phase end times
+    /// followed by the band count, band write time and panel-on time, separated by commas. Firmware that
+    /// predates the panel-on time leaves it out. Malformed cycles are skipped.
+    /// </summary>
+    public int AddSamples(ObjectId dashboardId, string report)
+    {
+        var receivedAt = DateTimeOffset.UtcNow;
+        var samples = report
+            .Split(';', StringSplitOptions.RemoveEmptyEntries | StringSplitOptions.TrimEntries)
+            .Select(cycle => ParseCycle(dashboardId, receivedAt, cycle))
+            .OfType<WakeCycleSample>()
+            .ToList();
+
+        if (samples.Count == 0)
+        {
+            return 0;
+        }
+
+        _dbContext.WakeCycleSamples.InsertBulk(samples);
+        TrimSamples(dashboardId);
+        return samples.Count;
+    }
+
+    public IReadOnlyList<WakePhasePercentiles> GetPercentiles(ObjectId dashboardId)
+    {
+        var samples = _dbContext.WakeCycleSamples.Find(s => s.DashboardId == dashboardId).ToList();
+        return
+        [
+            .. Enum.GetValues<WakePhase>().Select(phase => WakePhasePercentiles.From(
+                phase.ToString(),
+                samples.Select(s => s.PhaseEndMilliseconds[(int)phase]))),
+            WakePhasePercentiles.From("BandWrite", samples.Select(s => s.BandWriteMilliseconds)),
+            WakePhasePercentiles.From("PanelOn", samples.Select(s => s.PanelOnMilliseconds))
+        ];
+    }
+
+    public void DeleteSamples(ObjectId dashboardId) =>
+        _dbContext.WakeCycleSamples.DeleteMany(s => s.DashboardId == dashboardId);
+
+    private void TrimSamples(ObjectId dashboardId)
+    {
+        var staleIds = _dbContext.WakeCycleSamples
+            .Query()
+            .Where(s => s.DashboardId == dashboardId)
+            .OrderByDescending(s => s.Id)
+            .Select(s => s.Id)
+            .Offset(SamplesPerDashboard)
+            .ToList();
+
+        foreach (var id in staleIds)
+        {
+            _dbContext.WakeCycleSamples.Delete(id);
+        }
+    }
+
+    private static WakeCycleSample? ParseCycle(ObjectId dashboardId, DateTimeOffset receivedAt, string cycle)
+    {
+        var values = cycle.Split(',');
+        if (values.Length != PhaseCount + 2 && values.Length != PhaseCount + 3)
+        {
+            return null;
+        }
+
+        var numbers = new int[values.Length];
+        for (var i = 0; i < values.Length; i++)
+        {
+            if (!int.TryParse(values[i], out numbers[i]) || numbers[i] < 0)
+            {
+                return null;
+            }
+        }
+
+        return new WakeCycleSample
+        {
+            DashboardId = dashboardId,
+            ReceivedAt = receivedAt,
+            PhaseEndMilliseconds = numbers[..PhaseCount],
+            BandCount = numbers[PhaseCount],
+            BandWriteMilliseconds = numbers[PhaseCount + 1],
+            PanelOnMilliseconds = numbers.Length > PhaseCount + 2 ? numbers[PhaseCount + 2] : 0
+        };
+    }
+}
+
+/// <summary>
+/// Percentiles in milliseconds over the cycles that reached the phase.
+/// </summary>
+public sealed record WakePhasePercentiles(string Phase, int Samples, int P50, int P90, int P99)
+{
+    public static WakePhasePercentiles From(string phase, IEnumerable<int> milliseconds)
+    {
+        var sorted = milliseconds.Where(ms => ms > 0).Order().ToArray();
+        return new(phase, sorted.Length, Percentile(sorted, 50), Percentile(sorted, 90), Percentile(sorted, 99));
+    }
+
+    // Nearest-rank percentile of an ascending array.
+    private static int Percentile(int[] sorted, int percentile) =>
+        sorted.Length == 0 ? 0 : sorted[Math.Max(0, (int)Math.Ceiling(percentile / 100.0 * sorted.Length) - 1)];
+}
@@ -3,4 +3,22 @@ namespace EPaperDashboard.Utilities;
 public static class HttpHeaderNames
 {
     public const string ApiKeyHeaderName = "X-Api-Key";
+
+    public const string FrameEncodingHeaderName = "X-Frame-Encoding";
+
+    public const string FrameDeltaHeaderName = "X-Frame-Delta";
+
+    public const string FrameChecksumHeaderName = "X-Frame-Checksum";
+
+    public const string FramePlanesHeaderName = "X-Frame-Planes";
+
+    public const string NextUpdateWaitHeaderName = "X-Next-Update-Wait-Seconds";
+
+    public const string UpdateScheduleHeaderName = "X-Update-Schedule";
+
+    public const string WakeTimingsHeaderName = "X-Wake-Timings";
+
+    public const string FirmwareVersionHeaderName = "X-Firmware-Version";
+
+    public const string FirmwareUpdateHeaderName = "X-Firmware-Update";
 }
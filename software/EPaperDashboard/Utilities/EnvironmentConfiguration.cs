@@ -10,6 +10,14 @@ public static class EnvironmentConfiguration
 	private const string StateSigningKeyKey = "STATE_SIGNING_KEY";
 	private const string DashboardScheduleCheckIntervalMinutesKey = "DASHBOARD_SCHEDULE_CHECK_INTERVAL_MINUTES";
 	private const string DashboardMissedScheduleToleranceMinutesKey = "DASHBOARD_MISSED_SCHEDULE_TOLERANCE_MINUTES";
+	private const string RenderBrowserPoolSizeKey = "RENDER_BROWSER_POOL_SIZE";
+	private const string RenderQueueLimitKey = "RENDER_QUEUE_LIMIT";
+	private const string RenderBrowserMaxAgeMinutesKey = "RENDER_BROWSER_MAX_AGE_MINUTES";
+	private const string FramePrerenderLeadSecondsKey = "FRAME_PRERENDER_LEAD_SECONDS";
+	private const string RenderCacheTtlSecondsKey = "RENDER_CACHE_TTL_SECONDS";
+	private const string RenderCacheMaxMegabytesKey = "RENDER_CACHE_MAX_MEGABYTES";
+	private const string FirmwareDeltaCacheTtlMinutesKey = "FIRMWARE_DELTA_CACHE_TTL_MINUTES";
+	private const string FirmwareDeltaCacheMaxMegabytesKey = "FIRMWARE_DELTA_CACHE_MAX_MEGABYTES";
 
 	private static readonly Lazy<JsonDocument?> _jsonConfig = new(LoadJsonConfig);
 
@@ -31,6 +39,30 @@ public static class EnvironmentConfiguration
 	private static readonly Lazy<TimeSpan> _dashboardMissedScheduleTolerance = new(() =>
 		TimeSpan.FromMinutes(GetIntFromEnvOrConfig(DashboardMissedScheduleToleranceMinutesKey, 15))); // 15 minutes default
 
+	private static readonly Lazy<int> _renderBrowserPoolSize = new(() =>
+		GetIntFromEnvOrConfig(RenderBrowserPoolSizeKey, 2));
+
+	private static readonly Lazy<int> _renderQueueLimit = new(() =>
+		GetIntFromEnvOrConfig(RenderQueueLimitKey, 32));
+
+	private static readonly Lazy<TimeSpan> _renderBrowserMaxAge = new(() =>
+		TimeSpan.FromMinutes(GetIntFromEnvOrConfig(RenderBrowserMaxAgeMinutesKey, 60))); // 1 hour default
+
+	private static readonly Lazy<TimeSpan> _framePrerenderLead = new(() =>
+		TimeSpan.FromSeconds(GetIntFromEnvOrConfig(FramePrerenderLeadSecondsKey, 60))); // 0 disables pre-rendering
+
+	private static readonly Lazy<TimeSpan> _renderCacheTtl = new(() =>
+		TimeSpan.FromSeconds(GetIntFromEnvOrConfig(RenderCacheTtlSecondsKey, 30))); // 0 only coalesces concurrent renders
+
+	private static readonly Lazy<long> _renderCacheMaxBytes = new(() =>
+		GetIntFromEnvOrConfig(RenderCacheMaxMegabytesKey, 64) * 1024L * 1024L);
+
+	private static readonly Lazy<TimeSpan> _firmwareDeltaCacheTtl = new(() =>
+		TimeSpan.FromMinutes(GetIntFromEnvOrConfig(FirmwareDeltaCacheTtlMinutesKey, 60))); // 0 only coalesces concurrent writes
+
+	private static readonly Lazy<long> _firmwareDeltaCacheMaxBytes = new(() =>
+		GetIntFromEnvOrConfig(FirmwareDeltaCacheMaxMegabytesKey, 16) * 1024L * 1024L);
+
 	private static readonly Lazy<string> _configDir = new(() => "/data");
 
 	private static readonly Lazy<bool> _isHomeAssistantAddon = new(() =>
@@ -51,10 +83,28 @@ public static class EnvironmentConfiguration
 
 	public static TimeSpan DashboardMissedScheduleTolerance => _dashboardMissedScheduleTolerance.Value;
 
+	public static int RenderBrowserPoolSize => _renderBrowserPoolSize.Value;
+
+	public static int RenderQueueLimit => _renderQueueLimit.Value;
+
+	public static TimeSpan RenderBrowserMaxAge => _renderBrowserMaxAge.Value;
+
+	public static TimeSpan FramePrerenderLead => _framePrerenderLead.Value;
+
+	public static TimeSpan RenderCacheTtl => _renderCacheTtl.Value;
+
+	public static long RenderCacheMaxBytes => _renderCacheMaxBytes.Value;
+
+	public static TimeSpan FirmwareDeltaCacheTtl => _firmwareDeltaCacheTtl.Value;
+
+	public static long FirmwareDeltaCacheMaxBytes => _firmwareDeltaCacheMaxBytes.Value;
+
 	public static string ConfigDir => _configDir.Value;
 
 	public static string DataProtectionKeysDir => Path.Combine(ConfigDir, "DataProtection-Keys");
 
+	public static string FirmwareDir => Path.Combine(ConfigDir, "firmware");
+
 	private static JsonDocument? LoadJsonConfig()
 	{
 		try
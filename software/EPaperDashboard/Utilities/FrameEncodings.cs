@@ -0,0 +1,24 @@
+namespace EPaperDashboard.Utilities;
+
+/// <summary>
+/// Encodings of the binary frame negotiated with the device through the <c>encoding</c> query parameter.
+/// Rows are sent in blocks of at most the device band height, either full bands or delta regions.
+/// The chosen encoding is reported back in the <see cref="HttpHeaderNames.FrameEncodingHeaderName"/> header.
+/// </summary>
+public static class FrameEncodings
+{
+    /// <summary>Interleaved black and red bytes, understood by every firmware version.</summary>
+    public const string Raw = "raw";
+
+    /// <summary>PackBits-coded black and red planes, one row at a time.</summary>
+    public const string Rle = "rle";
+
+    /// <summary>Uncompressed black rows of a band followed by its red rows, read by the device without copying.</summary>
+    public const string Planar = "planar";
+
+    /// <summary>Encodings the server may choose between when the device accepts several.</summary>
+    public static readonly IReadOnlyList<string> Negotiable = [Rle, Planar];
+
+    /// <summary>Checksum requested with the <c>checksum</c> query parameter: a little-endian CRC-32 after every band or region.</summary>
+    public const string Crc32Checksum = "crc32";
+}